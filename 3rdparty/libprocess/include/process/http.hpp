@@ -360,6 +360,12 @@ public:
     // was unable to continue reading!
     Future<Nothing> readerClosed() const;
 
+    // Returns Nothing once all the data written so far has been read,
+    // or once the read-end is closed. This allows the writer to apply
+    // backpressure, i.e., to produce data only as fast as the reader
+    // consumes it rather than buffering it in the pipe.
+    Future<Nothing> drained() const;
+
     // Comparison operators useful for checking connection equality.
     bool operator==(const Writer& other) const { return data == other.data; }
     bool operator!=(const Writer& other) const { return !(*this == other); }
@@ -407,6 +413,9 @@ private:
     // empty strings as they serve as a signal for end-of-file.
     std::queue<std::string> writes;
 
+    // Represents writers waiting for the unread writes to be read.
+    std::queue<Owned<Promise<Nothing>>> drains;
+
     // Signals when the read-end is closed before the write-end.
     Promise<Nothing> readerClosure;
 
@@ -981,6 +990,8 @@ private:
   friend Future<Connection> connect(
       const network::Address& address, Scheme scheme);
   friend Future<Connection> connect(const URL&);
+  friend Future<Connection> connect(
+      const network::Socket& socket, const network::Address& address);
 
   // Forward declaration.
   struct Data;
@@ -995,6 +1006,17 @@ Future<Connection> connect(const network::Address& address, Scheme scheme);
 Future<Connection> connect(const URL& url);
 
 
+/**
+ * Connects the given socket to the server at `address`. This allows
+ * connecting from a socket set up by the caller, e.g., one created in
+ * another network namespace. The scheme follows from the kind of the
+ * socket.
+ */
+Future<Connection> connect(
+    const network::Socket& socket,
+    const network::Address& address);
+
+
 namespace internal {
 
 Future<Nothing> serve(
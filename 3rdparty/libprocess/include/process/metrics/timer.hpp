@@ -87,6 +87,24 @@ public:
     return t;
   }
 
+  // Record a duration that was measured by the caller. This is useful
+  // for events that are not contiguous, e.g., the accumulated time of
+  // a phase which is interleaved with other work.
+  void record(const Duration& duration)
+  {
+    const T t(duration);
+
+    double value = 0.0;
+
+    synchronized (data->lock) {
+      data->lastValue = t.value();
+
+      value = data->lastValue.get();
+    }
+
+    push(value);
+  }
+
   // Time an asynchronous event.
   template <typename U>
   Future<U> time(const Future<U>& future)
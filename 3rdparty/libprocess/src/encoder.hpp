@@ -16,9 +16,12 @@
 #include <stdint.h>
 #include <time.h>
 
+#include <algorithm>
 #include <limits>
 #include <map>
 #include <sstream>
+#include <string>
+#include <utility>
 
 #include <process/http.hpp>
 #include <process/process.hpp>
@@ -28,6 +31,8 @@
 #include <stout/hashmap.hpp>
 #include <stout/numify.hpp>
 #include <stout/os.hpp>
+#include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 
 
 namespace process {
@@ -243,6 +248,16 @@ public:
     CHECK_LE(_size, static_cast<size_t>(std::numeric_limits<off_t>::max()));
   }
 
+  // Encodes the `_length` bytes of the file starting at `_offset`.
+  FileEncoder(int_fd _fd, off_t _offset, size_t _length)
+    : fd(_fd), size(_offset + static_cast<off_t>(_length)), index(_offset)
+  {
+    CHECK_GE(_offset, 0);
+    CHECK_LE(
+        _length,
+        static_cast<size_t>(std::numeric_limits<off_t>::max() - _offset));
+  }
+
   virtual ~FileEncoder()
   {
     CHECK_SOME(os::close(fd)) << "Failed to close file descriptor";
@@ -280,6 +295,138 @@ private:
   off_t index;
 };
 
+
+namespace internal {
+
+// Parses a single byte range of a file of the given size, i.e.,
+// "FIRST-LAST", "FIRST-" or "-SUFFIX" (see RFC 7233), into an offset
+// and a length. Returns None if the range is malformed, and a length
+// of zero if the range lies past the end of the file.
+inline Option<std::pair<off_t, size_t>> byteRange(
+    const std::string& spec,
+    off_t size)
+{
+  const size_t dash = spec.find('-');
+  if (dash == std::string::npos) {
+    return None();
+  }
+
+  const std::string first = strings::trim(spec.substr(0, dash));
+  const std::string last = strings::trim(spec.substr(dash + 1));
+
+  if (first.empty()) {
+    Try<uint64_t> suffix = numify<uint64_t>(last);
+    if (last.empty() || suffix.isError()) {
+      return None();
+    }
+
+    const off_t length =
+      static_cast<off_t>(std::min(suffix.get(), static_cast<uint64_t>(size)));
+
+    return std::make_pair(size - length, static_cast<size_t>(length));
+  }
+
+  Try<uint64_t> _first = numify<uint64_t>(first);
+  if (_first.isError()) {
+    return None();
+  }
+
+  uint64_t _last = std::numeric_limits<uint64_t>::max();
+  if (!last.empty()) {
+    Try<uint64_t> result = numify<uint64_t>(last);
+    if (result.isError() || result.get() < _first.get()) {
+      return None();
+    }
+
+    _last = result.get();
+  }
+
+  if (_first.get() >= static_cast<uint64_t>(size)) {
+    return std::make_pair(size, static_cast<size_t>(0));
+  }
+
+  _last = std::min(_last, static_cast<uint64_t>(size) - 1);
+
+  return std::make_pair(
+      static_cast<off_t>(_first.get()),
+      static_cast<size_t>(_last - _first.get() + 1));
+}
+
+} // namespace internal {
+
+
+// Returns the part of a file of the given size to send for a `PATH`
+// response to `request`, as an offset and a length, and updates the
+// status and the headers of `response` accordingly (see RFC 7233):
+//
+//   * A 'Content-Range' header set by the handler of the request (e.g.,
+//     to return a part of a file without copying it) selects that part.
+//   * Otherwise, a single byte range in the 'Range' header of the
+//     request turns a '200 OK' response into a '206 Partial Content'
+//     response for that range, or into a '416 Range Not Satisfiable'
+//     response if the range lies past the end of the file.
+//
+// NOTE: Requests for multiple ranges get the whole file, as allowed
+// by RFC 7233.
+inline std::pair<off_t, size_t> fileRange(
+    const http::Request& request,
+    http::Response* response,
+    off_t size)
+{
+  const std::pair<off_t, size_t> whole(0, static_cast<size_t>(size));
+
+  Option<std::pair<off_t, size_t>> range;
+
+  if (response->headers.contains("Content-Range")) {
+    const std::string& value = response->headers.at("Content-Range");
+
+    if (strings::startsWith(value, "bytes ")) {
+      range = internal::byteRange(
+          strings::split(value.substr(6), "/")[0], size);
+    }
+
+    if (range.isNone()) {
+      response->headers.erase("Content-Range");
+      return whole;
+    }
+  } else if (response->code == http::Status::OK) {
+    response->headers["Accept-Ranges"] = "bytes";
+
+    if (!request.headers.contains("Range")) {
+      return whole;
+    }
+
+    const std::string& value = request.headers.at("Range");
+
+    if (strings::startsWith(value, "bytes=") &&
+        !strings::contains(value, ",")) {
+      range = internal::byteRange(value.substr(6), size);
+    }
+
+    if (range.isNone()) {
+      return whole;
+    }
+  } else {
+    return whole;
+  }
+
+  if (range->second == 0) {
+    response->code = http::Status::REQUESTED_RANGE_NOT_SATISFIABLE;
+    response->status = http::Status::string(response->code);
+    response->headers["Content-Range"] = "bytes */" + stringify(size);
+    return range.get();
+  }
+
+  response->code = http::Status::PARTIAL_CONTENT;
+  response->status = http::Status::string(response->code);
+  response->headers["Content-Range"] =
+    "bytes " + stringify(range->first) + "-" +
+    stringify(range->first + static_cast<off_t>(range->second) - 1) + "/" +
+    stringify(size);
+
+  return range.get();
+}
+
 }  // namespace process {
 
 #endif // __ENCODER_HPP__
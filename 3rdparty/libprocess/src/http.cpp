@@ -423,13 +423,20 @@ Pipe::Writer Pipe::writer() const
 
 Future<string> Pipe::Reader::read()
 {
+  Option<string> write;
+  queue<Owned<Promise<Nothing>>> drains;
+
   synchronized (data->lock) {
     if (data->readEnd == Reader::CLOSED) {
       return Failure("closed");
     } else if (!data->writes.empty()) {
-      Future<string> future = data->writes.front();
+      write = std::move(data->writes.front());
       data->writes.pop();
-      return future;
+
+      // Extract the drains to complete once all writes have been read.
+      if (data->writes.empty()) {
+        std::swap(data->drains, drains);
+      }
     } else if (data->writeEnd == Writer::CLOSED) {
       return ""; // End-of-file.
     } else if (data->writeEnd == Writer::FAILED) {
@@ -440,6 +447,16 @@ Future<string> Pipe::Reader::read()
       return data->reads.back()->future();
     }
   }
+
+  // NOTE: We set the promises outside the critical section to avoid
+  // triggering callbacks that try to reacquire the lock.
+  while (!drains.empty()) {
+    drains.front()->set(Nothing());
+    drains.pop();
+  }
+
+  CHECK_SOME(write);
+  return write.get();
 }
 
 
@@ -469,6 +486,7 @@ bool Pipe::Reader::close()
   bool closed = false;
   bool notify = false;
   queue<Owned<Promise<string>>> reads;
+  queue<Owned<Promise<Nothing>>> drains;
 
   synchronized (data->lock) {
     if (data->readEnd == Reader::OPEN) {
@@ -477,8 +495,10 @@ bool Pipe::Reader::close()
         data->writes.pop();
       }
 
-      // Extract the pending reads so we can fail them.
+      // Extract the pending reads so we can fail them, and the
+      // drains so we can complete them.
       std::swap(data->reads, reads);
+      std::swap(data->drains, drains);
 
       closed = true;
       data->readEnd = Reader::CLOSED;
@@ -496,6 +516,11 @@ bool Pipe::Reader::close()
       reads.pop();
     }
 
+    while (!drains.empty()) {
+      drains.front()->set(Nothing());
+      drains.pop();
+    }
+
     if (notify) {
       data->readerClosure.set(Nothing());
     } else {
@@ -600,6 +625,19 @@ Future<Nothing> Pipe::Writer::readerClosed() const
 }
 
 
+Future<Nothing> Pipe::Writer::drained() const
+{
+  synchronized (data->lock) {
+    if (data->writes.empty() || data->readEnd == Reader::CLOSED) {
+      return Nothing();
+    }
+
+    data->drains.push(Owned<Promise<Nothing>>(new Promise<Nothing>()));
+    return data->drains.back()->future();
+  }
+}
+
+
 namespace header {
 
 Try<WWWAuthenticate> WWWAuthenticate::create(const string& value)
@@ -1415,15 +1453,26 @@ Future<Connection> connect(const network::Address& address, Scheme scheme)
     return Failure("Failed to create socket: " + socket.error());
   }
 
-  return socket->connect(address)
-    .then([socket, address]() -> Future<Connection> {
-      Try<network::Address> localAddress = socket->address();
+  return connect(socket.get(), address);
+}
+
+
+Future<Connection> connect(
+    const network::Socket& socket,
+    const network::Address& address)
+{
+  // Copy the socket so that it can be used in the continuation.
+  network::Socket _socket = socket;
+
+  return _socket.connect(address)
+    .then([_socket, address]() -> Future<Connection> {
+      Try<network::Address> localAddress = _socket.address();
       if (localAddress.isError()) {
         return Failure("Failed to get socket's local address: " +
             localAddress.error());
       }
 
-      return Connection(socket.get(), localAddress.get(), address);
+      return Connection(_socket, localAddress.get(), address);
     });
 }
 
@@ -1574,9 +1623,18 @@ Future<Nothing> sendfile(
     return send(socket, InternalServerError(body), request);
   }
 
+  // Honor the byte range requested by the client, if any.
+  const std::pair<off_t, size_t> range =
+    fileRange(*request, &response, s.st_size);
+
   // While the user is expected to properly set a 'Content-Type'
   // header, we'll fill in (or overwrite) 'Content-Length' header.
-  response.headers["Content-Length"] = stringify(s.st_size);
+  response.headers["Content-Length"] = stringify(range.second);
+
+  if (range.second == 0) {
+    os::close(fd.get());
+    return send(socket, response, request);
+  }
 
   // TODO(benh): If this is a TCP socket consider turning on TCP_CORK
   // for both sends and then turning it off.
@@ -1593,7 +1651,7 @@ Future<Nothing> sendfile(
     })
     .then([=]() mutable -> Future<Nothing> {
       // NOTE: the file descriptor gets closed by FileEncoder.
-      Encoder* encoder = new FileEncoder(fd.get(), s.st_size);
+      Encoder* encoder = new FileEncoder(fd.get(), range.first, range.second);
       return send(socket, encoder)
         .onAny([=]() {
           delete encoder;
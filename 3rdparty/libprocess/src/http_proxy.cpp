@@ -177,18 +177,24 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
         VLOG(1) << "Returning '404 Not Found' for directory '" << path << "'";
         socket_manager->send(NotFound(), request, socket);
       } else {
+        // Honor the byte range requested by the client, if any.
+        const std::pair<off_t, size_t> range =
+          fileRange(request, &response, s.st_size);
+
         // While the user is expected to properly set a 'Content-Type'
         // header, we fill in (or overwrite) 'Content-Length' header.
         stringstream out;
-        out << s.st_size;
+        out << range.second;
         response.headers["Content-Length"] = out.str();
 
-        if (s.st_size == 0) {
+        if (range.second == 0) {
+          os::close(fd);
           socket_manager->send(response, request, socket);
           return true; // All done, can process next request.
         }
 
-        VLOG(1) << "Sending file at '" << path << "' with length " << s.st_size;
+        VLOG(1) << "Sending file at '" << path << "' with length "
+                << range.second << " from offset " << range.first;
 
         // TODO(benh): Consider a way to have the socket manager turn
         // on TCP_CORK for both sends and then turn it off.
@@ -199,7 +205,7 @@ bool HttpProxy::process(const Future<Response>& future, const Request& request)
 
         // Note the file descriptor gets closed by FileEncoder.
         socket_manager->send(
-            new FileEncoder(fd, s.st_size),
+            new FileEncoder(fd, range.first, range.second),
             request.keepAlive,
             socket);
       }
@@ -593,6 +593,39 @@ TEST_P(HTTPTest, PipeReaderCloses)
 }
 
 
+TEST(HTTPTest, PipeDrained)
+{
+  http::Pipe pipe;
+  http::Pipe::Reader reader = pipe.reader();
+  http::Pipe::Writer writer = pipe.writer();
+
+  // An empty pipe is drained.
+  AWAIT_READY(writer.drained());
+
+  EXPECT_TRUE(writer.write("hello"));
+  EXPECT_TRUE(writer.write("world"));
+
+  // The pipe is drained only once all the writes have been read.
+  Future<Nothing> drained = writer.drained();
+  EXPECT_TRUE(drained.isPending());
+
+  AWAIT_EXPECT_EQ("hello", reader.read());
+  EXPECT_TRUE(drained.isPending());
+
+  AWAIT_EXPECT_EQ("world", reader.read());
+  AWAIT_READY(drained);
+
+  // Closing the read end drains the pipe.
+  EXPECT_TRUE(writer.write("!"));
+
+  drained = writer.drained();
+  EXPECT_TRUE(drained.isPending());
+
+  EXPECT_TRUE(reader.close());
+  AWAIT_READY(drained);
+}
+
+
 TEST_P(HTTPTest, Encode)
 {
   string unencoded = "a$&+,/:;=?@ \"<>#%{}|\\^~[]`\x19\x80\xFF";
@@ -528,6 +528,24 @@ TEST_F(MetricsTest, Timer)
 }
 
 
+TEST_F(MetricsTest, TimerRecord)
+{
+  metrics::Timer<Milliseconds> timer("test/timer");
+  EXPECT_EQ("test/timer_ms", timer.name());
+
+  AWAIT_READY(metrics::add(timer));
+
+  timer.record(Milliseconds(3));
+  timer.record(Milliseconds(5));
+
+  Future<double> value = timer.value();
+  AWAIT_READY(value);
+  EXPECT_DOUBLE_EQ(5.0, value.get());
+
+  AWAIT_READY(metrics::remove(timer));
+}
+
+
 static Future<int> advanceAndReturn()
 {
   Clock::advance(Seconds(1));
@@ -23,6 +23,8 @@
 // ONLY USEFUL AFTER RUNNING PROTOC.
 #include <mesos/allocator/allocator.pb.h>
 
+#include <mesos/authorizer/authorizer.hpp>
+
 #include <mesos/maintenance/maintenance.hpp>
 
 #include <mesos/quota/quota.hpp>
@@ -97,6 +99,13 @@ public:
       bool filterGpuResources = true,
       const Option<DomainInfo>& domain = None()) = 0;
 
+  /**
+   * Sets the authorizer used by the master, if any. The allocator may
+   * use it to authorize requests to its own HTTP endpoints. This is a
+   * no-op by default, for allocators without such endpoints.
+   */
+  virtual void setAuthorizer(const Option<Authorizer*>& authorizer) {}
+
   /**
    * Informs the allocator of the recovered state from the master.
    *
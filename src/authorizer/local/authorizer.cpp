@@ -413,6 +413,7 @@ public:
         case authorization::UPDATE_MAINTENANCE_SCHEDULE:
         case authorization::MODIFY_RESOURCE_PROVIDER_CONFIG:
         case authorization::PRUNE_IMAGES:
+        case authorization::VIEW_ALLOCATION_RUNS:
           aclObject.set_type(ACL::Entity::ANY);
 
           break;
@@ -702,6 +703,7 @@ public:
         case authorization::LAUNCH_STANDALONE_CONTAINER:
         case authorization::MARK_AGENT_GONE:
         case authorization::PRUNE_IMAGES:
+        case authorization::VIEW_ALLOCATION_RUNS:
         case authorization::REGISTER_AGENT:
         case authorization::REMOVE_NESTED_CONTAINER:
         case authorization::REMOVE_STANDALONE_CONTAINER:
@@ -920,6 +922,7 @@ public:
       case authorization::LAUNCH_STANDALONE_CONTAINER:
       case authorization::MARK_AGENT_GONE:
       case authorization::PRUNE_IMAGES:
+      case authorization::VIEW_ALLOCATION_RUNS:
       case authorization::REGISTER_AGENT:
       case authorization::REMOVE_NESTED_CONTAINER:
       case authorization::REMOVE_STANDALONE_CONTAINER:
@@ -1134,6 +1137,7 @@ public:
       case authorization::LAUNCH_STANDALONE_CONTAINER:
       case authorization::MARK_AGENT_GONE:
       case authorization::PRUNE_IMAGES:
+      case authorization::VIEW_ALLOCATION_RUNS:
       case authorization::REGISTER_AGENT:
       case authorization::REMOVE_NESTED_CONTAINER:
       case authorization::REMOVE_STANDALONE_CONTAINER:
@@ -1517,6 +1521,17 @@ private:
           acls_.push_back(acl_);
         }
 
+        return acls_;
+      case authorization::VIEW_ALLOCATION_RUNS:
+        foreach (const ACL::ViewAllocationRuns& acl,
+                 acls.view_allocation_runs()) {
+          GenericACL acl_;
+          acl_.subjects = acl.principals();
+          acl_.objects = acl.allocation_runs();
+
+          acls_.push_back(acl_);
+        }
+
         return acls_;
       case authorization::REGISTER_FRAMEWORK:
       case authorization::CREATE_VOLUME:
@@ -1703,6 +1718,12 @@ Option<Error> LocalAuthorizer::validate(const ACLs& acls)
     }
   }
 
+  foreach (const ACL::ViewAllocationRuns& acl, acls.view_allocation_runs()) {
+    if (acl.allocation_runs().type() == ACL::Entity::SOME) {
+      return Error("ACL.ViewAllocationRuns type must be either NONE or ANY");
+    }
+  }
+
   // TODO(alexr): Consider validating not only protobuf, but also the original
   // JSON in order to spot misspelled names. A misspelled action may affect
   // authorization result and hence lead to a security issue (e.g. when there
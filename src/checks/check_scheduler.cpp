@@ -0,0 +1,163 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "checks/check_scheduler.hpp"
+
+#include <random>
+
+#include <process/metrics/metrics.hpp>
+
+#include <stout/check.hpp>
+#include <stout/synchronized.hpp>
+
+using process::Future;
+using process::Owned;
+using process::Promise;
+
+using std::shared_ptr;
+
+namespace mesos {
+namespace internal {
+namespace checks {
+
+CheckScheduler::Permit::~Permit()
+{
+  scheduler->release(stopwatch.elapsed());
+}
+
+
+CheckScheduler* CheckScheduler::instance()
+{
+  // NOTE: The scheduler is intentionally leaked, as permits may still
+  // be returned to it while the process exits.
+  static CheckScheduler* scheduler = new CheckScheduler();
+  return scheduler;
+}
+
+
+Duration CheckScheduler::jitter(const Duration& interval)
+{
+  // NOTE: `os::random()` is not seeded, so the executors of an agent
+  // would all draw the same jitters. The generator is seeded once per
+  // process instead.
+  static std::mutex* mutex = new std::mutex();
+  static std::mt19937* generator = new std::mt19937(std::random_device()());
+
+  std::uniform_real_distribution<double> distribution(0.0, 1.0);
+
+  synchronized (mutex) {
+    return interval * CHECK_JITTER_FRACTION * distribution(*generator);
+  }
+}
+
+
+CheckScheduler::CheckScheduler()
+  : running(0),
+    metrics(this) {}
+
+
+CheckScheduler::~CheckScheduler() {}
+
+
+Future<shared_ptr<CheckScheduler::Permit>> CheckScheduler::acquire()
+{
+  synchronized (mutex) {
+    if (running < MAX_CONCURRENT_CHECKS) {
+      ++running;
+
+      metrics.check_queue_latency.record(Duration::zero());
+
+      return shared_ptr<Permit>(new Permit(this));
+    }
+
+    Owned<Waiter> waiter(new Waiter());
+    waiter->stopwatch.start();
+
+    waiters.push_back(waiter);
+
+    return waiter->promise.future();
+  }
+}
+
+
+void CheckScheduler::release(const Duration& latency)
+{
+  metrics.check_latency.record(latency);
+
+  Owned<Waiter> waiter;
+
+  synchronized (mutex) {
+    CHECK_GT(running, 0u);
+
+    if (waiters.empty()) {
+      --running;
+      return;
+    }
+
+    // The permit is handed over, so the number of running checks
+    // does not change.
+    waiter = waiters.front();
+    waiters.pop_front();
+  }
+
+  metrics.check_queue_latency.record(waiter->stopwatch.elapsed());
+
+  // NOTE: The promise is completed without holding the lock, as this
+  // runs the callbacks of the waiting checker, which might release the
+  // permit right away if the checker has terminated in the meantime.
+  waiter->promise.set(shared_ptr<Permit>(new Permit(this)));
+}
+
+
+CheckScheduler::Metrics::Metrics(CheckScheduler* scheduler)
+  : checks_queued(
+        "checker/checks_queued",
+        [scheduler]() {
+          synchronized (scheduler->mutex) {
+            return static_cast<double>(scheduler->waiters.size());
+          }
+        }),
+    checks_running(
+        "checker/checks_running",
+        [scheduler]() {
+          synchronized (scheduler->mutex) {
+            return static_cast<double>(scheduler->running);
+          }
+        }),
+    check_queue_latency("checker/check_queue_latency", Hours(1)),
+    check_latency("checker/check_latency", Hours(1))
+{
+  process::metrics::add(checks_queued);
+  process::metrics::add(checks_running);
+  process::metrics::add(check_queue_latency);
+  process::metrics::add(check_latency);
+}
+
+
+CheckScheduler::Metrics::~Metrics()
+{
+  process::metrics::remove(check_latency);
+  process::metrics::remove(check_queue_latency);
+
+  // Wait for the metrics to be removed to protect against asynchronous
+  // evaluation referencing a deleted object.
+  process::metrics::remove(checks_running).await();
+  process::metrics::remove(checks_queued).await();
+}
+
+} // namespace checks {
+} // namespace internal {
+} // namespace mesos {
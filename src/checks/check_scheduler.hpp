@@ -0,0 +1,133 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __CHECK_SCHEDULER_HPP__
+#define __CHECK_SCHEDULER_HPP__
+
+#include <cstddef>
+#include <deque>
+#include <memory>
+#include <mutex>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+
+#include <process/metrics/gauge.hpp>
+#include <process/metrics/timer.hpp>
+
+#include <stout/duration.hpp>
+#include <stout/stopwatch.hpp>
+
+namespace mesos {
+namespace internal {
+namespace checks {
+
+// Maximum number of checks performed concurrently by the checkers of a
+// process, e.g., by an executor for all of its tasks.
+constexpr size_t MAX_CONCURRENT_CHECKS = 32;
+
+// The first check of a checker is delayed by a random fraction, up to
+// this one, of its interval.
+constexpr double CHECK_JITTER_FRACTION = 0.1;
+
+
+// Schedules the checks performed by all checkers of a process, so that
+// tasks checked by the same executor do not all run their checks at the
+// same time. Checkers start at a random offset within their interval,
+// which keeps the checks of tasks launched together from staying in
+// step, while each checker still respects its interval. At most
+// `MAX_CONCURRENT_CHECKS` checks run at once; the others wait for a
+// permit in the order they became due.
+//
+// NOTE: The scheduler only coordinates the checkers of one process.
+// The executors of an agent each have their own, so there is no limit
+// on the checks performed concurrently across the agent.
+class CheckScheduler
+{
+public:
+  // A permit to perform a check, which is returned to the scheduler
+  // when it is destroyed, i.e., once the check completed or the checker
+  // was terminated.
+  class Permit
+  {
+  public:
+    ~Permit();
+
+  private:
+    friend class CheckScheduler;
+
+    Permit(CheckScheduler* _scheduler) : scheduler(_scheduler)
+    {
+      stopwatch.start();
+    }
+
+    CheckScheduler* scheduler;
+    Stopwatch stopwatch;
+  };
+
+  // Returns the scheduler shared by the checkers of this process.
+  static CheckScheduler* instance();
+
+  // Returns a random delay to add to the first check of a checker with
+  // the given interval.
+  static Duration jitter(const Duration& interval);
+
+  ~CheckScheduler();
+
+  // Returns a permit once the check can be performed.
+  process::Future<std::shared_ptr<Permit>> acquire();
+
+private:
+  CheckScheduler();
+
+  CheckScheduler(const CheckScheduler&) = delete;
+  CheckScheduler& operator=(const CheckScheduler&) = delete;
+
+  // Hands the permit of a completed check over to the next queued check,
+  // if any.
+  void release(const Duration& latency);
+
+  struct Waiter
+  {
+    process::Promise<std::shared_ptr<Permit>> promise;
+    Stopwatch stopwatch;
+  };
+
+  struct Metrics
+  {
+    explicit Metrics(CheckScheduler* scheduler);
+    ~Metrics();
+
+    process::metrics::Gauge checks_queued;
+    process::metrics::Gauge checks_running;
+
+    // The time checks waited for a permit, and took once they had one.
+    process::metrics::Timer<Milliseconds> check_queue_latency;
+    process::metrics::Timer<Milliseconds> check_latency;
+  };
+
+  std::mutex mutex;
+  std::deque<process::Owned<Waiter>> waiters;
+  size_t running;
+
+  Metrics metrics;
+};
+
+} // namespace checks {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __CHECK_SCHEDULER_HPP__
@@ -16,10 +16,14 @@
 
 #include "checks/checker_process.hpp"
 
+#include <algorithm>
+#include <condition_variable>
 #include <cstdint>
 #include <map>
 #include <memory>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <tuple>
 #include <vector>
 
@@ -30,12 +34,14 @@
 
 #include <mesos/agent/agent.hpp>
 
+#include <process/address.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/future.hpp>
 #include <process/io.hpp>
 #include <process/protobuf.hpp>
+#include <process/socket.hpp>
 #include <process/subprocess.hpp>
 #include <process/time.hpp>
 
@@ -43,6 +49,8 @@
 #include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/ip.hpp>
 #include <stout/jsonify.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
@@ -50,6 +58,7 @@
 #include <stout/recordio.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/strings.hpp>
+#include <stout/synchronized.hpp>
 #include <stout/try.hpp>
 #include <stout/unreachable.hpp>
 #include <stout/uuid.hpp>
@@ -96,6 +105,10 @@ constexpr char HTTP_CHECK_COMMAND[] = "curl.exe";
 constexpr char TCP_CHECK_COMMAND[] = "mesos-tcp-connect.exe";
 #endif // __WINDOWS__
 
+// Maximum number of redirects followed by HTTP checks, which matches
+// the default of `curl -L`.
+constexpr size_t MAX_HTTP_CHECK_REDIRECTS = 50;
+
 
 #ifdef __linux__
 // TODO(alexr): Instead of defining this ad-hoc clone function, provide a
@@ -159,6 +172,191 @@ getCustomCloneFunc(const Option<runtime::Plain>& plain)
 }
 
 
+#ifdef __linux__
+// A helper thread which stays in the network namespace of a task and
+// creates the sockets HTTP and TCP checks of the task connect from. A
+// socket keeps belonging to the namespace it was created in, so the
+// checks can be performed by the checker itself. As `setns` only
+// affects the calling thread, this leaves the libprocess worker threads
+// in their own namespace. The thread is shared by all checkers of the
+// task, and exits once none of them uses it anymore.
+class NetworkNamespaceHelper
+{
+public:
+  // Returns the helper for the network namespace of the given task,
+  // starting it if needed.
+  static Try<shared_ptr<NetworkNamespaceHelper>> get(pid_t taskPid);
+
+  ~NetworkNamespaceHelper()
+  {
+    synchronized (mutex) {
+      stopping = true;
+      condition.notify_all();
+    }
+
+    thread.join();
+  }
+
+  // The task whose network namespace the helper is in.
+  const pid_t taskPid;
+
+  // Creates a non-blocking stream socket in the network namespace.
+  Try<int_fd> socket(int domain)
+  {
+    synchronized (mutex) {
+      // Wait for the requests of other checkers to be answered.
+      while (request.isSome() || response.isSome()) {
+        synchronized_wait(&condition, &mutex);
+      }
+
+      request = domain;
+      condition.notify_all();
+
+      while (response.isNone()) {
+        synchronized_wait(&condition, &mutex);
+      }
+
+      Try<int_fd> fd = response.get();
+      response = None();
+      condition.notify_all();
+
+      return fd;
+    }
+
+    UNREACHABLE();
+  }
+
+private:
+  explicit NetworkNamespaceHelper(pid_t _taskPid)
+    : taskPid(_taskPid),
+      thread(&NetworkNamespaceHelper::run, this) {}
+
+  // Waits until the thread has entered the network namespace.
+  Try<Nothing> started()
+  {
+    synchronized (mutex) {
+      while (entered.isNone()) {
+        synchronized_wait(&condition, &mutex);
+      }
+
+      return entered.get();
+    }
+
+    UNREACHABLE();
+  }
+
+  void run()
+  {
+    Try<Nothing> setns = ns::setns(taskPid, "net", false);
+
+    synchronized (mutex) {
+      if (setns.isError()) {
+        entered = Error(
+            "Failed to enter the net namespace of task (pid: " +
+            stringify(taskPid) + "): " + setns.error());
+      } else {
+        entered = Nothing();
+      }
+
+      condition.notify_all();
+
+      if (setns.isError()) {
+        return;
+      }
+
+      while (true) {
+        while (!stopping && request.isNone()) {
+          synchronized_wait(&condition, &mutex);
+        }
+
+        if (stopping) {
+          return;
+        }
+
+        response = net::socket(
+            request.get(), SOCK_STREAM | SOCK_NONBLOCK | SOCK_CLOEXEC, 0);
+
+        request = None();
+        condition.notify_all();
+      }
+    }
+  }
+
+  std::mutex mutex;
+  std::condition_variable condition;
+
+  Option<Try<Nothing>> entered;
+  Option<int> request;
+  Option<Try<int_fd>> response;
+  bool stopping = false;
+
+  // NOTE: This is declared last, so that the thread is started once
+  // the other members are initialized.
+  std::thread thread;
+};
+
+
+Try<shared_ptr<NetworkNamespaceHelper>> NetworkNamespaceHelper::get(
+    pid_t taskPid)
+{
+  static std::mutex* mutex = new std::mutex();
+  static hashmap<pid_t, std::weak_ptr<NetworkNamespaceHelper>>* helpers =
+    new hashmap<pid_t, std::weak_ptr<NetworkNamespaceHelper>>();
+
+  synchronized (mutex) {
+    if (helpers->contains(taskPid)) {
+      shared_ptr<NetworkNamespaceHelper> helper = helpers->at(taskPid).lock();
+      if (helper) {
+        return helper;
+      }
+
+      helpers->erase(taskPid);
+    }
+
+    shared_ptr<NetworkNamespaceHelper> helper(
+        new NetworkNamespaceHelper(taskPid));
+
+    Try<Nothing> started = helper->started();
+    if (started.isError()) {
+      return Error(started.error());
+    }
+
+    (*helpers)[taskPid] = helper;
+
+    return helper;
+  }
+
+  UNREACHABLE();
+}
+#endif // __linux__
+
+
+// Returns the path to send the next request of an HTTP check to when
+// the server redirects it to `location`, or none if the redirect leaves
+// the checked server.
+static Option<string> redirectPath(
+    const check::Http& http,
+    const string& location)
+{
+  if (strings::startsWith(location, "/")) {
+    return location;
+  }
+
+  const string origin =
+    http.scheme + "://" + http.domain + ":" + stringify(http.port);
+
+  if (location == origin) {
+    return string("/");
+  }
+
+  if (strings::startsWith(location, origin + "/")) {
+    return location.substr(origin.size());
+  }
+
+  return None();
+}
+
+
 // Reads `ProcessIO::Data` records from a string containing "Record-IO"
 // data encoded in protobuf messages, and returns the stdout and stderr.
 //
@@ -252,7 +450,8 @@ CheckerProcess::CheckerProcess(
     name(_name),
     runtime(std::move(_runtime)),
     check(checkInfoToCheck(checkInfo, launcherDir, scheme, ipv6)),
-    paused(false)
+    paused(false),
+    waitingForPermit(false)
 {
   Try<Duration> create = Duration::create(checkInfo.delay_seconds());
   CHECK_SOME(create);
@@ -272,18 +471,43 @@ CheckerProcess::CheckerProcess(
 
 void CheckerProcess::initialize()
 {
-  scheduleNext(checkDelay);
+  // Jitter the first check so that the checks of tasks which are
+  // launched together do not keep running at the same time.
+  scheduleNext(checkDelay + CheckScheduler::jitter(checkInterval));
 }
 
 
 void CheckerProcess::finalize()
 {
+  // Let the helper thread exit if no other checker of the task uses it.
+  networkNamespaceHelper.reset();
+
   LOG(INFO) << "Stopped " << name << " for task '" << taskId << "'";
 }
 
 
 void CheckerProcess::performCheck()
 {
+  if (paused || waitingForPermit) {
+    return;
+  }
+
+  // Wait until the scheduler permits the check, which bounds the number
+  // of checks performed concurrently for all tasks of this process.
+  waitingForPermit = true;
+
+  CheckScheduler::instance()->acquire()
+    .onReady(defer(self(), &Self::_performCheck, lambda::_1));
+}
+
+
+void CheckerProcess::_performCheck(
+    const shared_ptr<CheckScheduler::Permit>& permit)
+{
+  waitingForPermit = false;
+
+  // The permit is returned once this function returns if the check
+  // is not performed, or once the check completes otherwise.
   if (paused) {
     return;
   }
@@ -321,6 +545,8 @@ void CheckerProcess::performCheck()
   // - G: The library uses Agent API to delegate running the command in a
   //   nested container on Linux.
   // - '-': Not implemented (nested command checks on Windows).
+  //
+  // Each check holds on to the permit of the scheduler until it completes.
   check.visit(
       [=](const check::Command& cmd) {
         Future<int> future = runtime.visit(
@@ -337,6 +563,7 @@ void CheckerProcess::performCheck()
               return nestedCommandCheck(cmd, nested);
             });
 
+        future.onAny([permit](const Future<int>&) {});
         future.onAny(defer(
             self(), &Self::processCommandCheckResult, stopwatch, lambda::_1));
       },
@@ -361,6 +588,7 @@ void CheckerProcess::performCheck()
               return httpCheck(http, None());
             });
 
+        future.onAny([permit](const Future<int>&) {});
         future.onAny(defer(
             self(), &Self::processHttpCheckResult, stopwatch, lambda::_1));
       },
@@ -385,6 +613,7 @@ void CheckerProcess::performCheck()
               return tcpCheck(tcp, None());
             });
 
+        future.onAny([permit](const Future<bool>&) {});
         future.onAny(
             defer(self(), &Self::processTcpCheckResult, stopwatch, lambda::_1));
       });
@@ -989,10 +1218,68 @@ void CheckerProcess::processCommandCheckResult(
 }
 
 
+Try<process::network::Socket> CheckerProcess::createSocket(
+    process::network::Address::Family family,
+    const Option<runtime::Plain>& plain)
+{
+  const process::network::internal::SocketImpl::Kind kind =
+    process::network::internal::SocketImpl::Kind::POLL;
+
+#ifdef __linux__
+  if (plain.isSome() &&
+      plain->taskPid.isSome() &&
+      std::find(plain->namespaces.begin(), plain->namespaces.end(), "net") !=
+        plain->namespaces.end()) {
+    // The helper is kept for the next checks, unless the task has
+    // changed (e.g., it is checked again after being restarted).
+    if (!networkNamespaceHelper ||
+        networkNamespaceHelper->taskPid != plain->taskPid.get()) {
+      Try<shared_ptr<NetworkNamespaceHelper>> helper =
+        NetworkNamespaceHelper::get(plain->taskPid.get());
+
+      if (helper.isError()) {
+        return Error(helper.error());
+      }
+
+      networkNamespaceHelper = helper.get();
+    }
+
+    Try<int_fd> fd = networkNamespaceHelper->socket(
+        family == process::network::Address::Family::INET6
+          ? AF_INET6
+          : AF_INET);
+
+    if (fd.isError()) {
+      return Error(fd.error());
+    }
+
+    Try<process::network::Socket> socket =
+      process::network::Socket::create(fd.get(), kind);
+
+    if (socket.isError()) {
+      os::close(fd.get());
+    }
+
+    return socket;
+  }
+#endif // __linux__
+
+  return process::network::Socket::create(family, kind);
+}
+
+
 Future<int> CheckerProcess::httpCheck(
     const check::Http& http,
     const Option<runtime::Plain>& plain)
 {
+  // Plain HTTP checks are sent by the checker itself, which saves forking
+  // `curl` for every check and lets consecutive checks reuse the same
+  // connection. HTTPS checks still use `curl`, which does not validate
+  // the server certificate.
+  if (http.scheme == "http") {
+    return inProcessHttpCheck(http, plain);
+  }
+
   const string url = http.scheme + "://" + http.domain + ":" +
                      stringify(http.port) + http.path;
 
@@ -1012,6 +1299,136 @@ Future<int> CheckerProcess::httpCheck(
 }
 
 
+Future<int> CheckerProcess::inProcessHttpCheck(
+    const check::Http& http,
+    const Option<runtime::Plain>& plain)
+{
+  process::http::Request request;
+  request.method = "GET";
+  request.url = process::http::URL(
+      http.scheme,
+      http.domain,
+      static_cast<uint16_t>(http.port),
+      http.path);
+  request.keepAlive = true;
+
+  VLOG(1) << "Sending " << name << " to '" << request.url << "'"
+          << " for task '" << taskId << "'";
+
+  const Duration timeout = checkTimeout;
+
+  return sendHttpCheck(http, request, plain)
+    .then(defer(
+        self(),
+        &Self::_inProcessHttpCheck,
+        http,
+        request,
+        plain,
+        lambda::_1,
+        0u))
+    .after(timeout, defer(self(), [=](Future<int> future) -> Future<int> {
+      future.discard();
+
+      // The request might still be in flight, so the connection
+      // cannot be used for the next check.
+      if (httpConnection.isSome()) {
+        httpConnection->disconnect();
+        httpConnection = None();
+      }
+
+      return Failure("HTTP check timed out after " + stringify(timeout));
+    }));
+}
+
+
+Future<process::http::Response> CheckerProcess::sendHttpCheck(
+    const check::Http& http,
+    const process::http::Request& request,
+    const Option<runtime::Plain>& plain)
+{
+  // Reuse the connection of the previous check, unless the server has
+  // closed it in the meantime.
+  if (httpConnection.isSome() && !httpConnection->disconnected().isPending()) {
+    httpConnection = None();
+  }
+
+  if (httpConnection.isSome()) {
+    process::http::Connection connection = httpConnection.get();
+
+    return connection.send(request)
+      .repair(defer(self(), [=](const Future<process::http::Response>&) {
+        // The server might have closed the idle connection while the
+        // request was being sent, so retry once on a new connection.
+        if (httpConnection == connection) {
+          httpConnection = None();
+        }
+
+        return sendHttpCheck(http, request, plain);
+      }));
+  }
+
+  Try<net::IP> ip = net::IP::parse(strings::trim(http.domain, "[]"));
+  if (ip.isError()) {
+    return Failure(
+        "Failed to parse the IP of '" + http.domain + "': " + ip.error());
+  }
+
+  const process::network::Address address =
+    process::network::inet::Address(ip.get(), static_cast<uint16_t>(http.port));
+
+  Try<process::network::Socket> socket = createSocket(address.family(), plain);
+  if (socket.isError()) {
+    return Failure("Failed to create socket: " + socket.error());
+  }
+
+  return process::http::connect(socket.get(), address)
+    .then(defer(self(), [=](process::http::Connection connection) {
+      httpConnection = connection;
+
+      return connection.send(request);
+    }));
+}
+
+
+Future<int> CheckerProcess::_inProcessHttpCheck(
+    const check::Http& http,
+    const process::http::Request& request,
+    const Option<runtime::Plain>& plain,
+    const process::http::Response& response,
+    size_t redirects)
+{
+  // Follow redirects like `curl -L` does, as long as they stay on the
+  // checked server. Otherwise the status code of the redirect is the
+  // result of the check.
+  if (response.code >= 300 &&
+      response.code < 400 &&
+      response.headers.contains("Location") &&
+      redirects < MAX_HTTP_CHECK_REDIRECTS) {
+    Option<string> path = redirectPath(http, response.headers.at("Location"));
+
+    if (path.isSome()) {
+      process::http::Request redirect = request;
+      redirect.url.path = path.get();
+
+      return sendHttpCheck(http, redirect, plain)
+        .then(defer(
+            self(),
+            &Self::_inProcessHttpCheck,
+            http,
+            redirect,
+            plain,
+            lambda::_1,
+            redirects + 1));
+    }
+  }
+
+  VLOG(1) << name << " for task '" << taskId << "' received status '"
+          << response.status << "'";
+
+  return static_cast<int>(response.code);
+}
+
+
 Future<int> CheckerProcess::_httpCheck(
     const vector<string>& cmdArgv,
     const Option<runtime::Plain>& plain)
@@ -1216,14 +1633,49 @@ Future<bool> CheckerProcess::tcpCheck(
     const check::Tcp& tcp,
     const Option<runtime::Plain>& plain)
 {
-  const string command = path::join(tcp.launcherDir, TCP_CHECK_COMMAND);
+  // The checker connects to the port itself instead of launching
+  // `mesos-tcp-connect` for every check.
+  Try<net::IP> ip = net::IP::parse(tcp.domain);
+  if (ip.isError()) {
+    return Failure(
+        "Failed to parse the IP of '" + tcp.domain + "': " + ip.error());
+  }
 
-  const vector<string> argv = {
-    command,
-    "--ip=" + tcp.domain,
-    "--port=" + stringify(tcp.port)
-  };
-  return _tcpCheck(argv, plain);
+  const process::network::Address address =
+    process::network::inet::Address(ip.get(), static_cast<uint16_t>(tcp.port));
+
+  Try<process::network::Socket> socket = createSocket(address.family(), plain);
+  if (socket.isError()) {
+    return Failure("Failed to create socket: " + socket.error());
+  }
+
+  VLOG(1) << "Connecting to " << address << " for " << name
+          << " of task '" << taskId << "'";
+
+  // TODO(alexr): Use lambda named captures for
+  // these cached values once they are available.
+  process::network::Socket _socket = socket.get();
+  const string _name = name;
+  const Duration timeout = checkTimeout;
+  const TaskID _taskId = taskId;
+
+  // NOTE: The socket is captured so that it is only closed once the
+  // connection attempt completes.
+  return _socket.connect(address)
+    .then([_socket]() { return true; })
+    .repair([_name, _taskId](const Future<bool>& future) {
+      VLOG(1) << _name << " for task '" << _taskId << "' failed to connect: "
+              << (future.isFailed() ? future.failure() : "discarded");
+
+      // We cannot distinguish between a system error and an actual
+      // connection failure, hence treat all of them as the latter.
+      return false;
+    })
+    .after(timeout, [timeout](Future<bool> future) -> Future<bool> {
+      future.discard();
+
+      return Failure("TCP connection timed out after " + stringify(timeout));
+    });
 }
 
 Future<bool> CheckerProcess::_tcpCheck(
@@ -27,6 +27,7 @@
 #include <process/future.hpp>
 #include <process/http.hpp>
 #include <process/protobuf.hpp>
+#include <process/socket.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/option.hpp>
@@ -34,6 +35,7 @@
 #include <stout/try.hpp>
 #include <stout/variant.hpp>
 
+#include "checks/check_scheduler.hpp"
 #include "checks/checks_runtime.hpp"
 #include "checks/checks_types.hpp"
 
@@ -47,6 +49,10 @@ namespace checks {
 constexpr char DOCKER_HEALTH_CHECK_IMAGE[] = "microsoft/powershell:nanoserver";
 #endif // __WINDOWS__
 
+// Forward declaration.
+class NetworkNamespaceHelper;
+
+
 class CheckerProcess : public ProtobufProcess<CheckerProcess>
 {
 public:
@@ -79,6 +85,7 @@ protected:
 
 private:
   void performCheck();
+  void _performCheck(const std::shared_ptr<CheckScheduler::Permit>& permit);
   void scheduleNext(const Duration& duration);
   void processCheckResult(
       const Stopwatch& stopwatch,
@@ -129,9 +136,28 @@ private:
       const Stopwatch& stopwatch,
       const process::Future<int>& future);
 
+  // Creates a socket to connect to the task from, in the network
+  // namespace of the task if the check has to enter it.
+  Try<process::network::Socket> createSocket(
+      process::network::Address::Family family,
+      const Option<runtime::Plain>& plain);
+
   process::Future<int> httpCheck(
       const check::Http& http,
       const Option<runtime::Plain>& plain);
+  process::Future<int> inProcessHttpCheck(
+      const check::Http& http,
+      const Option<runtime::Plain>& plain);
+  process::Future<process::http::Response> sendHttpCheck(
+      const check::Http& http,
+      const process::http::Request& request,
+      const Option<runtime::Plain>& plain);
+  process::Future<int> _inProcessHttpCheck(
+      const check::Http& http,
+      const process::http::Request& request,
+      const Option<runtime::Plain>& plain,
+      const process::http::Response& response,
+      size_t redirects);
   process::Future<int> _httpCheck(
       const std::vector<std::string>& cmdArgv,
       const Option<runtime::Plain>& plain);
@@ -186,9 +212,22 @@ private:
 
   bool paused;
 
+  // Whether a check is waiting for a permit of the `CheckScheduler`.
+  // Checks due in the meantime (e.g., when checking is resumed) are
+  // skipped, as the waiting check continues the checking loop.
+  bool waitingForPermit;
+
   // Contains the ID of the most recently terminated nested container
   // that was used to perform a COMMAND check.
   Option<ContainerID> previousCheckContainerId;
+
+  // The connection HTTP checks are sent over. It is kept across checks
+  // until the server closes it or a check times out.
+  Option<process::http::Connection> httpConnection;
+
+  // The helper thread which creates the sockets of HTTP and TCP checks
+  // in the network namespace of the task, if the check enters it.
+  std::shared_ptr<NetworkNamespaceHelper> networkNamespaceHelper;
 };
 
 } // namespace checks {
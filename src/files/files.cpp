@@ -20,13 +20,19 @@
 
 #include <sys/stat.h>
 
+#ifdef __linux__
+#include <sys/inotify.h>
+#endif // __linux__
+
 #include <algorithm>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <boost/shared_array.hpp>
 
+#include <process/after.hpp>
 #include <process/defer.hpp>
 #include <process/deferred.hpp> // TODO(benh): This is required by Clang.
 #include <process/dispatch.hpp>
@@ -34,9 +40,12 @@
 #include <process/help.hpp>
 #include <process/http.hpp>
 #include <process/io.hpp>
+#include <process/loop.hpp>
 #include <process/mime.hpp>
 #include <process/process.hpp>
 
+#include <stout/bytes.hpp>
+#include <stout/duration.hpp>
 #include <stout/error.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/json.hpp>
@@ -73,8 +82,12 @@ using http::OK;
 
 using mesos::Authorizer;
 
+using process::after;
 using process::AUTHENTICATION;
 using process::AUTHORIZATION;
+using process::Break;
+using process::Continue;
+using process::ControlFlow;
 using process::defer;
 using process::DESCRIPTION;
 using process::Failure;
@@ -95,6 +108,100 @@ using std::vector;
 namespace mesos {
 namespace internal {
 
+// How often, and for how long at most, a `follow` read waits for the
+// file to grow past the requested offset.
+constexpr Duration FOLLOW_INTERVAL = Milliseconds(100);
+constexpr Duration FOLLOW_TIMEOUT = Seconds(30);
+
+// The most data a `/files/tail` stream reads from the file at a time.
+constexpr Bytes TAIL_CHUNK_SIZE = Kilobytes(64);
+
+
+namespace {
+
+// The state of a `/files/tail` stream, which keeps the file open for
+// as long as the client reads from it.
+struct Tail
+{
+  Tail(int_fd _fd,
+       const Option<int_fd>& _watch,
+       const http::Pipe::Writer& _writer)
+    : fd(_fd),
+      watch(_watch),
+      writer(_writer),
+      buffer(new char[TAIL_CHUNK_SIZE.bytes()]) {}
+
+  ~Tail()
+  {
+    os::close(fd);
+
+    if (watch.isSome()) {
+      os::close(watch.get());
+    }
+  }
+
+  const int_fd fd;
+
+  // An inotify instance watching the file, if available. Otherwise,
+  // the stream polls the file for new data.
+  const Option<int_fd> watch;
+
+  http::Pipe::Writer writer;
+  std::unique_ptr<char[]> buffer;
+
+  // The offset the stream has read up to.
+  off_t offset = 0;
+
+  // Whether the file has been removed or renamed (e.g., rotated).
+  bool removed = false;
+
+  // Waiting for the file to change once its end has been reached.
+  Future<Nothing> waiting;
+};
+
+
+#ifdef __linux__
+// Consumes the pending events of the inotify instance watching the
+// file of a stream, and returns whether the file was removed or moved.
+Try<bool> readEvents(int_fd watch)
+{
+  char buffer[4096]
+    __attribute__ ((aligned(__alignof__(struct inotify_event))));
+
+  bool removed = false;
+
+  while (true) {
+    ssize_t length = ::read(watch, buffer, sizeof(buffer));
+
+    if (length < 0 && errno == EINTR) {
+      continue;
+    } else if (length < 0 && (errno == EAGAIN || errno == EWOULDBLOCK)) {
+      break;
+    } else if (length < 0) {
+      return ErrnoError("Failed to read inotify events");
+    } else if (length == 0) {
+      break;
+    }
+
+    for (char* event = buffer; event < buffer + length;) {
+      const struct inotify_event* inotify =
+        reinterpret_cast<const struct inotify_event*>(event);
+
+      if (inotify->mask & (IN_DELETE_SELF | IN_MOVE_SELF | IN_IGNORED)) {
+        removed = true;
+      }
+
+      event += sizeof(struct inotify_event) + inotify->len;
+    }
+  }
+
+  return removed;
+}
+#endif // __linux__
+
+} // namespace {
+
+
 class FilesProcess : public Process<FilesProcess>
 {
 public:
@@ -158,6 +265,31 @@ private:
       const http::Request& request,
       const Option<Principal>& principal);
 
+  // Returns the raw contents of a file starting at a given offset and
+  // for a given length, which are sent directly from the file rather
+  // than copied into the response.
+  Future<http::Response> _readRaw(
+      const Option<size_t>& offset,
+      const Option<size_t>& length,
+      const string& path);
+
+  // Returns once the file is larger than `offset`, or after `timeout`.
+  Future<Nothing> follow(
+      const string& path,
+      size_t offset,
+      const Duration& timeout);
+
+  // Streams the data of a file from a given offset, including the data
+  // appended to it afterwards, until the client closes the connection.
+  Future<http::Response> tail(
+      const http::Request& request,
+      const Option<Principal>& principal);
+
+  Future<http::Response> _tail(size_t offset, const string& path);
+
+  // Waits for the file of a stream to change once its end is reached.
+  Future<Nothing> wait(const std::shared_ptr<Tail>& tail);
+
   // Returns the raw file contents for a given path.
   // Requests have the following parameters:
   //   path: The directory to browse. Required.
@@ -175,6 +307,7 @@ private:
   const static string BROWSE_HELP;
   const static string READ_HELP;
   const static string DOWNLOAD_HELP;
+  const static string TAIL_HELP;
   const static string DEBUG_HELP;
 
   hashmap<string, string> paths;
@@ -227,6 +360,13 @@ void FilesProcess::initialize()
       return download(request, principal);
     };
 
+    auto tail_ = [this](
+        const http::Request& request,
+        const Option<Principal>& principal) {
+      logRequest(request);
+      return tail(request, principal);
+    };
+
     auto debug_ = [this](
         const http::Request& request,
         const Option<Principal>& principal) {
@@ -265,6 +405,10 @@ void FilesProcess::initialize()
           authenticationRealm.get(),
           FilesProcess::DOWNLOAD_HELP,
           download_);
+    route("/tail",
+          authenticationRealm.get(),
+          FilesProcess::TAIL_HELP,
+          tail_);
     route("/debug",
           authenticationRealm.get(),
           FilesProcess::DEBUG_HELP,
@@ -285,6 +429,11 @@ void FilesProcess::initialize()
       return download(request, None());
     };
 
+    auto tail_ = [this](const http::Request& request) {
+      logRequest(request);
+      return tail(request, None());
+    };
+
     auto debug_ = [this](const http::Request& request) {
       logRequest(request);
       return debug(request, None());
@@ -300,6 +449,7 @@ void FilesProcess::initialize()
     route("/browse", FilesProcess::BROWSE_HELP, browse_);
     route("/read", FilesProcess::READ_HELP, read_);
     route("/download", FilesProcess::DOWNLOAD_HELP, download_);
+    route("/tail", FilesProcess::TAIL_HELP, tail_);
     route("/debug", FilesProcess::DEBUG_HELP, debug_);
   }
 }
@@ -503,12 +653,27 @@ const string FilesProcess::READ_HELP = HELP(
         "This endpoint reads data from a file at a given offset and for",
         "a given length."
         "",
+        "By default, the data is returned in a JSON object along with the",
+        "offset, and at most 16 pages are returned at a time. With",
+        "`raw=true`, the data is returned as is, without any limit on its",
+        "length, as a '206 Partial Content' response if an offset or a",
+        "length is given. A 'Range' header can be used instead of these",
+        "to request a single byte range of the file. A raw read past the",
+        "end of the file returns '416 Range Not Satisfiable' along with",
+        "the size of the file.",
+        "",
+        "With `follow=true`, a read at or past the end of the file waits",
+        "up to " + stringify(FOLLOW_TIMEOUT) + " for the file to grow",
+        "before returning.",
+        "",
         "Query parameters:",
         "",
         ">        path=VALUE          The path of directory to browse.",
         ">        offset=VALUE        Value added to base address to obtain "
         "a second address",
-        ">        length=VALUE        Length of file to read."),
+        ">        length=VALUE        Length of file to read.",
+        ">        raw=(true|false)    Whether to return the raw data.",
+        ">        follow=(true|false) Whether to wait for new data."),
     AUTHENTICATION(true),
     AUTHORIZATION(
         "Reading files requires that the request principal is",
@@ -573,6 +738,31 @@ Future<http::Response> FilesProcess::__read(
     }
   }
 
+  const bool raw = request.url.query.get("raw").getOrElse("") == "true";
+  const bool follow = request.url.query.get("follow").getOrElse("") == "true";
+
+  if (raw) {
+    Option<size_t> offset_;
+    if (offset != -1) {
+      offset_ = offset;
+    }
+
+    return authorize(path.get(), principal)
+      .then(defer(self(),
+          [=](bool authorized) -> Future<http::Response> {
+        if (!authorized) {
+          return Forbidden();
+        }
+
+        if (!follow) {
+          return _readRaw(offset_, length, path.get());
+        }
+
+        return this->follow(path.get(), offset_.getOrElse(0), FOLLOW_TIMEOUT)
+          .then(defer(self(), &Self::_readRaw, offset_, length, path.get()));
+      }));
+  }
+
   size_t offset_ = offset;
 
   // The pailer in the webui sends `offset=-1` initially to determine the length
@@ -585,7 +775,25 @@ Future<http::Response> FilesProcess::__read(
 
   Option<string> jsonp = request.url.query.get("jsonp");
 
-  return read(offset_, length, path.get(), principal)
+  Future<Try<tuple<size_t, string>, FilesError>> data;
+
+  if (follow && offset != -1) {
+    data = authorize(path.get(), principal)
+      .then(defer(self(),
+          [=](bool authorized)
+            -> Future<Try<tuple<size_t, string>, FilesError>> {
+        if (!authorized) {
+          return FilesError(FilesError::Type::UNAUTHORIZED);
+        }
+
+        return this->follow(path.get(), offset_, FOLLOW_TIMEOUT)
+          .then(defer(self(), &Self::_read, offset_, length, path.get()));
+      }));
+  } else {
+    data = read(offset_, length, path.get(), principal);
+  }
+
+  return data
     .then([offset, jsonp](const Try<tuple<size_t, string>, FilesError>& result)
         -> Future<http::Response> {
       if (result.isError()) {
@@ -734,6 +942,80 @@ Future<Try<tuple<size_t, string>, FilesError>> FilesProcess::_read(
 }
 
 
+Future<http::Response> FilesProcess::_readRaw(
+    const Option<size_t>& offset,
+    const Option<size_t>& length,
+    const string& path)
+{
+  Result<string> resolvedPath = resolve(path);
+
+  if (resolvedPath.isError()) {
+    return BadRequest(resolvedPath.error() + ".\n");
+  } else if (!resolvedPath.isSome()) {
+    return NotFound();
+  }
+
+  // Don't read directories.
+  if (os::stat::isdir(resolvedPath.get())) {
+    return BadRequest("Cannot read a directory.\n");
+  }
+
+  if (length == 0u) {
+    return OK();
+  }
+
+  OK response;
+  response.type = response.PATH;
+  response.path = resolvedPath.get();
+  response.headers["Content-Type"] = "application/octet-stream";
+
+  // Let libprocess send the requested part of the file, after checking
+  // it against the size of the file at that time (see `Content-Range`
+  // handling of `PATH` responses). Without an offset or a length, a
+  // 'Range' header in the request is honored instead.
+  if (offset.isSome() || length.isSome()) {
+    const size_t first = offset.getOrElse(0);
+
+    string range = "bytes " + stringify(first) + "-";
+    if (length.isSome()) {
+      range += stringify(first + length.get() - 1);
+    }
+
+    response.headers["Content-Range"] = range + "/*";
+  }
+
+  return response;
+}
+
+
+Future<Nothing> FilesProcess::follow(
+    const string& path,
+    size_t offset,
+    const Duration& timeout)
+{
+  // Errors are left for the subsequent read to report.
+  Result<string> resolvedPath = resolve(path);
+  if (!resolvedPath.isSome()) {
+    return Nothing();
+  }
+
+  Try<Bytes> size = os::stat::size(resolvedPath.get());
+  if (size.isError() ||
+      size->bytes() > offset ||
+      timeout <= FOLLOW_INTERVAL) {
+    return Nothing();
+  }
+
+  return after(FOLLOW_INTERVAL)
+    .then(defer(
+        self(),
+        &Self::follow,
+        path,
+        offset,
+        timeout - FOLLOW_INTERVAL));
+}
+
+
 const string FilesProcess::DOWNLOAD_HELP = HELP(
     TLDR(
         "Returns the raw file contents for a given path."),
@@ -815,6 +1097,244 @@ Future<http::Response> FilesProcess::_download(const string& path)
 }
 
 
+const string FilesProcess::TAIL_HELP = HELP(
+    TLDR(
+        "Streams the contents of a file as they are appended to it."),
+    DESCRIPTION(
+        "This endpoint returns the contents of a file from a given offset",
+        "in a chunked response which stays open after the end of the file",
+        "is reached, and carries the data appended to the file afterwards.",
+        "The file is read as fast as the client consumes the response.",
+        "",
+        "The response ends if the file is removed or renamed (e.g., when",
+        "it is rotated). If the file is truncated, it is streamed again",
+        "from its beginning.",
+        "",
+        "Query parameters:",
+        "",
+        ">        path=VALUE          The path of the file to stream.",
+        ">        offset=VALUE        The offset to stream the file from."),
+    AUTHENTICATION(true),
+    AUTHORIZATION(
+        "Streaming files requires that the request principal is",
+        "authorized to do so for the target virtual file path.",
+        "",
+        "Authorizers may categorize different virtual paths into",
+        "different ACLs, e.g. logs in one and task sandboxes in",
+        "another.",
+        "",
+        "See authorization documentation for details."));
+
+
+Future<http::Response> FilesProcess::tail(
+    const http::Request& request,
+    const Option<Principal>& principal)
+{
+  Option<string> path = request.url.query.get("path");
+
+  if (!path.isSome() || path->empty()) {
+    return BadRequest("Expecting 'path=value' in query.\n");
+  }
+
+  size_t offset = 0;
+
+  if (request.url.query.get("offset").isSome()) {
+    Try<size_t> result = numify<size_t>(request.url.query.get("offset").get());
+
+    if (result.isError()) {
+      return BadRequest("Failed to parse offset: " + result.error() + ".\n");
+    }
+
+    offset = result.get();
+  }
+
+  return authorize(path.get(), principal)
+    .then(defer(self(),
+        [this, offset, path](bool authorized) -> Future<http::Response> {
+      if (authorized) {
+        return _tail(offset, path.get());
+      }
+
+      return Forbidden();
+    }));
+}
+
+
+Future<http::Response> FilesProcess::_tail(size_t offset, const string& path)
+{
+  Result<string> resolvedPath = resolve(path);
+
+  if (resolvedPath.isError()) {
+    return BadRequest(resolvedPath.error() + ".\n");
+  } else if (!resolvedPath.isSome()) {
+    return NotFound();
+  }
+
+  // Don't stream directories.
+  if (os::stat::isdir(resolvedPath.get())) {
+    return BadRequest("Cannot stream a directory.\n");
+  }
+
+  Try<int_fd> fd = os::open(resolvedPath.get(), O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    string error = strings::format(
+        "Failed to open file at '%s': %s",
+        resolvedPath.get(),
+        fd.error()).get();
+    LOG(WARNING) << error;
+    return InternalServerError(error + ".\n");
+  }
+
+  Try<off_t> lseek = os::lseek(fd.get(), static_cast<off_t>(offset), SEEK_SET);
+  if (lseek.isError()) {
+    string error = strings::format(
+        "Failed to seek file at '%s': %s",
+        resolvedPath.get(),
+        lseek.error()).get();
+    LOG(WARNING) << error;
+    os::close(fd.get());
+    return InternalServerError(error + ".\n");
+  }
+
+  Try<Nothing> nonblock = os::nonblock(fd.get());
+  if (nonblock.isError()) {
+    string error =
+      "Failed to set file descriptor nonblocking: " + nonblock.error();
+    LOG(WARNING) << error;
+    os::close(fd.get());
+    return InternalServerError(error + ".\n");
+  }
+
+  // Watch the file so that new data is pushed as soon as it is written
+  // rather than when the file is next polled.
+  Option<int_fd> watch;
+
+#ifdef __linux__
+  int inotify = ::inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+
+  if (inotify >= 0 &&
+      ::inotify_add_watch(
+          inotify,
+          resolvedPath->c_str(),
+          IN_MODIFY | IN_DELETE_SELF | IN_MOVE_SELF) >= 0) {
+    watch = inotify;
+  } else {
+    LOG(WARNING) << "Failed to watch file at '" << resolvedPath.get()
+                 << "', polling it instead: " << os::strerror(errno);
+
+    if (inotify >= 0) {
+      os::close(inotify);
+    }
+  }
+#endif // __linux__
+
+  http::Pipe pipe;
+
+  std::shared_ptr<Tail> tail(new Tail(fd.get(), watch, pipe.writer()));
+  tail->offset = lseek.get();
+
+  // Stop waiting for the file to change once the client goes away.
+  std::weak_ptr<Tail> weak = tail;
+  tail->writer.readerClosed()
+    .onAny(defer(self(), [weak](const Future<Nothing>&) {
+      std::shared_ptr<Tail> tail = weak.lock();
+      if (tail) {
+        tail->waiting.discard();
+      }
+    }));
+
+  process::loop(
+      self(),
+      [tail]() {
+        return io::read(
+            tail->fd,
+            tail->buffer.get(),
+            TAIL_CHUNK_SIZE.bytes());
+      },
+      [this, tail](size_t length) -> Future<ControlFlow<Nothing>> {
+        if (length > 0) {
+          tail->offset += length;
+
+          if (!tail->writer.write(string(tail->buffer.get(), length))) {
+            return Break(); // The client went away.
+          }
+
+          // Only read more data once the client has consumed this chunk.
+          return tail->writer.drained()
+            .then([]() -> ControlFlow<Nothing> { return Continue(); });
+        }
+
+        if (tail->removed) {
+          return Break();
+        }
+
+        return wait(tail)
+          .then([]() -> ControlFlow<Nothing> { return Continue(); });
+      })
+    .onAny([tail](const Future<Nothing>& future) {
+      if (future.isFailed()) {
+        LOG(WARNING) << "Failed to stream file: " << future.failure();
+      }
+
+      tail->writer.close();
+    });
+
+  OK response;
+  response.type = response.PIPE;
+  response.reader = pipe.reader();
+  response.headers["Content-Type"] = "application/octet-stream";
+
+  return response;
+}
+
+
+Future<Nothing> FilesProcess::wait(const std::shared_ptr<Tail>& tail)
+{
+  // Stream the file again if it was truncated (e.g., when rotated by
+  // copying and truncating it).
+  Try<off_t> size = os::lseek(tail->fd, 0, SEEK_END);
+  if (size.isError()) {
+    return Failure(size.error());
+  }
+
+  if (size.get() < tail->offset) {
+    tail->offset = 0;
+  }
+
+  Try<off_t> lseek = os::lseek(tail->fd, tail->offset, SEEK_SET);
+  if (lseek.isError()) {
+    return Failure(lseek.error());
+  }
+
+  if (size.get() != tail->offset) {
+    return Nothing();
+  }
+
+#ifdef __linux__
+  if (tail->watch.isSome()) {
+    tail->waiting = io::poll(tail->watch.get(), io::READ)
+      .then([tail]() -> Future<Nothing> {
+        Try<bool> removed = readEvents(tail->watch.get());
+        if (removed.isError()) {
+          return Failure(removed.error());
+        }
+
+        // Read whatever was written before the file was removed.
+        tail->removed = removed.get();
+
+        return Nothing();
+      });
+
+    return tail->waiting;
+  }
+#endif // __linux__
+
+  tail->waiting = after(FOLLOW_INTERVAL);
+
+  return tail->waiting;
+}
+
+
 const string FilesProcess::DEBUG_HELP = HELP(
     TLDR(
         "Returns the internal virtual path mapping."),
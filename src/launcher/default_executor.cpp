@@ -31,16 +31,20 @@
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/id.hpp>
+#include <process/loop.hpp>
 #include <process/owned.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
 
 #include <stout/flags.hpp>
 #include <stout/fs.hpp>
+#include <stout/hashmap.hpp>
 #include <stout/lambda.hpp>
 #include <stout/linkedhashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
+#include <stout/recordio.hpp>
+#include <stout/result.hpp>
 #include <stout/uuid.hpp>
 
 #include "checks/checker.hpp"
@@ -49,6 +53,7 @@
 
 #include "common/http.hpp"
 #include "common/protobuf_utils.hpp"
+#include "common/recordio.hpp"
 #include "common/status_utils.hpp"
 
 #include "internal/devolve.hpp"
@@ -61,12 +66,16 @@ using mesos::executor::Event;
 
 using mesos::v1::executor::Mesos;
 
+using process::Break;
 using process::Clock;
+using process::Continue;
+using process::ControlFlow;
 using process::Future;
 using process::Owned;
 using process::UPID;
 
 using process::http::Connection;
+using process::http::Pipe;
 using process::http::Request;
 using process::http::Response;
 using process::http::URL;
@@ -104,9 +113,10 @@ private:
     // Health checker for the container.
     Option<Owned<checks::HealthChecker>> healthChecker;
 
-    // Connection used for waiting on the child container. It is possible
-    // that a container is active but a connection for sending the
-    // `WAIT_NESTED_CONTAINER` call has not been established yet.
+    // Connection used for waiting on the child container. The child
+    // containers waited on by the same `WAIT_CONTAINERS` call share the
+    // connection. It is possible that a container is active but a
+    // connection for sending the call has not been established yet.
     Option<Connection> waiting;
 
     // Error returned by the agent while trying to launch the container.
@@ -331,9 +341,9 @@ protected:
     // Send all unacknowledged tasks. We don't send tasks whose container
     // didn't launch yet, because the agent will learn about once it launches.
     // We also don't send unacknowledged terminated (and hence already removed
-    // from `containers`) tasks, because for such tasks `WAIT_NESTED_CONTAINER`
-    // call has already succeeded, meaning the agent knows about the tasks and
-    // corresponding containers.
+    // from `containers`) tasks, because for such tasks the `WAIT_CONTAINERS`
+    // call has already reported their termination, meaning the agent knows
+    // about the tasks and corresponding containers.
     foreachvalue (const Owned<Container>& container, containers) {
       if (container->launched && !container->acknowledged) {
         subscribe->add_unacknowledged_tasks()->MergeFrom(container->taskInfo);
@@ -506,20 +516,30 @@ protected:
       responses.push_back(post(connection.get(), call));
     }
 
+    // Establish the connection for waiting on the child containers
+    // while they are being launched. All the child containers of the
+    // task group are waited on by a single streaming `WAIT_CONTAINERS`
+    // call, see `__wait()`.
+    Future<Connection> waiting = process::http::connect(agent);
+
     process::collect(responses)
       .onAny(defer(self(),
                    &Self::__launchGroup,
                    taskGroup,
                    containerIds,
                    connection.get(),
-                   lambda::_1));
+                   lambda::_1,
+                   waiting,
+                   connectionId.get()));
   }
 
   void __launchGroup(
       const TaskGroupInfo& taskGroup,
       const list<ContainerID>& containerIds,
       const Connection& connection,
-      const Future<list<Response>>& responses)
+      const Future<list<Response>>& responses,
+      const Future<Connection>& waiting,
+      const id::UUID& _connectionId)
   {
     if (shuttingDown) {
       LOG(WARNING) << "Ignoring the launch group operation as the "
@@ -541,6 +561,18 @@ protected:
     CHECK_EQ(containerIds.size(), (size_t) taskGroup.tasks().size());
     CHECK_EQ(containerIds.size(), responses->size());
 
+    // Currently, the Mesos agent does not expose the mapping from
+    // `ContainerID` to `TaskID` for nested containers.
+    // In order for the Web UI to access the task sandbox, we create
+    // a symbolic link from 'tasks/taskId' -> 'containers/containerId'.
+    const string TASKS_DIRECTORY = "tasks";
+    const string CONTAINERS_DIRECTORY = "containers";
+
+    Try<Nothing> mkdir = os::mkdir(TASKS_DIRECTORY);
+    if (mkdir.isError()) {
+      LOG(FATAL) << "Unable to create task directory: " << mkdir.error();
+    }
+
     int index = 0;
     auto responseIterator = responses->begin();
     foreach (const ContainerID& containerId, containerIds) {
@@ -606,18 +638,6 @@ protected:
         container->healthChecker = healthChecker.get();
       }
 
-      // Currently, the Mesos agent does not expose the mapping from
-      // `ContainerID` to `TaskID` for nested containers.
-      // In order for the Web UI to access the task sandbox, we create
-      // a symbolic link from 'tasks/taskId' -> 'containers/containerId'.
-      const string TASKS_DIRECTORY = "tasks";
-      const string CONTAINERS_DIRECTORY = "containers";
-
-      Try<Nothing> mkdir = os::mkdir(TASKS_DIRECTORY);
-      if (mkdir.isError()) {
-        LOG(FATAL) << "Unable to create task directory: " << mkdir.error();
-      }
-
       Try<Nothing> symlink = fs::symlink(
           path::join(sandboxDirectory,
                      CONTAINERS_DIRECTORY,
@@ -646,7 +666,16 @@ protected:
       << stringify(taskIds()) << " in child containers "
       << stringify(containerIds);
 
-    if (state == SUBSCRIBED) {
+    if (state == SUBSCRIBED && connectionId == _connectionId) {
+      LOG(INFO) << "Waiting on child containers of tasks "
+                << stringify(taskIds());
+
+      // Use the connection established during the launch, unless the
+      // agent has failed over in the meantime.
+      waiting
+        .onAny(defer(
+            self(), &Self::_wait, lambda::_1, taskIds(), _connectionId));
+    } else if (state == SUBSCRIBED) {
       // `wait()` requires the executor to be subscribed.
       //
       // Upon subscription, `received()` will call `wait()` on all containers,
@@ -667,18 +696,13 @@ protected:
 
     LOG(INFO) << "Waiting on child containers of tasks " << stringify(taskIds);
 
-    list<Future<Connection>> connections;
-    for (size_t i = 0; i < taskIds.size(); i++) {
-      connections.push_back(process::http::connect(agent));
-    }
-
-    process::collect(connections)
+    process::http::connect(agent)
       .onAny(defer(
           self(), &Self::_wait, lambda::_1, taskIds, connectionId.get()));
   }
 
   void _wait(
-      const Future<list<Connection>>& _connections,
+      const Future<Connection>& connection,
       const list<TaskID>& taskIds,
       const id::UUID& _connectionId)
   {
@@ -690,10 +714,10 @@ protected:
       return;
     }
 
-    if (!_connections.isReady()) {
+    if (!connection.isReady()) {
       LOG(ERROR)
         << "Unable to establish connection with the agent: "
-        << (_connections.isFailed() ? _connections.failure() : "discarded");
+        << (connection.isFailed() ? connection.failure() : "discarded");
       _shutdown();
       return;
     }
@@ -701,19 +725,17 @@ protected:
     CHECK_EQ(SUBSCRIBED, state);
     CHECK_SOME(connectionId);
 
-    list<Connection> connections = _connections.get();
-
-    CHECK_EQ(taskIds.size(), connections.size());
-    foreach (const TaskID& taskId, taskIds) {
-      __wait(connectionId.get(), connections.front(), taskId);
-      connections.pop_front();
-    }
+    __wait(connectionId.get(), connection.get(), taskIds);
   }
 
+  // Waits on the child containers of the given tasks with a single
+  // `WAIT_CONTAINERS` call. The agent streams back the termination of
+  // each child container as it happens, so a task group of any size
+  // only needs one connection for waiting.
   void __wait(
       const id::UUID& _connectionId,
       const Connection& connection,
-      const TaskID& taskId)
+      const list<TaskID>& taskIds)
   {
     if (connectionId != _connectionId) {
       VLOG(1) << "Ignoring the wait operation from a stale connection";
@@ -722,36 +744,49 @@ protected:
 
     CHECK_EQ(SUBSCRIBED, state);
     CHECK_SOME(connectionId);
-    CHECK(containers.contains(taskId));
 
-    Owned<Container> container = containers.at(taskId);
+    agent::Call call;
+    call.set_type(agent::Call::WAIT_CONTAINERS);
+
+    // Maps the child containers back to their tasks.
+    hashmap<ContainerID, TaskID> waiting;
+
+    foreach (const TaskID& taskId, taskIds) {
+      // The task might have terminated while we were (re-)establishing
+      // the connection.
+      if (!containers.contains(taskId)) {
+        continue;
+      }
 
-    LOG(INFO) << "Waiting for child container " << container->containerId
-              << " of task '" << taskId << "'";
+      Owned<Container> container = containers.at(taskId);
 
-    CHECK_NONE(container->waiting);
-    container->waiting = connection;
+      LOG(INFO) << "Waiting for child container " << container->containerId
+                << " of task '" << taskId << "'";
 
-    agent::Call call;
-    call.set_type(agent::Call::WAIT_NESTED_CONTAINER);
+      CHECK_NONE(container->waiting);
+      container->waiting = connection;
 
-    agent::Call::WaitNestedContainer* containerWait =
-      call.mutable_wait_nested_container();
+      call.mutable_wait_containers()->add_container_ids()
+        ->CopyFrom(container->containerId);
 
-    containerWait->mutable_container_id()->CopyFrom(container->containerId);
+      waiting[container->containerId] = taskId;
+    }
 
-    Future<Response> response = post(connection, call);
-    response
+    if (waiting.empty()) {
+      return;
+    }
+
+    post(connection, call, true)
       .onAny(defer(self(),
-                   &Self::waited,
+                   &Self::_waited,
                    connectionId.get(),
-                   taskId,
+                   waiting,
                    lambda::_1));
   }
 
-  void waited(
+  void _waited(
       const id::UUID& _connectionId,
-      const TaskID& taskId,
+      const hashmap<ContainerID, TaskID>& waiting,
       const Future<Response>& response)
   {
     // It is possible that this callback executed after the agent process
@@ -763,55 +798,131 @@ protected:
     }
 
     CHECK_EQ(SUBSCRIBED, state);
-    CHECK(containers.contains(taskId));
-
-    Owned<Container> container = containers.at(taskId);
-
-    CHECK_SOME(container->waiting);
-
-    auto retry_ = [this, container]() mutable {
-      container->waiting->disconnect();
-      container->waiting = None();
-      retry(connectionId.get(), container->taskInfo.task_id());
-    };
 
     // It is possible that the response failed due to a network blip
     // rather than the agent process failing. In that case, reestablish
     // the connection.
     if (!response.isReady()) {
       LOG(ERROR)
-        << "Connection for waiting on child container "
-        << container->containerId << " of task '" << taskId << "' interrupted: "
+        << "Connection for waiting on child containers "
+        << stringify(waiting.keys()) << " interrupted: "
         << (response.isFailed() ? response.failure() : "discarded");
-      retry_();
+      rewait(waiting);
       return;
     }
 
     // It is possible that the agent was still recovering when we
     // subscribed again after an agent process failure and started to
-    // wait for the child container. In that case, reestablish
+    // wait for the child containers. In that case, reestablish
     // the connection.
     if (response->code == process::http::Status::SERVICE_UNAVAILABLE) {
       LOG(WARNING) << "Received '" << response->status << "' ("
-                   << response->body << ") waiting on child container "
-                   << container->containerId << " of task '" << taskId << "'";
-      retry_();
+                   << response->body << ") waiting on child containers "
+                   << stringify(waiting.keys());
+      rewait(waiting);
       return;
     }
 
     // Shutdown the executor if the agent responded to the
-    // `WAIT_NESTED_CONTAINER` call with an error. Note that several race
-    // conditions can cause a 404 NOT FOUND response, which shouldn't be
-    // treated as an error.
-    if (response->code != process::http::Status::NOT_FOUND &&
-        response->code != process::http::Status::OK) {
+    // `WAIT_CONTAINERS` call with an error.
+    if (response->code != process::http::Status::OK) {
       LOG(ERROR) << "Received '" << response->status << "' ("
-                 << response->body << ") waiting on child container "
-                 << container->containerId << " of task '" << taskId << "'";
+                 << response->body << ") waiting on child containers "
+                 << stringify(waiting.keys());
       _shutdown();
       return;
     }
 
+    CHECK_EQ(Response::PIPE, response->type);
+    CHECK_SOME(response->reader);
+
+    // The records are encoded with the content type that
+    // we asked for in the 'Message-Accept' header.
+    Pipe::Reader pipe = response->reader.get();
+
+    Owned<recordio::Reader<agent::Response>> reader(
+        new recordio::Reader<agent::Response>(
+            ::recordio::Decoder<agent::Response>(lambda::bind(
+                deserialize<agent::Response>, contentType, lambda::_1)),
+            pipe));
+
+    process::loop(
+        self(),
+        [reader]() {
+          return reader->read();
+        },
+        [=](const Result<agent::Response>& record)
+            -> Future<ControlFlow<Nothing>> {
+          // The agent closes the stream once all
+          // child containers have terminated.
+          if (record.isNone()) {
+            return Break();
+          }
+
+          if (record.isError()) {
+            return process::Failure(record.error());
+          }
+
+          if (connectionId != _connectionId) {
+            return Break();
+          }
+
+          CHECK(record->has_wait_containers());
+
+          const ContainerID& containerId =
+            record->wait_containers().container_id();
+
+          if (!waiting.contains(containerId)) {
+            LOG(WARNING) << "Ignoring termination of unknown child container "
+                         << containerId;
+            return Continue();
+          }
+
+          waited(
+              waiting.at(containerId),
+              record->wait_containers().has_wait_container()
+                ? record->wait_containers().wait_container()
+                : Option<agent::Response::WaitContainer>::none());
+
+          return Continue();
+        })
+      .onAny(defer(self(), [=](const Future<Nothing>& future) mutable {
+        pipe.close();
+
+        if (connectionId != _connectionId) {
+          return;
+        }
+
+        if (!future.isReady()) {
+          LOG(ERROR)
+            << "Failed to read the terminations of child containers "
+            << stringify(waiting.keys()) << ": "
+            << (future.isFailed() ? future.failure() : "discarded");
+        }
+
+        // Wait again on the child containers that are still active,
+        // e.g., if the connection broke due to a network blip.
+        rewait(waiting);
+      }));
+  }
+
+  void waited(
+      const TaskID& taskId,
+      const Option<agent::Response::WaitContainer>& termination)
+  {
+    CHECK_EQ(SUBSCRIBED, state);
+
+    // The task might have terminated already if we were waiting on it
+    // with more than one call, e.g., after retrying a broken connection.
+    if (!containers.contains(taskId)) {
+      return;
+    }
+
+    Owned<Container> container = containers.at(taskId);
+
+    CHECK_SOME(container->waiting);
+    container->waiting = None();
+
     // If the task is checked, pause the associated checker to avoid
     // sending check updates after a terminal status update.
     if (container->checker.isSome()) {
@@ -833,8 +944,8 @@ protected:
     Option<TaskStatus::Reason> reason;
     Option<TaskResourceLimitation> limitation;
 
-    if (response->code == process::http::Status::NOT_FOUND) {
-      // The agent can respond with 404 NOT FOUND due to a failed container
+    if (termination.isNone()) {
+      // The agent does not know the container due to a failed container
       // launch or due to a race condition.
 
       if (container->killing) {
@@ -847,17 +958,13 @@ protected:
         taskState = TASK_FAILED;
         message = container->launchError;
       } else {
-        // We don't know exactly why `WAIT_NESTED_CONTAINER` returned 404 NOT
-        // FOUND, so we'll assume that the task failed.
+        // We don't know exactly why the agent does not know the
+        // container, so we'll assume that the task failed.
         taskState = TASK_FAILED;
         message = "Unable to retrieve command's termination information";
       }
     } else {
-      Try<agent::Response> waitResponse =
-        deserialize<agent::Response>(contentType, response->body);
-      CHECK_SOME(waitResponse);
-
-      if (!waitResponse->wait_nested_container().has_exit_status()) {
+      if (!termination->has_exit_status()) {
         taskState = TASK_FAILED;
 
         if (container->launchError.isSome()) {
@@ -866,7 +973,7 @@ protected:
           message = "Command terminated with unknown status";
         }
       } else {
-        int status = waitResponse->wait_nested_container().exit_status();
+        int status = termination->exit_status();
 
         CHECK(WIFEXITED(status) || WIFSIGNALED(status))
           << "Unexpected wait status " << status;
@@ -889,25 +996,24 @@ protected:
       // in general, the agent has more specific information about why
       // the container exited (e.g. this might be a container resource
       // limitation).
-      if (waitResponse->wait_nested_container().has_state()) {
-        taskState = waitResponse->wait_nested_container().state();
+      if (termination->has_state()) {
+        taskState = termination->state();
       }
 
-      if (waitResponse->wait_nested_container().has_reason()) {
-        reason = waitResponse->wait_nested_container().reason();
+      if (termination->has_reason()) {
+        reason = termination->reason();
       }
 
-      if (waitResponse->wait_nested_container().has_message()) {
+      if (termination->has_message()) {
         if (message.isSome()) {
-          message->append(
-              ": " +  waitResponse->wait_nested_container().message());
+          message->append(": " + termination->message());
         } else {
-          message = waitResponse->wait_nested_container().message();
+          message = termination->message();
         }
       }
 
-      if (waitResponse->wait_nested_container().has_limitation()) {
-        limitation = waitResponse->wait_nested_container().limitation();
+      if (termination->has_limitation()) {
+        limitation = termination->limitation();
       }
     }
 
@@ -1434,9 +1540,13 @@ private:
     mesos->send(evolve(call));
   }
 
+  // Sends the call to the agent. If `streaming` is set, the response
+  // is a stream of RecordIO records which is read via its pipe, and
+  // `connection` must be set.
   Future<Response> post(
       Option<Connection> connection,
-      const agent::Call& call)
+      const agent::Call& call,
+      bool streaming = false)
   {
     ::Request request;
     request.method = "POST";
@@ -1445,6 +1555,12 @@ private:
     request.headers = {{"Accept", stringify(contentType)},
                        {"Content-Type", stringify(contentType)}};
 
+    if (streaming) {
+      CHECK_SOME(connection);
+      request.headers["Accept"] = APPLICATION_RECORDIO;
+      request.headers[MESSAGE_ACCEPT] = stringify(contentType);
+    }
+
     if (authorizationHeader.isSome()) {
       request.headers["Authorization"] = authorizationHeader.get();
     }
@@ -1454,11 +1570,35 @@ private:
       request.keepAlive = true;
     }
 
-    return connection.isSome() ? connection->send(request)
+    return connection.isSome() ? connection->send(request, streaming)
                                : process::http::request(request);
   }
 
-  void retry(const id::UUID& _connectionId, const TaskID& taskId)
+  // Waits again on the child containers of an interrupted
+  // `WAIT_CONTAINERS` call that are still active.
+  void rewait(const hashmap<ContainerID, TaskID>& waiting)
+  {
+    list<TaskID> taskIds;
+    foreachvalue (const TaskID& taskId, waiting) {
+      if (!containers.contains(taskId)) {
+        continue;
+      }
+
+      Owned<Container> container = containers.at(taskId);
+
+      CHECK_SOME(container->waiting);
+      container->waiting->disconnect();
+      container->waiting = None();
+
+      taskIds.push_back(taskId);
+    }
+
+    if (!taskIds.empty()) {
+      retry(connectionId.get(), taskIds);
+    }
+  }
+
+  void retry(const id::UUID& _connectionId, const list<TaskID>& taskIds)
   {
     if (connectionId != _connectionId) {
       VLOG(1) << "Ignoring retry attempt from a stale connection";
@@ -1472,13 +1612,13 @@ private:
                    &Self::_retry,
                    lambda::_1,
                    connectionId.get(),
-                   taskId));
+                   taskIds));
   }
 
   void _retry(
       const Future<Connection>& connection,
       const id::UUID& _connectionId,
-      const TaskID& taskId)
+      const list<TaskID>& taskIds)
   {
     const Duration duration = Seconds(1);
 
@@ -1489,31 +1629,28 @@ private:
 
     CHECK_EQ(SUBSCRIBED, state);
     CHECK_SOME(connectionId);
-    CHECK(containers.contains(taskId));
-
-    const Owned<Container>& container = containers.at(taskId);
 
     if (!connection.isReady()) {
       LOG(ERROR)
         << "Unable to establish connection with the agent ("
         << (connection.isFailed() ? connection.failure() : "discarded")
-        << ") for waiting on child container " << container->containerId
-        << " of task '" << taskId << "'; Retrying again in " << duration;
+        << ") for waiting on child containers of tasks "
+        << stringify(taskIds) << "; Retrying again in " << duration;
 
       process::delay(
-          duration, self(), &Self::retry, connectionId.get(), taskId);
+          duration, self(), &Self::retry, connectionId.get(), taskIds);
 
       return;
     }
 
     LOG(INFO)
-      << "Established connection to wait for child container "
-      << container->containerId << " of task '" << taskId
-      << "'; Retrying the WAIT_NESTED_CONTAINER call " << "in " << duration;
+      << "Established connection to wait for child containers of tasks "
+      << stringify(taskIds) << "; Retrying the WAIT_CONTAINERS call in "
+      << duration;
 
     // It is possible that we were able to reestablish the connection
     // but the agent might still be recovering. To avoid the vicious
-    // cycle i.e., the `WAIT_NESTED_CONTAINER` call failing immediately
+    // cycle i.e., the `WAIT_CONTAINERS` call failing immediately
     // with a '503 SERVICE UNAVAILABLE' followed by retrying establishing
     // the connection again, we wait before making the call.
     process::delay(
@@ -1522,7 +1659,7 @@ private:
         &Self::__wait,
         connectionId.get(),
         connection.get(),
-        taskId);
+        taskIds);
   }
 
   void dropTaskGroup(const TaskGroupInfo& taskGroup)
@@ -14,12 +14,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <algorithm>
+#include <atomic>
+#include <mutex>
 #include <string>
+#include <thread>
 #include <vector>
 
 #include <process/owned.hpp>
 #include <process/subprocess.hpp>
 
+#include <stout/hashmap.hpp>
 #include <stout/json.hpp>
 #include <stout/net.hpp>
 #include <stout/option.hpp>
@@ -466,6 +471,95 @@ static Try<string> fetch(
 }
 
 
+// Fetches the items using up to the given number of threads, and
+// returns the first failure if any. Items with the same output file
+// are fetched one after another in their original order, so that they
+// never write the same file concurrently. The extraction of an archive
+// thus overlaps with the download of the other items.
+static Try<Nothing> fetch(
+    const FetcherInfo& fetcherInfo,
+    const Option<string>& cacheDirectory,
+    const Option<string>& frameworksHome,
+    size_t concurrency)
+{
+  vector<vector<FetcherInfo::Item>> queues;
+  hashmap<string, size_t> outputFiles;
+
+  foreach (const FetcherInfo::Item& item, fetcherInfo.items()) {
+    Try<string> outputFile = item.uri().has_output_file()
+      ? item.uri().output_file()
+      : Fetcher::basename(item.uri().value());
+
+    // Errors are reported when fetching the item.
+    const string key = outputFile.isSome()
+      ? outputFile.get()
+      : item.uri().value();
+
+    if (!outputFiles.contains(key)) {
+      outputFiles[key] = queues.size();
+      queues.emplace_back();
+    }
+
+    queues[outputFiles.at(key)].push_back(item);
+  }
+
+  std::atomic<size_t> next(0);
+  std::mutex mutex;
+  Option<Error> error;
+
+  auto worker = [&]() {
+    for (size_t i = next++; i < queues.size(); i = next++) {
+      foreach (const FetcherInfo::Item& item, queues[i]) {
+        {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (error.isSome()) {
+            return;
+          }
+        }
+
+        Try<string> fetched = fetch(
+            item,
+            cacheDirectory,
+            fetcherInfo.sandbox_directory(),
+            frameworksHome);
+
+        if (fetched.isError()) {
+          std::lock_guard<std::mutex> lock(mutex);
+          if (error.isNone()) {
+            error = Error(
+                "Failed to fetch '" + item.uri().value() + "': " +
+                fetched.error());
+          }
+
+          return;
+        }
+
+        LOG(INFO) << "Fetched '" << item.uri().value()
+                  << "' to '" << fetched.get() << "'";
+      }
+    }
+  };
+
+  vector<std::thread> threads;
+  for (size_t i = 1; i < std::min(concurrency, queues.size()); i++) {
+    threads.emplace_back(worker);
+  }
+
+  // The calling thread fetches as well.
+  worker();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+
+  if (error.isSome()) {
+    return error.get();
+  }
+
+  return Nothing();
+}
+
+
 // Checks to see if it's necessary to create a fetcher cache directory for this
 // user, and creates it if so.
 static Try<Nothing> createCacheDirectory(const FetcherInfo& fetcherInfo)
@@ -594,16 +688,14 @@ int main(int argc, char* argv[])
       : Option<string>::none();
 
   // Fetch each URI to a local file and chmod if necessary.
-  foreach (const FetcherInfo::Item& item, fetcherInfo->items()) {
-    Try<string> fetched =
-      fetch(item, cacheDirectory, sandboxDirectory, frameworksHome);
-    if (fetched.isError()) {
-      EXIT(EXIT_FAILURE)
-        << "Failed to fetch '" << item.uri().value() << "': " + fetched.error();
-    } else {
-      LOG(INFO) << "Fetched '" << item.uri().value()
-                << "' to '" << fetched.get() << "'";
-    }
+  result = fetch(
+      fetcherInfo.get(),
+      cacheDirectory,
+      frameworksHome,
+      std::max(fetcherInfo->max_concurrent_downloads(), 1u));
+
+  if (result.isError()) {
+    EXIT(EXIT_FAILURE) << result.error();
   }
 
   LOG(INFO) << "Successfully fetched all URIs into "
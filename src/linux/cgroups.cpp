@@ -14,11 +14,14 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <ctype.h>
 #include <errno.h>
+#include <fcntl.h>
 #include <fts.h>
 #include <signal.h>
 #include <stdint.h>
 #include <stdlib.h>
+#include <string.h>
 #include <unistd.h>
 
 #include <sys/syscall.h>
@@ -1856,6 +1859,91 @@ Future<bool> _cleanup(const string& hierarchy)
 }
 
 
+namespace internal {
+
+// Parses an unsigned decimal number starting at `*data`, and advances
+// `*data` past it. Returns None if there are no digits or the number
+// overflows.
+static Option<uint64_t> parseNumber(const char** data, const char* end)
+{
+  const char* start = *data;
+  uint64_t value = 0;
+
+  for (; *data < end && **data >= '0' && **data <= '9'; (*data)++) {
+    const uint64_t digit = **data - '0';
+    if (value > (UINT64_MAX - digit) / 10) {
+      return None();
+    }
+
+    value = value * 10 + digit;
+  }
+
+  if (*data == start) {
+    return None();
+  }
+
+  return value;
+}
+
+
+// Parses the "<name> <value>" lines of a stat file and calls `f` for
+// each of them. The name is passed in `name` which is reused, so that
+// no memory is allocated once it is large enough to hold the names.
+static Try<Nothing> stat(
+    const char* data,
+    size_t size,
+    const string& file,
+    string* name,
+    const lambda::function<void(const string&, uint64_t)>& f)
+{
+  const char* end = data + size;
+
+  while (data < end) {
+    const char* newline = static_cast<const char*>(
+        ::memchr(data, '\n', end - data));
+
+    const char* eol = newline != nullptr ? newline : end;
+    const char* line = data;
+
+    data = newline != nullptr ? newline + 1 : end;
+
+    // Skip the leading whitespaces and empty lines.
+    while (line < eol && ::isspace(*line)) {
+      line++;
+    }
+
+    if (line == eol) {
+      continue;
+    }
+
+    // Expected line format: "%s %llu".
+    const char* separator = line;
+    while (separator < eol && !::isspace(*separator)) {
+      separator++;
+    }
+
+    name->assign(line, separator - line);
+
+    const char* number = separator;
+    while (number < eol && ::isspace(*number)) {
+      number++;
+    }
+
+    Option<uint64_t> value = parseNumber(&number, eol);
+    if (value.isNone()) {
+      return Error(
+          "Unexpected line format in " + file + ": " + string(line, eol));
+    }
+
+    f(*name, value.get());
+  }
+
+  return Nothing();
+}
+
+} // namespace internal {
+
+
 Try<hashmap<string, uint64_t>> stat(
     const string& hierarchy,
     const string& cgroup,
@@ -1868,28 +1956,131 @@ Try<hashmap<string, uint64_t>> stat(
   }
 
   hashmap<string, uint64_t> result;
+  string name;
 
-  foreach (const string& line, strings::split(contents.get(), "\n")) {
-    // Skip empty lines.
-    if (strings::trim(line).empty()) {
-      continue;
+  Try<Nothing> parse = internal::stat(
+      contents->data(),
+      contents->size(),
+      file,
+      &name,
+      [&result](const string& name, uint64_t value) {
+        result[name] = value;
+      });
+
+  if (parse.isError()) {
+    return Error(parse.error());
+  }
+
+  return result;
+}
+
+
+Try<Owned<ControlFile>> ControlFile::open(
+    const string& hierarchy,
+    const string& cgroup,
+    const string& control)
+{
+  Option<Error> error = verify(hierarchy, cgroup, control);
+  if (error.isSome()) {
+    return error.get();
+  }
+
+  const string path = path::join(hierarchy, cgroup, control);
+
+  int fd = ::open(path.c_str(), O_RDONLY | O_CLOEXEC);
+  if (fd < 0) {
+    return ErrnoError("Failed to open '" + path + "'");
+  }
+
+  return Owned<ControlFile>(new ControlFile(fd, path));
+}
+
+
+ControlFile::ControlFile(int _fd, const string& _path)
+  : fd(_fd), path(_path), buffer(4096), size(0) {}
+
+
+ControlFile::~ControlFile()
+{
+  os::close(fd);
+}
+
+
+Try<uint64_t> ControlFile::value()
+{
+  Try<Nothing> read = this->read();
+  if (read.isError()) {
+    return Error(read.error());
+  }
+
+  const char* data = buffer.data();
+  const char* end = data + size;
+
+  while (data < end && ::isspace(*data)) {
+    data++;
+  }
+
+  Option<uint64_t> value = internal::parseNumber(&data, end);
+
+  while (data < end && ::isspace(*data)) {
+    data++;
+  }
+
+  if (value.isNone() || data != end) {
+    return Error(
+        "Failed to parse '" + path + "': " + string(buffer.data(), size));
+  }
+
+  return value.get();
+}
+
+
+Try<Nothing> ControlFile::stat(
+    const lambda::function<void(const string&, uint64_t)>& f)
+{
+  Try<Nothing> read = this->read();
+  if (read.isError()) {
+    return Error(read.error());
+  }
+
+  return internal::stat(buffer.data(), size, path, &name, f);
+}
+
+
+Try<Nothing> ControlFile::read()
+{
+  size = 0;
+
+  while (true) {
+    // Keep room for the terminating NUL character.
+    if (size + 1 >= buffer.size()) {
+      buffer.resize(buffer.size() * 2);
     }
 
-    string name;
-    uint64_t value;
+    ssize_t length = ::pread(
+        fd,
+        buffer.data() + size,
+        buffer.size() - size - 1,
+        size);
 
-    // Expected line format: "%s %llu".
-    istringstream stream(line);
-    stream >> name >> value;
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
 
-    if (stream.fail()) {
-      return Error("Unexpected line format in " + file + ": " + line);
+      return ErrnoError("Failed to read '" + path + "'");
     }
 
-    result[name] = value;
+    if (length == 0) {
+      break;
+    }
+
+    size += length;
   }
 
-  return result;
+  buffer[size] = '\0';
+
+  return Nothing();
 }
 
 
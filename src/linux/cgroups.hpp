@@ -27,11 +27,13 @@
 #include <sys/types.h>
 
 #include <process/future.hpp>
+#include <process/owned.hpp>
 #include <process/timeout.hpp>
 
 #include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
 #include <stout/try.hpp>
@@ -401,6 +403,56 @@ Try<hashmap<std::string, uint64_t>> stat(
     const std::string& file);
 
 
+// A control file which is kept open so that it can be read repeatedly,
+// e.g., to periodically collect statistics, without being reopened.
+// The contents are read into a buffer which is reused across reads, so
+// that neither reading nor parsing the file allocates memory once the
+// buffer has grown to the size of the file.
+class ControlFile
+{
+public:
+  // Opens the given control file of a cgroup.
+  // @param   hierarchy   Path to the hierarchy root.
+  // @param   cgroup      Path to the cgroup relative to the hierarchy root.
+  // @param   control     Name of the control file.
+  // @return  The opened control file.
+  //          Error if the cgroup or the control file does not exist.
+  static Try<process::Owned<ControlFile>> open(
+      const std::string& hierarchy,
+      const std::string& cgroup,
+      const std::string& control);
+
+  ~ControlFile();
+
+  // Returns the value of a control file holding a single number
+  // (Ex: "memory.usage_in_bytes").
+  Try<uint64_t> value();
+
+  // Calls `f` with the name and the value of each entry of a stat file
+  // (Ex: "memory.stat"), in the format expected by `cgroups::stat`.
+  Try<Nothing> stat(
+      const lambda::function<void(const std::string&, uint64_t)>& f);
+
+private:
+  ControlFile(int _fd, const std::string& _path);
+
+  ControlFile(const ControlFile&) = delete;
+  ControlFile& operator=(const ControlFile&) = delete;
+
+  // Reads the whole file into `buffer`, terminated by a NUL character.
+  Try<Nothing> read();
+
+  const int fd;
+  const std::string path;
+
+  std::vector<char> buffer;
+  size_t size;
+
+  // Reused to pass the names of the entries of a stat file.
+  std::string name;
+};
+
+
 // Blkio subsystem.
 namespace blkio {
 
@@ -61,6 +61,8 @@ public:
       bool filterGpuResources = true,
       const Option<DomainInfo>& domain = None());
 
+  void setAuthorizer(const Option<Authorizer*>& authorizer);
+
   void recover(
       const int expectedAgentCount,
       const hashmap<std::string, Quota>& quotas);
@@ -207,6 +209,8 @@ public:
       bool filterGpuResources = true,
       const Option<DomainInfo>& domain = None()) = 0;
 
+  virtual void setAuthorizer(const Option<Authorizer*>& authorizer) {}
+
   virtual void recover(
       const int expectedAgentCount,
       const hashmap<std::string, Quota>& quotas) = 0;
@@ -374,6 +378,17 @@ inline void MesosAllocator<AllocatorProcess>::initialize(
 }
 
 
+template <typename AllocatorProcess>
+inline void MesosAllocator<AllocatorProcess>::setAuthorizer(
+    const Option<Authorizer*>& authorizer)
+{
+  process::dispatch(
+      process,
+      &MesosAllocatorProcess::setAuthorizer,
+      authorizer);
+}
+
+
 template <typename AllocatorProcess>
 inline void MesosAllocator<AllocatorProcess>::recover(
     const int expectedAgentCount,
@@ -24,22 +24,27 @@
 
 #include <mesos/attributes.hpp>
 #include <mesos/resources.hpp>
+#include <mesos/roles.hpp>
 #include <mesos/type_utils.hpp>
 
 #include <process/after.hpp>
 #include <process/delay.hpp>
 #include <process/dispatch.hpp>
 #include <process/event.hpp>
+#include <process/help.hpp>
+#include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/loop.hpp>
 #include <process/timeout.hpp>
 
 #include <stout/check.hpp>
 #include <stout/hashset.hpp>
+#include <stout/jsonify.hpp>
 #include <stout/set.hpp>
 #include <stout/stopwatch.hpp>
 #include <stout/stringify.hpp>
 
+#include "common/http.hpp"
 #include "common/protobuf_utils.hpp"
 
 using std::set;
@@ -49,14 +54,28 @@ using std::vector;
 using mesos::allocator::InverseOfferStatus;
 
 using process::after;
+using process::AUTHENTICATION;
+using process::AUTHORIZATION;
+using process::Clock;
 using process::Continue;
 using process::ControlFlow;
+using process::defer;
+using process::DESCRIPTION;
 using process::Failure;
 using process::Future;
+using process::HELP;
 using process::loop;
 using process::Owned;
 using process::PID;
+using process::Time;
 using process::Timeout;
+using process::TLDR;
+
+using process::http::Forbidden;
+using process::http::OK;
+using process::http::Response;
+
+using process::http::authentication::Principal;
 
 using mesos::internal::protobuf::framework::Capabilities;
 
@@ -73,13 +92,20 @@ public:
   virtual ~OfferFilter() {}
 
   virtual bool filter(const Resources& resources) const = 0;
+
+  // Returns true if this filter filters (at least) everything that
+  // the other filter does, for (at least) as long. Such redundant
+  // filters are not kept, which keeps the number of filters that
+  // `isFiltered()` has to evaluate for an agent small.
+  virtual bool subsumes(const OfferFilter& other) const = 0;
 };
 
 
 class RefusedOfferFilter : public OfferFilter
 {
 public:
-  RefusedOfferFilter(const Resources& _resources) : resources(_resources) {}
+  RefusedOfferFilter(const Resources& _resources, const Time& _expiry)
+    : resources(_resources), expiry(_expiry) {}
 
   virtual bool filter(const Resources& _resources) const
   {
@@ -91,8 +117,19 @@ public:
     return resources.contains(_resources); // Refused resources are superset.
   }
 
+  virtual bool subsumes(const OfferFilter& other) const
+  {
+    const RefusedOfferFilter* refused =
+      dynamic_cast<const RefusedOfferFilter*>(&other);
+
+    return refused != nullptr &&
+           expiry >= refused->expiry &&
+           resources.contains(refused->resources);
+  }
+
 private:
   const Resources resources;
+  const Time expiry;
 };
 
 
@@ -133,6 +170,62 @@ private:
 };
 
 
+bool OfferFilters::filter(const Resources& resources) const
+{
+  if (last.isSome() && last->first == resources) {
+    return last->second;
+  }
+
+  bool filtered = false;
+
+  foreach (OfferFilter* offerFilter, offerFilters) {
+    if (offerFilter->filter(resources)) {
+      filtered = true;
+      break;
+    }
+  }
+
+  last = std::make_pair(resources, filtered);
+
+  return filtered;
+}
+
+
+bool OfferFilters::subsumes(const OfferFilter& offerFilter) const
+{
+  foreach (OfferFilter* existing, offerFilters) {
+    if (existing->subsumes(offerFilter)) {
+      return true;
+    }
+  }
+
+  return false;
+}
+
+
+void OfferFilters::add(OfferFilter* offerFilter)
+{
+  for (auto it = offerFilters.begin(); it != offerFilters.end();) {
+    if (offerFilter->subsumes(**it)) {
+      it = offerFilters.erase(it);
+    } else {
+      ++it;
+    }
+  }
+
+  offerFilters.insert(offerFilter);
+  last = None();
+}
+
+
+void OfferFilters::remove(OfferFilter* offerFilter)
+{
+  if (offerFilters.erase(offerFilter) > 0) {
+    last = None();
+  }
+}
+
+
 HierarchicalAllocatorProcess::Framework::Framework(
     const FrameworkInfo& frameworkInfo,
     const set<string>& _suppressedRoles,
@@ -164,6 +257,7 @@ void HierarchicalAllocatorProcess::initialize(
   filterGpuResources = _filterGpuResources;
   domain = _domain;
   initialized = true;
+  initializedTime = Clock::now();
   paused = false;
 
   // Resources for quota'ed roles are allocated separately and prior to
@@ -172,6 +266,12 @@ void HierarchicalAllocatorProcess::initialize(
   roleSorter->initialize(fairnessExcludeResourceNames);
   quotaRoleSorter->initialize(fairnessExcludeResourceNames);
 
+  route(
+      "/allocation_runs",
+      READONLY_HTTP_AUTHENTICATION_REALM,
+      ALLOCATION_RUNS_HELP(),
+      &Self::allocationRuns);
+
   VLOG(1) << "Initialized hierarchical allocator process";
 
   // Start a loop to run allocation periodically.
@@ -189,6 +289,13 @@ void HierarchicalAllocatorProcess::initialize(
 }
 
 
+void HierarchicalAllocatorProcess::setAuthorizer(
+    const Option<Authorizer*>& _authorizer)
+{
+  authorizer = _authorizer;
+}
+
+
 void HierarchicalAllocatorProcess::recover(
     const int _expectedAgentCount,
     const hashmap<string, Quota>& quotas)
@@ -338,7 +445,7 @@ void HierarchicalAllocatorProcess::removeFramework(
   // Do not delete the filters contained in this
   // framework's `offerFilters` hashset yet, see comments in
   // HierarchicalAllocatorProcess::reviveOffers and
-  // HierarchicalAllocatorProcess::expire.
+  // HierarchicalAllocatorProcess::_expireOfferFilters.
   frameworks.erase(frameworkId);
 
   LOG(INFO) << "Removed framework " << frameworkId;
@@ -398,7 +505,7 @@ void HierarchicalAllocatorProcess::deactivateFramework(
   // Do not delete the filters contained in this
   // framework's `offerFilters` hashset yet, see comments in
   // HierarchicalAllocatorProcess::reviveOffers and
-  // HierarchicalAllocatorProcess::expire.
+  // HierarchicalAllocatorProcess::_expireOfferFilters.
   framework.offerFilters.clear();
   framework.inverseOfferFilters.clear();
 
@@ -510,8 +617,8 @@ void HierarchicalAllocatorProcess::addSlave(
 
   Slave& slave = slaves.at(slaveId);
 
-  slave.total = total;
-  slave.allocated = Resources::sum(used);
+  slave.updateTotal(total);
+  slave.allocate(Resources::sum(used));
   slave.activated = true;
   slave.info = slaveInfo;
   slave.capabilities = protobuf::slave::Capabilities(capabilities);
@@ -524,6 +631,9 @@ void HierarchicalAllocatorProcess::addSlave(
 
   trackReservations(total.reservations());
 
+  unreservedScalarQuantities +=
+    total.unreserved().nonRevocable().createStrippedScalarQuantity();
+
   roleSorter->add(slaveId, total);
 
   // See comment at `quotaRoleSorter` declaration regarding non-revocable.
@@ -572,8 +682,8 @@ void HierarchicalAllocatorProcess::addSlave(
   }
 
   LOG(INFO) << "Added agent " << slaveId << " (" << slave.info.hostname() << ")"
-            << " with " << slave.total
-            << " (allocated: " << slave.allocated << ")";
+            << " with " << slave.getTotal()
+            << " (allocated: " << slave.getAllocated() << ")";
 
   allocate(slaveId);
 }
@@ -591,20 +701,24 @@ void HierarchicalAllocatorProcess::removeSlave(
   // all the resources. Fixing this would require more information
   // than what we currently track in the allocator.
 
-  roleSorter->remove(slaveId, slaves.at(slaveId).total);
+  roleSorter->remove(slaveId, slaves.at(slaveId).getTotal());
 
   // See comment at `quotaRoleSorter` declaration regarding non-revocable.
-  quotaRoleSorter->remove(slaveId, slaves.at(slaveId).total.nonRevocable());
+  quotaRoleSorter->remove(
+      slaveId, slaves.at(slaveId).getTotal().nonRevocable());
+
+  untrackReservations(slaves.at(slaveId).getTotal().reservations());
 
-  untrackReservations(slaves.at(slaveId).total.reservations());
+  unreservedScalarQuantities -= slaves.at(slaveId).getTotal()
+    .unreserved().nonRevocable().createStrippedScalarQuantity();
 
   slaves.erase(slaveId);
   allocationCandidates.erase(slaveId);
 
   // Note that we DO NOT actually delete any filters associated with
   // this slave, that will occur when the delayed
-  // HierarchicalAllocatorProcess::expire gets invoked (or the framework
-  // that applied the filters gets removed).
+  // HierarchicalAllocatorProcess::expireOfferFilters gets invoked (or the
+  // framework that applied the filters gets removed).
 
   LOG(INFO) << "Removed agent " << slaveId;
 }
@@ -706,8 +820,8 @@ void HierarchicalAllocatorProcess::addResourceProvider(
   }
 
   Slave& slave = slaves.at(slaveId);
-  updateSlaveTotal(slaveId, slave.total + total);
-  slave.allocated += Resources::sum(used);
+  updateSlaveTotal(slaveId, slave.getTotal() + total);
+  slave.allocate(Resources::sum(used));
 
   VLOG(1)
     << "Grew agent " << slaveId << " by "
@@ -727,7 +841,7 @@ void HierarchicalAllocatorProcess::removeFilters(const SlaveID& slaveId)
 
     // Need a typedef here, otherwise the preprocessor gets confused
     // by the comma in the template argument list.
-    typedef hashmap<SlaveID, hashset<OfferFilter*>> Filters;
+    typedef hashmap<SlaveID, OfferFilters> Filters;
     foreachpair(const string& role,
                 Filters& filters,
                 framework.offerFilters) {
@@ -844,8 +958,8 @@ void HierarchicalAllocatorProcess::updateAllocation(
   const Resources& updatedOfferedResources = _updatedOfferedResources.get();
 
   // Update the per-slave allocation.
-  slave.allocated -= offeredResources;
-  slave.allocated += updatedOfferedResources;
+  slave.unallocate(offeredResources);
+  slave.allocate(updatedOfferedResources);
 
   // Update the allocation in the framework sorter.
   frameworkSorter->update(
@@ -872,6 +986,11 @@ void HierarchicalAllocatorProcess::updateAllocation(
         updatedOfferedResources.nonRevocable());
   }
 
+  // Conversions such as RESERVE and UNRESERVE change the portion of
+  // the allocation that counts as unreserved.
+  untrackUnreservedAllocation(role, offeredResources);
+  trackUnreservedAllocation(role, updatedOfferedResources);
+
   // Update the agent total resources so they are consistent with the updated
   // allocation. We do not directly use `updatedOfferedResources` here because
   // the agent's total resources shouldn't contain:
@@ -904,7 +1023,7 @@ void HierarchicalAllocatorProcess::updateAllocation(
     strippedConversions.emplace_back(consumed, converted);
   }
 
-  Try<Resources> updatedTotal = slave.total.apply(strippedConversions);
+  Try<Resources> updatedTotal = slave.getTotal().apply(strippedConversions);
   CHECK_SOME(updatedTotal);
 
   updateSlaveTotal(slaveId, updatedTotal.get());
@@ -963,7 +1082,7 @@ Future<Nothing> HierarchicalAllocatorProcess::updateAvailable(
   }
 
   // Update the total resources.
-  Try<Resources> updatedTotal = slave.total.apply(operations);
+  Try<Resources> updatedTotal = slave.getTotal().apply(operations);
   CHECK_SOME(updatedTotal);
 
   // Update the total resources in the allocator and role and quota sorters.
@@ -1184,14 +1303,14 @@ void HierarchicalAllocatorProcess::recoverResources(
   if (slaves.contains(slaveId)) {
     Slave& slave = slaves.at(slaveId);
 
-    CHECK(slave.allocated.contains(resources))
-      << slave.allocated << " does not contain " << resources;
+    CHECK(slave.getAllocated().contains(resources))
+      << slave.getAllocated() << " does not contain " << resources;
 
-    slave.allocated -= resources;
+    slave.unallocate(resources);
 
     VLOG(1) << "Recovered " << resources
-            << " (total: " << slave.total
-            << ", allocated: " << slave.allocated << ")"
+            << " (total: " << slave.getTotal()
+            << ", allocated: " << slave.getAllocated() << ")"
             << " on agent " << slaveId
             << " from framework " << frameworkId;
   }
@@ -1239,43 +1358,63 @@ void HierarchicalAllocatorProcess::recoverResources(
             << " filtered agent " << slaveId
             << " for " << timeout.get();
 
-    // Create a new filter. Note that we unallocate the resources
-    // since filters are applied per-role already.
-    Resources unallocated = resources;
-    unallocated.unallocate();
-
-    OfferFilter* offerFilter = new RefusedOfferFilter(unallocated);
-    frameworks.at(frameworkId)
-      .offerFilters[role][slaveId].insert(offerFilter);
-
     // Expire the filter after both an `allocationInterval` and the
     // `timeout` have elapsed. This ensures that the filter does not
     // expire before we perform the next allocation for this agent,
     // see MESOS-4302 for more information.
     //
     // Because the next periodic allocation goes through a dispatch
-    // after `allocationInterval`, we do the same for `expire()`
-    // (with a helper `_expire()`) to achieve the above.
+    // after `allocationInterval`, we do the same for
+    // `expireOfferFilters()` (with a helper `_expireOfferFilters()`)
+    // to achieve the above.
     //
     // TODO(alexr): If we allocated upon resource recovery
     // (MESOS-3078), we would not need to increase the timeout here.
     timeout = std::max(allocationInterval, timeout.get());
 
-    // We need to disambiguate the function call to pick the correct
-    // `expire()` overload.
-    void (Self::*expireOffer)(
-        const FrameworkID&,
-        const string&,
-        const SlaveID&,
-        OfferFilter*) = &Self::expire;
+    const Time expiry = Clock::now() + timeout.get();
+
+    // Create a new filter. Note that we unallocate the resources
+    // since filters are applied per-role already.
+    Resources unallocated = resources;
+    unallocated.unallocate();
+
+    OfferFilter* offerFilter = new RefusedOfferFilter(unallocated, expiry);
+
+    OfferFilters& agentFilters =
+      frameworks.at(frameworkId).offerFilters[role][slaveId];
 
-    delay(timeout.get(),
+    // Drop the new filter if an existing one already covers it, and
+    // otherwise stop evaluating the existing filters that the new one
+    // covers. The latter are still deleted upon their own expiration,
+    // see the comments in `reviveOffers()`.
+    if (agentFilters.subsumes(*offerFilter)) {
+      VLOG(1) << "Filter of framework " << frameworkId
+              << " on agent " << slaveId
+              << " is covered by an existing filter";
+
+      delete offerFilter;
+      return;
+    }
+
+    agentFilters.add(offerFilter);
+
+    // Only schedule a timer for the first filter in this bucket,
+    // the others are expired along with it.
+    const Time bucket = offerFilterBucket(expiry);
+
+    bool scheduled = offerFilterExpiries.count(bucket) > 0;
+
+    offerFilterExpiries[bucket].push_back(
+        OfferFilterExpiry{frameworkId, role, slaveId, offerFilter});
+
+    if (!scheduled) {
+      delay(
+          bucket - Clock::now(),
           self(),
-          expireOffer,
-          frameworkId,
-          role,
-          slaveId,
-          offerFilter);
+          &Self::expireOfferFilters,
+          bucket);
+    }
   }
 }
 
@@ -1330,11 +1469,12 @@ void HierarchicalAllocatorProcess::reviveOffers(
   }
 
   // We delete each actual `OfferFilter` when
-  // `HierarchicalAllocatorProcess::expire` gets invoked. If we delete the
-  // `OfferFilter` here it's possible that the same `OfferFilter` (i.e., same
-  // address) could get reused and `HierarchicalAllocatorProcess::expire`
-  // would expire that filter too soon. Note that this only works
-  // right now because ALL Filter types "expire".
+  // `HierarchicalAllocatorProcess::_expireOfferFilters` gets invoked. If we
+  // delete the `OfferFilter` here it's possible that the same `OfferFilter`
+  // (i.e., same address) could get reused and
+  // `HierarchicalAllocatorProcess::_expireOfferFilters` would expire that
+  // filter too soon. Note that this only works right now because ALL
+  // Filter types "expire".
 
   LOG(INFO) << "Revived offers for roles " << stringify(roles)
             << " of framework " << frameworkId;
@@ -1505,7 +1645,14 @@ Nothing HierarchicalAllocatorProcess::_allocate()
   stopwatch.start();
   metrics.allocation_run.start();
 
-  __allocate();
+  AllocationRunTrace trace;
+  trace.start = Clock::now();
+
+  if (allocationRunCount++ % ALLOCATION_RUN_FILTER_SAMPLING == 0) {
+    trace.filter = Duration::zero();
+  }
+
+  __allocate(&trace);
 
   // NOTE: For now, we implement maintenance inverse offers within the
   // allocator. We leverage the existing timer/cycle of offers to also do any
@@ -1514,6 +1661,24 @@ Nothing HierarchicalAllocatorProcess::_allocate()
 
   metrics.allocation_run.stop();
 
+  trace.total = stopwatch.elapsed();
+
+  metrics.allocation_run_sort.record(trace.sort);
+  metrics.allocation_run_quota_headroom.record(trace.quotaHeadroom);
+  if (trace.filter.isSome()) {
+    metrics.allocation_run_filter.record(trace.filter.get());
+  }
+
+  metrics.allocation_run_resources.record(trace.resources);
+  metrics.allocation_run_offer_callback.record(trace.offerCallback);
+
+  metrics.allocation_run_agents_considered += trace.agentsConsidered;
+  metrics.allocation_run_agents_skipped += trace.agentsSkipped;
+  metrics.allocation_run_frameworks_considered += trace.frameworksConsidered;
+  metrics.allocation_run_frameworks_skipped += trace.frameworksSkipped;
+
+  allocationRunTraces.push_back(trace);
+
   VLOG(1) << "Performed allocation for " << allocationCandidates.size()
           << " agents in " << stopwatch.elapsed();
 
@@ -1525,8 +1690,32 @@ Nothing HierarchicalAllocatorProcess::_allocate()
 
 
 // TODO(alexr): Consider factoring out the quota allocation logic.
-void HierarchicalAllocatorProcess::__allocate()
+void HierarchicalAllocatorProcess::__allocate(AllocationRunTrace* trace)
 {
+  CHECK_NOTNULL(trace);
+
+  // Used to time the individual phases of the allocation run.
+  Stopwatch phase;
+
+  // Returns whether the framework filters the resources. The check is
+  // only timed in sampled allocation runs, as it is made for each pair
+  // of framework and agent.
+  auto filtered = [&](
+      const FrameworkID& frameworkId,
+      const string& role,
+      const SlaveID& slaveId,
+      const Resources& resources) {
+    if (trace->filter.isNone()) {
+      return isFiltered(frameworkId, role, slaveId, resources);
+    }
+
+    phase.start();
+    const bool result = isFiltered(frameworkId, role, slaveId, resources);
+    trace->filter.get() += phase.elapsed();
+
+    return result;
+  };
+
   // Compute the offerable resources, per framework:
   //   (1) For reserved resources on the slave, allocate these to a
   //       framework having the corresponding role.
@@ -1551,38 +1740,23 @@ void HierarchicalAllocatorProcess::__allocate()
     }
   }
 
+  trace->agentsConsidered = slaveIds.size();
+  trace->agentsSkipped = allocationCandidates.size() - slaveIds.size();
+
   // Randomize the order in which slaves' resources are allocated.
   //
   // TODO(vinod): Implement a smarter sorting algorithm.
   std::random_shuffle(slaveIds.begin(), slaveIds.end());
 
-  // Returns the __quantity__ of resources allocated to a role with
-  // non-default quota. Since we account for reservations and persistent
-  // volumes toward quota, we strip reservation and persistent volumes
-  // related information for comparability. The result is used to
-  // determine whether a role's quota guarantee is satisfied, and
-  // also to determine how many resources the role would need in
-  // order to meet its quota guarantee.
-  //
-  // NOTE: Revocable resources are excluded in `quotaRoleSorter`.
-  auto getQuotaRoleAllocatedScalarQuantities = [this](const string& role) {
-    CHECK(quotas.contains(role));
-
-    // NOTE: `allocationScalarQuantities` omits dynamic reservation,
-    // persistent volume info, and allocation info. We additionally
-    // remove the static reservations here via `toUnreserved()`.
-    return quotaRoleSorter->allocationScalarQuantities(role).toUnreserved();
-  };
+  phase.start();
 
   // To enforce quota, we keep track of consumed quota for roles with a
   // non-default quota.
   //
-  // NOTE: We build the map here to avoid repetitive aggregation in the
-  // allocation loop. But this map will still need to be updated in the
-  // allocation loop as we make new allocations.
-  //
-  // TODO(mzhu): Build and persist this information across allocation cycles in
-  // track/untrackAllocatedResources().
+  // NOTE: The consumed quota is derived from aggregates maintained in
+  // track/untrackAllocatedResources() and track/untrackReservations(),
+  // so building this map does not iterate over agents. The map still
+  // needs to be updated in the allocation loop as we make new allocations.
   //
   // TODO(mzhu): Ideally, we want the sorter to track consumed quota. It then
   // could use consumed quota instead of allocated resources (the former
@@ -1605,26 +1779,12 @@ void HierarchicalAllocatorProcess::__allocate()
   // It is calculated as:
   //
   //   Consumed Quota = reservations + unreserved allocation
-  //                  = reservations + allocation - allocated reservations
+  //
+  // NOTE: Revocable resources are excluded from the unreserved allocation.
   foreachkey (const string& role, quotas) {
-    // First add reservations.
-    rolesConsumedQuotaScalarQuantites[role] +=
-      reservationScalarQuantities.get(role).getOrElse(Resources());
-
-    // Then add allocated resoruces.
-    rolesConsumedQuotaScalarQuantites[role] +=
-      getQuotaRoleAllocatedScalarQuantities(role);
-
-    // Lastly subtract allocated reservations on each agent.
-    const hashmap<SlaveID, Resources> allocations =
-      quotaRoleSorter->allocation(role);
-
-    foreachvalue (const Resources& resources, allocations) {
-      // We need to remove the static reservation metadata here via
-      // `toUnreserved()`.
-      rolesConsumedQuotaScalarQuantites[role] -=
-        resources.reserved().createStrippedScalarQuantity().toUnreserved();
-    }
+    rolesConsumedQuotaScalarQuantites[role] =
+      reservationScalarQuantities.get(role).getOrElse(Resources()) +
+      unreservedAllocationScalarQuantities.get(role).getOrElse(Resources());
   }
 
   // We need to constantly make sure that we are holding back enough
@@ -1654,62 +1814,16 @@ void HierarchicalAllocatorProcess::__allocate()
   //
   // We compute this as:
   //
-  //   available headroom = total resources -
-  //                        allocated resources -
-  //                        unallocated reservations -
-  //                        unallocated revocable resources
-
-  // NOTE: `totalScalarQuantities` omits dynamic reservation,
-  // persistent volume info, and allocation info. We additionally
-  // remove the static reservations here via `toUnreserved()`.
-  Resources availableHeadroom =
-    roleSorter->totalScalarQuantities().toUnreserved();
-
-  // Subtract allocated resources from the total.
-  foreachkey (const string& role, roles) {
-    // NOTE: `totalScalarQuantities` omits dynamic reservation,
-    // persistent volume info, and allocation info. We additionally
-    // remove the static reservations here via `toUnreserved()`.
-    availableHeadroom -=
-      roleSorter->allocationScalarQuantities(role).toUnreserved();
-  }
-
-  // Calculate total allocated reservations. Note that we need to ensure
-  // we count a reservation for "a" being allocated to "a/b", therefore
-  // we cannot simply loop over the reservations' roles.
-  Resources totalAllocatedReservationScalarQuantities;
-  foreachkey (const string& role, roles) {
-    hashmap<SlaveID, Resources> allocations;
-    if (quotaRoleSorter->contains(role)) {
-      allocations = quotaRoleSorter->allocation(role);
-    } else if (roleSorter->contains(role)) {
-      allocations = roleSorter->allocation(role);
-    } else {
-      continue; // This role has no allocation.
-    }
-
-    foreachvalue (const Resources& resources, allocations) {
-      // NOTE: `totalScalarQuantities` omits dynamic reservation,
-      // persistent volume info, and allocation info. We additionally
-      // remove the static reservations here via `toUnreserved()`.
-      totalAllocatedReservationScalarQuantities +=
-        resources.reserved().createStrippedScalarQuantity().toUnreserved();
-    }
-  }
+  //   available headroom = unreserved non-revocable resources -
+  //                        allocated unreserved non-revocable resources
+  Resources availableHeadroom = unreservedScalarQuantities -
+    Resources::sum(unreservedAllocationScalarQuantities);
 
-  // Subtract total unallocated reservations.
-  availableHeadroom -=
-    Resources::sum(reservationScalarQuantities) -
-    totalAllocatedReservationScalarQuantities;
+  trace->quotaHeadroom = phase.elapsed();
 
-  // Subtract revocable resources.
-  foreachvalue (const Slave& slave, slaves) {
-    // NOTE: `totalScalarQuantities` omits dynamic reservation,
-    // persistent volume info, and allocation info. We additionally
-    // remove the static reservations here via `toUnreserved()`.
-    availableHeadroom -= slave.available().revocable()
-      .createStrippedScalarQuantity().toUnreserved();
-  }
+  // Time spent in both allocation stages, from which we derive the time
+  // spent on resource arithmetic by excluding sorting and filtering.
+  Duration stages;
 
   // Due to the two stages in the allocation algorithm and the nature of
   // shared resources being re-offerable even if already allocated, the
@@ -1735,8 +1849,15 @@ void HierarchicalAllocatorProcess::__allocate()
   // we try to satisfy the quota guarantee in this first stage so that those
   // roles with unsatisfied guarantee can have more choices and higher
   // probability in getting their guarantee satisfied.
+  Stopwatch stage;
+  stage.start();
+
   foreach (const SlaveID& slaveId, slaveIds) {
-    foreach (const string& role, quotaRoleSorter->sort()) {
+    phase.start();
+    const vector<string> quotaRoles = quotaRoleSorter->sort();
+    trace->sort += phase.elapsed();
+
+    foreach (const string& role, quotaRoles) {
       CHECK(quotas.contains(role));
 
       const Quota& quota = quotas.at(role);
@@ -1752,10 +1873,16 @@ void HierarchicalAllocatorProcess::__allocate()
       CHECK(frameworkSorters.contains(role));
       const Owned<Sorter>& frameworkSorter = frameworkSorters.at(role);
 
-      foreach (const string& frameworkId_, frameworkSorter->sort()) {
+      phase.start();
+      const vector<string> frameworkIds = frameworkSorter->sort();
+      trace->sort += phase.elapsed();
+
+      foreach (const string& frameworkId_, frameworkIds) {
         FrameworkID frameworkId;
         frameworkId.set_value(frameworkId_);
 
+        ++trace->frameworksConsidered;
+
         CHECK(slaves.contains(slaveId));
         CHECK(frameworks.contains(frameworkId));
 
@@ -1769,29 +1896,32 @@ void HierarchicalAllocatorProcess::__allocate()
         // See MESOS-5634.
         if (filterGpuResources &&
             !framework.capabilities.gpuResources &&
-            slave.total.gpus().getOrElse(0) > 0) {
+            slave.getTotal().gpus().getOrElse(0) > 0) {
+          ++trace->frameworksSkipped;
           continue;
         }
 
         // If this framework is not region-aware, don't offer it
         // resources on agents in remote regions.
         if (!framework.capabilities.regionAware && isRemoteSlave(slave)) {
+          ++trace->frameworksSkipped;
           continue;
         }
 
-        // Calculate the currently available resources on the slave, which
-        // is the difference in non-shared resources between total and
-        // allocated, plus all shared resources on the agent (if applicable).
-        Resources available = slave.available().nonShared();
-
+        // The currently available resources on the slave are the
+        // difference in non-shared resources between total and allocated
+        // (see the cached `Slave::available*()` views), plus all shared
+        // resources on the agent (if applicable).
+        //
         // Since shared resources are offerable even when they are in use, we
         // make one copy of the shared resources available regardless of the
         // past allocations. Offer a shared resource only if it has not been
         // offered in this offer cycle to a framework.
+        Resources availableShared;
         if (framework.capabilities.sharedResources) {
-          available += slave.total.shared();
+          availableShared = slave.getTotal().shared();
           if (offeredSharedResources.contains(slaveId)) {
-            available -= offeredSharedResources[slaveId];
+            availableShared -= offeredSharedResources[slaveId];
           }
         }
 
@@ -1829,7 +1959,12 @@ void HierarchicalAllocatorProcess::__allocate()
         //
         // NOTE: Since we currently only support top-level roles to
         // have quota, there are no ancestor reservations involved here.
-        Resources resources = available.reserved(role).nonRevocable();
+        Resources resources = availableShared.reserved(role).nonRevocable();
+
+        if (slave.availableReservations().contains(role)) {
+          resources +=
+            slave.availableReservations().at(role).nonRevocable();
+        }
 
         // This is a scalar quantity with no meta-data.
         Resources unsatisfiedQuotaGuarantee =
@@ -1846,7 +1981,8 @@ void HierarchicalAllocatorProcess::__allocate()
         // `nonQuotaGuaranteeResources` tentatively.
         Resources nonQuotaGuaranteeResources;
 
-        Resources unreserved = available.nonRevocable().unreserved();
+        Resources unreserved = slave.availableUnreservedNonRevocable() +
+          availableShared.nonRevocable().unreserved();
 
         set<string> quotaGuaranteeResourceNames =
           Resources(quota.info.guarantee()).names();
@@ -1953,7 +2089,8 @@ void HierarchicalAllocatorProcess::__allocate()
         }
 
         // If the framework filters these resources, ignore.
-        if (isFiltered(frameworkId, role, slaveId, resources)) {
+        if (filtered(frameworkId, role, slaveId, resources)) {
+          ++trace->frameworksSkipped;
           continue;
         }
 
@@ -1985,13 +2122,15 @@ void HierarchicalAllocatorProcess::__allocate()
         // in the cluster.
         availableHeadroom -= allocatedUnreserved;
 
-        slave.allocated += resources;
+        slave.allocate(resources);
 
         trackAllocatedResources(slaveId, frameworkId, resources);
       }
     }
   }
 
+  stages += stage.elapsed();
+
   // Similar to the first stage, we will allocate resources while ensuring
   // that the required unreserved non-revocable headroom is still available
   // for unsastified quota guarantees. Otherwise, we will not be able to
@@ -1999,9 +2138,14 @@ void HierarchicalAllocatorProcess::__allocate()
   // revocable resources will always be included in the offers since these
   // are not part of the headroom (and therefore can't be used to satisfy
   // quota guarantees).
+  stage.start();
 
   foreach (const SlaveID& slaveId, slaveIds) {
-    foreach (const string& role, roleSorter->sort()) {
+    phase.start();
+    const vector<string> roles_ = roleSorter->sort();
+    trace->sort += phase.elapsed();
+
+    foreach (const string& role, roles_) {
       // In the second allocation stage, we only allocate
       // for non-quota roles.
       if (quotas.contains(role)) {
@@ -2012,10 +2156,16 @@ void HierarchicalAllocatorProcess::__allocate()
       CHECK(frameworkSorters.contains(role));
       const Owned<Sorter>& frameworkSorter = frameworkSorters.at(role);
 
-      foreach (const string& frameworkId_, frameworkSorter->sort()) {
+      phase.start();
+      const vector<string> frameworkIds = frameworkSorter->sort();
+      trace->sort += phase.elapsed();
+
+      foreach (const string& frameworkId_, frameworkIds) {
         FrameworkID frameworkId;
         frameworkId.set_value(frameworkId_);
 
+        ++trace->frameworksConsidered;
+
         CHECK(slaves.contains(slaveId));
         CHECK(frameworks.contains(frameworkId));
 
@@ -2027,29 +2177,32 @@ void HierarchicalAllocatorProcess::__allocate()
         // See MESOS-5634.
         if (filterGpuResources &&
             !framework.capabilities.gpuResources &&
-            slave.total.gpus().getOrElse(0) > 0) {
+            slave.getTotal().gpus().getOrElse(0) > 0) {
+          ++trace->frameworksSkipped;
           continue;
         }
 
         // If this framework is not region-aware, don't offer it
         // resources on agents in remote regions.
         if (!framework.capabilities.regionAware && isRemoteSlave(slave)) {
+          ++trace->frameworksSkipped;
           continue;
         }
 
-        // Calculate the currently available resources on the slave, which
-        // is the difference in non-shared resources between total and
-        // allocated, plus all shared resources on the agent (if applicable).
-        Resources available = slave.available().nonShared();
-
+        // The currently available resources on the slave are the
+        // difference in non-shared resources between total and allocated
+        // (see the cached `Slave::available*()` views), plus all shared
+        // resources on the agent (if applicable).
+        //
         // Since shared resources are offerable even when they are in use, we
         // make one copy of the shared resources available regardless of the
         // past allocations. Offer a shared resource only if it has not been
         // offered in this offer cycle to a framework.
+        Resources availableShared;
         if (framework.capabilities.sharedResources) {
-          available += slave.total.shared();
+          availableShared = slave.getTotal().shared();
           if (offeredSharedResources.contains(slaveId)) {
-            available -= offeredSharedResources[slaveId];
+            availableShared -= offeredSharedResources[slaveId];
           }
         }
 
@@ -2061,7 +2214,17 @@ void HierarchicalAllocatorProcess::__allocate()
         // Calling reserved('*') returns an empty Resources object.
         //
         // TODO(mpark): Offer unreserved resources as revocable beyond quota.
-        Resources resources = available.allocatableTo(role);
+        Resources resources = slave.availableUnreserved() +
+          availableShared.allocatableTo(role);
+
+        foreachpair (const string& reservationRole,
+                     const Resources& reserved,
+                     slave.availableReservations()) {
+          if (role == reservationRole ||
+              roles::isStrictSubroleOf(role, reservationRole)) {
+            resources += reserved;
+          }
+        }
 
         // It is safe to break here, because all frameworks under a role would
         // consider the same resources, so in case we don't have allocatable
@@ -2119,7 +2282,8 @@ void HierarchicalAllocatorProcess::__allocate()
         }
 
         // If the framework filters these resources, ignore.
-        if (isFiltered(frameworkId, role, slaveId, resources)) {
+        if (filtered(frameworkId, role, slaveId, resources)) {
+          ++trace->frameworksSkipped;
           continue;
         }
 
@@ -2138,13 +2302,22 @@ void HierarchicalAllocatorProcess::__allocate()
             headroomToAllocate.createStrippedScalarQuantity();
         }
 
-        slave.allocated += resources;
+        slave.allocate(resources);
 
         trackAllocatedResources(slaveId, frameworkId, resources);
       }
     }
   }
 
+  stages += stage.elapsed();
+
+  // NOTE: In runs where the offer filter checks are not timed, their
+  // time is accounted to the resource arithmetic.
+  trace->resources =
+    stages - trace->sort - trace->filter.getOrElse(Duration::zero());
+
+  phase.start();
+
   if (offerable.empty()) {
     VLOG(2) << "No allocations performed";
   } else {
@@ -2153,6 +2326,51 @@ void HierarchicalAllocatorProcess::__allocate()
       offerCallback(frameworkId, offerable.at(frameworkId));
     }
   }
+
+  trace->offerCallback = phase.elapsed();
+  trace->offers = offerable.size();
+}
+
+
+string HierarchicalAllocatorProcess::ALLOCATION_RUNS_HELP()
+{
+  return HELP(
+      TLDR(
+          "Shows where the time went in the most recent allocation runs."),
+      DESCRIPTION(
+          "Returns a JSON array with a trace of each of the most recent",
+          "allocation runs, oldest first. Each trace contains the time",
+          "spent in the phases of the allocation algorithm (sorting,",
+          "quota headroom computation, offer filter checks, resource",
+          "arithmetic and offer callbacks) as well as the number of",
+          "agents and frameworks that were considered and skipped."),
+      AUTHENTICATION(true),
+      AUTHORIZATION(
+          "The request principal must be authorized to view the",
+          "allocation runs (see the `view_allocation_runs` ACL)."));
+}
+
+
+Future<Response> HierarchicalAllocatorProcess::allocationRuns(
+    const process::http::Request& request,
+    const Option<Principal>& principal)
+{
+  return ObjectApprovers::create(
+      authorizer, principal, {authorization::VIEW_ALLOCATION_RUNS})
+    .then(defer(
+        self(),
+        [this, request](const Owned<ObjectApprovers>& approvers)
+          -> Future<Response> {
+          if (!approvers->approved<authorization::VIEW_ALLOCATION_RUNS>()) {
+            return Forbidden();
+          }
+
+          return OK(jsonify([this](JSON::ArrayWriter* writer) {
+            foreach (const AllocationRunTrace& trace, allocationRunTraces) {
+              writer->element(trace);
+            }
+          }), request.url.query.get("jsonp"));
+        }));
 }
 
 
@@ -2256,56 +2474,60 @@ void HierarchicalAllocatorProcess::deallocate()
 }
 
 
-void HierarchicalAllocatorProcess::_expire(
-    const FrameworkID& frameworkId,
-    const string& role,
-    const SlaveID& slaveId,
-    OfferFilter* offerFilter)
+Time HierarchicalAllocatorProcess::offerFilterBucket(const Time& expiry) const
 {
-  // The filter might have already been removed (e.g., if the
-  // framework no longer exists or in `reviveOffers()`) but not
-  // yet deleted (to keep the address from getting reused
-  // possibly causing premature expiration).
-  //
-  // Since this is a performance-sensitive piece of code,
-  // we use find to avoid the doing any redundant lookups.
+  const int64_t granularity = OFFER_FILTER_EXPIRY_GRANULARITY.ns();
+  const int64_t elapsed = std::max((expiry - initializedTime).ns(), int64_t(0));
+
+  return initializedTime +
+    Nanoseconds(((elapsed + granularity - 1) / granularity) * granularity);
+}
 
-  auto frameworkIterator = frameworks.find(frameworkId);
-  if (frameworkIterator != frameworks.end()) {
-    Framework& framework = frameworkIterator->second;
 
-    auto roleFilters = framework.offerFilters.find(role);
-    if (roleFilters != framework.offerFilters.end()) {
-      auto agentFilters = roleFilters->second.find(slaveId);
+void HierarchicalAllocatorProcess::expireOfferFilters(const Time& expiry)
+{
+  dispatch(self(), &Self::_expireOfferFilters, expiry);
+}
 
-      if (agentFilters != roleFilters->second.end()) {
-        // Erase the filter (may be a no-op per the comment above).
-        agentFilters->second.erase(offerFilter);
 
-        if (agentFilters->second.empty()) {
-          roleFilters->second.erase(slaveId);
+void HierarchicalAllocatorProcess::_expireOfferFilters(const Time& expiry)
+{
+  auto expiries = offerFilterExpiries.find(expiry);
+  if (expiries == offerFilterExpiries.end()) {
+    return;
+  }
+
+  foreach (const OfferFilterExpiry& expired, expiries->second) {
+    // The filter might have already been removed (e.g., if the
+    // framework no longer exists or in `reviveOffers()`) but not
+    // yet deleted (to keep the address from getting reused
+    // possibly causing premature expiration).
+    //
+    // Since this is a performance-sensitive piece of code,
+    // we use find to avoid the doing any redundant lookups.
+    auto frameworkIterator = frameworks.find(expired.frameworkId);
+    if (frameworkIterator != frameworks.end()) {
+      Framework& framework = frameworkIterator->second;
+
+      auto roleFilters = framework.offerFilters.find(expired.role);
+      if (roleFilters != framework.offerFilters.end()) {
+        auto agentFilters = roleFilters->second.find(expired.slaveId);
+
+        if (agentFilters != roleFilters->second.end()) {
+          // Erase the filter (may be a no-op per the comment above).
+          agentFilters->second.remove(expired.offerFilter);
+
+          if (agentFilters->second.empty()) {
+            roleFilters->second.erase(expired.slaveId);
+          }
         }
       }
     }
-  }
-
-  delete offerFilter;
-}
 
+    delete expired.offerFilter;
+  }
 
-void HierarchicalAllocatorProcess::expire(
-    const FrameworkID& frameworkId,
-    const string& role,
-    const SlaveID& slaveId,
-    OfferFilter* offerFilter)
-{
-  dispatch(
-      self(),
-      &Self::_expire,
-      frameworkId,
-      role,
-      slaveId,
-      offerFilter);
+  offerFilterExpiries.erase(expiries);
 }
 
 
@@ -2403,15 +2625,13 @@ bool HierarchicalAllocatorProcess::isFiltered(
     return false;
   }
 
-  foreach (OfferFilter* offerFilter, agentFilters->second) {
-    if (offerFilter->filter(resources)) {
-      VLOG(1) << "Filtered offer with " << resources
-              << " on agent " << slaveId
-              << " for role " << role
-              << " of framework " << frameworkId;
+  if (agentFilters->second.filter(resources)) {
+    VLOG(1) << "Filtered offer with " << resources
+            << " on agent " << slaveId
+            << " for role " << role
+            << " of framework " << frameworkId;
 
-      return true;
-    }
+    return true;
   }
 
   return false;
@@ -2461,7 +2681,7 @@ double HierarchicalAllocatorProcess::_resources_offered_or_allocated(
 
   foreachvalue (const Slave& slave, slaves) {
     Option<Value::Scalar> value =
-      slave.allocated.get<Value::Scalar>(resource);
+      slave.getAllocated().get<Value::Scalar>(resource);
 
     if (value.isSome()) {
       offered_or_allocated += value->value();
@@ -2623,6 +2843,45 @@ void HierarchicalAllocatorProcess::untrackReservations(
 }
 
 
+void HierarchicalAllocatorProcess::trackUnreservedAllocation(
+    const string& role,
+    const Resources& allocation)
+{
+  // NOTE: Shared resources are always reserved, so the unreserved
+  // portion of an allocation never double counts them.
+  const Resources scalarQuantitiesToTrack =
+    allocation.unreserved().nonRevocable().createStrippedScalarQuantity();
+
+  if (!scalarQuantitiesToTrack.empty()) {
+    unreservedAllocationScalarQuantities[role] += scalarQuantitiesToTrack;
+  }
+}
+
+
+void HierarchicalAllocatorProcess::untrackUnreservedAllocation(
+    const string& role,
+    const Resources& allocation)
+{
+  const Resources scalarQuantitiesToUntrack =
+    allocation.unreserved().nonRevocable().createStrippedScalarQuantity();
+
+  if (scalarQuantitiesToUntrack.empty()) {
+    return;
+  }
+
+  CHECK(unreservedAllocationScalarQuantities.contains(role));
+  Resources& currentAllocationQuantity =
+    unreservedAllocationScalarQuantities.at(role);
+
+  CHECK(currentAllocationQuantity.contains(scalarQuantitiesToUntrack));
+  currentAllocationQuantity -= scalarQuantitiesToUntrack;
+
+  if (currentAllocationQuantity.empty()) {
+    unreservedAllocationScalarQuantities.erase(role);
+  }
+}
+
+
 bool HierarchicalAllocatorProcess::updateSlaveTotal(
     const SlaveID& slaveId,
     const Resources& total)
@@ -2631,13 +2890,13 @@ bool HierarchicalAllocatorProcess::updateSlaveTotal(
 
   Slave& slave = slaves.at(slaveId);
 
-  const Resources oldTotal = slave.total;
+  const Resources oldTotal = slave.getTotal();
 
   if (oldTotal == total) {
     return false;
   }
 
-  slave.total = total;
+  slave.updateTotal(total);
 
   hashmap<std::string, Resources> oldReservations = oldTotal.reservations();
   hashmap<std::string, Resources> newReservations = total.reservations();
@@ -2647,6 +2906,11 @@ bool HierarchicalAllocatorProcess::updateSlaveTotal(
     trackReservations(newReservations);
   }
 
+  unreservedScalarQuantities -=
+    oldTotal.unreserved().nonRevocable().createStrippedScalarQuantity();
+  unreservedScalarQuantities +=
+    total.unreserved().nonRevocable().createStrippedScalarQuantity();
+
   // Currently `roleSorter` and `quotaRoleSorter`, being the root-level
   // sorters, maintain all of `slaves[slaveId].total` (or the `nonRevocable()`
   // portion in the case of `quotaRoleSorter`) in their own totals (which
@@ -2663,6 +2927,112 @@ bool HierarchicalAllocatorProcess::updateSlaveTotal(
 }
 
 
+HierarchicalAllocatorProcess::Slave::Views&
+HierarchicalAllocatorProcess::Slave::views()
+{
+  if (views_.version != version) {
+    views_ = Views();
+    views_.version = version;
+  }
+
+  return views_;
+}
+
+
+const Resources& HierarchicalAllocatorProcess::Slave::available()
+{
+  Views& cached = views();
+
+  if (cached.available.isNone()) {
+    // In order to subtract from the total,
+    // we strip the allocation information.
+    Resources allocated_ = allocated;
+    allocated_.unallocate();
+
+    cached.available = total - allocated_;
+  }
+
+  return cached.available.get();
+}
+
+
+const Resources& HierarchicalAllocatorProcess::Slave::availableNonShared()
+{
+  const Resources& available_ = available();
+
+  Views& cached = views();
+
+  if (cached.nonShared.isNone()) {
+    cached.nonShared = available_.nonShared();
+  }
+
+  return cached.nonShared.get();
+}
+
+
+const Resources& HierarchicalAllocatorProcess::Slave::availableUnreserved()
+{
+  const Resources& nonShared = availableNonShared();
+
+  Views& cached = views();
+
+  if (cached.unreserved.isNone()) {
+    cached.unreserved = nonShared.unreserved();
+  }
+
+  return cached.unreserved.get();
+}
+
+
+const Resources&
+HierarchicalAllocatorProcess::Slave::availableUnreservedNonRevocable()
+{
+  const Resources& unreserved = availableUnreserved();
+
+  Views& cached = views();
+
+  if (cached.unreservedNonRevocable.isNone()) {
+    cached.unreservedNonRevocable = unreserved.nonRevocable();
+  }
+
+  return cached.unreservedNonRevocable.get();
+}
+
+
+const hashmap<string, Resources>&
+HierarchicalAllocatorProcess::Slave::availableReservations()
+{
+  const Resources& nonShared = availableNonShared();
+
+  Views& cached = views();
+
+  if (cached.reservations.isNone()) {
+    cached.reservations = nonShared.reservations();
+  }
+
+  return cached.reservations.get();
+}
+
+
+const Resources&
+HierarchicalAllocatorProcess::Slave::availableRevocableScalarQuantities()
+{
+  const Resources& available_ = available();
+
+  Views& cached = views();
+
+  if (cached.revocableScalarQuantities.isNone()) {
+    // NOTE: `createStrippedScalarQuantity` omits dynamic reservation,
+    // persistent volume info, and allocation info. We additionally
+    // remove the static reservations here via `toUnreserved()`.
+    cached.revocableScalarQuantities =
+      available_.revocable().createStrippedScalarQuantity().toUnreserved();
+  }
+
+  return cached.revocableScalarQuantities.get();
+}
+
+
 bool HierarchicalAllocatorProcess::isRemoteSlave(const Slave& slave) const
 {
   // If the slave does not have a configured domain, assume it is not remote.
@@ -2730,6 +3100,8 @@ void HierarchicalAllocatorProcess::trackAllocatedResources(
       // See comment at `quotaRoleSorter` declaration regarding non-revocable.
       quotaRoleSorter->allocated(role, slaveId, allocation.nonRevocable());
     }
+
+    trackUnreservedAllocation(role, allocation);
   }
 }
 
@@ -2766,6 +3138,8 @@ void HierarchicalAllocatorProcess::untrackAllocatedResources(
       // See comment at `quotaRoleSorter` declaration regarding non-revocable.
       quotaRoleSorter->unallocated(role, slaveId, allocation.nonRevocable());
     }
+
+    untrackUnreservedAllocation(role, allocation);
   }
 }
 
@@ -17,14 +17,22 @@
 #ifndef __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 #define __MASTER_ALLOCATOR_MESOS_HIERARCHICAL_HPP__
 
+#include <map>
 #include <set>
 #include <string>
+#include <utility>
+#include <vector>
+
+#include <boost/circular_buffer.hpp>
 
 #include <mesos/mesos.hpp>
+#include <mesos/resources.hpp>
 
 #include <process/future.hpp>
+#include <process/http.hpp>
 #include <process/id.hpp>
 #include <process/owned.hpp>
+#include <process/time.hpp>
 
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
@@ -68,6 +76,39 @@ class OfferFilter;
 class InverseOfferFilter;
 
 
+// The offer filters of a framework for one of its roles on an agent.
+//
+// While a framework keeps declining the resources of an agent, every
+// allocation cycle checks the same resources against its filters, so
+// the result of the last check is kept until the filters change. This
+// saves evaluating each filter of the agent again on every cycle.
+class OfferFilters
+{
+public:
+  // Returns true if one of the filters filters the resources.
+  bool filter(const Resources& resources) const;
+
+  // Returns true if one of the filters subsumes `offerFilter`.
+  bool subsumes(const OfferFilter& offerFilter) const;
+
+  // Adds the filter, removing the filters that it subsumes.
+  void add(OfferFilter* offerFilter);
+
+  // Removes the filter (if present).
+  void remove(OfferFilter* offerFilter);
+
+  bool empty() const { return offerFilters.empty(); }
+  size_t size() const { return offerFilters.size(); }
+
+private:
+  hashset<OfferFilter*> offerFilters;
+
+  // The resources last checked by `filter()`, and whether they were
+  // filtered.
+  mutable Option<std::pair<Resources, bool>> last;
+};
+
+
 // Implements the basic allocator algorithm - first pick a role by
 // some criteria, then pick one of their frameworks to allocate to.
 class HierarchicalAllocatorProcess : public MesosAllocatorProcess
@@ -80,6 +121,7 @@ public:
     : initialized(false),
       paused(true),
       metrics(*this),
+      allocationRunTraces(MAX_ALLOCATION_RUN_TRACES),
       roleSorter(roleSorterFactory()),
       quotaRoleSorter(quotaRoleSorterFactory()),
       frameworkSorterFactory(_frameworkSorterFactory) {}
@@ -106,6 +148,8 @@ public:
       bool filterGpuResources = true,
       const Option<DomainInfo>& domain = None());
 
+  void setAuthorizer(const Option<Authorizer*>& authorizer);
+
   void recover(
       const int _expectedAgentCount,
       const hashmap<std::string, Quota>& quotas);
@@ -238,24 +282,23 @@ protected:
   // Method that performs allocation work.
   Nothing _allocate();
 
-  // Helper for `_allocate()` that allocates resources for offers.
-  void __allocate();
+  // Helper for `_allocate()` that allocates resources for offers. The
+  // time spent in each phase is accumulated into the given trace.
+  void __allocate(AllocationRunTrace* trace);
 
   // Helper for `_allocate()` that deallocates resources for inverse offers.
   void deallocate();
 
-  // Remove an offer filter for the specified role of the framework.
-  void expire(
-      const FrameworkID& frameworkId,
-      const std::string& role,
-      const SlaveID& slaveId,
-      OfferFilter* offerFilter);
+  // Returns the expiration time of the offer filter bucket for a filter
+  // that expires at the specified time. This is the first multiple of
+  // `OFFER_FILTER_EXPIRY_GRANULARITY` since the allocator was initialized
+  // that is not earlier than the specified time.
+  process::Time offerFilterBucket(const process::Time& expiry) const;
 
-  void _expire(
-      const FrameworkID& frameworkId,
-      const std::string& role,
-      const SlaveID& slaveId,
-      OfferFilter* offerFilter);
+  // Remove all the offer filters that expire at the specified time.
+  void expireOfferFilters(const process::Time& expiry);
+
+  void _expireOfferFilters(const process::Time& expiry);
 
   // Remove an inverse offer filter for the specified framework.
   void expire(
@@ -283,6 +326,10 @@ protected:
   static bool allocatable(const Resources& resources);
 
   bool initialized;
+
+  // The time at which the allocator was initialized, which the offer
+  // filter buckets are aligned to.
+  process::Time initializedTime;
   bool paused;
 
   // Recovery data.
@@ -303,6 +350,22 @@ protected:
   friend Metrics;
   Metrics metrics;
 
+  // Traces of the most recent allocation runs, see `allocationRuns()`.
+  boost::circular_buffer<AllocationRunTrace> allocationRunTraces;
+
+  // The number of allocation runs so far, used to sample the runs in
+  // which offer filter checks are timed.
+  size_t allocationRunCount = 0;
+
+  // Handler for the `allocation_runs` endpoint, which returns the
+  // traces of the most recent allocation runs.
+  process::Future<process::http::Response> allocationRuns(
+      const process::http::Request& request,
+      const Option<process::http::authentication::Principal>&
+        principal);
+
+  static std::string ALLOCATION_RUNS_HELP();
+
   struct Framework
   {
     Framework(
@@ -319,7 +382,7 @@ protected:
     // Active offer and inverse offer filters for the framework.
     // Offer filters are tied to the role the filtered resources
     // were allocated to.
-    hashmap<std::string, hashmap<SlaveID, hashset<OfferFilter*>>> offerFilters;
+    hashmap<std::string, hashmap<SlaveID, OfferFilters>> offerFilters;
     hashmap<SlaveID, hashset<InverseOfferFilter*>> inverseOfferFilters;
 
     bool active;
@@ -345,23 +408,53 @@ protected:
 
   hashmap<FrameworkID, Framework> frameworks;
 
-  struct Slave
+  struct OfferFilterExpiry
   {
-    // Total amount of regular *and* oversubscribed resources.
-    Resources total;
+    FrameworkID frameworkId;
+    std::string role;
+    SlaveID slaveId;
+    OfferFilter* offerFilter;
+  };
 
-    // Regular *and* oversubscribed resources that are allocated.
-    //
-    // NOTE: We maintain multiple copies of each shared resource allocated
-    // to a slave, where the number of copies represents the number of times
-    // this shared resource has been allocated to (and has not been recovered
-    // from) a specific framework.
-    //
-    // NOTE: We keep track of slave's allocated resources despite
-    // having that information in sorters. This is because the
-    // information in sorters is not accurate if some framework
-    // hasn't reregistered. See MESOS-2919 for details.
-    Resources allocated;
+  // Offer filters keyed by the expiration time of their bucket. Rather
+  // than having a timer for each offer filter, expiration times are
+  // rounded up to `OFFER_FILTER_EXPIRY_GRANULARITY` and a single timer
+  // is scheduled for each bucket, which expires all the offer filters
+  // in it at once. Rounding up only delays the removal of a filter, so
+  // it is still not removed before the next allocation (MESOS-4302).
+  //
+  // NOTE: A bucket also holds the offer filters that were already
+  // removed from the framework before their expiration (e.g., upon
+  // REVIVE). They are only deleted once the bucket expires, see the
+  // comments in `reviveOffers()`.
+  std::map<process::Time, std::vector<OfferFilterExpiry>> offerFilterExpiries;
+
+  class Slave
+  {
+  public:
+    Slave() : activated(false), version(0) {}
+
+    const Resources& getTotal() const { return total; }
+
+    const Resources& getAllocated() const { return allocated; }
+
+    void updateTotal(const Resources& newTotal)
+    {
+      total = newTotal;
+      ++version;
+    }
+
+    void allocate(const Resources& toAllocate)
+    {
+      allocated += toAllocate;
+      ++version;
+    }
+
+    void unallocate(const Resources& toUnallocate)
+    {
+      allocated -= toUnallocate;
+      ++version;
+    }
 
     // We track the total and allocated resources on the slave, the
     // available resources are computed as follows:
@@ -370,15 +463,23 @@ protected:
     //
     // Note that it's possible for the slave to be over-allocated!
     // In this case, allocated > total.
-    Resources available() const
-    {
-      // In order to subtract from the total,
-      // we strip the allocation information.
-      Resources allocated_ = allocated;
-      allocated_.unallocate();
+    const Resources& available();
 
-      return total - allocated_;
-    }
+    // The following are views of the available resources that are
+    // needed by the allocation loop. Note that all but the last one
+    // only include the *non-shared* available resources.
+    const Resources& availableNonShared();
+
+    const Resources& availableUnreserved();
+
+    const Resources& availableUnreservedNonRevocable();
+
+    // Available reservations keyed by the reservation role.
+    const hashmap<std::string, Resources>& availableReservations();
+
+    // NOTE: This is a quantity with no meta-data (including any static
+    // reservations), for use in the quota headroom computation.
+    const Resources& availableRevocableScalarQuantities();
 
     bool activated;  // Whether to offer resources.
 
@@ -425,6 +526,55 @@ protected:
     // a given point in time, for an optional duration. This information is used
     // to send out `InverseOffers`.
     Option<Maintenance> maintenance;
+
+  private:
+    // Total amount of regular *and* oversubscribed resources.
+    Resources total;
+
+    // Regular *and* oversubscribed resources that are allocated.
+    //
+    // NOTE: We maintain multiple copies of each shared resource allocated
+    // to a slave, where the number of copies represents the number of times
+    // this shared resource has been allocated to (and has not been recovered
+    // from) a specific framework.
+    //
+    // NOTE: We keep track of slave's allocated resources despite
+    // having that information in sorters. This is because the
+    // information in sorters is not accurate if some framework
+    // hasn't reregistered. See MESOS-2919 for details.
+    Resources allocated;
+
+    // Bumped whenever `total` or `allocated` changes, i.e., when the
+    // agent total is updated and when resources are allocated or
+    // recovered.
+    uint64_t version;
+
+    // Computing the views of the available resources is expensive
+    // (each one filters or copies all the resources of the agent) and
+    // was previously done for every framework considered on every
+    // agent in every allocation cycle. Instead, they are computed on
+    // demand and cached along with the `version` they were derived
+    // from. This allows an allocation cycle to reuse them across the
+    // frameworks that do not end up being allocated anything on this
+    // agent, and across cycles for agents whose resources have not
+    // changed.
+    struct Views
+    {
+      Views() : version(0) {}
+
+      uint64_t version;
+
+      Option<Resources> available;
+      Option<Resources> nonShared;
+      Option<Resources> unreserved;
+      Option<Resources> unreservedNonRevocable;
+      Option<hashmap<std::string, Resources>> reservations;
+      Option<Resources> revocableScalarQuantities;
+    } views_;
+
+    // Returns the cached views, discarding them first if the total or
+    // allocated resources have changed since they were computed.
+    Views& views();
   };
 
   hashmap<SlaveID, Slave> slaves;
@@ -455,6 +605,21 @@ protected:
   // Only roles with non-empty reservations will be stored in the map.
   hashmap<std::string, Resources> reservationScalarQuantities;
 
+  // Aggregated unreserved non-revocable resources on all agents. These
+  // are stripped scalar quantities that contain no meta-data. Together
+  // with `unreservedAllocationScalarQuantities` this lets the allocator
+  // compute the available quota headroom without iterating over all
+  // roles and agents in every allocation cycle.
+  Resources unreservedScalarQuantities;
+
+  // Aggregated unreserved non-revocable resources allocated to each
+  // role. These are stripped scalar quantities that contain no meta-data.
+  // A role's consumed quota is its reservations plus this allocation.
+  //
+  // Only roles with non-empty unreserved allocations will be stored in
+  // the map.
+  hashmap<std::string, Resources> unreservedAllocationScalarQuantities;
+
   // Slaves to send offers for.
   Option<hashset<std::string>> whitelist;
 
@@ -467,6 +632,10 @@ protected:
   // The master's domain, if any.
   Option<DomainInfo> domain;
 
+  // The master's authorizer, if any, used to authorize requests to
+  // the allocator's endpoints.
+  Option<Authorizer*> authorizer;
+
   // There are two stages of allocation:
   //
   //   Stage 1: Allocate to satisfy quota guarantees.
@@ -570,6 +739,16 @@ private:
   void untrackReservations(
       const hashmap<std::string, Resources>& reservations);
 
+  // Helpers to track and untrack the unreserved non-revocable resources
+  // allocated to a role, see `unreservedAllocationScalarQuantities`.
+  void trackUnreservedAllocation(
+      const std::string& role,
+      const Resources& allocation);
+
+  void untrackUnreservedAllocation(
+      const std::string& role,
+      const Resources& allocation);
+
   // Helper to update the agent's total resources maintained in the allocator
   // and the role and quota sorters (whose total resources match the agent's
   // total resources). Returns true iff the stored agent total was changed.
@@ -24,6 +24,7 @@
 #include <process/metrics/metrics.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/jsonify.hpp>
 
 #include "master/allocator/mesos/hierarchical.hpp"
 
@@ -37,6 +38,26 @@ namespace master {
 namespace allocator {
 namespace internal {
 
+void json(JSON::ObjectWriter* writer, const AllocationRunTrace& trace)
+{
+  writer->field("start", trace.start.secs());
+  writer->field("total_ms", trace.total.ms());
+  writer->field("sort_ms", trace.sort.ms());
+  writer->field("quota_headroom_ms", trace.quotaHeadroom.ms());
+  if (trace.filter.isSome()) {
+    writer->field("filter_ms", trace.filter->ms());
+  }
+
+  writer->field("resources_ms", trace.resources.ms());
+  writer->field("offer_callback_ms", trace.offerCallback.ms());
+  writer->field("agents_considered", trace.agentsConsidered);
+  writer->field("agents_skipped", trace.agentsSkipped);
+  writer->field("frameworks_considered", trace.frameworksConsidered);
+  writer->field("frameworks_skipped", trace.frameworksSkipped);
+  writer->field("offers", trace.offers);
+}
+
+
 Metrics::Metrics(const HierarchicalAllocatorProcess& _allocator)
   : allocator(_allocator.self()),
     event_queue_dispatches(
@@ -49,13 +70,38 @@ Metrics::Metrics(const HierarchicalAllocatorProcess& _allocator)
             allocator, &HierarchicalAllocatorProcess::_event_queue_dispatches)),
     allocation_runs("allocator/mesos/allocation_runs"),
     allocation_run("allocator/mesos/allocation_run", Hours(1)),
-    allocation_run_latency("allocator/mesos/allocation_run_latency", Hours(1))
+    allocation_run_latency("allocator/mesos/allocation_run_latency", Hours(1)),
+    allocation_run_sort("allocator/mesos/allocation_run_sort", Hours(1)),
+    allocation_run_quota_headroom(
+        "allocator/mesos/allocation_run_quota_headroom", Hours(1)),
+    allocation_run_filter("allocator/mesos/allocation_run_filter", Hours(1)),
+    allocation_run_resources(
+        "allocator/mesos/allocation_run_resources", Hours(1)),
+    allocation_run_offer_callback(
+        "allocator/mesos/allocation_run_offer_callback", Hours(1)),
+    allocation_run_agents_considered(
+        "allocator/mesos/allocation_run_agents_considered"),
+    allocation_run_agents_skipped(
+        "allocator/mesos/allocation_run_agents_skipped"),
+    allocation_run_frameworks_considered(
+        "allocator/mesos/allocation_run_frameworks_considered"),
+    allocation_run_frameworks_skipped(
+        "allocator/mesos/allocation_run_frameworks_skipped")
 {
   process::metrics::add(event_queue_dispatches);
   process::metrics::add(event_queue_dispatches_);
   process::metrics::add(allocation_runs);
   process::metrics::add(allocation_run);
   process::metrics::add(allocation_run_latency);
+  process::metrics::add(allocation_run_sort);
+  process::metrics::add(allocation_run_quota_headroom);
+  process::metrics::add(allocation_run_filter);
+  process::metrics::add(allocation_run_resources);
+  process::metrics::add(allocation_run_offer_callback);
+  process::metrics::add(allocation_run_agents_considered);
+  process::metrics::add(allocation_run_agents_skipped);
+  process::metrics::add(allocation_run_frameworks_considered);
+  process::metrics::add(allocation_run_frameworks_skipped);
 
   // Create and install gauges for the total and allocated
   // amount of standard scalar resources.
@@ -95,6 +141,15 @@ Metrics::~Metrics()
   process::metrics::remove(allocation_runs);
   process::metrics::remove(allocation_run);
   process::metrics::remove(allocation_run_latency);
+  process::metrics::remove(allocation_run_sort);
+  process::metrics::remove(allocation_run_quota_headroom);
+  process::metrics::remove(allocation_run_filter);
+  process::metrics::remove(allocation_run_resources);
+  process::metrics::remove(allocation_run_offer_callback);
+  process::metrics::remove(allocation_run_agents_considered);
+  process::metrics::remove(allocation_run_agents_skipped);
+  process::metrics::remove(allocation_run_frameworks_considered);
+  process::metrics::remove(allocation_run_frameworks_skipped);
 
   foreach (const Gauge& gauge, resources_total) {
     process::metrics::remove(gauge);
@@ -27,8 +27,11 @@
 #include <process/metrics/timer.hpp>
 
 #include <process/pid.hpp>
+#include <process/time.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
+#include <stout/jsonify.hpp>
 
 namespace mesos {
 namespace internal {
@@ -39,6 +42,42 @@ namespace internal {
 // Forward declarations.
 class HierarchicalAllocatorProcess;
 
+// Breakdown of where the time went within a single allocation run.
+// The phase durations are accumulated over the whole run, e.g.,
+// `filter` is the sum of the time spent in all offer filter checks.
+// The offer filter checks are only timed in sampled runs, see
+// `ALLOCATION_RUN_FILTER_SAMPLING`.
+struct AllocationRunTrace
+{
+  process::Time start;
+
+  Duration total;
+  Duration sort;
+  Duration quotaHeadroom;
+  Option<Duration> filter;
+  Duration resources;
+  Duration offerCallback;
+
+  // Agents that are allocation candidates in this run, and those that
+  // were skipped because they are removed, deactivated or not
+  // whitelisted.
+  size_t agentsConsidered = 0;
+  size_t agentsSkipped = 0;
+
+  // Frameworks considered for an agent, and those that were skipped
+  // because of their capabilities or offer filters. These are counted
+  // once for each agent a framework is considered for.
+  size_t frameworksConsidered = 0;
+  size_t frameworksSkipped = 0;
+
+  // Number of frameworks that received offers in this run.
+  size_t offers = 0;
+};
+
+
+void json(JSON::ObjectWriter* writer, const AllocationRunTrace& trace);
+
+
 // Collection of metrics for the allocator; these begin
 // with the following prefix: `allocator/mesos/`.
 struct Metrics
@@ -72,6 +111,21 @@ struct Metrics
   // The latency of allocation runs due to the batching of allocation requests.
   process::metrics::Timer<Milliseconds> allocation_run_latency;
 
+  // Time spent in each phase of the allocation algorithm,
+  // see `AllocationRunTrace`.
+  process::metrics::Timer<Milliseconds> allocation_run_sort;
+  process::metrics::Timer<Milliseconds> allocation_run_quota_headroom;
+  process::metrics::Timer<Milliseconds> allocation_run_filter;
+  process::metrics::Timer<Milliseconds> allocation_run_resources;
+  process::metrics::Timer<Milliseconds> allocation_run_offer_callback;
+
+  // Number of agents and frameworks considered or skipped by the
+  // allocation algorithm, see `AllocationRunTrace`.
+  process::metrics::Counter allocation_run_agents_considered;
+  process::metrics::Counter allocation_run_agents_skipped;
+  process::metrics::Counter allocation_run_frameworks_considered;
+  process::metrics::Counter allocation_run_frameworks_skipped;
+
   // Gauges for the total amount of each resource in the cluster.
   std::vector<process::metrics::Gauge> resources_total;
 
@@ -47,6 +47,11 @@ constexpr double MIN_CPUS = 0.01;
 // Minimum amount of memory per offer.
 constexpr Bytes MIN_MEM = Megabytes(32);
 
+// Granularity to which the allocator rounds up the expiration time of
+// offer filters, so that filters expiring close to each other share a
+// single timer and are removed together.
+constexpr Duration OFFER_FILTER_EXPIRY_GRANULARITY = Seconds(1);
+
 // Default interval the master uses to send heartbeats to an HTTP
 // scheduler.
 constexpr Duration DEFAULT_HEARTBEAT_INTERVAL = Seconds(15);
@@ -94,6 +99,15 @@ constexpr size_t DEFAULT_MAX_COMPLETED_TASKS_PER_FRAMEWORK = 1000;
 // to store in the cache.
 constexpr size_t DEFAULT_MAX_UNREACHABLE_TASKS_PER_FRAMEWORK = 1000;
 
+// Maximum number of recent allocation runs whose trace is kept by the
+// allocator for the `allocation_runs` endpoint.
+constexpr size_t MAX_ALLOCATION_RUN_TRACES = 20;
+
+// The allocator times its offer filter checks in one out of this many
+// allocation runs. The checks are made for every framework and agent
+// pair, so timing each of them in every run would add to their cost.
+constexpr size_t ALLOCATION_RUN_FILTER_SAMPLING = 10;
+
 // Time interval to check for updated watchers list.
 constexpr Duration WHITELIST_WATCH_INTERVAL = Seconds(5);
 
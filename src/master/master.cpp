@@ -774,6 +774,8 @@ void Master::initialize()
       flags.filter_gpu_resources,
       flags.domain);
 
+  allocator->setAuthorizer(authorizer);
+
   // Parse the whitelist. Passing Allocator::updateWhitelist()
   // callback is safe because we shut down the whitelistWatcher in
   // Master::finalize(), while allocator lifetime is greater than
@@ -3213,7 +3215,7 @@ void Master::disconnect(Framework* framework)
 
     // Close the HTTP connection, which may already have
     // been closed due to scheduler disconnection.
-    framework->http->close();
+    process::dispatch(framework->encoder.get(), &StreamingEncoder::close);
   }
 }
 
@@ -9592,7 +9594,7 @@ void Master::removeFramework(Framework* framework)
 
   // For http frameworks, close the connection.
   if (framework->http.isSome()) {
-    framework->http->close();
+    process::dispatch(framework->encoder.get(), &StreamingEncoder::close);
   }
 
   framework->unregisteredTime = Clock::now();
@@ -11139,14 +11141,20 @@ void Master::Subscribers::send(
   Shared<Task> sharedTask(task.isSome() ? new Task(task.get()) : nullptr);
 
   foreachvalue (const Owned<Subscriber>& subscriber, subscribed) {
+    // NOTE: We capture the connection rather than the subscriber, which
+    // is destroyed on the master actor without waiting for its encoder
+    // to terminate.
+    const HttpConnection http = subscriber->http;
+
     ObjectApprovers::create(
         master->authorizer,
         subscriber->principal,
         {VIEW_ROLE, VIEW_FRAMEWORK, VIEW_TASK, VIEW_EXECUTOR})
       .then(defer(
-          master->self(),
+          subscriber->encoder,
           [=](const Owned<ObjectApprovers>& approvers) {
-            subscriber->send(
+            Subscriber::send(
+                http,
                 sharedEvent,
                 approvers,
                 sharedFrameworkInfo,
@@ -11159,6 +11167,7 @@ void Master::Subscribers::send(
 
 
 void Master::Subscribers::Subscriber::send(
+    HttpConnection http,
     const Shared<mesos::master::Event>& event,
     const Owned<ObjectApprovers>& approvers,
     const Shared<FrameworkInfo>& frameworkInfo,
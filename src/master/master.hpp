@@ -366,12 +366,54 @@ struct HttpConnection
 };
 
 
+// This process evolves, encodes and writes events destined for a
+// streaming HTTP connection (i.e., an HTTP framework or a subscriber
+// of the 'api/vX' endpoint). Evolving and serializing events is a
+// significant portion of the cost of sending them, so moving it off
+// the master actor allows the master to spread this work across cores.
+//
+// Since messages dispatched from one process to another are delivered
+// in order, events are written to the connection in the order in
+// which they were dispatched to this process, and `close()` only takes
+// effect after all previously dispatched events are written.
+class StreamingEncoder : public process::Process<StreamingEncoder>
+{
+public:
+  StreamingEncoder(const std::string& _logMessage,
+                   const HttpConnection& _http)
+    : process::ProcessBase(process::ID::generate("streaming-encoder")),
+      logMessage(_logMessage),
+      http(_http) {}
+
+  template <typename Message, typename Event = v1::scheduler::Event>
+  void send(const Message& message)
+  {
+    if (!http.send<Message, Event>(message)) {
+      LOG(WARNING) << "Unable to send event to " << logMessage
+                   << ": connection closed";
+    }
+  }
+
+  // NOTE: The connection may have already been closed (e.g., due to
+  // a client disconnection), so a failure to close it is ignored.
+  void close()
+  {
+    http.close();
+  }
+
+private:
+  const std::string logMessage;
+  HttpConnection http;
+};
+
+
 // This process periodically sends heartbeats to a given HTTP connection.
 // The `Message` template parameter is the type of the heartbeat event passed
 // into the heartbeater during construction, while the `Event` template
 // parameter is the versioned event type which is sent to the client.
 // The optional delay parameter is used to specify the delay period before it
-// sends the first heartbeat.
+// sends the first heartbeat. If an encoder is given, the heartbeats are sent
+// through it so that they are ordered with the other events on the connection.
 template <typename Message, typename Event>
 class Heartbeater : public process::Process<Heartbeater<Message, Event>>
 {
@@ -380,13 +422,15 @@ public:
               const Message& _heartbeatMessage,
               const HttpConnection& _http,
               const Duration& _interval,
-              const Option<Duration>& _delay = None())
+              const Option<Duration>& _delay = None(),
+              const Option<process::PID<StreamingEncoder>>& _encoder = None())
     : process::ProcessBase(process::ID::generate("heartbeater")),
       logMessage(_logMessage),
       heartbeatMessage(_heartbeatMessage),
       http(_http),
       interval(_interval),
-      delay(_delay) {}
+      delay(_delay),
+      encoder(_encoder) {}
 
 protected:
   virtual void initialize() override
@@ -409,7 +453,15 @@ private:
       VLOG(2) << "Sending heartbeat to " << logMessage;
 
       Message message(heartbeatMessage);
-      http.send<Message, Event>(message);
+
+      if (encoder.isSome()) {
+        process::dispatch(
+            encoder.get(),
+            &StreamingEncoder::send<Message, Event>,
+            message);
+      } else {
+        http.send<Message, Event>(message);
+      }
     }
 
     process::delay(interval, this, &Heartbeater<Message, Event>::heartbeat);
@@ -420,6 +472,7 @@ private:
   HttpConnection http;
   const Duration interval;
   const Option<Duration> delay;
+  const Option<process::PID<StreamingEncoder>> encoder;
 };
 
 
@@ -1989,28 +2042,42 @@ private:
         : http(_http),
           principal(_principal)
       {
+        // NOTE: The encoder and the heartbeater are managed by
+        // libprocess, so that the subscriber does not need to wait for
+        // them to terminate when it is destroyed on the master actor.
+        encoder = process::spawn(
+            new StreamingEncoder(
+                "subscriber " + stringify(http.streamId),
+                http),
+            true);
+
         mesos::master::Event event;
         event.set_type(mesos::master::Event::HEARTBEAT);
 
-        heartbeater =
-          process::Owned<Heartbeater<mesos::master::Event, v1::master::Event>>(
-              new Heartbeater<mesos::master::Event, v1::master::Event>(
-                  "subscriber " + stringify(http.streamId),
-                  event,
-                  http,
-                  DEFAULT_HEARTBEAT_INTERVAL,
-                  DEFAULT_HEARTBEAT_INTERVAL));
-
-        process::spawn(heartbeater.get());
+        heartbeater = process::spawn(
+            new Heartbeater<mesos::master::Event, v1::master::Event>(
+                "subscriber " + stringify(http.streamId),
+                event,
+                http,
+                DEFAULT_HEARTBEAT_INTERVAL,
+                DEFAULT_HEARTBEAT_INTERVAL,
+                encoder),
+            true);
       }
 
       // Not copyable, not assignable.
       Subscriber(const Subscriber&) = delete;
       Subscriber& operator=(const Subscriber&) = delete;
 
+      // Filters and writes the event to the connection. This is invoked
+      // within the context of `encoder` so that the filtering and the
+      // serialization of events is done off the master actor. It does
+      // not refer to the subscriber, which may be destroyed meanwhile.
+      //
       // TODO(greggomann): Refactor this function into multiple event-specific
       // overloads. See MESOS-8475.
-      void send(
+      static void send(
+          HttpConnection http,
           const process::Shared<mesos::master::Event>& event,
           const process::Owned<ObjectApprovers>& approvers,
           const process::Shared<FrameworkInfo>& frameworkInfo,
@@ -2018,19 +2085,25 @@ private:
 
       ~Subscriber()
       {
+        // Stop the heartbeats before the encoder they are sent through.
+        // Any events that are still queued in the encoder are dropped.
+        //
+        // NOTE: We do not wait for them to terminate, as this would
+        // block the master actor. They are deleted by libprocess.
+        terminate(heartbeater);
+        terminate(encoder);
+
         // TODO(anand): Refactor `HttpConnection` to being a RAII class instead.
         // It is possible that a caller might accidentally invoke `close()`
         // after passing ownership to the `Subscriber` object. See MESOS-5843
         // for more details.
         http.close();
-
-        terminate(heartbeater.get());
-        wait(heartbeater.get());
       }
 
       HttpConnection http;
-      process::Owned<Heartbeater<mesos::master::Event, v1::master::Event>>
+      process::PID<Heartbeater<mesos::master::Event, v1::master::Event>>
         heartbeater;
+      process::PID<StreamingEncoder> encoder;
       const Option<process::http::authentication::Principal> principal;
     };
 
@@ -2213,7 +2286,7 @@ struct Framework
             const process::Time& time = process::Clock::now())
     : Framework(master, masterFlags, info, ACTIVE, time)
   {
-    http = _http;
+    setHttpConnection(_http);
   }
 
   Framework(Master* const master,
@@ -2340,10 +2413,12 @@ struct Framework
     }
 
     if (http.isSome()) {
-      if (!http->send(message)) {
-        LOG(WARNING) << "Unable to send event to framework " << *this << ":"
-                     << " connection closed";
-      }
+      CHECK_SOME(encoder);
+
+      process::dispatch(
+          encoder.get(),
+          &StreamingEncoder::send<Message, v1::scheduler::Event>,
+          message);
     } else {
       CHECK_SOME(pid);
       master->send(pid.get(), message);
@@ -2766,7 +2841,7 @@ struct Framework
 
     CHECK_NONE(http);
 
-    http = newHttp;
+    setHttpConnection(newHttp);
   }
 
   // Closes the HTTP connection and stops the heartbeat.
@@ -2776,19 +2851,29 @@ struct Framework
   void closeHttpConnection()
   {
     CHECK_SOME(http);
+    CHECK_SOME(encoder);
 
-    if (connected() && !http->close()) {
-      LOG(WARNING) << "Failed to close HTTP pipe for " << *this;
-    }
+    // Stop the heartbeats first so that none is sent after the
+    // connection is closed.
+    if (heartbeater.isSome()) {
+      terminate(heartbeater->get());
+      wait(heartbeater->get());
 
-    http = None();
+      heartbeater = None();
+    }
 
-    CHECK_SOME(heartbeater);
+    if (connected()) {
+      process::dispatch(encoder.get(), &StreamingEncoder::close);
+    }
 
-    terminate(heartbeater->get());
-    wait(heartbeater->get());
+    // NOTE: We do not inject the termination event at the front of
+    // the queue so that all events sent so far are written before
+    // the connection is closed. The encoder is managed by libprocess,
+    // so we do not wait for it to drain its queue here.
+    terminate(encoder.get(), false);
 
-    heartbeater = None();
+    encoder = None();
+    http = None();
   }
 
   void heartbeat()
@@ -2806,7 +2891,9 @@ struct Framework
           "framework " + stringify(info.id()),
           event,
           http.get(),
-          DEFAULT_HEARTBEAT_INTERVAL);
+          DEFAULT_HEARTBEAT_INTERVAL,
+          None(),
+          encoder.get());
 
     process::spawn(heartbeater->get());
   }
@@ -2915,7 +3002,25 @@ struct Framework
   Option<process::Owned<Heartbeater<scheduler::Event, v1::scheduler::Event>>>
     heartbeater;
 
+  // This is only set for HTTP frameworks. All events sent to the
+  // framework (and the closing of the connection) go through the
+  // encoder so that they are serialized off the master actor. The
+  // encoder is managed by libprocess so that closing the connection
+  // does not block the master until the encoder has drained.
+  Option<process::PID<StreamingEncoder>> encoder;
+
 private:
+  void setHttpConnection(const HttpConnection& _http)
+  {
+    CHECK_NONE(encoder);
+
+    http = _http;
+
+    encoder = process::spawn(
+        new StreamingEncoder("framework " + stringify(info.id()), _http),
+        true);
+  }
+
   Framework(Master* const _master,
             const Flags& masterFlags,
             const FrameworkInfo& _info,
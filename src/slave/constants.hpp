@@ -50,6 +50,14 @@ constexpr Duration DEFAULT_EXECUTOR_SHUTDOWN_GRACE_PERIOD = Seconds(5);
 
 constexpr Duration RECOVERY_TIMEOUT = Minutes(15);
 
+// Maximum number of executors of a framework whose checkpointed state
+// is read concurrently during agent recovery.
+constexpr size_t MAX_CONCURRENT_EXECUTOR_RECOVERIES = 8;
+
+// The checkpoint journal is compacted once it has grown past this
+// size and at least half of it is made of superseded records.
+constexpr Bytes CHECKPOINT_JOURNAL_MIN_COMPACTION_SIZE = Megabytes(8);
+
 // TODO(gkleiman): Move this to a different file once `TaskStatusUpdateManager`
 // uses `StatusUpdateManagerProcess`. See MESOS-8296.
 constexpr Duration STATUS_UPDATE_RETRY_INTERVAL_MIN = Seconds(10);
@@ -78,6 +86,10 @@ constexpr Duration DISK_WATCH_INTERVAL = Minutes(1);
 // Minimum free disk capacity enforced by the garbage collector.
 constexpr double GC_DISK_HEADROOM = 0.1;
 
+// Default maximum number of paths the garbage collector removes
+// concurrently.
+constexpr unsigned int DEFAULT_GC_MAX_CONCURRENT_REMOVALS = 2;
+
 // Maximum number of completed frameworks to store in memory.
 constexpr size_t MAX_COMPLETED_FRAMEWORKS = 50;
 
@@ -170,6 +182,9 @@ constexpr char EXECUTOR_HTTP_AUTHENTICATION_REALM[] = "mesos-agent-executor";
 // Default maximum storage space to be used by the fetcher cache.
 constexpr Bytes DEFAULT_FETCHER_CACHE_SIZE = Gigabytes(2);
 
+// Default maximum number of URIs of a container fetched concurrently.
+constexpr unsigned int DEFAULT_FETCHER_MAX_CONCURRENT_DOWNLOADS = 4;
+
 // If no pings received within this timeout, then the slave will
 // trigger a re-detection of the master to cause a re-registration.
 Duration DEFAULT_MASTER_PING_TIMEOUT();
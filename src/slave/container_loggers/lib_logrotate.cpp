@@ -15,9 +15,13 @@
 // limitations under the License.
 
 #include <unistd.h>
+#include <zlib.h>
 
+#include <algorithm>
 #include <map>
+#include <memory>
 #include <string>
+#include <vector>
 
 #include <mesos/mesos.hpp>
 
@@ -26,28 +30,50 @@
 #include <mesos/slave/container_logger.hpp>
 #include <mesos/slave/containerizer.hpp>
 
+#include <process/async.hpp>
+#include <process/defer.hpp>
 #include <process/dispatch.hpp>
 #include <process/future.hpp>
+#include <process/id.hpp>
+#include <process/io.hpp>
+#include <process/loop.hpp>
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
 
+#include <process/metrics/counter.hpp>
+#include <process/metrics/metrics.hpp>
+
 #include <stout/bytes.hpp>
 #include <stout/error.hpp>
 #include <stout/try.hpp>
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/strings.hpp>
 
+#include <stout/os/close.hpp>
 #include <stout/os/constants.hpp>
 #include <stout/os/environment.hpp>
+#include <stout/os/exists.hpp>
 #include <stout/os/fcntl.hpp>
 #include <stout/os/killtree.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/pipe.hpp>
+#include <stout/os/read.hpp>
+#include <stout/os/rename.hpp>
+#include <stout/os/rm.hpp>
+#include <stout/os/stat.hpp>
+#include <stout/os/write.hpp>
 
 #ifdef __linux__
 #include "linux/systemd.hpp"
 #endif // __linux__
 
+#include "slave/paths.hpp"
+#include "slave/state.hpp"
+
 #include "slave/container_loggers/logrotate.hpp"
 #include "slave/container_loggers/lib_logrotate.hpp"
 
@@ -57,6 +83,9 @@ using namespace process;
 
 using std::map;
 using std::string;
+using std::vector;
+
+using process::metrics::Counter;
 
 using mesos::slave::ContainerLogger;
 using mesos::slave::ContainerIO;
@@ -65,6 +94,407 @@ namespace mesos {
 namespace internal {
 namespace logger {
 
+// The container a sandbox belongs to, as derived from the path of the
+// sandbox within the work directory of the agent.
+struct Sandbox
+{
+  // The ID of the container, including the IDs of its parents.
+  string containerId;
+
+  // Whether the framework of the container has checkpointing enabled,
+  // i.e., expects the container to survive restarts of the agent. The
+  // agent checkpoints the info of such frameworks before it launches
+  // any of their executors.
+  bool checkpoint;
+};
+
+
+static Try<Sandbox> parseSandbox(const string& directory)
+{
+  const vector<string> tokens = strings::tokenize(directory, "/");
+
+  for (size_t i = 0; i < tokens.size(); i++) {
+    if (tokens[i] != "slaves") {
+      continue;
+    }
+
+    const string workDir = path::join(
+        "/", strings::join("/", vector<string>(
+            tokens.begin(), tokens.begin() + i)));
+
+    Try<slave::paths::ExecutorRunPath> run =
+      slave::paths::parseExecutorRunPath(workDir, directory);
+
+    if (run.isError()) {
+      continue;
+    }
+
+    Sandbox sandbox;
+    sandbox.containerId = run->containerId.value();
+
+    // The sandboxes of nested containers are in the 'containers'
+    // directory of the sandbox of their parent.
+    for (size_t j = i + 8; j + 1 < tokens.size(); j += 2) {
+      sandbox.containerId += "." + tokens[j + 1];
+    }
+
+    // NOTE: The framework info may be recorded in the checkpoint
+    // journal of the agent rather than in its own file.
+    sandbox.checkpoint = slave::state::exists(
+        slave::paths::getFrameworkInfoPath(
+            slave::paths::getMetaRootDir(workDir),
+            run->slaveId,
+            run->frameworkId));
+
+    return sandbox;
+  }
+
+  return Error("Not in the work directory of an agent");
+}
+
+
+// Reads the output of a container from a pipe and writes it to a
+// leading log file in its sandbox, which it rotates once it reaches its
+// maximum size. This is what the module does with `--in_process`,
+// rather than spawning a `mesos-logrotate-logger` process per stream
+// which calls `logrotate` on every rotation.
+//
+// The writer terminates (and is garbage collected) once the container
+// closes its end of the pipe.
+class LogrotateWriterProcess : public Process<LogrotateWriterProcess>
+{
+public:
+  LogrotateWriterProcess(
+      int_fd _pipe,
+      const string& _filename,
+      const Bytes& _maxSize,
+      const Option<string>& options,
+      const Option<string>& _user,
+      const string& metricsPrefix)
+    : ProcessBase(process::ID::generate("logrotate-writer")),
+      pipe(_pipe),
+      filename(_filename),
+      maxSize(_maxSize),
+      user(_user),
+      keep(0),
+      compress(false),
+      size(0),
+      rotations(0),
+      compressing(Nothing()),
+      buffer(new char[BUFFER_SIZE]),
+      metrics(metricsPrefix)
+  {
+    // Only the options of `logrotate` which decide the files to keep
+    // apply to the native rotation.
+    foreach (const string& line, strings::split(options.getOrElse(""), "\n")) {
+      vector<string> tokens = strings::tokenize(line, " \t");
+
+      if (tokens.empty()) {
+        continue;
+      } else if (tokens[0] == "rotate" && tokens.size() == 2) {
+        Try<size_t> count = numify<size_t>(tokens[1]);
+        if (count.isSome()) {
+          keep = count.get();
+          continue;
+        }
+      } else if (tokens[0] == "compress" && tokens.size() == 1) {
+        compress = true;
+        continue;
+      } else if (tokens[0] == "nocompress" && tokens.size() == 1) {
+        compress = false;
+        continue;
+      }
+
+      LOG(WARNING) << "Ignoring unsupported option '" << line << "'"
+                   << " for rotating '" << filename << "'";
+    }
+  }
+
+  virtual ~LogrotateWriterProcess()
+  {
+    os::close(pipe);
+
+    if (leading.isSome()) {
+      os::close(leading.get());
+    }
+  }
+
+protected:
+  virtual void initialize()
+  {
+    // Continue with the size of an existing leading log file, in case
+    // it is appended to.
+    Try<Bytes> existing = os::stat::size(filename);
+    if (existing.isSome()) {
+      size = existing.get();
+    }
+
+    process::loop(
+        self(),
+        [this]() {
+          return io::read(pipe, buffer.get(), BUFFER_SIZE);
+        },
+        [this](size_t length) -> ControlFlow<Nothing> {
+          // EOF indicates that the container has exited.
+          if (length == 0) {
+            return Break();
+          }
+
+          write(buffer.get(), length);
+          return Continue();
+        })
+      .onAny(defer(self(), [this](const Future<Nothing>& future) {
+        if (!future.isReady()) {
+          LOG(ERROR) << "Failed to read the output for '" << filename << "': "
+                     << (future.isFailed() ? future.failure() : "discarded");
+        }
+
+        // Let the pending compressions finish their rotations.
+        compressing.onAny(defer(self(), [this](const Future<Nothing>&) {
+          terminate(self());
+        }));
+      }));
+  }
+
+private:
+  // Writes the output to the leading log file, rotating it whenever it
+  // reaches `maxSize` so that log files never exceed it.
+  //
+  // NOTE: Like `mesos-logrotate-logger`, we keep draining the pipe when
+  // writes fail, so as not to block the container; such output is
+  // counted as dropped.
+  void write(const char* data, size_t length)
+  {
+    while (length > 0) {
+      if (size >= maxSize) {
+        rotate();
+      }
+
+      const size_t chunk =
+        std::min(length, static_cast<size_t>((maxSize - size).bytes()));
+
+      Try<Nothing> result = open();
+      if (result.isSome()) {
+        result = os::write(leading.get(), string(data, chunk));
+      }
+
+      if (result.isError()) {
+        LOG(WARNING) << "Failed to write to '" << filename << "': "
+                     << result.error();
+
+        metrics.bytes_dropped += chunk;
+      } else {
+        metrics.bytes_written += chunk;
+      }
+
+      size += Bytes(chunk);
+      data += chunk;
+      length -= chunk;
+    }
+  }
+
+  // Opens the leading log file unless it is already open.
+  Try<Nothing> open()
+  {
+    if (leading.isSome()) {
+      return Nothing();
+    }
+
+    Try<int_fd> fd = os::open(
+        filename,
+        O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+        S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+    if (fd.isError()) {
+      return Error("Failed to open: " + fd.error());
+    }
+
+    leading = fd.get();
+
+    if (user.isSome()) {
+      Try<Nothing> chown = os::chown(user.get(), filename, false);
+      if (chown.isError()) {
+        LOG(WARNING) << "Failed to chown '" << filename << "' to user '"
+                     << user.get() << "': " << chown.error();
+      }
+    }
+
+    return Nothing();
+  }
+
+  // Moves the leading log file to 'FILE.1' after shifting the rotated
+  // log files, like `logrotate` does.
+  //
+  // NOTE: As with `logrotate`, errors are ignored and we keep logging
+  // to the leading log file.
+  void rotate()
+  {
+    if (leading.isSome()) {
+      os::close(leading.get());
+      leading = None();
+    }
+
+    size = 0;
+
+    if (keep == 0) {
+      os::rm(filename);
+      return;
+    }
+
+    if (!compress) {
+      shift(filename, keep, "");
+      os::rename(filename, filename + ".1");
+      return;
+    }
+
+    // Compressing blocks on reading and writing the whole log file, so
+    // it is done asynchronously on a copy of the leading log file, which
+    // is moved aside right away. The compressions (and thus the shifts
+    // of the compressed log files) are done in order.
+    const string rotated = filename + ".rotating." + stringify(++rotations);
+
+    Try<Nothing> rename = os::rename(filename, rotated);
+    if (rename.isError()) {
+      LOG(WARNING) << "Failed to move '" << filename << "' to '" << rotated
+                   << "': " << rename.error();
+      return;
+    }
+
+    const string _filename = filename;
+    const size_t _keep = keep;
+
+    compressing = compressing
+      .then([=]() {
+        return async([=]() {
+          shift(_filename, _keep, ".gz");
+          _compress(rotated, _filename + ".1.gz");
+          return Nothing();
+        });
+      });
+  }
+
+  // Shifts the rotated log files (i.e., 'FILE.1' to 'FILE.2', ...),
+  // deleting the oldest one.
+  static void shift(
+      const string& filename,
+      size_t keep,
+      const string& extension)
+  {
+    auto rotated = [=](size_t index) {
+      return filename + "." + stringify(index) + extension;
+    };
+
+    if (os::exists(rotated(keep))) {
+      os::rm(rotated(keep));
+    }
+
+    for (size_t index = keep - 1; index > 0; index--) {
+      if (os::exists(rotated(index))) {
+        os::rename(rotated(index), rotated(index + 1));
+      }
+    }
+  }
+
+  // Compresses the given log file with gzip, streaming it in chunks so
+  // that memory use does not depend on the size of the log file, and
+  // removes it.
+  static void _compress(const string& source, const string& target)
+  {
+    Try<int_fd> fd = os::open(source, O_RDONLY | O_CLOEXEC);
+    if (fd.isError()) {
+      LOG(WARNING) << "Failed to open '" << source << "' to compress it: "
+                   << fd.error();
+      return;
+    }
+
+    gzFile file = gzopen(target.c_str(), "wb");
+    if (file == nullptr) {
+      LOG(WARNING) << "Failed to open '" << target << "'";
+      os::close(fd.get());
+      return;
+    }
+
+    std::unique_ptr<char[]> chunk(new char[BUFFER_SIZE]);
+
+    Option<string> error;
+    while (error.isNone()) {
+      ssize_t length = os::read(fd.get(), chunk.get(), BUFFER_SIZE);
+      if (length < 0 && errno == EINTR) {
+        continue;
+      } else if (length < 0) {
+        error = ErrnoError("Failed to read '" + source + "'").message;
+      } else if (length == 0) {
+        break;
+      } else if (gzwrite(file, chunk.get(), length) != length) {
+        error = "Failed to write '" + target + "'";
+      }
+    }
+
+    os::close(fd.get());
+
+    if (gzclose(file) != Z_OK && error.isNone()) {
+      error = "Failed to close '" + target + "'";
+    }
+
+    if (error.isSome()) {
+      LOG(WARNING) << "Failed to compress '" << source << "': "
+                   << error.get();
+
+      // Keep the uncompressed log file rather than losing it.
+      os::rm(target);
+      os::rename(source, target.substr(0, target.size() - strlen(".gz")));
+      return;
+    }
+
+    os::rm(source);
+  }
+
+  static constexpr size_t BUFFER_SIZE = 64 * 1024;
+
+  const int_fd pipe;
+  const string filename;
+  const Bytes maxSize;
+  const Option<string> user;
+
+  // The number of rotated log files to keep, and whether to compress them.
+  size_t keep;
+  bool compress;
+
+  Option<int_fd> leading;
+  Bytes size;
+
+  // The number of rotations that compressed the leading log file, and
+  // the compressions which are still pending.
+  size_t rotations;
+  Future<Nothing> compressing;
+
+  std::unique_ptr<char[]> buffer;
+
+  struct Metrics
+  {
+    explicit Metrics(const string& prefix)
+      : bytes_written(prefix + "bytes_written"),
+        bytes_dropped(prefix + "bytes_dropped")
+    {
+      process::metrics::add(bytes_written);
+      process::metrics::add(bytes_dropped);
+    }
+
+    ~Metrics()
+    {
+      process::metrics::remove(bytes_written);
+      process::metrics::remove(bytes_dropped);
+    }
+
+    Counter bytes_written;
+    Counter bytes_dropped;
+  } metrics;
+};
+
+
+constexpr size_t LogrotateWriterProcess::BUFFER_SIZE;
+
+
 class LogrotateContainerLoggerProcess :
   public Process<LogrotateContainerLoggerProcess>
 {
@@ -145,6 +575,28 @@ public:
       }
     }
 
+    if (flags.in_process) {
+      // The agent holds the only read-ends of the pipes of the writers,
+      // so the container would get `SIGPIPE` once the agent exits. The
+      // output of containers which are expected to survive restarts of
+      // the agent is thus still handed to companion processes.
+      Try<Sandbox> sandbox = parseSandbox(sandboxDirectory);
+      if (sandbox.isError()) {
+        LOG(WARNING) << "Not logging in process to '" << sandboxDirectory
+                     << "': " << sandbox.error();
+      } else if (sandbox->checkpoint) {
+        LOG(INFO) << "Not logging in process for container "
+                  << sandbox->containerId
+                  << " as its framework has checkpointing enabled";
+      } else {
+        return _prepare(
+            overriddenFlags,
+            sandbox->containerId,
+            sandboxDirectory,
+            user);
+      }
+    }
+
     // NOTE: We manually construct a pipe here instead of using
     // `Subprocess::PIPE` so that the ownership of the FDs is properly
     // represented.  The `Subprocess` spawned below owns the read-end
@@ -261,6 +713,68 @@ public:
     return io;
   }
 
+  // Spawns a writer for each of stdout and stderr within the agent,
+  // rather than companion processes.
+  Future<ContainerIO> _prepare(
+      const LoggerFlags& overriddenFlags,
+      const string& containerId,
+      const string& sandboxDirectory,
+      const Option<string>& user)
+  {
+    // NOTE: As above, the writers own the read-ends of the pipes and
+    // the ownership of the write-ends is given to the caller.
+    Try<std::array<int_fd, 2>> outfds = os::pipe();
+    if (outfds.isError()) {
+      return Failure("Failed to create pipe: " + outfds.error());
+    }
+
+    Try<std::array<int_fd, 2>> errfds = os::pipe();
+    if (errfds.isError()) {
+      os::close(outfds->at(0));
+      os::close(outfds->at(1));
+      return Failure("Failed to create pipe: " + errfds.error());
+    }
+
+    const vector<int_fd> reads = {outfds->at(0), errfds->at(0)};
+
+    foreach (int_fd fd, reads) {
+      // NOTE: This is a prerequisuite for `io::read`.
+      Try<Nothing> nonblock = os::nonblock(fd);
+      if (nonblock.isError()) {
+        os::close(outfds->at(0));
+        os::close(outfds->at(1));
+        os::close(errfds->at(0));
+        os::close(errfds->at(1));
+        return Failure("Failed to set nonblocking pipe: " + nonblock.error());
+      }
+    }
+
+    const string prefix = "container_logger/logrotate/" + containerId + "/";
+
+    spawn(new LogrotateWriterProcess(
+              outfds->at(0),
+              path::join(sandboxDirectory, "stdout"),
+              overriddenFlags.max_stdout_size,
+              overriddenFlags.logrotate_stdout_options,
+              user,
+              prefix + "stdout/"),
+          true);
+
+    spawn(new LogrotateWriterProcess(
+              errfds->at(0),
+              path::join(sandboxDirectory, "stderr"),
+              overriddenFlags.max_stderr_size,
+              overriddenFlags.logrotate_stderr_options,
+              user,
+              prefix + "stderr/"),
+          true);
+
+    ContainerIO io;
+    io.out = ContainerIO::IO::FD(outfds->at(1));
+    io.err = ContainerIO::IO::FD(errfds->at(1));
+    return io;
+  }
+
 protected:
   Flags flags;
 };
@@ -172,6 +172,19 @@ struct Flags : public virtual LoggerFlags
 
           return None();
         });
+
+    add(&Flags::in_process,
+        "in_process",
+        "If true, the logs of containers are written and rotated within\n"
+        "the agent rather than by companion '" +
+        mesos::internal::logger::rotate::NAME + "'\n"
+        "processes which call 'logrotate'. Of the 'logrotate' options, only\n"
+        "'rotate <count>' and '[no]compress' are then supported.\n"
+        "NOTE: The output of containers is no longer logged once the agent\n"
+        "exits, e.g., while it restarts. Containers of frameworks with\n"
+        "checkpointing enabled, which are expected to survive restarts of\n"
+        "the agent, are thus still logged by companion processes.",
+        false);
   }
 
   std::string environment_variable_prefix;
@@ -180,6 +193,8 @@ struct Flags : public virtual LoggerFlags
   std::string logrotate_path;
 
   size_t libprocess_num_worker_threads;
+
+  bool in_process;
 };
 
 
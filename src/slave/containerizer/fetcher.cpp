@@ -29,6 +29,7 @@
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/net.hpp>
+#include <stout/numify.hpp>
 #include <stout/path.hpp>
 #include <stout/strings.hpp>
 #include <stout/uri.hpp>
@@ -47,6 +48,8 @@
 
 #include "common/status_utils.hpp"
 
+#include "slave/state.hpp"
+
 #include "slave/containerizer/fetcher_process.hpp"
 
 using std::list;
@@ -58,6 +61,7 @@ using std::vector;
 
 using strings::startsWith;
 
+using mesos::fetcher::CacheInfo;
 using mesos::fetcher::FetcherInfo;
 
 using process::async;
@@ -73,10 +77,18 @@ namespace slave {
 
 static const string CACHE_FILE_NAME_PREFIX = "c";
 
+// Name of the file in the cache directory the cache entries are
+// checkpointed to. NOTE: It must not contain the cache file name prefix.
+static const string CACHE_ENTRIES_FILE_NAME = "entries";
+
 
 Fetcher::Fetcher(const Flags& flags) : process(new FetcherProcess(flags))
 {
-  if (os::exists(flags.fetcher_cache_dir)) {
+  Try<Nothing> recover = process->recover();
+  if (recover.isError()) {
+    LOG(WARNING) << "Failed to recover the fetcher cache, clearing it: "
+                 << recover.error();
+
     Try<Nothing> rmdir = os::rmdir(flags.fetcher_cache_dir, true);
     CHECK_SOME(rmdir)
       << "Could not delete fetcher cache directory '"
@@ -265,12 +277,34 @@ FetcherProcess::Metrics::Metrics(FetcherProcess *fetcher)
         [=]() {
           // This value is safe to read while it is concurrently updated.
           return static_cast<double>(fetcher->cache.usedSpace().bytes());
+        }),
+    cache_hits("containerizer/fetcher/cache_hits"),
+    cache_misses("containerizer/fetcher/cache_misses"),
+    cache_bytes_downloaded("containerizer/fetcher/cache_bytes_downloaded"),
+    cache_bytes_reused("containerizer/fetcher/cache_bytes_reused"),
+    cache_time_saved_ms("containerizer/fetcher/cache_time_saved_ms"),
+    cache_evictions("containerizer/fetcher/cache_evictions"),
+    cache_hit_ratio(
+        "containerizer/fetcher/cache_hit_ratio",
+        [=]() -> Future<double> {
+          // The counters are always ready and safe to read concurrently.
+          const double hits = cache_hits.value().get();
+          const double misses = cache_misses.value().get();
+
+          return hits + misses > 0 ? hits / (hits + misses) : 0.0;
         })
 {
   process::metrics::add(task_fetches_succeeded);
   process::metrics::add(task_fetches_failed);
   process::metrics::add(cache_size_total_bytes);
   process::metrics::add(cache_size_used_bytes);
+  process::metrics::add(cache_hits);
+  process::metrics::add(cache_misses);
+  process::metrics::add(cache_bytes_downloaded);
+  process::metrics::add(cache_bytes_reused);
+  process::metrics::add(cache_time_saved_ms);
+  process::metrics::add(cache_evictions);
+  process::metrics::add(cache_hit_ratio);
 }
 
 
@@ -278,12 +312,19 @@ FetcherProcess::Metrics::~Metrics()
 {
   process::metrics::remove(task_fetches_succeeded);
   process::metrics::remove(task_fetches_failed);
+  process::metrics::remove(cache_hits);
+  process::metrics::remove(cache_misses);
+  process::metrics::remove(cache_bytes_downloaded);
+  process::metrics::remove(cache_bytes_reused);
+  process::metrics::remove(cache_time_saved_ms);
+  process::metrics::remove(cache_evictions);
 
   // Wait for the metrics to be removed before we allow the destructor
   // to complete.
   await(
       process::metrics::remove(cache_size_total_bytes),
-      process::metrics::remove(cache_size_used_bytes)).await();
+      process::metrics::remove(cache_size_used_bytes),
+      process::metrics::remove(cache_hit_ratio)).await();
 }
 
 
@@ -291,7 +332,10 @@ FetcherProcess::FetcherProcess(const Flags& _flags)
     : ProcessBase(process::ID::generate("fetcher")),
       metrics(this),
       flags(_flags),
-      cache(_flags.fetcher_cache_size)
+      cache(
+          _flags.fetcher_cache_size,
+          _flags.fetcher_cache_dir,
+          _flags.fetcher_cache_eviction_policy)
 {
 }
 
@@ -540,10 +584,16 @@ Future<Nothing> FetcherProcess::__fetch(
         // completion in FetcherProcess::fetch().
         item->set_action(FetcherInfo::Item::DOWNLOAD_AND_CACHE);
         item->set_cache_filename(entry.get()->filename);
+
+        ++metrics.cache_misses;
       } else {
         CHECK_READY(entry.get()->completion());
         item->set_action(FetcherInfo::Item::RETRIEVE_FROM_CACHE);
         item->set_cache_filename(entry.get()->filename);
+
+        ++metrics.cache_hits;
+        metrics.cache_bytes_reused += entry.get()->size.bytes();
+        metrics.cache_time_saved_ms += entry.get()->fetchTime.ms();
       }
     } else {
       item->set_action(FetcherInfo::Item::BYPASS_CACHE);
@@ -561,6 +611,8 @@ Future<Nothing> FetcherProcess::__fetch(
     info.set_frameworks_home(flags.frameworks_home);
   }
 
+  info.set_max_concurrent_downloads(flags.fetcher_max_concurrent_downloads);
+
   return run(containerId, sandboxDirectory, user, info)
     .repair(defer(self(), [=](const Future<Nothing>& future) {
       ++metrics.task_fetches_failed;
@@ -597,7 +649,9 @@ Future<Nothing> FetcherProcess::__fetch(
 
             Try<Nothing> adjust = cache.adjust(entry.get());
             if (adjust.isSome()) {
-              entry.get()->complete();
+              metrics.cache_bytes_downloaded += entry.get()->size.bytes();
+
+              cache.complete(entry.get());
             } else {
               LOG(WARNING) << "Failed to adjust the cache size for entry '"
                            << entry.get()->key << "' with error: "
@@ -698,8 +752,12 @@ FetcherProcess::reserveCacheSpace(
                    requestedSpace.error());
   }
 
+  const size_t entries = cache.size();
+
   Try<Nothing> reservation = cache.reserve(requestedSpace.get());
 
+  metrics.cache_evictions += entries - cache.size();
+
   if (reservation.isError()) {
     // Let anyone waiting on this future know that we've
     // failed to download and they should bypass the cache
@@ -923,6 +981,12 @@ Future<Nothing> FetcherProcess::run(
 }
 
 
+Try<Nothing> FetcherProcess::recover()
+{
+  return cache.recover();
+}
+
+
 void FetcherProcess::kill(const ContainerID& containerId)
 {
   if (subprocessPids.contains(containerId)) {
@@ -935,6 +999,100 @@ void FetcherProcess::kill(const ContainerID& containerId)
 }
 
 
+// Evicts the least recently used entries first.
+class LRUEvictionPolicy : public FetcherProcess::Cache::EvictionPolicy
+{
+public:
+  virtual void update(FetcherProcess::Cache::Entry* entry) {}
+
+  virtual void evicted(const FetcherProcess::Cache::Entry& entry) {}
+
+  virtual list<shared_ptr<FetcherProcess::Cache::Entry>> order(
+      const list<shared_ptr<FetcherProcess::Cache::Entry>>& lruSortedEntries)
+  {
+    return lruSortedEntries;
+  }
+};
+
+
+// Greedy-Dual-Size-Frequency: evicts the entries with the lowest
+// `frequency * cost / size` first, where the cost of an entry is the
+// time it took to download it. A small entry that is requested often
+// or is expensive to download thus outlives a large entry that is
+// rarely requested. The priorities are offset by the priority of the
+// last evicted entry, so that entries which used to be requested often
+// age and are eventually evicted as well.
+class GDSFEvictionPolicy : public FetcherProcess::Cache::EvictionPolicy
+{
+public:
+  GDSFEvictionPolicy() : age(0) {}
+
+  virtual void update(FetcherProcess::Cache::Entry* entry)
+  {
+    // Entries are charged at least a millisecond of fetch time and a
+    // byte of size, e.g., while they are being downloaded.
+    const double cost = std::max(entry->fetchTime.ms(), 1.0);
+    const double size = std::max(entry->size.bytes(), (uint64_t) 1);
+
+    entry->priority = age + entry->frequency * cost / size;
+  }
+
+  virtual void evicted(const FetcherProcess::Cache::Entry& entry)
+  {
+    age = std::max(age, entry.priority);
+  }
+
+  virtual list<shared_ptr<FetcherProcess::Cache::Entry>> order(
+      const list<shared_ptr<FetcherProcess::Cache::Entry>>& lruSortedEntries)
+  {
+    list<shared_ptr<FetcherProcess::Cache::Entry>> entries = lruSortedEntries;
+
+    // NOTE: The sort is stable, so that entries with the same priority
+    // are evicted in LRU order.
+    entries.sort([](
+        const shared_ptr<FetcherProcess::Cache::Entry>& left,
+        const shared_ptr<FetcherProcess::Cache::Entry>& right) {
+      return left->priority < right->priority;
+    });
+
+    return entries;
+  }
+
+private:
+  double age;
+};
+
+
+Try<Owned<FetcherProcess::Cache::EvictionPolicy>>
+FetcherProcess::Cache::EvictionPolicy::create(const string& name)
+{
+  if (name == "lru") {
+    return Owned<EvictionPolicy>(new LRUEvictionPolicy());
+  } else if (name == "gdsf") {
+    return Owned<EvictionPolicy>(new GDSFEvictionPolicy());
+  }
+
+  return Error("Unknown fetcher cache eviction policy '" + name + "'");
+}
+
+
+FetcherProcess::Cache::Cache(
+    Bytes _space,
+    const string& _directory,
+    const string& evictionPolicy)
+  : space(_space),
+    directory(_directory),
+    tally(0),
+    filenameSerial(0)
+{
+  // NOTE: The policy is validated by the agent flags.
+  Try<Owned<EvictionPolicy>> policy = EvictionPolicy::create(evictionPolicy);
+  CHECK_SOME(policy);
+
+  this->evictionPolicy = policy.get();
+}
+
+
 string FetcherProcess::Cache::nextFilename(const CommandInfo::URI& uri)
 {
   // Different URIs may have the same base name, so we need to
@@ -992,6 +1150,8 @@ shared_ptr<FetcherProcess::Cache::Entry> FetcherProcess::Cache::create(
   auto entry = shared_ptr<Cache::Entry>(
       new Cache::Entry(key, cacheDirectory, filename));
 
+  evictionPolicy->update(entry.get());
+
   table.put(key, entry);
   lruSortedEntries.push_back(entry);
 
@@ -1013,6 +1173,9 @@ FetcherProcess::Cache::get(
     // Refresh the cache entry by moving it to the back of lruSortedEntries.
     lruSortedEntries.remove(entry.get());
     lruSortedEntries.push_back(entry.get());
+
+    entry.get()->frequency++;
+    evictionPolicy->update(entry.get().get());
   }
 
   return entry;
@@ -1108,7 +1271,8 @@ Try<Nothing> FetcherProcess::Cache::remove(
 }
 
 
-// Select LRU cache entries for cache eviction.
+// Select cache entries for cache eviction in the order given by the
+// eviction policy.
 Try<list<shared_ptr<FetcherProcess::Cache::Entry>>>
 FetcherProcess::Cache::selectVictims(const Bytes& requiredSpace)
 {
@@ -1116,7 +1280,8 @@ FetcherProcess::Cache::selectVictims(const Bytes& requiredSpace)
 
   Bytes space = 0;
 
-  foreach (const shared_ptr<Cache::Entry>& entry, lruSortedEntries) {
+  foreach (const shared_ptr<Cache::Entry>& entry,
+           evictionPolicy->order(lruSortedEntries)) {
     if (!entry->isReferenced()) {
       victims.push_back(entry);
 
@@ -1147,11 +1312,19 @@ Try<Nothing> FetcherProcess::Cache::reserve(
     }
 
     foreach (const shared_ptr<Cache::Entry>& entry, victims.get()) {
+      evictionPolicy->evicted(*entry);
+
       Try<Nothing> removal = remove(entry);
       if (removal.isError()) {
         return Error(removal.error());
       }
     }
+
+    Try<Nothing> persist = this->persist();
+    if (persist.isError()) {
+      LOG(WARNING) << "Failed to persist the fetcher cache: "
+                   << persist.error();
+    }
   }
 
   return Nothing();
@@ -1187,6 +1360,155 @@ Try<Nothing> FetcherProcess::Cache::adjust(
 }
 
 
+void FetcherProcess::Cache::complete(const shared_ptr<Cache::Entry>& entry)
+{
+  entry->complete();
+
+  evictionPolicy->update(entry.get());
+
+  Try<Nothing> persist = this->persist();
+  if (persist.isError()) {
+    LOG(WARNING) << "Failed to persist the fetcher cache: " << persist.error();
+  }
+}
+
+
+Try<Nothing> FetcherProcess::Cache::recover()
+{
+  CHECK(table.empty());
+
+  if (!os::exists(directory)) {
+    return Nothing();
+  }
+
+  const string path = path::join(directory, CACHE_ENTRIES_FILE_NAME);
+
+  Result<CacheInfo> info = None();
+  if (os::exists(path)) {
+    info = state::read<CacheInfo>(path);
+    if (info.isError()) {
+      return Error(
+          "Failed to read cache entries from '" + path + "': " +
+          info.error());
+    }
+  }
+
+  hashset<string> files;
+
+  if (info.isSome()) {
+    foreach (const CacheInfo::Entry& _entry, info->entries()) {
+      auto entry = shared_ptr<Cache::Entry>(
+          new Cache::Entry(_entry.key(), _entry.directory(), _entry.filename()));
+
+      // Only recover entries in the cache directory whose files have
+      // not been tampered with.
+      Try<Bytes> size = os::stat::size(
+          entry->path().string(),
+          os::stat::FollowSymlink::DO_NOT_FOLLOW_SYMLINK);
+
+      if (!strings::startsWith(entry->directory, directory) ||
+          table.contains(entry->key) ||
+          size.isError() ||
+          size.get() != _entry.size()) {
+        VLOG(1) << "Not recovering fetcher cache entry '" << entry->key
+                << "' with file: " << entry->path();
+        continue;
+      }
+
+      // Avoid reusing the file names of the recovered entries.
+      const string serial = strings::tokenize(
+          strings::remove(
+              entry->filename,
+              CACHE_FILE_NAME_PREFIX,
+              strings::PREFIX),
+          "-").front();
+
+      Try<unsigned long> number = numify<unsigned long>(serial);
+      if (number.isSome()) {
+        filenameSerial = std::max(filenameSerial, number.get());
+      }
+
+      entry->size = size.get();
+      entry->frequency = std::max(_entry.frequency(), (uint64_t) 1);
+
+      entry->complete();
+      entry->fetchTime = Nanoseconds(_entry.fetch_time().nanoseconds());
+
+      evictionPolicy->update(entry.get());
+
+      table.put(entry->key, entry);
+      lruSortedEntries.push_back(entry);
+      claimSpace(entry->size);
+
+      files.insert(entry->path().string());
+    }
+  }
+
+  // Remove everything else, e.g., partial downloads and the files of
+  // entries that had not been checkpointed yet.
+  Try<list<string>> entries = os::find(directory, "");
+  if (entries.isError()) {
+    return Error(
+        "Failed to list the cache directory '" + directory + "': " +
+        entries.error());
+  }
+
+  foreach (const string& entry, entries.get()) {
+    if (!files.contains(entry)) {
+      Try<Nothing> rm = os::rm(entry);
+      if (rm.isError()) {
+        return Error("Failed to remove '" + entry + "': " + rm.error());
+      }
+    }
+  }
+
+  // The cache may have been shrunk since the entries were persisted.
+  if (tally > space) {
+    Try<list<shared_ptr<Cache::Entry>>> victims =
+      selectVictims(tally - space);
+
+    CHECK_SOME(victims) << "Unreferenced entries are always evictable";
+
+    foreach (const shared_ptr<Cache::Entry>& entry, victims.get()) {
+      evictionPolicy->evicted(*entry);
+
+      Try<Nothing> removal = remove(entry);
+      if (removal.isError()) {
+        return Error(removal.error());
+      }
+    }
+  }
+
+  LOG(INFO) << "Recovered " << table.size() << " fetcher cache entries using "
+            << tally << " of the cache";
+
+  return persist();
+}
+
+
+Try<Nothing> FetcherProcess::Cache::persist() const
+{
+  CacheInfo info;
+
+  foreach (const shared_ptr<Cache::Entry>& entry, lruSortedEntries) {
+    // Only the completed entries can be reused after a restart.
+    if (!entry->completion().isReady()) {
+      continue;
+    }
+
+    CacheInfo::Entry* _entry = info.add_entries();
+    _entry->set_key(entry->key);
+    _entry->set_directory(entry->directory);
+    _entry->set_filename(entry->filename);
+    _entry->set_size(entry->size.bytes());
+    _entry->set_frequency(entry->frequency);
+    _entry->mutable_fetch_time()->set_nanoseconds(entry->fetchTime.ns());
+  }
+
+  return state::checkpoint(path::join(directory, CACHE_ENTRIES_FILE_NAME), info);
+}
+
+
 size_t FetcherProcess::Cache::size() const
 {
   return table.size();
@@ -1250,6 +1572,8 @@ void FetcherProcess::Cache::Entry::complete()
 {
   CHECK_PENDING(promise.future());
 
+  fetchTime = process::Clock::now() - created;
+
   promise.set(Nothing());
 }
 
@@ -24,12 +24,16 @@
 #include <mesos/mesos.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/clock.hpp>
 #include <process/future.hpp>
+#include <process/owned.hpp>
 #include <process/process.hpp>
+#include <process/time.hpp>
 
 #include <process/metrics/counter.hpp>
 #include <process/metrics/gauge.hpp>
 
+#include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 
 #include "slave/flags.hpp"
@@ -62,6 +66,11 @@ public:
   // running on behalf of the given container ID, if any.
   void kill(const ContainerID& containerId);
 
+  // Recovers the cache entries persisted by a previous instance of the
+  // fetcher, and removes everything else from the cache directory.
+  // Must be called before the process is spawned.
+  Try<Nothing> recover();
+
   // Representation of the fetcher cache and its contents. There is
   // exactly one instance per instance of FetcherProcess. All methods
   // of Cache are to be executed on the latter to ensure atomicity of
@@ -80,6 +89,9 @@ public:
           directory(directory),
           filename(filename),
           size(0),
+          created(process::Clock::now()),
+          frequency(1),
+          priority(0),
           referenceCount(0) {}
 
       ~Entry() {}
@@ -124,6 +136,17 @@ public:
       // different a warning is logged and the field's value adjusted.
       Bytes size;
 
+      // When the entry was created, and how long it took until its
+      // download into the cache was completed. The latter is the time
+      // saved by every subsequent fetch from the cache.
+      const process::Time created;
+      Duration fetchTime;
+
+      // How often the entry has been requested, and its priority to
+      // stay in the cache as determined by the eviction policy.
+      unsigned long frequency;
+      double priority;
+
     private:
       // Concurrent fetch attempts can reference the same entry multiple
       // times.
@@ -133,7 +156,33 @@ public:
       process::Promise<Nothing> promise;
     };
 
-    explicit Cache(Bytes _space) : space(_space), tally(0), filenameSerial(0) {}
+    // Determines which entries are evicted first when space is needed.
+    class EvictionPolicy
+    {
+    public:
+      static Try<process::Owned<EvictionPolicy>> create(
+          const std::string& name);
+
+      virtual ~EvictionPolicy() {}
+
+      // Updates the priority of an entry which has been requested or
+      // completed, i.e., when its frequency or fetch time changed.
+      virtual void update(Entry* entry) = 0;
+
+      // Notifies the policy about an entry that is being evicted.
+      virtual void evicted(const Entry& entry) = 0;
+
+      // Returns the given entries, sorted from least recently used to
+      // most recently used, in the order they should be evicted.
+      virtual std::list<std::shared_ptr<Entry>> order(
+          const std::list<std::shared_ptr<Entry>>& lruSortedEntries) = 0;
+    };
+
+    Cache(
+        Bytes _space,
+        const std::string& _directory,
+        const std::string& evictionPolicy);
+
     virtual ~Cache() {}
 
     void claimSpace(const Bytes& bytes);
@@ -186,6 +235,18 @@ public:
     // sizes and adjusts the cache's total amount of space in use.
     Try<Nothing> adjust(const std::shared_ptr<Cache::Entry>& entry);
 
+    // Marks the download of an entry as successful and persists the
+    // cache entries.
+    void complete(const std::shared_ptr<Cache::Entry>& entry);
+
+    // Recovers the entries persisted by `persist()` whose files are
+    // intact, and removes all other files from the cache directory.
+    Try<Nothing> recover();
+
+    // Writes the completed entries to the cache directory, so that
+    // they can be recovered after an agent restart.
+    Try<Nothing> persist() const;
+
     // Number of entries.
     size_t size() const;
 
@@ -193,6 +254,11 @@ public:
     // Maximum storable number of bytes in the cache directory.
     const Bytes space;
 
+    // The cache directory, with one subdirectory per user.
+    const std::string directory;
+
+    process::Owned<EvictionPolicy> evictionPolicy;
+
     // How much space has been reserved to be occupied by cache files.
     Bytes tally;
 
@@ -260,6 +326,23 @@ private:
 
     process::metrics::Gauge cache_size_total_bytes;
     process::metrics::Gauge cache_size_used_bytes;
+
+    // NOTE: These metrics are per URI fetched through the cache. A URI
+    // that is concurrently being downloaded on behalf of another
+    // container counts as a hit, as it is downloaded only once.
+    process::metrics::Counter cache_hits;
+    process::metrics::Counter cache_misses;
+    process::metrics::Counter cache_bytes_downloaded;
+    process::metrics::Counter cache_bytes_reused;
+
+    // The time the cache hits would have spent downloading, estimated
+    // from the time it took to download the cache entries.
+    process::metrics::Counter cache_time_saved_ms;
+
+    // Number of entries evicted to make space for others, and the
+    // ratio of cache hits achieved with the configured eviction policy.
+    process::metrics::Counter cache_evictions;
+    process::metrics::Gauge cache_hit_ratio;
   } metrics;
 
   const Flags flags;
@@ -1255,6 +1255,7 @@ Future<Containerizer::LaunchResult> MesosContainerizerProcess::launch(
 
   Owned<Container> container(new Container());
   container->state = PROVISIONING;
+  container->launchTime = Clock::now();
   container->config = containerConfig;
   container->resources = containerConfig.resources();
   container->directory = containerConfig.directory();
@@ -2072,6 +2073,11 @@ Future<Containerizer::LaunchResult> MesosContainerizerProcess::exec(
 
   transition(containerId, RUNNING);
 
+  if (container->launchTime.isSome()) {
+    metrics.container_start_latency.record(
+        Clock::now() - container->launchTime.get());
+  }
+
   return Containerizer::LaunchResult::SUCCESS;
 }
 
@@ -2182,11 +2188,19 @@ Future<ResourceStatistics> _usage(
 {
   ResourceStatistics result;
 
-  // Set the timestamp now we have all statistics.
-  result.set_timestamp(Clock::now().secs());
+  // Isolators which serve statistics collected earlier (e.g., the
+  // cgroups isolator) set the time of the collection. We report the
+  // time of the oldest collection so that the rates computed between
+  // samples are not skewed, or the current time if none is set.
+  Option<double> timestamp;
 
   foreach (const Future<ResourceStatistics>& statistic, statistics) {
     if (statistic.isReady()) {
+      if (statistic->has_timestamp() &&
+          (timestamp.isNone() || statistic->timestamp() < timestamp.get())) {
+        timestamp = statistic->timestamp();
+      }
+
       result.MergeFrom(statistic.get());
     } else {
       LOG(WARNING) << "Skipping resource statistic for container "
@@ -2196,6 +2210,9 @@ Future<ResourceStatistics> _usage(
     }
   }
 
+  result.set_timestamp(
+      timestamp.isSome() ? timestamp.get() : Clock::now().secs());
+
   if (resources.isSome()) {
     // Set the resource allocations.
     Option<Bytes> mem = resources->mem();
@@ -2891,15 +2908,19 @@ ContainerClass MesosContainerizerProcess::Container::containerClass()
 
 MesosContainerizerProcess::Metrics::Metrics()
   : container_destroy_errors(
-        "containerizer/mesos/container_destroy_errors")
+        "containerizer/mesos/container_destroy_errors"),
+    container_start_latency(
+        "containerizer/mesos/container_start_latency")
 {
   process::metrics::add(container_destroy_errors);
+  process::metrics::add(container_start_latency);
 }
 
 
 MesosContainerizerProcess::Metrics::~Metrics()
 {
   process::metrics::remove(container_destroy_errors);
+  process::metrics::remove(container_start_latency);
 }
 
 
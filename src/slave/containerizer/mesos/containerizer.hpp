@@ -30,6 +30,7 @@
 #include <process/shared.hpp>
 
 #include <process/metrics/counter.hpp>
+#include <process/metrics/timer.hpp>
 
 #include <stout/hashmap.hpp>
 #include <stout/multihashmap.hpp>
@@ -379,6 +380,11 @@ private:
 
     State state;
 
+    // The time at which the container was asked to be launched, used
+    // to measure how long it takes until the container starts
+    // running. Not set for recovered containers.
+    Option<process::Time> launchTime;
+
     // Used when `status` needs to be collected from isolators
     // associated with this container. `Sequence` allows us to
     // maintain the order of `status` requests for a given container.
@@ -405,6 +411,11 @@ private:
     ~Metrics();
 
     process::metrics::Counter container_destroy_errors;
+
+    // The time from the launch of a container until its first process
+    // is allowed to run, including provisioning its image, preparing
+    // the isolators and fetching.
+    process::metrics::Timer<Milliseconds> container_start_latency;
   } metrics;
 };
 
@@ -0,0 +1,430 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <fnmatch.h>
+#include <fts.h>
+#include <string.h>
+#include <time.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#include <set>
+#include <utility>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashset.hpp>
+#include <stout/nothing.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+
+#include "slave/containerizer/mesos/disk_usage.hpp"
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// The maximum number of nested directories that are open at once while
+// walking a tree. Deeper subtrees are walked by path with `fts`, so
+// that neither the number of open file descriptors nor the stack used
+// grows with the depth of the tree.
+constexpr size_t MAX_OPEN_DIRECTORIES = 32;
+
+
+// Walks a tree to determine its disk usage, see `diskUsage()`.
+class DiskUsageWalker
+{
+public:
+  DiskUsageWalker(
+      const vector<string>& _excludes,
+      DirectoryCache* _cache,
+      const std::atomic_bool* _cancelled)
+    : excludes(_excludes),
+      cache(_cache),
+      cancelled(_cancelled),
+      started(::time(nullptr)) {}
+
+  Try<Bytes> walk(const string& path)
+  {
+    struct stat s;
+    const int result = strings::endsWith(path, "/")
+      ? ::stat(path.c_str(), &s)
+      : ::lstat(path.c_str(), &s);
+
+    if (result < 0) {
+      return ErrnoError("Failed to stat '" + path + "'");
+    }
+
+    Bytes usage = size(s);
+
+    if (S_ISDIR(s.st_mode)) {
+      const int fd = ::open(path.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+      if (fd < 0) {
+        return ErrnoError("Failed to open '" + path + "'");
+      }
+
+      Try<Bytes> directory = walk(fd, s, path);
+      if (directory.isError()) {
+        return directory;
+      }
+
+      usage += directory.get();
+    }
+
+    // Forget the directories which no longer exist.
+    if (cache != nullptr) {
+      vector<string> removed;
+      foreachkey (const string& directory, cache->listings) {
+        if (!visited.contains(directory)) {
+          removed.push_back(directory);
+        }
+      }
+
+      foreach (const string& directory, removed) {
+        cache->listings.erase(directory);
+      }
+    }
+
+    return usage;
+  }
+
+private:
+  // A directory being walked, with its entries which are yet to be.
+  struct Directory
+  {
+    int fd;
+    string path;
+    string relative;
+    vector<string> entries;
+    size_t next;
+  };
+
+  // Returns the disk usage of the entries of the directory opened as
+  // `fd`, with the given status and path, and closes `fd`.
+  //
+  // The directories being walked are kept on an explicit stack rather
+  // than recursing, and subtrees below `MAX_OPEN_DIRECTORIES` levels
+  // are left to `walkTree`.
+  Try<Bytes> walk(int fd, const struct stat& s, const string& path)
+  {
+    vector<Directory> directories;
+
+    auto fail = [&directories](const Error& error) -> Try<Bytes> {
+      foreach (const Directory& directory, directories) {
+        ::close(directory.fd);
+      }
+
+      return error;
+    };
+
+    // Opens the directory at `fd` and pushes it onto the stack.
+    auto push = [&](
+        int fd,
+        const struct stat& s,
+        const string& path,
+        const string& relative) -> Try<Nothing> {
+      visited.insert(relative);
+
+      Try<vector<string>> entries = list(fd, s, path, relative);
+      if (entries.isError()) {
+        ::close(fd);
+        return Error(entries.error());
+      }
+
+      directories.push_back({fd, path, relative, entries.get(), 0});
+      return Nothing();
+    };
+
+    Try<Nothing> root = push(fd, s, path, "");
+    if (root.isError()) {
+      return Error(root.error());
+    }
+
+    Bytes usage;
+
+    while (!directories.empty()) {
+      if (isCancelled()) {
+        return fail(Error("Cancelled"));
+      }
+
+      Directory& directory = directories.back();
+
+      if (directory.next == directory.entries.size()) {
+        ::close(directory.fd);
+        directories.pop_back();
+        continue;
+      }
+
+      // NOTE: We copy the entry since pushing a directory onto the
+      // stack invalidates `directory`.
+      const string entry = directory.entries[directory.next++];
+      const string _path = path::join(directory.path, entry);
+      if (excluded(_path)) {
+        continue;
+      }
+
+      struct stat _s;
+      const int result = ::fstatat(
+          directory.fd, entry.c_str(), &_s, AT_SYMLINK_NOFOLLOW);
+
+      if (result < 0) {
+        // The entry may have been removed while walking the tree.
+        if (errno == ENOENT) {
+          continue;
+        }
+
+        return fail(ErrnoError("Failed to stat '" + _path + "'"));
+      }
+
+      usage += size(_s);
+
+      if (!S_ISDIR(_s.st_mode)) {
+        continue;
+      }
+
+      if (directories.size() >= MAX_OPEN_DIRECTORIES) {
+        Try<Bytes> subtree = walkTree(_path);
+        if (subtree.isError()) {
+          return fail(Error(subtree.error()));
+        }
+
+        usage += subtree.get();
+        continue;
+      }
+
+      const int _fd = ::openat(
+          directory.fd,
+          entry.c_str(),
+          O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+      if (_fd < 0) {
+        if (errno == ENOENT) {
+          continue;
+        }
+
+        return fail(ErrnoError("Failed to open '" + _path + "'"));
+      }
+
+      Try<Nothing> pushed =
+        push(_fd, _s, _path, path::join(directory.relative, entry));
+
+      if (pushed.isError()) {
+        return fail(Error(pushed.error()));
+      }
+    }
+
+    return usage;
+  }
+
+  // Returns the disk usage of the entries beneath the directory at
+  // `path` with `fts`, which does not keep a file descriptor per
+  // level. The listings of these directories are not cached.
+  Try<Bytes> walkTree(const string& path)
+  {
+    char* paths[] = {const_cast<char*>(path.c_str()), nullptr};
+
+    FTS* tree = ::fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, nullptr);
+    if (tree == nullptr) {
+      return ErrnoError("Failed to open '" + path + "'");
+    }
+
+    Bytes usage;
+
+    errno = 0;
+
+    FTSENT* node;
+    while ((node = ::fts_read(tree)) != nullptr) {
+      // Directories are only counted in preorder.
+      if (node->fts_info == FTS_DP) {
+        continue;
+      }
+
+      if (isCancelled()) {
+        ::fts_close(tree);
+        return Error("Cancelled");
+      }
+
+      // The directory itself is accounted for by the caller.
+      const bool root = node->fts_level == FTS_ROOTLEVEL;
+
+      if (!root && excluded(node->fts_path)) {
+        ::fts_set(tree, node, FTS_SKIP);
+        continue;
+      }
+
+      if (node->fts_info == FTS_DNR ||
+          node->fts_info == FTS_ERR ||
+          node->fts_info == FTS_NS) {
+        // The entry may have been removed while walking the tree.
+        if (node->fts_errno == ENOENT) {
+          continue;
+        }
+
+        Error error = ErrnoError(
+            node->fts_errno,
+            "Failed to read '" + string(node->fts_path) + "'");
+
+        ::fts_close(tree);
+        return error;
+      }
+
+      if (!root) {
+        usage += size(*node->fts_statp);
+      }
+    }
+
+    const int error = errno;
+    ::fts_close(tree);
+
+    if (error != 0) {
+      return ErrnoError(error, "Failed to walk '" + path + "'");
+    }
+
+    return usage;
+  }
+
+  // Returns the entries of the directory opened as `fd`, from the
+  // cache if the directory has not changed since it was last read.
+  Try<vector<string>> list(
+      int fd,
+      const struct stat& s,
+      const string& path,
+      const string& relative)
+  {
+    if (cache != nullptr) {
+      auto cached = cache->listings.find(relative);
+      if (cached != cache->listings.end() &&
+          cached->second.device == s.st_dev &&
+          cached->second.inode == s.st_ino &&
+          cached->second.ctime == s.st_ctime) {
+        return cached->second.entries;
+      }
+    }
+
+    const int _fd = ::dup(fd);
+    if (_fd < 0) {
+      return ErrnoError("Failed to duplicate file descriptor");
+    }
+
+    DIR* directory = ::fdopendir(_fd);
+    if (directory == nullptr) {
+      ::close(_fd);
+      return ErrnoError("Failed to open '" + path + "'");
+    }
+
+    DirectoryCache::Listing listing{s.st_dev, s.st_ino, s.st_ctime, {}};
+
+    errno = 0;
+
+    struct dirent* entry;
+    while ((entry = ::readdir(directory)) != nullptr) {
+      if (::strcmp(entry->d_name, ".") != 0 &&
+          ::strcmp(entry->d_name, "..") != 0) {
+        listing.entries.push_back(entry->d_name);
+      }
+    }
+
+    const int error = errno;
+    ::closedir(directory);
+
+    if (error != 0) {
+      return ErrnoError(error, "Failed to read '" + path + "'");
+    }
+
+    // NOTE: The status change time has a granularity of a second, so
+    // we only cache directories which have not changed during the
+    // second before the walk started, as they could otherwise change
+    // again without their status change time changing.
+    if (cache != nullptr) {
+      if (s.st_ctime < started - 1) {
+        cache->listings[relative] = listing;
+      } else {
+        cache->listings.erase(relative);
+      }
+    }
+
+    return listing.entries;
+  }
+
+  bool isCancelled() const
+  {
+    return cancelled != nullptr && cancelled->load();
+  }
+
+  Bytes size(const struct stat& s)
+  {
+    // Files with multiple hard links are only counted once.
+    if (!S_ISDIR(s.st_mode) && s.st_nlink > 1) {
+      if (!inodes.insert(std::make_pair(s.st_dev, s.st_ino)).second) {
+        return Bytes(0);
+      }
+    }
+
+    // NOTE: `st_blocks` is in units of 512 bytes on all platforms.
+    return Bytes(s.st_blocks * 512);
+  }
+
+  // The patterns are matched against the path and each of its
+  // suffixes starting after a '/', as with `du --exclude`.
+  bool excluded(const string& path) const
+  {
+    foreach (const string& exclude, excludes) {
+      size_t index = 0;
+
+      while (index != string::npos) {
+        if (::fnmatch(exclude.c_str(), path.c_str() + index, 0) == 0) {
+          return true;
+        }
+
+        index = path.find('/', index);
+        if (index != string::npos) {
+          index++;
+        }
+      }
+    }
+
+    return false;
+  }
+
+  const vector<string>& excludes;
+  DirectoryCache* cache;
+  const std::atomic_bool* cancelled;
+  const time_t started;
+
+  hashset<string> visited;
+  std::set<std::pair<dev_t, ino_t>> inodes;
+};
+
+
+Try<Bytes> diskUsage(
+    const string& path,
+    const vector<string>& excludes,
+    DirectoryCache* cache,
+    const std::atomic_bool* cancelled)
+{
+  return DiskUsageWalker(excludes, cache, cancelled).walk(path);
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,73 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __MESOS_CONTAINERIZER_DISK_USAGE_HPP__
+#define __MESOS_CONTAINERIZER_DISK_USAGE_HPP__
+
+#include <sys/types.h>
+
+#include <atomic>
+#include <string>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/try.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// Caches the entries of the directories of a tree, so that the
+// directories which have not changed since the previous walk do not
+// need to be read again. Only the sizes of their entries are.
+struct DirectoryCache
+{
+  struct Listing
+  {
+    dev_t device;
+    ino_t inode;
+    time_t ctime;
+    std::vector<std::string> entries;
+  };
+
+  // Keyed by the path of the directory relative to the root.
+  hashmap<std::string, Listing> listings;
+};
+
+
+// Returns the disk space used by the tree at `path` the same way as
+// `du -s` does, i.e., summing the blocks allocated to all the files in
+// the tree, counting files with multiple hard links once and not
+// following symbolic links (except for the root if it ends with '/').
+// Entries matching one of the `excludes` patterns, and the entire tree
+// below excluded directories, are skipped as with `du --exclude`.
+//
+// The listings of the directories are reused from and saved to the
+// `cache`, if any. The walk fails once `cancelled` (if any) is set.
+//
+// NOTE: This blocks the calling thread while it walks the tree.
+Try<Bytes> diskUsage(
+    const std::string& path,
+    const std::vector<std::string>& excludes = std::vector<std::string>(),
+    DirectoryCache* cache = nullptr,
+    const std::atomic_bool* cancelled = nullptr);
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __MESOS_CONTAINERIZER_DISK_USAGE_HPP__
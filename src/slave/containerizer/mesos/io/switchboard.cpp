@@ -14,11 +14,15 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <fcntl.h>
 #include <stdio.h>
 #include <stdlib.h>
 
+#include <sys/stat.h>
+
 #include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <vector>
 
@@ -40,6 +44,7 @@
 #include <process/socket.hpp>
 #include <process/subprocess.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
@@ -933,6 +938,11 @@ void IOSwitchboard::reaped(
 const char IOSwitchboardServer::NAME[] = "mesos-io-switchboard";
 
 
+// The most output that is read at once to send it to the attached
+// output connections as a single `ProcessIO` record.
+constexpr Bytes MAX_OUTPUT_RECORD_SIZE = Kilobytes(256);
+
+
 class IOSwitchboardServerProcess : public Process<IOSwitchboardServerProcess>
 {
 public:
@@ -959,15 +969,23 @@ private:
   public:
     HttpConnection(
         const http::Pipe::Writer& _writer,
-        const ContentType& contentType)
-      : writer(_writer),
-        encoder(lambda::bind(serialize, contentType, lambda::_1)) {}
+        const ContentType& _contentType)
+      : contentType(_contentType),
+        writer(_writer),
+        encoder(lambda::bind(serialize, _contentType, lambda::_1)) {}
 
     bool send(const agent::ProcessIO& message)
     {
       return writer.write(encoder.encode(message));
     }
 
+    // Sends a message already encoded for the content type of this
+    // connection, so that it is encoded once for all connections.
+    bool send(const string& record)
+    {
+      return writer.write(record);
+    }
+
     bool close()
     {
       return writer.close();
@@ -978,6 +996,8 @@ private:
       return writer.readerClosed();
     }
 
+    const ContentType contentType;
+
   private:
     http::Pipe::Writer writer;
     ::recordio::Encoder<agent::ProcessIO> encoder;
@@ -1012,6 +1032,14 @@ private:
       ContentType acceptType,
       Option<ContentType> messageAcceptType);
 
+  // Forwards the output of the container from `from` (i.e.,
+  // `stdoutFromFd` or `stderrFromFd`) to `to` and to the attached
+  // output connections, until EOF is reached.
+  Future<Nothing> redirect(
+      int from,
+      int to,
+      const agent::ProcessIO::Data::Type& type);
+
   // Asynchronously receive data as we read it from our
   // `stdoutFromFd` and `stderrFromFd` file descriptors.
   void outputHook(
@@ -1174,14 +1202,8 @@ Future<Nothing> IOSwitchboardServerProcess::run()
 
   startRedirect.future()
     .then(defer(self(), [this]() {
-      Future<Nothing> stdoutRedirect = process::io::redirect(
-          stdoutFromFd,
-          stdoutToFd,
-          process::io::BUFFERED_READ_SIZE,
-          {defer(self(),
-                 &Self::outputHook,
-                 lambda::_1,
-                 agent::ProcessIO::Data::STDOUT)});
+      Future<Nothing> stdoutRedirect =
+        redirect(stdoutFromFd, stdoutToFd, agent::ProcessIO::Data::STDOUT);
 
       // NOTE: We don't need to redirect stderr if TTY is enabled. If
       // TTY is enabled for the container, stdout and stderr for the
@@ -1192,14 +1214,8 @@ Future<Nothing> IOSwitchboardServerProcess::run()
       if (tty) {
         stderrRedirect = Nothing();
       } else {
-        stderrRedirect = process::io::redirect(
-            stderrFromFd,
-            stderrToFd,
-            process::io::BUFFERED_READ_SIZE,
-            {defer(self(),
-                   &Self::outputHook,
-                   lambda::_1,
-                   agent::ProcessIO::Data::STDERR)});
+        stderrRedirect =
+          redirect(stderrFromFd, stderrToFd, agent::ProcessIO::Data::STDERR);
       }
 
       // Set the future once our IO redirects finish. On failure,
@@ -1767,6 +1783,156 @@ Future<http::Response> IOSwitchboardServerProcess::attachContainerOutput(
 }
 
 
+Future<Nothing> IOSwitchboardServerProcess::redirect(
+    int from,
+    int to,
+    const agent::ProcessIO::Data::Type& type)
+{
+  // Make the file descriptors non-blocking (no-op if already set).
+  Try<Nothing> nonblock = os::nonblock(from);
+  if (nonblock.isError()) {
+    return Failure("Failed to make 'from' non-blocking: " + nonblock.error());
+  }
+
+  nonblock = os::nonblock(to);
+  if (nonblock.isError()) {
+    return Failure("Failed to make 'to' non-blocking: " + nonblock.error());
+  }
+
+  // While no output connection is attached, the output is spliced from
+  // `from` to `to` within the kernel rather than copied through our
+  // buffers. This requires `from` to be a pipe, which it is not with a
+  // TTY (i.e., it is the master end of the pseudo terminal).
+  std::shared_ptr<bool> splice(new bool(false));
+
+  // The file descriptor to splice into, which differs from `to` if the
+  // latter cannot be spliced into (see below).
+  int spliceTo = to;
+  bool append = false;
+
+#ifdef __linux__
+  struct stat s;
+  *splice = ::fstat(from, &s) == 0 && S_ISFIFO(s.st_mode);
+
+  // Files opened with `O_APPEND` (e.g., the sandbox logs of the
+  // default container logger, see `Subprocess::PATH`) cannot be
+  // spliced into. We splice into such a file through a file
+  // description of our own without `O_APPEND` instead, which we seek
+  // to the end of the file before each splice, so that the output is
+  // still appended to what other processes wrote (e.g., the fetcher).
+  const int flags = ::fcntl(to, F_GETFL);
+
+  if (*splice &&
+      flags >= 0 &&
+      (flags & O_APPEND) &&
+      ::fstat(to, &s) == 0 &&
+      S_ISREG(s.st_mode)) {
+    Try<int> reopen = os::open(
+        path::join("/proc/self/fd", stringify(to)),
+        O_WRONLY | O_CLOEXEC);
+
+    if (reopen.isError()) {
+      LOG(WARNING) << "Failed to reopen the output for splicing: "
+                   << reopen.error();
+
+      *splice = false;
+    } else {
+      spliceTo = reopen.get();
+      append = true;
+    }
+  }
+#endif // __linux__
+
+  std::shared_ptr<char> buffer(
+      new char[process::io::BUFFERED_READ_SIZE],
+      std::default_delete<char[]>());
+
+  return loop(
+      self(),
+      [=]() -> Future<short> {
+        // Wait for output to splice, otherwise `io::read()` waits for it.
+        if (*splice && outputConnections.empty()) {
+          return process::io::poll(from, process::io::READ);
+        }
+
+        return process::io::READ;
+      },
+      [=](short) -> Future<ControlFlow<Nothing>> {
+#ifdef __linux__
+        if (*splice && outputConnections.empty()) {
+          if (append && ::lseek(spliceTo, 0, SEEK_END) < 0) {
+            return ErrnoFailure("Failed to seek to the end of the output");
+          }
+
+          ssize_t length = ::splice(
+              from,
+              nullptr,
+              spliceTo,
+              nullptr,
+              process::io::BUFFERED_READ_SIZE,
+              SPLICE_F_MOVE | SPLICE_F_NONBLOCK);
+
+          if (length > 0 || (length < 0 && errno == EINTR)) {
+            return Continue();
+          } else if (length == 0) {
+            return Break(); // EOF.
+          } else if (errno == EAGAIN || errno == EWOULDBLOCK) {
+            // Since `from` was readable, `to` is most likely full.
+            return process::io::poll(spliceTo, process::io::WRITE)
+              .then([]() -> ControlFlow<Nothing> { return Continue(); });
+          } else if (errno != EINVAL) {
+            return ErrnoFailure("Failed to splice");
+          }
+
+          // `to` does not support splicing into it, so we fall back
+          // to copying.
+          *splice = false;
+        }
+#endif // __linux__
+
+        return process::io::read(
+            from,
+            buffer.get(),
+            process::io::BUFFERED_READ_SIZE)
+          .then(defer(self(), [=](size_t length)
+              -> Future<ControlFlow<Nothing>> {
+            if (length == 0) {
+              return Break(); // EOF.
+            }
+
+            string data(buffer.get(), length);
+
+            // Drain the output that is already available so that it is
+            // sent to the output connections as one record rather than
+            // as one record per read.
+            while (Bytes(data.size()) < MAX_OUTPUT_RECORD_SIZE) {
+              ssize_t more = ::read(
+                  from,
+                  buffer.get(),
+                  process::io::BUFFERED_READ_SIZE);
+
+              // Leave EOF and errors to the next `io::read()`.
+              if (more <= 0) {
+                break;
+              }
+
+              data.append(buffer.get(), more);
+            }
+
+            outputHook(data, type);
+
+            return process::io::write(to, data)
+              .then([]() -> ControlFlow<Nothing> { return Continue(); });
+          }));
+      })
+    .onAny([=]() {
+      if (spliceTo != to) {
+        os::close(spliceTo);
+      }
+    });
+}
+
+
 void IOSwitchboardServerProcess::outputHook(
     const string& data,
     const agent::ProcessIO::Data::Type& type)
@@ -1782,6 +1948,10 @@ void IOSwitchboardServerProcess::outputHook(
   message.mutable_data()->set_type(type);
   message.mutable_data()->set_data(data);
 
+  // The message is encoded once per content type, rather than once
+  // per connection.
+  map<ContentType, string> records;
+
   // Walk through our list of connections and write the message to
   // them. It's possible that a write might fail if the writer has
   // been closed. That's OK because we already take care of removing
@@ -1790,7 +1960,14 @@ void IOSwitchboardServerProcess::outputHook(
   // unnecessary writes if we have a bunch of messages queued up,
   // but that shouldn't be a problem.
   foreach (HttpConnection& connection, outputConnections) {
-    connection.send(message);
+    if (records.count(connection.contentType) == 0) {
+      ::recordio::Encoder<agent::ProcessIO> encoder(
+          lambda::bind(serialize, connection.contentType, lambda::_1));
+
+      records[connection.contentType] = encoder.encode(message);
+    }
+
+    connection.send(records.at(connection.contentType));
   }
 }
 #endif // __WINDOWS__
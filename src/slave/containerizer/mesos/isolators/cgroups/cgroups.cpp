@@ -16,6 +16,7 @@
 
 #include <vector>
 
+#include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/id.hpp>
@@ -41,6 +42,7 @@ using mesos::slave::ContainerLimitation;
 using mesos::slave::ContainerState;
 using mesos::slave::Isolator;
 
+using process::Clock;
 using process::Failure;
 using process::Future;
 using process::Owned;
@@ -719,6 +721,81 @@ Future<ResourceStatistics> CgroupsIsolatorProcess::usage(
     return Failure("Unknown container");
   }
 
+  // Start a new pass unless the statistics of the last one are still
+  // fresh. A pass which is still in progress is always joined.
+  if (statistics.isNone() ||
+      (!statistics->isPending() &&
+       statisticsWatch.elapsed() >= USAGE_STATISTICS_FRESHNESS)) {
+    statisticsWatch.start();
+    statistics = collect();
+  }
+
+  return statistics.get()
+    .then(defer(
+        PID<CgroupsIsolatorProcess>(this),
+        &CgroupsIsolatorProcess::_usage,
+        containerId,
+        lambda::_1));
+}
+
+
+Future<ResourceStatistics> CgroupsIsolatorProcess::_usage(
+    const ContainerID& containerId,
+    const hashmap<ContainerID, ResourceStatistics>& statistics)
+{
+  if (!infos.contains(containerId)) {
+    return Failure("Unknown container");
+  }
+
+  // The container might have been launched after the pass started.
+  if (!statistics.contains(containerId)) {
+    return collect(containerId);
+  }
+
+  return statistics.at(containerId);
+}
+
+
+Future<hashmap<ContainerID, ResourceStatistics>>
+CgroupsIsolatorProcess::collect()
+{
+  list<ContainerID> containerIds;
+  list<Future<ResourceStatistics>> usages;
+
+  foreachkey (const ContainerID& containerId, infos) {
+    containerIds.push_back(containerId);
+    usages.push_back(collect(containerId));
+  }
+
+  return await(usages)
+    .then([containerIds](const list<Future<ResourceStatistics>>& usages) {
+      hashmap<ContainerID, ResourceStatistics> result;
+
+      list<ContainerID>::const_iterator containerId = containerIds.begin();
+      foreach (const Future<ResourceStatistics>& usage, usages) {
+        // NOTE: The collection of the statistics of a container never
+        // fails, see below.
+        if (usage.isReady()) {
+          result[*containerId] = usage.get();
+        }
+
+        ++containerId;
+      }
+
+      return result;
+    });
+}
+
+
+Future<ResourceStatistics> CgroupsIsolatorProcess::collect(
+    const ContainerID& containerId)
+{
+  CHECK(infos.contains(containerId));
+
+  // The statistics may be served to `usage()` calls for a while after
+  // they are collected, so they carry the time of their collection.
+  const double timestamp = Clock::now().secs();
+
   list<Future<ResourceStatistics>> usages;
   foreachvalue (const Owned<Subsystem>& subsystem, subsystems) {
     if (infos[containerId]->subsystems.contains(subsystem->name())) {
@@ -729,7 +806,8 @@ Future<ResourceStatistics> CgroupsIsolatorProcess::usage(
   }
 
   return await(usages)
-    .then([containerId](const list<Future<ResourceStatistics>>& _usages) {
+    .then([containerId, timestamp](
+        const list<Future<ResourceStatistics>>& _usages) {
       ResourceStatistics result;
 
       foreach (const Future<ResourceStatistics>& statistics, _usages) {
@@ -743,6 +821,8 @@ Future<ResourceStatistics> CgroupsIsolatorProcess::usage(
         }
       }
 
+      result.set_timestamp(timestamp);
+
       return result;
     });
 }
@@ -807,6 +887,10 @@ Future<Nothing> CgroupsIsolatorProcess::cleanup(
 
   list<Future<Nothing>> cleanups;
   foreachvalue (const Owned<Subsystem>& subsystem, subsystems) {
+    // Close the control files kept open to collect the statistics of
+    // the container before its cgroups are destroyed.
+    subsystem->close(containerId);
+
     if (infos[containerId]->subsystems.contains(subsystem->name())) {
       cleanups.push_back(subsystem->cleanup(
           containerId,
@@ -29,6 +29,7 @@
 #include <stout/multihashmap.hpp>
 #include <stout/nothing.hpp>
 #include <stout/option.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/try.hpp>
 
 #include "slave/flags.hpp"
@@ -140,6 +141,16 @@ private:
   process::Future<Nothing> _update(
       const std::list<process::Future<Nothing>>& futures);
 
+  process::Future<ResourceStatistics> _usage(
+      const ContainerID& containerId,
+      const hashmap<ContainerID, ResourceStatistics>& statistics);
+
+  // Collects the usage statistics of all the containers.
+  process::Future<hashmap<ContainerID, ResourceStatistics>> collect();
+
+  // Collects the usage statistics of a single container.
+  process::Future<ResourceStatistics> collect(const ContainerID& containerId);
+
   process::Future<Nothing> _cleanup(
       const ContainerID& containerId,
       const std::list<process::Future<Nothing>>& futures);
@@ -165,6 +176,11 @@ private:
 
   // Store cgroups associated information for containers.
   hashmap<ContainerID, process::Owned<Info>> infos;
+
+  // The usage statistics of all the containers from the last pass,
+  // and the time elapsed since the pass started.
+  Option<process::Future<hashmap<ContainerID, ResourceStatistics>>> statistics;
+  Stopwatch statisticsWatch;
 };
 
 } // namespace slave {
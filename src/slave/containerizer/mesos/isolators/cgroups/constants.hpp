@@ -38,6 +38,14 @@ const Duration MIN_CPU_CFS_QUOTA = Milliseconds(1);
 const Bytes MIN_MEMORY = Megabytes(32);
 
 
+// The usage statistics of all the containers are collected in one pass
+// and served to the subsequent `usage()` calls within this interval, so
+// that polling the statistics of many containers (e.g., through the
+// '/monitor/statistics' endpoint) does not collect them once per
+// container.
+const Duration USAGE_STATISTICS_FRESHNESS = Milliseconds(500);
+
+
 // Subsystem names.
 const std::string CGROUP_SUBSYSTEM_BLKIO_NAME = "blkio";
 const std::string CGROUP_SUBSYSTEM_CPU_NAME = "cpu";
@@ -150,6 +150,34 @@ Future<Nothing> Subsystem::cleanup(
   return Nothing();
 }
 
+
+void Subsystem::close(const ContainerID& containerId)
+{
+  controls.erase(containerId);
+}
+
+
+Try<cgroups::ControlFile*> Subsystem::control(
+    const ContainerID& containerId,
+    const string& cgroup,
+    const string& control)
+{
+  hashmap<string, Owned<cgroups::ControlFile>>& files = controls[containerId];
+
+  if (!files.contains(control)) {
+    Try<Owned<cgroups::ControlFile>> file =
+      cgroups::ControlFile::open(hierarchy, cgroup, control);
+
+    if (file.isError()) {
+      return Error(file.error());
+    }
+
+    files[control] = file.get();
+  }
+
+  return files.at(control).get();
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
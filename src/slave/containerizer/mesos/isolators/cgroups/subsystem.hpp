@@ -27,9 +27,12 @@
 #include <process/owned.hpp>
 #include <process/process.hpp>
 
+#include <stout/hashmap.hpp>
 #include <stout/nothing.hpp>
 #include <stout/try.hpp>
 
+#include "linux/cgroups.hpp"
+
 #include "slave/flags.hpp"
 
 namespace mesos {
@@ -167,9 +170,32 @@ public:
       const ContainerID& containerId,
       const std::string& cgroup);
 
+  /**
+   * Close the control files kept open for the associated container.
+   *
+   * @param containerId The target containerId.
+   */
+  void close(const ContainerID& containerId);
+
 protected:
   Subsystem(const Flags& _flags, const std::string& _hierarchy);
 
+  /**
+   * Get a control file of the cgroup of the associated container. The
+   * control file is opened on first use and kept open until `close`
+   * is called, so that statistics can be collected repeatedly without
+   * reopening the control files.
+   *
+   * @param containerId The target containerId.
+   * @param cgroup The target cgroup.
+   * @param control The name of the control file.
+   * @return The control file or an error if it cannot be opened.
+   */
+  Try<cgroups::ControlFile*> control(
+      const ContainerID& containerId,
+      const std::string& cgroup,
+      const std::string& control);
+
   /**
    * `Flags` used to launch the agent.
    */
@@ -179,6 +205,11 @@ protected:
    * The hierarchy path of cgroups subsystem.
    */
   const std::string hierarchy;
+
+private:
+  hashmap<ContainerID,
+          hashmap<std::string, process::Owned<cgroups::ControlFile>>>
+    controls;
 };
 
 } // namespace slave {
@@ -136,29 +136,24 @@ Future<ResourceStatistics> CpuSubsystem::usage(
 
   // Add the cpu.stat information only if CFS is enabled.
   if (flags.cgroups_enable_cfs) {
-    Try<hashmap<string, uint64_t>> stat = cgroups::stat(
-        hierarchy,
-        cgroup,
-        "cpu.stat");
-
-    if (stat.isError()) {
-      return Failure("Failed to read 'cpu.stat': " + stat.error());
+    Try<cgroups::ControlFile*> file = control(containerId, cgroup, "cpu.stat");
+    if (file.isError()) {
+      return Failure("Failed to open 'cpu.stat': " + file.error());
     }
 
-    Option<uint64_t> nr_periods = stat->get("nr_periods");
-    if (nr_periods.isSome()) {
-      result.set_cpus_nr_periods(nr_periods.get());
-    }
+    Try<Nothing> stat = file.get()->stat(
+        [&result](const string& name, uint64_t value) {
+          if (name == "nr_periods") {
+            result.set_cpus_nr_periods(value);
+          } else if (name == "nr_throttled") {
+            result.set_cpus_nr_throttled(value);
+          } else if (name == "throttled_time") {
+            result.set_cpus_throttled_time_secs(Nanoseconds(value).secs());
+          }
+        });
 
-    Option<uint64_t> nr_throttled = stat->get("nr_throttled");
-    if (nr_throttled.isSome()) {
-      result.set_cpus_nr_throttled(nr_throttled.get());
-    }
-
-    Option<uint64_t> throttled_time = stat->get("throttled_time");
-    if (throttled_time.isSome()) {
-      result.set_cpus_throttled_time_secs(
-          Nanoseconds(throttled_time.get()).secs());
+    if (stat.isError()) {
+      return Failure("Failed to read 'cpu.stat': " + stat.error());
     }
   }
 
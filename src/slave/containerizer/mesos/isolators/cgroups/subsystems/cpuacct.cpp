@@ -88,19 +88,30 @@ Future<ResourceStatistics> CpuacctSubsystem::usage(
   PCHECK(ticks > 0) << "Failed to get sysconf(_SC_CLK_TCK)";
 
   // Add the cpuacct.stat information.
-  Try<hashmap<string, uint64_t>> stat = cgroups::stat(
-      hierarchy,
-      cgroup,
-      "cpuacct.stat");
+  Try<cgroups::ControlFile*> file =
+    control(containerId, cgroup, "cpuacct.stat");
 
-  if (stat.isError()) {
-    return Failure("Failed to read 'cpuacct.stat': " + stat.error());
+  if (file.isError()) {
+    return Failure("Failed to open 'cpuacct.stat': " + file.error());
   }
 
   // TODO(bmahler): Add namespacing to cgroups to enforce the expected
   // structure, e.g., cgroups::cpuacct::stat.
-  Option<uint64_t> user = stat->get("user");
-  Option<uint64_t> system = stat->get("system");
+  Option<uint64_t> user;
+  Option<uint64_t> system;
+
+  Try<Nothing> stat = file.get()->stat(
+      [&user, &system](const string& name, uint64_t value) {
+        if (name == "user") {
+          user = value;
+        } else if (name == "system") {
+          system = value;
+        }
+      });
+
+  if (stat.isError()) {
+    return Failure("Failed to read 'cpuacct.stat': " + stat.error());
+  }
 
   if (user.isSome() && system.isSome()) {
     result.set_cpus_user_time_secs((double) user.get() / (double) ticks);
@@ -317,67 +317,73 @@ Future<ResourceStatistics> MemorySubsystem::usage(
   // The rss from memory.stat is wrong in two dimensions:
   //   1. It does not include child cgroups.
   //   2. It does not include any file backed pages.
-  Try<Bytes> usage = cgroups::memory::usage_in_bytes(hierarchy, cgroup);
+  Try<cgroups::ControlFile*> file =
+    control(containerId, cgroup, "memory.usage_in_bytes");
+
+  if (file.isError()) {
+    return Failure("Failed to open 'memory.usage_in_bytes': " + file.error());
+  }
+
+  Try<uint64_t> usage = file.get()->value();
 
   if (usage.isError()) {
     return Failure("Failed to parse 'memory.usage_in_bytes': " + usage.error());
   }
 
-  result.set_mem_total_bytes(usage->bytes());
+  result.set_mem_total_bytes(usage.get());
 
   if (flags.cgroups_limit_swap) {
-    Try<Bytes> usage = cgroups::memory::memsw_usage_in_bytes(hierarchy, cgroup);
+    Try<cgroups::ControlFile*> file =
+      control(containerId, cgroup, "memory.memsw.usage_in_bytes");
+
+    if (file.isError()) {
+      return Failure(
+        "Failed to open 'memory.memsw.usage_in_bytes': " + file.error());
+    }
+
+    Try<uint64_t> usage = file.get()->value();
 
     if (usage.isError()) {
       return Failure(
         "Failed to parse 'memory.memsw.usage_in_bytes': " + usage.error());
     }
 
-    result.set_mem_total_memsw_bytes(usage->bytes());
+    result.set_mem_total_memsw_bytes(usage.get());
   }
 
   // TODO(bmahler): Add namespacing to cgroups to enforce the expected
   // structure, e.g, cgroups::memory::stat.
-  Try<hashmap<string, uint64_t>> stat = cgroups::stat(
-      hierarchy,
-      cgroup,
-      "memory.stat");
+  file = control(containerId, cgroup, "memory.stat");
+
+  if (file.isError()) {
+    return Failure("Failed to open 'memory.stat': " + file.error());
+  }
+
+  Try<Nothing> stat = file.get()->stat(
+      [&result](const string& name, uint64_t value) {
+        if (name == "total_cache") {
+          // TODO(chzhcn): mem_file_bytes is deprecated in 0.23.0 and
+          // will be removed in 0.24.0.
+          result.set_mem_file_bytes(value);
+          result.set_mem_cache_bytes(value);
+        } else if (name == "total_rss") {
+          // TODO(chzhcn): mem_anon_bytes is deprecated in 0.23.0 and
+          // will be removed in 0.24.0.
+          result.set_mem_anon_bytes(value);
+          result.set_mem_rss_bytes(value);
+        } else if (name == "total_mapped_file") {
+          result.set_mem_mapped_file_bytes(value);
+        } else if (name == "total_swap") {
+          result.set_mem_swap_bytes(value);
+        } else if (name == "total_unevictable") {
+          result.set_mem_unevictable_bytes(value);
+        }
+      });
 
   if (stat.isError()) {
     return Failure("Failed to read 'memory.stat': " + stat.error());
   }
 
-  Option<uint64_t> total_cache = stat->get("total_cache");
-  if (total_cache.isSome()) {
-    // TODO(chzhcn): mem_file_bytes is deprecated in 0.23.0 and will
-    // be removed in 0.24.0.
-    result.set_mem_file_bytes(total_cache.get());
-    result.set_mem_cache_bytes(total_cache.get());
-  }
-
-  Option<uint64_t> total_rss = stat->get("total_rss");
-  if (total_rss.isSome()) {
-    // TODO(chzhcn): mem_anon_bytes is deprecated in 0.23.0 and will
-    // be removed in 0.24.0.
-    result.set_mem_anon_bytes(total_rss.get());
-    result.set_mem_rss_bytes(total_rss.get());
-  }
-
-  Option<uint64_t> total_mapped_file = stat->get("total_mapped_file");
-  if (total_mapped_file.isSome()) {
-    result.set_mem_mapped_file_bytes(total_mapped_file.get());
-  }
-
-  Option<uint64_t> total_swap = stat->get("total_swap");
-  if (total_swap.isSome()) {
-    result.set_mem_swap_bytes(total_swap.get());
-  }
-
-  Option<uint64_t> total_unevictable = stat->get("total_unevictable");
-  if (total_unevictable.isSome()) {
-    result.set_mem_unevictable_bytes(total_unevictable.get());
-  }
-
   // Get pressure counter readings.
   list<Level> levels;
   list<Future<uint64_t>> values;
@@ -14,43 +14,37 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
-#include <signal.h>
-
-#ifdef __linux__
-#include <sys/prctl.h>
-#endif
 #include <sys/types.h>
 
+#include <atomic>
 #include <deque>
-#include <tuple>
+#include <memory>
 
 #include <glog/logging.h>
 
+#include <process/async.hpp>
 #include <process/check.hpp>
-#include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/delay.hpp>
 #include <process/id.hpp>
-#include <process/io.hpp>
-#include <process/subprocess.hpp>
 
 #include <stout/check.hpp>
 #include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/lambda.hpp>
-#include <stout/numify.hpp>
 #include <stout/strings.hpp>
 #include <stout/path.hpp>
 
 #include <stout/os/constants.hpp>
 #include <stout/os/exists.hpp>
-#include <stout/os/killtree.hpp>
 #include <stout/os/stat.hpp>
 
 #include "common/protobuf_utils.hpp"
 
-#include "slave/containerizer/mesos/isolators/posix/disk.hpp"
+#include "slave/containerizer/mesos/disk_usage.hpp"
 
-namespace io = process::io;
+#include "slave/containerizer/mesos/isolators/posix/disk.hpp"
 
 using std::deque;
 using std::list;
@@ -63,14 +57,11 @@ using process::Owned;
 using process::PID;
 using process::Process;
 using process::Promise;
-using process::Subprocess;
 
-using process::await;
 using process::defer;
 using process::delay;
 using process::dispatch;
 using process::spawn;
-using process::subprocess;
 using process::terminate;
 
 using mesos::slave::ContainerConfig;
@@ -85,8 +76,6 @@ namespace slave {
 
 Try<Isolator*> PosixDiskIsolatorProcess::create(const Flags& flags)
 {
-  // TODO(jieyu): Check the availability of command 'du'.
-
   return new MesosIsolator(process::Owned<MesosIsolatorProcess>(
         new PosixDiskIsolatorProcess(flags)));
 }
@@ -270,6 +259,8 @@ Future<Nothing> PosixDiskIsolatorProcess::update(
       // Cancel the usage collection as we are no longer interested.
       info->paths[path].usage.discard();
       info->paths.erase(path);
+
+      collector.forget(path);
     }
   }
 
@@ -289,7 +280,7 @@ Future<Bytes> PosixDiskIsolatorProcess::collect(
   //
   // TODO(jieyu): The 'excludes' list might change when a new
   // persistent volume is added to the list. That might result in the
-  // 'du' process to incorrectly include the disk usage of the newly
+  // collector to incorrectly include the disk usage of the newly
   // added persistent volume to the usage of the sandbox.
   vector<string> excludes;
   if (path == info->directory) {
@@ -300,8 +291,8 @@ Future<Bytes> PosixDiskIsolatorProcess::collect(
     }
   }
 
-  // We append "/" at the end to make sure that 'du' runs on actual
-  // directory pointed by the symlink (and not the symlink itself).
+  // We append "/" at the end to make sure that the collector walks the
+  // actual directory pointed by the symlink (and not the symlink itself).
   string _path = path;
   if (path != info->directory && os::stat::islink(path)) {
     _path = path::join(path, "");
@@ -455,28 +446,41 @@ Future<Nothing> PosixDiskIsolatorProcess::cleanup(
     return Nothing();
   }
 
+  const hashset<string> paths = infos[containerId]->paths.keys();
+
   infos.erase(containerId);
 
+  // Drop the directory listings cached for the paths of the container
+  // once their checks are cancelled, as they are not checked anymore.
+  foreach (const string& path, paths) {
+    collector.forget(path);
+  }
+
   return Nothing();
 }
 
 
+// Maximum number of paths whose disk usage is collected concurrently.
+// Each collection blocks a libprocess worker thread while it walks the
+// path, so we keep this bounded.
+constexpr size_t MAX_CONCURRENT_DISK_USAGE_COLLECTIONS = 4;
+
+
 class DiskUsageCollectorProcess : public Process<DiskUsageCollectorProcess>
 {
 public:
   DiskUsageCollectorProcess(const Duration& _interval)
     : ProcessBase(process::ID::generate("posix-disk-usage-collector")),
-      interval(_interval) {}
+      interval(_interval),
+      running(0),
+      cancelled(new std::atomic_bool(false)) {}
+
   virtual ~DiskUsageCollectorProcess() {}
 
   Future<Bytes> usage(
       const string& path,
       const vector<string>& excludes)
   {
-    // TODO(jieyu): 'excludes' is not supported on OSX. We should
-    // either return a Failure here, or does not allow 'excludes' to
-    // be specified on OSX.
-
     foreach (const Owned<Entry>& entry, entries) {
       if (entry->path == path) {
         return entry->promise.future();
@@ -489,22 +493,26 @@ public:
     Future<Bytes> future = entries.back()->promise.future();
     future.onDiscard(defer(self(), &Self::discard, path));
 
+    schedule();
+
     return future;
   }
 
-protected:
-  void initialize()
+  void forget(const string& path)
   {
-    schedule();
+    // The checks may have been asked for with a trailing "/" to follow
+    // a symbolic link, see `PosixDiskIsolatorProcess::collect()`.
+    caches.erase(path);
+    caches.erase(path::join(path, ""));
   }
 
+protected:
   void finalize()
   {
-    foreach (const Owned<Entry>& entry, entries) {
-      if (entry->du.isSome() && entry->du->status().isPending()) {
-        os::killtree(entry->du->pid(), SIGKILL);
-      }
+    // Stop the walks that are still running.
+    cancelled->store(true);
 
+    foreach (const Owned<Entry>& entry, entries) {
       entry->promise.fail("DiskUsageCollector is destroyed");
     }
   }
@@ -515,159 +523,110 @@ private:
   {
     explicit Entry(const string& _path, const vector<string>& _excludes)
       : path(_path),
-        excludes(_excludes) {}
+        excludes(_excludes),
+        started(false) {}
 
     string path;
     vector<string> excludes;
-    Option<Subprocess> du;
+    bool started;
     Promise<Bytes> promise;
   };
 
   void discard(const string& path)
   {
     for (auto it = entries.begin(); it != entries.end(); ++it) {
-      // We only cancel those checks whose 'du' haven't been launched.
-      if ((*it)->path == path && (*it)->du.isNone()) {
+      // We only cancel those checks which haven't been started.
+      if ((*it)->path == path && !(*it)->started) {
         (*it)->promise.discard();
         entries.erase(it);
+
+        // The path is no longer of interest.
+        caches.erase(path);
         break;
       }
     }
   }
 
-  // Schedule a 'du' to be invoked. The current implementation does
-  // not allow multiple 'du's running concurrently. The minimal
-  // interval between two subsequent 'du's is controlled by 'interval'
-  // for throttling purpose.
+  // Starts the pending checks, walking up to a bounded number of paths
+  // concurrently. The minimal interval between two subsequent walks in
+  // the same slot is controlled by 'interval' for throttling purpose.
+  //
+  // NOTE: The walks are run in the agent's cgroup and it will be that
+  // cgroup that is charged for (a) memory to cache the fs data
+  // structures, (b) disk I/O to read those structures, and (c) the cpu
+  // time to traverse.
   void schedule()
   {
-    if (entries.empty()) {
-      delay(interval, self(), &Self::schedule);
-      return;
-    }
+    foreach (const Owned<Entry>& entry, entries) {
+      if (running >= MAX_CONCURRENT_DISK_USAGE_COLLECTIONS) {
+        break;
+      }
 
-    const Owned<Entry>& entry = entries.front();
-
-    // Invoke 'du' and report number of 1K-byte blocks. We fix the
-    // block size here so that we can get consistent results on all
-    // platforms (e.g., OS X uses 512 byte blocks).
-    //
-    // NOTE: The 'du' processes are run in the slave's cgroup and it
-    // will be that cgroup that is charged for (a) memory to cache the
-    // fs data structures, (b) disk I/O to read those structures, and
-    // (c) the cpu time to traverse.
-
-    // Construct the 'du' command.
-    vector<string> command = {
-      "du",
-      "-k", // Use 1K size blocks for consistent results across platforms.
-      "-s", // Use 'silent' output mode.
-    };
-
-#ifdef __linux__
-    // Add paths that need to be excluded.
-    foreach (const string& exclude, entry->excludes) {
-      command.push_back("--exclude");
-      command.push_back(exclude);
-    }
-#endif
-
-    // Add path on which 'du' must be run.
-    command.push_back(entry->path);
-
-    // NOTE: The supervisor childhook will watch the parent process and kill
-    // the 'du' process in case that the parent die.
-    Try<Subprocess> s = subprocess(
-        "du",
-        command,
-        Subprocess::PATH(os::DEV_NULL),
-        Subprocess::PIPE(),
-        Subprocess::PIPE(),
-        nullptr,
-        None(),
-        None(),
-        {},
-        {Subprocess::ChildHook::SUPERVISOR()});
-
-    if (s.isError()) {
-      entry->promise.fail("Failed to exec 'du': " + s.error());
-
-      entries.pop_front();
-      delay(interval, self(), &Self::schedule);
-      return;
-    }
+      if (entry->started) {
+        continue;
+      }
 
-    entry->du = s.get();
+      entry->started = true;
+      running++;
 
-    await(s->status(),
-          io::read(s->out().get()),
-          io::read(s->err().get()))
-      .onAny(defer(self(), &Self::_schedule, lambda::_1));
+      if (!caches.contains(entry->path)) {
+        caches[entry->path] = Owned<DirectoryCache>(new DirectoryCache());
+      }
+
+      // NOTE: The walk owns everything it accesses, as it may outlive
+      // this process if the collector is destroyed.
+      const string path = entry->path;
+      const vector<string> excludes = entry->excludes;
+      const Owned<DirectoryCache> cache = caches.at(entry->path);
+      const std::shared_ptr<std::atomic_bool> cancelled = this->cancelled;
+
+      process::async([=]() {
+        return diskUsage(path, excludes, cache.get(), cancelled.get());
+      })
+      .onAny(defer(self(), &Self::_schedule, entry, lambda::_1));
+    }
   }
 
-  void _schedule(const Future<std::tuple<
-      Future<Option<int>>,
-      Future<string>,
-      Future<string>>>& future)
+  void _schedule(const Owned<Entry>& entry, const Future<Try<Bytes>>& future)
   {
     CHECK_READY(future);
-    CHECK(!entries.empty());
-
-    const Owned<Entry>& entry = entries.front();
-    CHECK_SOME(entry->du);
 
-    const Future<Option<int>>& status = std::get<0>(future.get());
-
-    if (!status.isReady()) {
+    if (future->isError()) {
       entry->promise.fail(
-          "Failed to perform 'du': " +
-          (status.isFailed() ? status.failure() : "discarded"));
-    } else if (status->isNone()) {
-      entry->promise.fail("Failed to reap the status of 'du'");
-    } else if (status->get() != 0) {
-      const Future<string>& error = std::get<2>(future.get());
-      if (!error.isReady()) {
-        entry->promise.fail(
-            "Failed to perform 'du'. Reading stderr failed: " +
-            (error.isFailed() ? error.failure() : "discarded"));
-      } else {
-        entry->promise.fail("Failed to perform 'du': " + error.get());
-      }
+          "Failed to check the disk usage of '" + entry->path + "': " +
+          future->error());
     } else {
-      const Future<string>& output = std::get<1>(future.get());
-      if (!output.isReady()) {
-        entry->promise.fail(
-            "Failed to read stdout from 'du': " +
-            (output.isFailed() ? output.failure() : "discarded"));
-      } else {
-        // Parsing the output from 'du'. The following is a sample
-        // output. Tab is used as the delimiter between the number of
-        // blocks and the checked path.
-        // $ du /var/lib/mesos/.../runs/container_id
-        // 1024   /var/lib/mesos/.../runs/container_id
-        vector<string> tokens = strings::tokenize(output.get(), " \t");
-        if (tokens.empty()) {
-          entry->promise.fail("Unexpected output from 'du': " + output.get());
-        } else {
-          Try<size_t> value = numify<size_t>(tokens[0]);
-          if (value.isError()) {
-            entry->promise.fail("Unexpected output from 'du': " + output.get());
-          } else {
-            // Notify the callers.
-            entry->promise.set(Kilobytes(value.get()));
-          }
-        }
+      entry->promise.set(future->get());
+    }
+
+    for (auto it = entries.begin(); it != entries.end(); ++it) {
+      if (*it == entry) {
+        entries.erase(it);
+        break;
       }
     }
 
-    entries.pop_front();
-    delay(interval, self(), &Self::schedule);
+    delay(interval, self(), &Self::release);
+  }
+
+  void release()
+  {
+    running--;
+    schedule();
   }
 
   const Duration interval;
 
   // A queue of pending checks.
   deque<Owned<Entry>> entries;
+
+  // Number of the walks running or throttled.
+  size_t running;
+
+  // The directory caches of the checked paths.
+  hashmap<string, Owned<DirectoryCache>> caches;
+
+  const std::shared_ptr<std::atomic_bool> cancelled;
 };
 
 
@@ -693,6 +652,12 @@ Future<Bytes> DiskUsageCollector::usage(
   return dispatch(process, &DiskUsageCollectorProcess::usage, path, excludes);
 }
 
+
+void DiskUsageCollector::forget(const string& path)
+{
+  dispatch(process, &DiskUsageCollectorProcess::forget, path);
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
@@ -38,7 +38,10 @@ class DiskUsageCollectorProcess;
 
 
 // Responsible for collecting disk usage for paths, while ensuring
-// that an interval elapses between each collection.
+// that an interval elapses between each collection. The usage is
+// collected natively by walking the paths, a bounded number of them
+// concurrently, and the listings of the directories which did not
+// change since the previous walk of a path are reused.
 class DiskUsageCollector
 {
 public:
@@ -51,6 +54,11 @@ public:
       const std::string& path,
       const std::vector<std::string>& excludes);
 
+  // Drops the directory listings cached for 'path' by previous checks.
+  // Must be called once the disk usage at 'path' is no longer checked,
+  // e.g., when the container using it is cleaned up.
+  void forget(const std::string& path);
+
 private:
   DiskUsageCollectorProcess* process;
 };
@@ -59,8 +67,8 @@ private:
 // This isolator monitors the disk usage for containers, and reports
 // ContainerLimitation when a container exceeds its disk quota. This
 // leverages the DiskUsageCollector to ensure that we don't induce too
-// much CPU usage and disk caching effects from running 'du' too
-// often.
+// much CPU usage and disk caching effects from walking the
+// sandboxes too often.
 //
 // NOTE: Currently all containers are processed in the same queue,
 // which means that when a container starts, it could take many disk
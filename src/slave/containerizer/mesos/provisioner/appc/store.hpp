@@ -50,6 +50,10 @@ public:
       const Image& image,
       const std::string& backend);
 
+  // TODO(gilbert): The store does not override `prune`, so its images
+  // are never garbage collected. It could track the images it fetches
+  // and their dependencies in a `LayerIndex`, as the docker store does.
+
 private:
   Store(process::Owned<StoreProcess> process);
 
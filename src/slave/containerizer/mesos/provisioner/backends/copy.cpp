@@ -14,20 +14,49 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifdef __linux__
+#include <fcntl.h>
+#include <unistd.h>
+
+#include <sys/ioctl.h>
+#include <sys/stat.h>
+#include <sys/syscall.h>
+#include <sys/xattr.h>
+#endif // __linux__
+
+#include <algorithm>
+#include <atomic>
+#include <deque>
 #include <list>
+#include <map>
+#include <memory>
+#include <mutex>
+#include <queue>
+#include <utility>
 
 #include <mesos/docker/spec.hpp>
 
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
+#include <process/executor.hpp>
 #include <process/id.hpp>
 #include <process/io.hpp>
 #include <process/process.hpp>
 #include <process/subprocess.hpp>
 
+#include <process/metrics/counter.hpp>
+#include <process/metrics/gauge.hpp>
+#include <process/metrics/metrics.hpp>
+#include <process/metrics/timer.hpp>
+
+#include <stout/bytes.hpp>
 #include <stout/foreach.hpp>
+#include <stout/lambda.hpp>
 #include <stout/os.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
+#include <stout/synchronized.hpp>
 
 #include <stout/os/constants.hpp>
 
@@ -35,21 +64,574 @@
 
 #include "slave/containerizer/mesos/provisioner/backends/copy.hpp"
 
+// `FICLONE` is only defined in <linux/fs.h> by recent kernel headers,
+// which we do not include as it conflicts with <sys/mount.h>.
+#if defined(__linux__) && !defined(FICLONE)
+#define FICLONE _IOW(0x94, 9, int)
+#endif
+
 using namespace process;
 
 using std::string;
 using std::list;
+using std::map;
+using std::pair;
+using std::shared_ptr;
 using std::vector;
 
 namespace mesos {
 namespace internal {
 namespace slave {
 
+#ifdef __linux__
+// Maximum number of blocking copy operations (e.g., walking a layer or
+// copying a batch of its regular files) that a copy backend runs in
+// parallel. These block libprocess worker threads, so we keep this
+// bounded to not starve the agent.
+constexpr size_t MAX_COPY_WORKERS = 4;
+
+
+// The entries of a layer that are copied after the layer has been
+// walked, i.e., after the whiteouts have been applied and the
+// directory tree has been created in the rootfs.
+struct LayerCopy
+{
+  // Regular files to copy from the layer to the rootfs. These are
+  // copied in parallel.
+  vector<pair<string, string>> files;
+
+  // Hard links within the layer, as pairs of the rootfs path of the
+  // first copied link and the rootfs path of another link. These are
+  // created once all regular files are copied.
+  vector<pair<string, string>> links;
+
+  // Directories whose metadata is copied from the layer to the rootfs
+  // once their content is copied, in the order of the walk.
+  vector<pair<string, string>> directories;
+};
+
+
+struct CopyStatistics
+{
+  size_t files = 0;
+  Bytes bytes;
+};
+
+
+// Copies the ownership, extended attributes and timestamps of
+// `source` to `target`, without following symbolic links. Ownership
+// is only preserved when permitted, similar to `cp -a`.
+static Try<Nothing> copyMetadata(
+    const string& source,
+    const string& target,
+    const struct stat& s)
+{
+  if (::lchown(target.c_str(), s.st_uid, s.st_gid) < 0 && errno != EPERM) {
+    return ErrnoError("Failed to change ownership of '" + target + "'");
+  }
+
+  // NOTE: Permissions have to be set after ownership, since
+  // `lchown` clears the set-user-ID and set-group-ID bits.
+  if (!S_ISLNK(s.st_mode) &&
+      ::chmod(target.c_str(), s.st_mode & 07777) < 0) {
+    return ErrnoError("Failed to change mode of '" + target + "'");
+  }
+
+  // Extended attributes are copied on a best effort basis, as the
+  // target filesystem may not support them.
+  ssize_t size = ::llistxattr(source.c_str(), nullptr, 0);
+  if (size > 0) {
+    vector<char> names(size);
+    size = ::llistxattr(source.c_str(), names.data(), names.size());
+
+    for (ssize_t i = 0; i < size; i += ::strlen(&names[i]) + 1) {
+      const char* name = &names[i];
+
+      ssize_t length = ::lgetxattr(source.c_str(), name, nullptr, 0);
+      if (length < 0) {
+        continue;
+      }
+
+      vector<char> value(length);
+      length = ::lgetxattr(source.c_str(), name, value.data(), value.size());
+      if (length < 0) {
+        continue;
+      }
+
+      ::lsetxattr(target.c_str(), name, value.data(), length, 0);
+    }
+  }
+
+  const struct timespec times[2] = {s.st_atim, s.st_mtim};
+
+  if (::utimensat(AT_FDCWD, target.c_str(), times, AT_SYMLINK_NOFOLLOW) < 0) {
+    return ErrnoError("Failed to change timestamps of '" + target + "'");
+  }
+
+  return Nothing();
+}
+
+
+// Copies the content of a regular file. We first try to share the
+// data extents with the source (a reflink) which is supported by
+// filesystems such as btrfs and XFS. Otherwise, the data is copied
+// in the kernel via `copy_file_range`, falling back to plain reads
+// and writes if that is not supported either.
+static Try<Nothing> copyContent(int source, int target, off_t length)
+{
+  if (::ioctl(target, FICLONE, source) == 0) {
+    return Nothing();
+  }
+
+  off_t copied = 0;
+
+#ifdef __NR_copy_file_range
+  while (copied < length) {
+    ssize_t n = ::syscall(
+        __NR_copy_file_range,
+        source,
+        nullptr,
+        target,
+        nullptr,
+        length - copied,
+        0);
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      // Fall back to reads and writes if the kernel or the filesystems
+      // do not support this, e.g., when copying across filesystems on
+      // kernels prior to 5.3.
+      if (copied == 0 &&
+          (errno == ENOSYS ||
+           errno == EXDEV ||
+           errno == EINVAL ||
+           errno == EOPNOTSUPP)) {
+        break;
+      }
+
+      return ErrnoError("Failed to copy file content");
+    } else if (n == 0) {
+      // Some combinations of kernels and filesystems (e.g., procfs or
+      // sysfs like files, or some FUSE and network filesystems) report
+      // end of file without copying anything. Fall back to reads and
+      // writes in that case.
+      if (copied == 0) {
+        break;
+      }
+
+      // Otherwise, only accept a short copy if the source was
+      // truncated while copying.
+      struct stat s;
+      if (::fstat(source, &s) < 0) {
+        return ErrnoError("Failed to stat source file");
+      }
+
+      if (s.st_size > copied) {
+        return Error(
+            "Copied only " + stringify(copied) + " of " +
+            stringify(s.st_size) + " bytes");
+      }
+
+      return Nothing();
+    }
+
+    copied += n;
+  }
+
+  if (copied > 0) {
+    return Nothing();
+  }
+#endif // __NR_copy_file_range
+
+  vector<char> buffer(128 * 1024);
+
+  while (true) {
+    ssize_t n = ::read(source, buffer.data(), buffer.size());
+
+    if (n < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      return ErrnoError("Failed to read file content");
+    } else if (n == 0) {
+      break;
+    }
+
+    ssize_t written = 0;
+    while (written < n) {
+      ssize_t m = ::write(target, buffer.data() + written, n - written);
+
+      if (m < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return ErrnoError("Failed to write file content");
+      }
+
+      written += m;
+    }
+  }
+
+  return Nothing();
+}
+
+
+// Copies the given regular files, including their metadata.
+static Try<CopyStatistics> copyFiles(
+    const vector<pair<string, string>>& files)
+{
+  CopyStatistics statistics;
+
+  foreach (const auto& file, files) {
+    const string& source = file.first;
+    const string& target = file.second;
+
+    int sourceFd = ::open(source.c_str(), O_RDONLY | O_CLOEXEC);
+    if (sourceFd < 0) {
+      return ErrnoError("Failed to open '" + source + "'");
+    }
+
+    struct stat s;
+    if (::fstat(sourceFd, &s) < 0) {
+      ErrnoError error("Failed to stat '" + source + "'");
+      ::close(sourceFd);
+      return error;
+    }
+
+    // We remove an existing file rather than writing into it, in case
+    // it is a hard link to another file in the rootfs.
+    if (::unlink(target.c_str()) < 0 && errno != ENOENT) {
+      ErrnoError error("Failed to remove '" + target + "'");
+      ::close(sourceFd);
+      return error;
+    }
+
+    int targetFd = ::open(
+        target.c_str(),
+        O_WRONLY | O_CREAT | O_EXCL | O_CLOEXEC,
+        S_IRUSR | S_IWUSR);
+
+    if (targetFd < 0) {
+      ErrnoError error("Failed to create '" + target + "'");
+      ::close(sourceFd);
+      return error;
+    }
+
+    Try<Nothing> content = copyContent(sourceFd, targetFd, s.st_size);
+
+    ::close(sourceFd);
+
+    if (::close(targetFd) < 0 && content.isSome()) {
+      content = ErrnoError();
+    }
+
+    if (content.isError()) {
+      return Error(
+          "Failed to copy '" + source + "' to '" + target + "': " +
+          content.error());
+    }
+
+    Try<Nothing> metadata = copyMetadata(source, target, s);
+    if (metadata.isError()) {
+      return Error(metadata.error());
+    }
+
+    statistics.files++;
+    statistics.bytes += Bytes(s.st_size);
+  }
+
+  return statistics;
+}
+
+
+// Removes a file or a directory in the rootfs. Symlinks are removed
+// rather than followed.
+static Try<Nothing> removeEntry(const string& path)
+{
+  if (os::stat::isdir(path, os::stat::FollowSymlink::DO_NOT_FOLLOW_SYMLINK)) {
+    Try<Nothing> rmdir = os::rmdir(path);
+    if (rmdir.isError()) {
+      return Error(
+          "Failed to remove directory '" + path + "': " + rmdir.error());
+    }
+  } else {
+    Try<Nothing> rm = os::rm(path);
+    if (rm.isError()) {
+      return Error("Failed to remove file '" + path + "': " + rm.error());
+    }
+  }
+
+  return Nothing();
+}
+
+
+// Walks the layer and applies it to the rootfs, except for the content
+// of regular files and hard links which are returned to be copied in
+// parallel. Whiteouts are applied during the walk.
+//
+// NOTE: We assume all image types use AUFS whiteout format.
+static Try<LayerCopy> walkLayer(const string& layer, const string& rootfs)
+{
+  char* source[] = {const_cast<char*>(layer.c_str()), nullptr};
+
+  FTS* tree = ::fts_open(source, FTS_NOCHDIR | FTS_PHYSICAL, nullptr);
+  if (tree == nullptr) {
+    return ErrnoError("Failed to open '" + layer + "'");
+  }
+
+  LayerCopy copy;
+
+  // The rootfs paths of the first link to each file with multiple
+  // hard links in the layer, keyed by device and inode.
+  map<pair<dev_t, ino_t>, string> inodes;
+
+  // Returns the error after closing the tree.
+  auto failure = [tree](const Error& error) -> Try<LayerCopy> {
+    ::fts_close(tree);
+    return error;
+  };
+
+  errno = 0;
+
+  for (FTSENT *node = ::fts_read(tree);
+       node != nullptr; node = ::fts_read(tree)) {
+    string ftsPath = string(node->fts_path);
+
+    if (node->fts_info == FTS_DNR ||
+        node->fts_info == FTS_ERR ||
+        node->fts_info == FTS_NS) {
+      return failure(Error(
+          "Failed to read '" + ftsPath + "': " +
+          os::strerror(node->fts_errno)));
+    }
+
+    // Skip the postorder visit of a directory.
+    // See the manpage of fts_read in the following link:
+    //   http://man7.org/linux/man-pages/man3/fts_read.3.html
+    if (node->fts_info == FTS_DP) {
+      continue;
+    }
+
+    if (ftsPath == layer) {
+      continue;
+    }
+
+    const struct stat& s = *node->fts_statp;
+
+    string layerPath = ftsPath.substr(layer.length() + 1);
+    string rootfsPath = path::join(rootfs, layerPath);
+    bool ftsIsDir = node->fts_info == FTS_D || node->fts_info == FTS_DC;
+
+    // Handle whiteout files. These are not copied to the rootfs.
+    if (node->fts_info == FTS_F &&
+        strings::startsWith(node->fts_name, docker::spec::WHITEOUT_PREFIX)) {
+      // Opaque whiteouts are handled when visiting their directory.
+      if (node->fts_name == string(docker::spec::WHITEOUT_OPAQUE_PREFIX)) {
+        continue;
+      }
+
+      Path whiteout = Path(layerPath);
+
+      string removePath = path::join(
+          rootfs,
+          whiteout.dirname(),
+          whiteout.basename().substr(strlen(docker::spec::WHITEOUT_PREFIX)));
+
+      // The file/directory referred to by the whiteout may have already
+      // been removed because its parent directory is labeled as opaque
+      // whiteout or overwritten by a file, so here we need to check if
+      // it exists before trying to remove it.
+      if (os::exists(removePath)) {
+        Try<Nothing> removed = removeEntry(removePath);
+        if (removed.isError()) {
+          return failure(Error(removed.error()));
+        }
+      }
+
+      continue;
+    }
+
+    if (os::exists(rootfsPath)) {
+      // Unlike `cp`, we replace any existing non-directory, which also
+      // handles overwriting a symlink. The symlink must be removed, or
+      // we would follow the link and overwrite the target instead of
+      // the link itself, which would cause a security issue in the
+      // following case:
+      //   ROOTFS: /bad@ -> /usr/bin/python
+      //   LAYER:  /bad is a malicious executable
+      //
+      // An existing directory is removed if it is overwritten by a
+      // non-directory or labeled as opaque whiteout in this layer. It
+      // is OK to remove the entire directory labeled as opaque
+      // whiteout, since the same directory exists in this layer and
+      // will be copied back to rootfs. If a symlink is overwritten by
+      // a directory, the symlink must be removed before the directory
+      // is traversed so the following case won't cause a security
+      // issue:
+      //   ROOTFS: /bad@ -> /usr
+      //   LAYER:  /bad/bin/.wh.wh.opq
+      bool rootfsIsDir = os::stat::isdir(
+          rootfsPath, os::stat::FollowSymlink::DO_NOT_FOLLOW_SYMLINK);
+
+      bool opaque = ftsIsDir && os::exists(
+          path::join(ftsPath, docker::spec::WHITEOUT_OPAQUE_PREFIX));
+
+      if (!rootfsIsDir || !ftsIsDir || opaque) {
+        Try<Nothing> removed = removeEntry(rootfsPath);
+        if (removed.isError()) {
+          return failure(Error(removed.error()));
+        }
+      }
+    }
+
+    switch (node->fts_info) {
+      case FTS_D:
+      case FTS_DC: {
+        if (!os::exists(rootfsPath)) {
+          // The directory is created writable so that we can copy its
+          // content, its permissions are set after.
+          if (::mkdir(rootfsPath.c_str(), S_IRWXU) < 0) {
+            return failure(
+                ErrnoError("Failed to create directory '" + rootfsPath + "'"));
+          }
+        }
+
+        copy.directories.emplace_back(ftsPath, rootfsPath);
+        break;
+      }
+      case FTS_F: {
+        if (s.st_nlink > 1) {
+          const pair<dev_t, ino_t> inode(s.st_dev, s.st_ino);
+
+          if (inodes.count(inode) > 0) {
+            copy.links.emplace_back(inodes.at(inode), rootfsPath);
+            break;
+          }
+
+          inodes.emplace(inode, rootfsPath);
+        }
+
+        copy.files.emplace_back(ftsPath, rootfsPath);
+        break;
+      }
+      case FTS_SL:
+      case FTS_SLNONE: {
+        vector<char> link(s.st_size + 1);
+        ssize_t length = ::readlink(ftsPath.c_str(), link.data(), s.st_size);
+        if (length < 0) {
+          return failure(
+              ErrnoError("Failed to read symlink '" + ftsPath + "'"));
+        }
+
+        link[length] = '\0';
+
+        if (::symlink(link.data(), rootfsPath.c_str()) < 0) {
+          return failure(
+              ErrnoError("Failed to create symlink '" + rootfsPath + "'"));
+        }
+
+        Try<Nothing> metadata = copyMetadata(ftsPath, rootfsPath, s);
+        if (metadata.isError()) {
+          return failure(Error(metadata.error()));
+        }
+        break;
+      }
+      default: {
+        // Special files such as devices, FIFOs and sockets.
+        if (::mknod(rootfsPath.c_str(), s.st_mode, s.st_rdev) < 0) {
+          return failure(
+              ErrnoError("Failed to create '" + rootfsPath + "'"));
+        }
+
+        Try<Nothing> metadata = copyMetadata(ftsPath, rootfsPath, s);
+        if (metadata.isError()) {
+          return failure(Error(metadata.error()));
+        }
+        break;
+      }
+    }
+  }
+
+  if (errno != 0) {
+    return failure(ErrnoError());
+  }
+
+  if (::fts_close(tree) != 0) {
+    return ErrnoError("Failed to stop traversing file system");
+  }
+
+  return copy;
+}
+
+
+// Creates the hard links and copies the directory metadata of the
+// layer, once all regular files of the layer are copied.
+static Try<Nothing> finishLayer(const LayerCopy& copy)
+{
+  foreach (const auto& link, copy.links) {
+    if (::unlink(link.second.c_str()) < 0 && errno != ENOENT) {
+      return ErrnoError("Failed to remove '" + link.second + "'");
+    }
+
+    if (::link(link.first.c_str(), link.second.c_str()) < 0) {
+      return ErrnoError("Failed to create hard link '" + link.second + "'");
+    }
+  }
+
+  // Copy the metadata of the deepest directories first, so that the
+  // timestamps are not changed by copying the metadata of their
+  // subdirectories.
+  for (auto it = copy.directories.rbegin();
+       it != copy.directories.rend();
+       ++it) {
+    struct stat s;
+    if (::lstat(it->first.c_str(), &s) < 0) {
+      return ErrnoError("Failed to stat '" + it->first + "'");
+    }
+
+    Try<Nothing> metadata = copyMetadata(it->first, it->second, s);
+    if (metadata.isError()) {
+      return Error(metadata.error());
+    }
+  }
+
+  return Nothing();
+}
+#endif // __linux__
+
+
+// The metrics of the copy backends. Since the metric names are not
+// specific to a backend, the metrics are shared by all copy backends
+// of the process (e.g., the ones of several agents in a test).
+struct CopyBackendMetrics
+{
+  // Returns the metrics of the existing copy backends, or adds them if
+  // there is no other copy backend. The metrics are removed once the
+  // last copy backend releases them.
+  static shared_ptr<CopyBackendMetrics> instance();
+
+  CopyBackendMetrics();
+  ~CopyBackendMetrics();
+
+  process::metrics::Counter bytes_copied;
+  process::metrics::Counter files_copied;
+  process::metrics::Timer<Milliseconds> layer_copy;
+  process::metrics::Gauge bytes_per_second;
+
+  // Copy throughput of the most recently provisioned layer.
+  std::atomic<double> bytesPerSecond;
+};
+
+
 class CopyBackendProcess : public Process<CopyBackendProcess>
 {
 public:
-  CopyBackendProcess()
-    : ProcessBase(process::ID::generate("copy-provisioner-backend")) {}
+  CopyBackendProcess();
 
   Future<Nothing> provision(const vector<string>& layers, const string& rootfs);
 
@@ -57,9 +639,54 @@ public:
 
 private:
   Future<Nothing> _provision(string layer, const string& rootfs);
+
+#ifdef __linux__
+  Future<Nothing> __provision(
+      const string& layer,
+      const LayerCopy& copy,
+      const Stopwatch& stopwatch);
+
+  // Runs the blocking copy operation on one of the `workers` once one
+  // is idle.
+  template <typename T>
+  Future<T> execute(const lambda::function<T()>& f);
+
+  // Hands the pending copy operations to the idle workers.
+  void schedule();
+
+  // Called when a worker has completed a copy operation.
+  void release(size_t worker);
+
+  // For running the blocking copy operations in separate actors, so
+  // that they do not block this process while a bounded number of them
+  // runs concurrently. The layers of a rootfs are copied one after the
+  // other, but the rootfses provisioned at the same time share the
+  // workers.
+  vector<Owned<Executor>> workers;
+  std::queue<size_t> idle;
+
+  // Copy operations waiting for an idle worker, in the order in which
+  // they were requested.
+  std::deque<lambda::function<void(size_t)>> pending;
+#endif // __linux__
+
+  shared_ptr<CopyBackendMetrics> metrics;
 };
 
 
+CopyBackendProcess::CopyBackendProcess()
+  : ProcessBase(process::ID::generate("copy-provisioner-backend")),
+    metrics(CopyBackendMetrics::instance())
+{
+#ifdef __linux__
+  for (size_t i = 0; i < MAX_COPY_WORKERS; i++) {
+    workers.push_back(Owned<Executor>(new Executor()));
+    idle.push(i);
+  }
+#endif // __linux__
+}
+
+
 Try<Owned<Backend>> CopyBackend::create(const Flags&)
 {
   return Owned<Backend>(new CopyBackend(
@@ -133,7 +760,26 @@ Future<Nothing> CopyBackendProcess::_provision(
     string layer,
     const string& rootfs)
 {
-#ifndef __WINDOWS__
+#ifdef __linux__
+  VLOG(1) << "Copying layer path '" << layer << "' to rootfs '" << rootfs
+          << "'";
+
+  Stopwatch stopwatch;
+  stopwatch.start();
+
+  // The layer is walked first, which applies the whiteouts and creates
+  // the directory tree in the rootfs. The regular files are then copied
+  // in parallel.
+  return execute<Try<LayerCopy>>(lambda::bind(&walkLayer, layer, rootfs))
+    .then(defer(self(), [=](const Try<LayerCopy>& copy) -> Future<Nothing> {
+      if (copy.isError()) {
+        return Failure(
+            "Failed to copy layer '" + layer + "': " + copy.error());
+      }
+
+      return __provision(layer, copy.get(), stopwatch);
+    }));
+#elif !defined(__WINDOWS__)
   // Traverse the layer to check if there is any whiteout files, if
   // yes, remove the corresponding files/directories from the rootfs.
   // Note: We assume all image types use AUFS whiteout format.
@@ -308,6 +954,107 @@ Future<Nothing> CopyBackendProcess::_provision(
 }
 
 
+#ifdef __linux__
+Future<Nothing> CopyBackendProcess::__provision(
+    const string& layer,
+    const LayerCopy& copy,
+    const Stopwatch& stopwatch)
+{
+  const size_t workers = std::min(MAX_COPY_WORKERS, copy.files.size());
+
+  vector<vector<pair<string, string>>> batches(workers);
+  for (size_t i = 0; i < copy.files.size(); i++) {
+    batches[i % workers].push_back(copy.files[i]);
+  }
+
+  list<Future<Try<CopyStatistics>>> futures;
+  foreach (const auto& batch, batches) {
+    futures.push_back(
+        execute<Try<CopyStatistics>>(lambda::bind(&copyFiles, batch)));
+  }
+
+  return collect(futures)
+    .then(defer(self(), [=](const list<Try<CopyStatistics>>& results)
+        -> Future<Nothing> {
+      CopyStatistics statistics;
+
+      foreach (const Try<CopyStatistics>& result, results) {
+        if (result.isError()) {
+          return Failure(
+              "Failed to copy layer '" + layer + "': " + result.error());
+        }
+
+        statistics.files += result->files;
+        statistics.bytes += result->bytes;
+      }
+
+      return execute<Try<Nothing>>(lambda::bind(&finishLayer, copy))
+        .then(defer(self(), [=](const Try<Nothing>& finish)
+            -> Future<Nothing> {
+          if (finish.isError()) {
+            return Failure(
+                "Failed to copy layer '" + layer + "': " + finish.error());
+          }
+
+          const Duration elapsed = stopwatch.elapsed();
+
+          metrics->files_copied += statistics.files;
+          metrics->bytes_copied += statistics.bytes.bytes();
+          metrics->layer_copy.record(elapsed);
+
+          if (elapsed > Duration::zero()) {
+            metrics->bytesPerSecond =
+              statistics.bytes.bytes() / elapsed.secs();
+          }
+
+          VLOG(1) << "Copied " << statistics.files << " files ("
+                  << statistics.bytes << ") of layer '" << layer << "' in "
+                  << elapsed;
+
+          return Nothing();
+        }));
+    }));
+}
+
+
+template <typename T>
+Future<T> CopyBackendProcess::execute(const lambda::function<T()>& f)
+{
+  shared_ptr<Promise<T>> promise(new Promise<T>());
+
+  pending.push_back([=](size_t worker) {
+    promise->associate(workers[worker]->execute(f)
+      .onAny(defer(self(), &Self::release, worker)));
+  });
+
+  schedule();
+
+  return promise->future();
+}
+
+
+void CopyBackendProcess::schedule()
+{
+  while (!pending.empty() && !idle.empty()) {
+    const size_t worker = idle.front();
+    idle.pop();
+
+    const lambda::function<void(size_t)> operation = pending.front();
+    pending.pop_front();
+
+    operation(worker);
+  }
+}
+
+
+void CopyBackendProcess::release(size_t worker)
+{
+  idle.push(worker);
+  schedule();
+}
+#endif // __linux__
+
+
 Future<bool> CopyBackendProcess::destroy(const string& rootfs)
 {
   vector<string> argv{"rm", "-rf", rootfs};
@@ -336,6 +1083,67 @@ Future<bool> CopyBackendProcess::destroy(const string& rootfs)
     });
 }
 
+
+// Guards the shared copy backend metrics.
+static std::mutex* metricsMutex = new std::mutex();
+static std::weak_ptr<CopyBackendMetrics>* sharedMetrics =
+  new std::weak_ptr<CopyBackendMetrics>();
+
+
+shared_ptr<CopyBackendMetrics> CopyBackendMetrics::instance()
+{
+  shared_ptr<CopyBackendMetrics> metrics;
+
+  synchronized (metricsMutex) {
+    metrics = sharedMetrics->lock();
+
+    if (!metrics) {
+      // NOTE: The metrics are deleted while holding the mutex, so that
+      // they are removed before the metrics of a new copy backend with
+      // the same names are added.
+      metrics.reset(
+          new CopyBackendMetrics(),
+          [](CopyBackendMetrics* metrics) {
+            synchronized (metricsMutex) {
+              delete metrics;
+            }
+          });
+
+      *sharedMetrics = metrics;
+    }
+  }
+
+  return metrics;
+}
+
+
+CopyBackendMetrics::CopyBackendMetrics()
+  : bytes_copied("containerizer/mesos/provisioner/copy/bytes_copied"),
+    files_copied("containerizer/mesos/provisioner/copy/files_copied"),
+    layer_copy("containerizer/mesos/provisioner/copy/layer_copy", Hours(1)),
+    bytes_per_second(
+        "containerizer/mesos/provisioner/copy/bytes_per_second",
+        [this]() { return bytesPerSecond.load(); }),
+    bytesPerSecond(0.0)
+{
+  process::metrics::add(bytes_copied);
+  process::metrics::add(files_copied);
+  process::metrics::add(layer_copy);
+  process::metrics::add(bytes_per_second);
+}
+
+
+CopyBackendMetrics::~CopyBackendMetrics()
+{
+  process::metrics::remove(bytes_copied);
+  process::metrics::remove(files_copied);
+  process::metrics::remove(layer_copy);
+
+  // Wait for the metric to be removed to protect against asynchronous
+  // evaluation referencing a deleted object.
+  process::metrics::remove(bytes_per_second).await();
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
@@ -0,0 +1,1444 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <errno.h>
+#include <fcntl.h>
+#include <string.h>
+#include <unistd.h>
+#include <zlib.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+
+#ifdef __linux__
+#include <sys/sysmacros.h>
+#include <sys/xattr.h>
+#endif // __linux__
+
+#ifdef USE_SSL_SOCKET
+#include <openssl/evp.h>
+#endif // USE_SSL_SOCKET
+
+#include <algorithm>
+#include <deque>
+#include <map>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <process/async.hpp>
+#include <process/defer.hpp>
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/error.hpp>
+#include <stout/foreach.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/lambda.hpp>
+#include <stout/numify.hpp>
+#include <stout/os.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+#include <stout/try.hpp>
+
+#include "common/command_utils.hpp"
+
+#include "slave/containerizer/mesos/provisioner/docker/extractor.hpp"
+
+using namespace process;
+
+using std::deque;
+using std::map;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace docker {
+
+// Maximum number of layers extracted in parallel on the agent. The
+// extraction blocks libprocess worker threads, so we keep this bounded
+// to not starve the agent.
+constexpr size_t MAX_LAYER_EXTRACTORS = 4;
+
+// Size of the chunks in which a layer tarball is read and inflated.
+constexpr size_t EXTRACT_BUFFER_SIZE = 256 * 1024;
+
+// Maximum size of the GNU long name and pax extended header entries,
+// which are buffered in memory.
+constexpr size_t MAX_TAR_HEADER_SIZE = 1024 * 1024;
+
+constexpr size_t TAR_BLOCK_SIZE = 512;
+
+
+// Returns the value of a numeric tar header field, which is either
+// octal or, for values that do not fit, base-256 encoded (a GNU
+// extension also used by docker).
+static uint64_t parseNumber(const char* field, size_t size)
+{
+  uint64_t value = 0;
+
+  if (static_cast<unsigned char>(field[0]) & 0x80) {
+    // Negative values (e.g., timestamps before the epoch) are treated
+    // as zero.
+    if (static_cast<unsigned char>(field[0]) & 0x40) {
+      return 0;
+    }
+
+    value = static_cast<unsigned char>(field[0]) & 0x3f;
+    for (size_t i = 1; i < size; i++) {
+      value = (value << 8) | static_cast<unsigned char>(field[i]);
+    }
+
+    return value;
+  }
+
+  size_t i = 0;
+  while (i < size && field[i] == ' ') {
+    i++;
+  }
+
+  for (; i < size && field[i] >= '0' && field[i] <= '7'; i++) {
+    value = (value << 3) | (field[i] - '0');
+  }
+
+  return value;
+}
+
+
+static string parseString(const char* field, size_t size)
+{
+  return string(field, ::strnlen(field, size));
+}
+
+
+// Parses the records of a pax extended header, which are of the form
+// '<length> <key>=<value>\n'.
+static Try<map<string, string>> parsePax(const string& data)
+{
+  map<string, string> records;
+
+  size_t offset = 0;
+  while (offset < data.size()) {
+    size_t space = data.find(' ', offset);
+    if (space == string::npos) {
+      return Error("Missing record length");
+    }
+
+    Try<size_t> length = numify<size_t>(data.substr(offset, space - offset));
+    if (length.isError() ||
+        length.get() <= space - offset + 1 ||
+        offset + length.get() > data.size() ||
+        data[offset + length.get() - 1] != '\n') {
+      return Error("Invalid record length");
+    }
+
+    const string record =
+      data.substr(space + 1, offset + length.get() - space - 2);
+
+    size_t equals = record.find('=');
+    if (equals == string::npos) {
+      return Error("Invalid record '" + record + "'");
+    }
+
+    records[record.substr(0, equals)] = record.substr(equals + 1);
+    offset += length.get();
+  }
+
+  return records;
+}
+
+
+// Parses a pax timestamp of the form '<seconds>[.<fraction>]'.
+static Try<struct timespec> parseTime(const string& value)
+{
+  vector<string> parts = strings::split(value, ".", 2);
+
+  Try<time_t> seconds = numify<time_t>(parts[0]);
+  if (seconds.isError()) {
+    return Error("Invalid timestamp '" + value + "'");
+  }
+
+  struct timespec time;
+  time.tv_sec = seconds.get();
+  time.tv_nsec = 0;
+
+  if (parts.size() == 2) {
+    const string fraction = (parts[1] + "000000000").substr(0, 9);
+
+    Try<long> nanoseconds = numify<long>(fraction);
+    if (nanoseconds.isError()) {
+      return Error("Invalid timestamp '" + value + "'");
+    }
+
+    time.tv_nsec = nanoseconds.get();
+  }
+
+  return time;
+}
+
+
+// Returns the path of a tar entry relative to the rootfs. Like `tar`,
+// leading slashes are stripped, and entries that would be extracted
+// outside of the rootfs are rejected.
+static Try<string> normalize(const string& name)
+{
+  vector<string> components;
+
+  foreach (const string& component, strings::tokenize(name, "/")) {
+    if (component == ".") {
+      continue;
+    } else if (component == "..") {
+      return Error("Entry '" + name + "' contains '..'");
+    }
+
+    components.push_back(component);
+  }
+
+  return strings::join("/", components);
+}
+
+
+// Verifies the digest of a tarball (e.g., 'sha256:<hex>') while it
+// is being read.
+class DigestVerifier
+{
+public:
+  static Try<Owned<DigestVerifier>> create(const string& digest)
+  {
+#ifdef USE_SSL_SOCKET
+    vector<string> parts = strings::split(digest, ":", 2);
+    if (parts.size() != 2) {
+      return Error("Invalid digest '" + digest + "'");
+    }
+
+    const EVP_MD* type = nullptr;
+    if (parts[0] == "sha256") {
+      type = EVP_sha256();
+    } else if (parts[0] == "sha384") {
+      type = EVP_sha384();
+    } else if (parts[0] == "sha512") {
+      type = EVP_sha512();
+    } else {
+      return Error("Unsupported digest algorithm '" + parts[0] + "'");
+    }
+
+    EVP_MD_CTX* context = EVP_MD_CTX_create();
+    if (context == nullptr || EVP_DigestInit_ex(context, type, nullptr) != 1) {
+      EVP_MD_CTX_destroy(context);
+      return Error("Failed to initialize the digest");
+    }
+
+    return Owned<DigestVerifier>(
+        new DigestVerifier(digest, strings::lower(parts[1]), context));
+#else
+    return Error("Digest verification requires building with OpenSSL");
+#endif // USE_SSL_SOCKET
+  }
+
+  ~DigestVerifier()
+  {
+#ifdef USE_SSL_SOCKET
+    EVP_MD_CTX_destroy(context);
+#endif // USE_SSL_SOCKET
+  }
+
+  void update(const char* data, size_t size)
+  {
+#ifdef USE_SSL_SOCKET
+    EVP_DigestUpdate(context, data, size);
+#endif // USE_SSL_SOCKET
+  }
+
+  Try<Nothing> verify()
+  {
+#ifdef USE_SSL_SOCKET
+    unsigned char value[EVP_MAX_MD_SIZE];
+    unsigned int size = 0;
+
+    if (EVP_DigestFinal_ex(context, value, &size) != 1) {
+      return Error("Failed to compute the digest");
+    }
+
+    string hex;
+    for (unsigned int i = 0; i < size; i++) {
+      hex += strings::format("%02x", value[i]).get();
+    }
+
+    if (hex != expected) {
+      return Error(
+          "Digest mismatch: expected '" + digest + "' but got '" + hex + "'");
+    }
+#endif // USE_SSL_SOCKET
+
+    return Nothing();
+  }
+
+private:
+#ifdef USE_SSL_SOCKET
+  DigestVerifier(
+      const string& _digest,
+      const string& _expected,
+      EVP_MD_CTX* _context)
+    : digest(_digest), expected(_expected), context(_context) {}
+
+  const string digest;
+  const string expected;
+  EVP_MD_CTX* context;
+#endif // USE_SSL_SOCKET
+};
+
+
+// Unpacks a (ustar, GNU or pax) tar stream into a rootfs as the
+// stream is fed to it, similar to running `tar -x` as the agent user.
+class TarExtractor
+{
+public:
+  // Returns whether the entry with the given path is extracted.
+  typedef lambda::function<bool(const string&)> Filter;
+
+  explicit TarExtractor(const string& _rootfs, const Filter& _filter = nullptr)
+    : rootfs(_rootfs), filter(_filter), privileged(::geteuid() == 0) {}
+
+  ~TarExtractor()
+  {
+    if (fd != -1) {
+      ::close(fd);
+    }
+  }
+
+  // Extracts the regular file entry with the given path, which is
+  // itself a tarball, into the given directory instead of the rootfs.
+  void nest(const string& path, const string& directory)
+  {
+    nested[path] = Owned<TarExtractor>(new TarExtractor(directory));
+  }
+
+  // Returns whether all the nested tarballs have been extracted.
+  bool nestedExtracted() const
+  {
+    return extractedNested.size() == nested.size();
+  }
+
+  // Returns the number of the upcoming bytes of the stream that are
+  // discarded, and can thus be skipped without being read.
+  uint64_t skippable() const
+  {
+    if (state == State::PADDING || (state == State::DATA && discard)) {
+      return remaining;
+    }
+
+    return 0;
+  }
+
+  // Skips the given number of upcoming bytes of the stream, which must
+  // be at most `skippable()`.
+  Try<Nothing> skip(uint64_t size)
+  {
+    CHECK_LE(size, skippable());
+
+    remaining -= size;
+    if (remaining > 0) {
+      return Nothing();
+    }
+
+    if (state == State::DATA) {
+      return finishEntry();
+    }
+
+    state = State::HEADER;
+    return Nothing();
+  }
+
+  Try<Nothing> feed(const char* data, size_t size)
+  {
+    while (size > 0 && state != State::END) {
+      size_t length = 0;
+
+      switch (state) {
+        case State::HEADER: {
+          length = std::min(size, TAR_BLOCK_SIZE - block.size());
+          block.append(data, length);
+
+          if (block.size() == TAR_BLOCK_SIZE) {
+            Try<Nothing> header = parseHeader();
+            block.clear();
+
+            if (header.isError()) {
+              return header;
+            }
+          }
+          break;
+        }
+        case State::DATA: {
+          length = std::min<uint64_t>(size, remaining);
+
+          Try<Nothing> write = writeData(data, length);
+          if (write.isError()) {
+            return write;
+          }
+
+          remaining -= length;
+          if (remaining == 0) {
+            Try<Nothing> finish = finishEntry();
+            if (finish.isError()) {
+              return finish;
+            }
+          }
+          break;
+        }
+        case State::PADDING: {
+          length = std::min<uint64_t>(size, remaining);
+
+          remaining -= length;
+          if (remaining == 0) {
+            state = State::HEADER;
+          }
+          break;
+        }
+        case State::END:
+          break;
+      }
+
+      data += length;
+      size -= length;
+    }
+
+    return Nothing();
+  }
+
+  // Checks that the stream is complete and sets the metadata of the
+  // extracted directories.
+  Try<Nothing> finish()
+  {
+    if (state == State::DATA || state == State::PADDING || !block.empty()) {
+      return Error("Unexpected end of archive");
+    }
+
+    // Directories are finished in reverse order, so that setting the
+    // metadata of a directory is not undone by the extraction of its
+    // content, and read-only directories can still be populated.
+    for (auto it = directories.rbegin(); it != directories.rend(); ++it) {
+      // A later entry may have replaced the directory, or one of its
+      // parents, with a symbolic link, which must not be followed.
+      const int fd = openBeneath(it->path, O_RDONLY | O_DIRECTORY);
+      if (fd < 0) {
+        if (errno == ELOOP || errno == ENOTDIR || errno == ENOENT) {
+          continue;
+        }
+
+        return ErrnoError("Failed to open directory '" + it->path + "'");
+      }
+
+      Try<Nothing> metadata = setMetadata(*it, fd);
+      ::close(fd);
+
+      if (metadata.isError()) {
+        return metadata;
+      }
+    }
+
+    directories.clear();
+
+    return Nothing();
+  }
+
+private:
+  enum class State
+  {
+    HEADER,
+    DATA,
+    PADDING,
+    END
+  };
+
+  struct Entry
+  {
+    char type = '0';
+    string path;
+    string link;
+    mode_t mode = 0;
+    uid_t uid = 0;
+    gid_t gid = 0;
+    struct timespec mtime = {0, 0};
+    uint64_t size = 0;
+    dev_t device = 0;
+    map<string, string> xattrs;
+  };
+
+  Try<Nothing> parseHeader()
+  {
+    if (std::all_of(block.begin(), block.end(), [](char c) {
+          return c == '\0';
+        })) {
+      // The archive ends with two zero blocks.
+      if (++zeroBlocks == 2) {
+        state = State::END;
+      }
+
+      return Nothing();
+    }
+
+    zeroBlocks = 0;
+
+    const char* header = block.data();
+
+    // The checksum is computed with the checksum field set to spaces,
+    // and some archivers use signed characters.
+    uint64_t unsignedSum = 0;
+    int64_t signedSum = 0;
+
+    for (size_t i = 0; i < TAR_BLOCK_SIZE; i++) {
+      const char c = (i >= 148 && i < 156) ? ' ' : header[i];
+      unsignedSum += static_cast<unsigned char>(c);
+      signedSum += static_cast<signed char>(c);
+    }
+
+    const uint64_t checksum = parseNumber(header + 148, 8);
+    if (checksum != unsignedSum &&
+        static_cast<int64_t>(checksum) != signedSum) {
+      return Error("Invalid tar header checksum");
+    }
+
+    entry = Entry();
+    entry.type = header[156];
+    entry.size = parseNumber(header + 124, 12);
+
+    switch (entry.type) {
+      case 'L': // GNU long name.
+      case 'K': // GNU long link name.
+      case 'x': // Pax extended header for the next entry.
+      case 'g': // Pax global extended header.
+        if (entry.size > MAX_TAR_HEADER_SIZE) {
+          return Error("Extended tar header is too large");
+        }
+
+        buffer.clear();
+        discard = false;
+        return startData();
+      case '1': // Hard link.
+      case 'D': // GNU dump directory.
+        // These may carry data that is not needed for the extraction.
+        break;
+      case '2': // Symbolic link.
+      case '3': // Character device.
+      case '4': // Block device.
+      case '5': // Directory.
+      case '6': // FIFO.
+        entry.size = 0;
+        break;
+    }
+
+    string name = parseString(header, 100);
+    if (::memcmp(header + 257, "ustar", 5) == 0 && header[345] != '\0') {
+      name = parseString(header + 345, 155) + "/" + name;
+    }
+
+    entry.link = parseString(header + 157, 100);
+    entry.mode = parseNumber(header + 100, 8);
+    entry.uid = parseNumber(header + 108, 8);
+    entry.gid = parseNumber(header + 116, 8);
+    entry.mtime.tv_sec = parseNumber(header + 136, 12);
+    entry.device = makedev(
+        parseNumber(header + 329, 8),
+        parseNumber(header + 337, 8));
+
+    if (longName.isSome()) {
+      name = longName.get();
+    }
+
+    if (longLink.isSome()) {
+      entry.link = longLink.get();
+    }
+
+    // The records of a pax extended header override the global ones. A
+    // record with an empty value discards the global record, so that
+    // the field of the tar header is used instead.
+    map<string, string> records = globalPax;
+    foreachpair (const string& key, const string& value, pax) {
+      records[key] = value;
+    }
+
+    foreachpair (const string& key, const string& value, records) {
+      if (value.empty()) {
+        continue;
+      }
+
+      if (key == "path") {
+        name = value;
+      } else if (key == "linkpath") {
+        entry.link = value;
+      } else if (key == "size" || key == "uid" || key == "gid") {
+        Try<uint64_t> number = numify<uint64_t>(value);
+        if (number.isError()) {
+          return Error("Invalid pax header '" + key + "=" + value + "'");
+        }
+
+        if (key == "size") {
+          entry.size = number.get();
+        } else if (key == "uid") {
+          entry.uid = number.get();
+        } else {
+          entry.gid = number.get();
+        }
+      } else if (key == "mtime") {
+        Try<struct timespec> mtime = parseTime(value);
+        if (mtime.isError()) {
+          return Error("Invalid pax header: " + mtime.error());
+        }
+
+        entry.mtime = mtime.get();
+      } else if (strings::startsWith(key, "SCHILY.xattr.")) {
+        entry.xattrs[key.substr(strlen("SCHILY.xattr."))] = value;
+      }
+    }
+
+    longName = None();
+    longLink = None();
+    pax.clear();
+
+    Try<string> path = normalize(name);
+    if (path.isError()) {
+      return Error(path.error());
+    }
+
+    entry.path = path.get();
+
+    if (nested.contains(entry.path) && isRegularFile(entry.type)) {
+      current = nested.at(entry.path).get();
+    } else if (!filter || filter(entry.path)) {
+      Try<Nothing> create = createEntry();
+      if (create.isError()) {
+        return Error(
+            "Failed to extract '" + entry.path + "': " + create.error());
+      }
+    }
+
+    discard = fd == -1 && current == nullptr;
+
+    return startData();
+  }
+
+  static bool isRegularFile(char type)
+  {
+    switch (type) {
+      case '1':
+      case '2':
+      case '3':
+      case '4':
+      case '5':
+      case '6':
+      case 'D':
+        return false;
+      default:
+        return true;
+    }
+  }
+
+  Try<Nothing> startData()
+  {
+    remaining = entry.size;
+
+    if (remaining == 0) {
+      return finishEntry();
+    }
+
+    state = State::DATA;
+    return Nothing();
+  }
+
+  Try<Nothing> writeData(const char* data, size_t size)
+  {
+    switch (entry.type) {
+      case 'L':
+      case 'K':
+      case 'x':
+      case 'g':
+        buffer.append(data, size);
+        return Nothing();
+    }
+
+    if (current != nullptr) {
+      Try<Nothing> feed = current->feed(data, size);
+      if (feed.isError()) {
+        return Error(
+            "Failed to extract '" + entry.path + "': " + feed.error());
+      }
+
+      return Nothing();
+    }
+
+    while (fd != -1 && size > 0) {
+      ssize_t length = ::write(fd, data, size);
+      if (length < 0) {
+        if (errno == EINTR) {
+          continue;
+        }
+
+        return ErrnoError("Failed to write '" + entry.path + "'");
+      }
+
+      data += length;
+      size -= length;
+    }
+
+    return Nothing();
+  }
+
+  Try<Nothing> finishEntry()
+  {
+    const uint64_t padding =
+      (TAR_BLOCK_SIZE - entry.size % TAR_BLOCK_SIZE) % TAR_BLOCK_SIZE;
+
+    remaining = padding;
+    state = padding > 0 ? State::PADDING : State::HEADER;
+
+    switch (entry.type) {
+      case 'L':
+        longName = string(buffer.c_str());
+        return Nothing();
+      case 'K':
+        longLink = string(buffer.c_str());
+        return Nothing();
+      case 'x': {
+        Try<map<string, string>> records = parsePax(buffer);
+        if (records.isError()) {
+          return Error("Invalid pax header: " + records.error());
+        }
+
+        pax = records.get();
+        return Nothing();
+      }
+      case 'g': {
+        Try<map<string, string>> records = parsePax(buffer);
+        if (records.isError()) {
+          return Error("Invalid pax global header: " + records.error());
+        }
+
+        // The global records apply to all the following entries, and
+        // a record with an empty value removes the global record.
+        //
+        // NOTE: Like `tar`, we ignore the records that identify a
+        // single entry, as applying them to all entries makes no sense.
+        foreachpair (const string& key, const string& value, records.get()) {
+          if (key == "path" || key == "linkpath" || key == "size") {
+            continue;
+          }
+
+          if (value.empty()) {
+            globalPax.erase(key);
+          } else {
+            globalPax[key] = value;
+          }
+        }
+
+        return Nothing();
+      }
+    }
+
+    if (current != nullptr) {
+      Try<Nothing> finish = current->finish();
+      current = nullptr;
+
+      if (finish.isError()) {
+        return Error(
+            "Failed to extract '" + entry.path + "': " + finish.error());
+      }
+
+      extractedNested.insert(entry.path);
+      return Nothing();
+    }
+
+    if (fd != -1) {
+      Try<Nothing> metadata = setMetadata(entry, fd);
+
+      const int close = ::close(fd);
+      fd = -1;
+
+      if (metadata.isError()) {
+        return metadata;
+      }
+
+      if (close < 0) {
+        return ErrnoError("Failed to close '" + entry.path + "'");
+      }
+    }
+
+    return Nothing();
+  }
+
+  // Opens the entry with the given path like `openat`, but resolves
+  // every component relative to the rootfs without following symbolic
+  // links, so that a layer cannot reach outside of the rootfs through
+  // the symbolic links it extracted. Returns -1 and sets `errno` on
+  // failure.
+  int openBeneath(const string& path, int flags) const
+  {
+    int fd = ::open(rootfs.c_str(), O_RDONLY | O_DIRECTORY | O_CLOEXEC);
+
+    const vector<string> components = strings::tokenize(path, "/");
+    for (size_t i = 0; fd >= 0 && i < components.size(); i++) {
+      const int next = ::openat(
+          fd,
+          components[i].c_str(),
+          (i + 1 < components.size() ? O_RDONLY | O_DIRECTORY : flags) |
+            O_NOFOLLOW | O_CLOEXEC);
+
+      const int error = errno;
+      ::close(fd);
+      errno = error;
+
+      fd = next;
+    }
+
+    return fd;
+  }
+
+  // Creates the parent directories of an entry, refusing to extract
+  // through symbolic links so that a layer cannot write outside of the
+  // rootfs, and removes an existing file the entry replaces.
+  Try<Nothing> prepare(const string& target, bool directory)
+  {
+    string parent = rootfs;
+
+    const vector<string> components = strings::tokenize(entry.path, "/");
+    for (size_t i = 0; i + 1 < components.size(); i++) {
+      parent = path::join(parent, components[i]);
+
+      struct stat s;
+      if (::lstat(parent.c_str(), &s) < 0) {
+        if (errno != ENOENT) {
+          return ErrnoError("Failed to stat '" + parent + "'");
+        }
+
+        if (::mkdir(parent.c_str(), 0755) < 0) {
+          return ErrnoError("Failed to create directory '" + parent + "'");
+        }
+      } else if (S_ISLNK(s.st_mode)) {
+        return Error("Parent '" + parent + "' is a symbolic link");
+      } else if (!S_ISDIR(s.st_mode)) {
+        return Error("Parent '" + parent + "' is not a directory");
+      }
+    }
+
+    struct stat s;
+    if (::lstat(target.c_str(), &s) < 0) {
+      if (errno != ENOENT) {
+        return ErrnoError("Failed to stat '" + target + "'");
+      }
+
+      return Nothing();
+    }
+
+    if (S_ISDIR(s.st_mode)) {
+      if (!directory) {
+        Try<Nothing> rmdir = os::rmdir(target);
+        if (rmdir.isError()) {
+          return Error(
+              "Failed to remove directory '" + target + "': " +
+              rmdir.error());
+        }
+      }
+    } else if (::unlink(target.c_str()) < 0) {
+      return ErrnoError("Failed to remove '" + target + "'");
+    }
+
+    return Nothing();
+  }
+
+  Try<Nothing> createEntry()
+  {
+    // NOTE: We keep the rootfs directory as created by the puller.
+    if (entry.path.empty()) {
+      return Nothing();
+    }
+
+    const string target = path::join(rootfs, entry.path);
+
+    Try<Nothing> prepare = this->prepare(target, entry.type == '5');
+    if (prepare.isError()) {
+      return prepare;
+    }
+
+    switch (entry.type) {
+      case '1': {
+        Try<string> link = normalize(entry.link);
+        if (link.isError()) {
+          return Error(link.error());
+        }
+
+        // The source is resolved without following symbolic links, as a
+        // link to e.g. 'x/shadow' would otherwise expose '/etc/shadow'
+        // if an earlier entry made 'x' a symbolic link to '/etc'.
+        const Path source(link.get());
+        const int parent =
+          openBeneath(source.dirname(), O_RDONLY | O_DIRECTORY);
+
+        if (parent < 0) {
+          return ErrnoError("Failed to resolve '" + source.string() + "'");
+        }
+
+        const int result = ::linkat(
+            parent,
+            source.basename().c_str(),
+            AT_FDCWD,
+            target.c_str(),
+            0);
+
+        const int error = errno;
+        ::close(parent);
+
+        if (result < 0) {
+          return ErrnoError(
+              error,
+              "Failed to link to '" + source.string() + "'");
+        }
+
+        return Nothing();
+      }
+      case '2':
+        if (::symlink(entry.link.c_str(), target.c_str()) < 0) {
+          return ErrnoError("Failed to create symbolic link");
+        }
+
+        return setMetadata(entry);
+      case '3':
+      case '4':
+      case '6': {
+        const mode_t type = entry.type == '3'
+          ? S_IFCHR
+          : (entry.type == '4' ? S_IFBLK : S_IFIFO);
+
+        if (::mknod(target.c_str(), type | 0600, entry.device) < 0) {
+          return ErrnoError("Failed to create special file");
+        }
+
+        return setMetadata(entry);
+      }
+      case '5':
+      case 'D':
+        if (::mkdir(target.c_str(), 0700) < 0 && errno != EEXIST) {
+          return ErrnoError("Failed to create directory");
+        }
+
+        directories.push_back(entry);
+        return Nothing();
+      default:
+        // Like `tar`, we extract unknown entry types as regular files.
+        fd = ::open(
+            target.c_str(),
+            O_WRONLY | O_CREAT | O_EXCL | O_NOFOLLOW | O_CLOEXEC,
+            0600);
+
+        if (fd < 0) {
+          return ErrnoError("Failed to create file");
+        }
+
+        // The metadata is set once the file is written and closed.
+        return Nothing();
+    }
+  }
+
+  // Sets the ownership, permissions, extended attributes and
+  // modification time of an extracted regular file or directory
+  // through a file descriptor of it. Like `tar`, ownership and the
+  // set-user-ID, set-group-ID and sticky bits are only restored when
+  // privileged.
+  Try<Nothing> setMetadata(const Entry& entry, int fd)
+  {
+    if (privileged && ::fchown(fd, entry.uid, entry.gid) < 0) {
+      return ErrnoError("Failed to change ownership of '" + entry.path + "'");
+    }
+
+    // NOTE: Permissions have to be set after ownership, since
+    // `fchown` clears the set-user-ID and set-group-ID bits.
+    if (::fchmod(fd, entry.mode & (privileged ? 07777 : 0777)) < 0) {
+      return ErrnoError("Failed to change mode of '" + entry.path + "'");
+    }
+
+#ifdef __linux__
+    // Extended attributes are restored on a best effort basis, as the
+    // target filesystem may not support them.
+    foreachpair (const string& name, const string& value, entry.xattrs) {
+      if (::fsetxattr(fd, name.c_str(), value.data(), value.size(), 0) < 0) {
+        VLOG(1) << "Failed to set extended attribute '" << name
+                << "' of '" << entry.path << "': " << os::strerror(errno);
+      }
+    }
+#endif // __linux__
+
+    struct timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_NOW;
+    times[1] = entry.mtime;
+
+    if (::futimens(fd, times) < 0) {
+      return ErrnoError("Failed to set timestamps of '" + entry.path + "'");
+    }
+
+    return Nothing();
+  }
+
+  // Sets the metadata of a symbolic link or special file, which cannot
+  // be opened, by path. This is only done right after the entry is
+  // created, while its parents are still known not to be symbolic
+  // links, and never follows the entry itself if it is a symbolic link.
+  Try<Nothing> setMetadata(const Entry& entry)
+  {
+    const string target = path::join(rootfs, entry.path);
+    const bool symlink = entry.type == '2';
+
+    if (privileged &&
+        ::lchown(target.c_str(), entry.uid, entry.gid) < 0) {
+      return ErrnoError("Failed to change ownership of '" + target + "'");
+    }
+
+    // NOTE: Symbolic links have no permissions of their own, and the
+    // special file at the target was just created by `mknod`.
+    if (!symlink &&
+        ::chmod(target.c_str(), entry.mode & (privileged ? 07777 : 0777)) < 0) {
+      return ErrnoError("Failed to change mode of '" + target + "'");
+    }
+
+#ifdef __linux__
+    foreachpair (const string& name, const string& value, entry.xattrs) {
+      if (::lsetxattr(
+              target.c_str(),
+              name.c_str(),
+              value.data(),
+              value.size(),
+              0) < 0) {
+        VLOG(1) << "Failed to set extended attribute '" << name
+                << "' of '" << target << "': " << os::strerror(errno);
+      }
+    }
+#endif // __linux__
+
+    struct timespec times[2];
+    times[0].tv_sec = 0;
+    times[0].tv_nsec = UTIME_NOW;
+    times[1] = entry.mtime;
+
+    if (::utimensat(AT_FDCWD, target.c_str(), times, AT_SYMLINK_NOFOLLOW) < 0) {
+      return ErrnoError("Failed to set timestamps of '" + target + "'");
+    }
+
+    return Nothing();
+  }
+
+  const string rootfs;
+  const Filter filter;
+  const bool privileged;
+
+  State state = State::HEADER;
+  string block;
+  size_t zeroBlocks = 0;
+
+  // The entry being extracted, the number of its data (or padding)
+  // bytes that have not been read yet, and whether its data is
+  // discarded.
+  Entry entry;
+  uint64_t remaining = 0;
+  bool discard = false;
+
+  // The extractors of the nested tarballs, the one the data of the
+  // current entry is fed to (if any), and the extracted ones.
+  hashmap<string, Owned<TarExtractor>> nested;
+  TarExtractor* current = nullptr;
+  hashset<string> extractedNested;
+
+  // The file of the regular file entry being extracted.
+  int fd = -1;
+
+  // The content of the GNU long name and pax header entries, and the
+  // overrides they specify for the next entry.
+  string buffer;
+  Option<string> longName;
+  Option<string> longLink;
+  map<string, string> pax;
+
+  // The records of the pax global headers, which apply to all the
+  // following entries.
+  map<string, string> globalPax;
+
+  // The extracted directories, whose metadata is set once the
+  // extraction finishes.
+  vector<Entry> directories;
+};
+
+
+// Extracts the tarball in a single pass, reading it in chunks that are
+// hashed, inflated (if gzip compressed) and fed to the extractor as
+// they are read. The data the extractor discards is skipped without
+// being read if possible. Returns false if the tarball is compressed
+// with a format we do not extract natively, in which case only its
+// digest is verified.
+static Try<bool> extract(
+    const string& tar,
+    TarExtractor* extractor,
+    const Option<string>& digest)
+{
+  Owned<DigestVerifier> verifier;
+  if (digest.isSome()) {
+#ifdef USE_SSL_SOCKET
+    Try<Owned<DigestVerifier>> create = DigestVerifier::create(digest.get());
+    if (create.isError()) {
+      return Error("Failed to verify '" + tar + "': " + create.error());
+    }
+
+    verifier = create.get();
+#else
+    LOG(WARNING) << "Not verifying digest '" << digest.get() << "' of '"
+                 << tar << "' as the agent is built without SSL support";
+#endif // USE_SSL_SOCKET
+  }
+
+  Try<int_fd> fd = os::open(tar, O_RDONLY | O_CLOEXEC);
+  if (fd.isError()) {
+    return Error("Failed to open '" + tar + "': " + fd.error());
+  }
+
+  z_stream stream;
+  memset(&stream, 0, sizeof(stream));
+
+  Option<bool> compressed;
+  bool supported = true;
+  bool inflated = false;
+
+  vector<char> input(EXTRACT_BUFFER_SIZE);
+  vector<char> output(EXTRACT_BUFFER_SIZE);
+
+  Try<Nothing> result = Nothing();
+
+  while (result.isSome()) {
+    ssize_t length = ::read(fd.get(), input.data(), input.size());
+    if (length < 0) {
+      if (errno == EINTR) {
+        continue;
+      }
+
+      result = ErrnoError("Failed to read '" + tar + "'");
+      break;
+    } else if (length == 0) {
+      break;
+    }
+
+    if (verifier.get() != nullptr) {
+      verifier->update(input.data(), length);
+    }
+
+    const unsigned char* magic =
+      reinterpret_cast<const unsigned char*>(input.data());
+
+    if (compressed.isNone()) {
+      compressed = length >= 2 && magic[0] == 0x1f && magic[1] == 0x8b;
+
+      // Tarballs compressed with bzip2, xz or zstd.
+      supported = compressed.get() || !(
+          (length >= 3 && ::memcmp(magic, "BZh", 3) == 0) ||
+          (length >= 6 && ::memcmp(magic, "\xfd" "7zXZ\0", 6) == 0) ||
+          (length >= 4 && ::memcmp(magic, "\x28\xb5\x2f\xfd", 4) == 0));
+
+      if (compressed.get() && inflateInit2(&stream, MAX_WBITS + 16) != Z_OK) {
+        os::close(fd.get());
+        return Error("Failed to initialize zlib");
+      }
+    }
+
+    if (!supported) {
+      continue;
+    }
+
+    if (!compressed.get()) {
+      result = extractor->feed(input.data(), length);
+
+      // Without a digest to compute, there is no need to read the
+      // discarded data of uncompressed tarballs.
+      const uint64_t skippable = extractor->skippable();
+      if (result.isSome() &&
+          verifier.get() == nullptr &&
+          skippable > EXTRACT_BUFFER_SIZE) {
+        struct stat s;
+        const off_t offset = ::lseek(fd.get(), skippable, SEEK_CUR);
+        if (offset < 0 || ::fstat(fd.get(), &s) < 0) {
+          result = ErrnoError("Failed to seek '" + tar + "'");
+        } else if (offset > s.st_size) {
+          // Let `finish()` report the truncated archive.
+          break;
+        } else {
+          result = extractor->skip(skippable);
+        }
+      }
+
+      continue;
+    }
+
+    stream.next_in = reinterpret_cast<Bytef*>(input.data());
+    stream.avail_in = length;
+
+    while (stream.avail_in > 0 && result.isSome()) {
+      if (inflated) {
+        // Only a concatenated gzip member may follow the end of the
+        // gzip stream; anything else (e.g., padding) is ignored.
+        if (stream.avail_in < 2 ||
+            stream.next_in[0] != 0x1f ||
+            stream.next_in[1] != 0x8b) {
+          stream.avail_in = 0;
+          break;
+        }
+
+        inflateReset(&stream);
+        inflated = false;
+      }
+
+      stream.next_out = reinterpret_cast<Bytef*>(output.data());
+      stream.avail_out = output.size();
+
+      int code = inflate(&stream, Z_NO_FLUSH);
+      if (code != Z_OK && code != Z_STREAM_END && code != Z_BUF_ERROR) {
+        result = Error(
+            "Failed to decompress '" + tar + "': " +
+            (stream.msg != nullptr ? string(stream.msg) : stringify(code)));
+        break;
+      }
+
+      result = extractor->feed(
+          output.data(),
+          output.size() - stream.avail_out);
+
+      if (code == Z_STREAM_END) {
+        inflated = true;
+      } else if (code == Z_BUF_ERROR) {
+        break;
+      }
+    }
+  }
+
+  if (compressed.isSome() && compressed.get()) {
+    inflateEnd(&stream);
+  }
+
+  os::close(fd.get());
+
+  if (result.isError()) {
+    return Error(result.error());
+  }
+
+  if (verifier.get() != nullptr) {
+    Try<Nothing> verify = verifier->verify();
+    if (verify.isError()) {
+      return Error("Failed to verify '" + tar + "': " + verify.error());
+    }
+  }
+
+  if (!supported) {
+    return false;
+  }
+
+  if (compressed.isSome() && compressed.get() && !inflated) {
+    return Error("Failed to decompress '" + tar + "': Unexpected end of file");
+  }
+
+  Try<Nothing> finish = extractor->finish();
+  if (finish.isError()) {
+    return Error("Failed to extract '" + tar + "': " + finish.error());
+  }
+
+  return true;
+}
+
+
+static Try<bool> _extractLayer(
+    const string& tar,
+    const string& rootfs,
+    const Option<string>& digest)
+{
+  TarExtractor extractor(rootfs);
+
+  return extract(tar, &extractor, digest);
+}
+
+
+static Try<bool> _extractArchiveMetadata(
+    const string& archive,
+    const string& directory)
+{
+  TarExtractor extractor(directory, [](const string& path) {
+    return Path(path).basename() != "layer.tar";
+  });
+
+  return extract(archive, &extractor, None());
+}
+
+
+static Try<bool> _extractArchivedLayer(
+    const string& archive,
+    const string& member,
+    const string& rootfs)
+{
+  // None of the entries of the archive itself is extracted, only the
+  // content of the layer tarball is.
+  TarExtractor extractor(rootfs, [](const string&) { return false; });
+  extractor.nest(member, rootfs);
+
+  Try<bool> extracted = extract(archive, &extractor, None());
+  if (extracted.isSome() && extracted.get() && !extractor.nestedExtracted()) {
+    return Error("Failed to find '" + member + "' in '" + archive + "'");
+  }
+
+  return extracted;
+}
+
+
+// Bounds the number of extractions running concurrently, as they block
+// libprocess worker threads.
+class LayerExtractorProcess : public Process<LayerExtractorProcess>
+{
+public:
+  LayerExtractorProcess()
+    : ProcessBase(process::ID::generate("docker-provisioner-layer-extractor")),
+      running(0) {}
+
+  // Runs the native extraction, and the fallback if the extraction
+  // returns false (i.e., the tarball is not supported natively).
+  Future<Nothing> extract(
+      const lambda::function<Try<bool>()>& extraction,
+      const lambda::function<Future<Nothing>()>& fallback)
+  {
+    Extraction _extraction{
+        extraction,
+        fallback,
+        Owned<Promise<Nothing>>(new Promise<Nothing>())};
+
+    pending.push_back(_extraction);
+
+    schedule();
+
+    return _extraction.promise->future();
+  }
+
+private:
+  struct Extraction
+  {
+    lambda::function<Try<bool>()> extract;
+    lambda::function<Future<Nothing>()> fallback;
+    Owned<Promise<Nothing>> promise;
+  };
+
+  void schedule()
+  {
+    while (running < MAX_LAYER_EXTRACTORS && !pending.empty()) {
+      const Extraction extraction = pending.front();
+      pending.pop_front();
+
+      running++;
+
+      const lambda::function<Future<Nothing>()> fallback =
+        extraction.fallback;
+
+      async(extraction.extract)
+        .then([fallback](const Try<bool>& extracted) -> Future<Nothing> {
+          if (extracted.isError()) {
+            return Failure(extracted.error());
+          }
+
+          if (!extracted.get()) {
+            return fallback();
+          }
+
+          return Nothing();
+        })
+        .onAny(defer(self(), &Self::finished, extraction.promise, lambda::_1));
+    }
+  }
+
+  void finished(
+      const Owned<Promise<Nothing>>& promise,
+      const Future<Nothing>& future)
+  {
+    running--;
+    promise->associate(future);
+
+    schedule();
+  }
+
+  size_t running;
+  deque<Extraction> pending;
+};
+
+
+// The extractor is shared by all pullers to bound the number of
+// extractions running concurrently on the agent.
+static Future<Nothing> schedule(
+    const lambda::function<Try<bool>()>& extraction,
+    const lambda::function<Future<Nothing>()>& fallback)
+{
+  static LayerExtractorProcess* extractor = []() {
+    LayerExtractorProcess* process = new LayerExtractorProcess();
+    spawn(process);
+    return process;
+  }();
+
+  return dispatch(
+      extractor,
+      &LayerExtractorProcess::extract,
+      extraction,
+      fallback);
+}
+
+
+Future<Nothing> extractLayer(
+    const string& tar,
+    const string& rootfs,
+    const Option<string>& digest)
+{
+  return schedule(
+      lambda::bind(&_extractLayer, tar, rootfs, digest),
+      [=]() { return command::untar(Path(tar), Path(rootfs)); });
+}
+
+
+Future<Nothing> extractArchiveMetadata(
+    const string& archive,
+    const string& directory)
+{
+  return schedule(
+      lambda::bind(&_extractArchiveMetadata, archive, directory),
+      [=]() { return command::untar(Path(archive), Path(directory)); });
+}
+
+
+Future<Nothing> extractArchivedLayer(
+    const string& archive,
+    const string& member,
+    const string& rootfs)
+{
+  return schedule(
+      lambda::bind(&_extractArchivedLayer, archive, member, rootfs),
+      [=]() -> Future<Nothing> {
+        return Failure(
+            "Extracting layers from '" + archive + "' is not supported");
+      });
+}
+
+} // namespace docker {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,89 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __PROVISIONER_DOCKER_EXTRACTOR_HPP__
+#define __PROVISIONER_DOCKER_EXTRACTOR_HPP__
+
+#include <string>
+
+#include <process/future.hpp>
+
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace docker {
+
+/**
+ * Extracts the given image layer tarball into the rootfs directory.
+ *
+ * The tarball is read, decompressed (if gzip compressed) and unpacked
+ * in a single streaming pass, without spawning a `tar` subprocess or
+ * writing an intermediate decompressed copy. Layers are extracted
+ * concurrently, up to a bounded number across all pullers. Tarballs
+ * compressed with other formats are extracted with `tar`.
+ *
+ * @param tar path of the layer tarball.
+ * @param rootfs directory the layer is extracted into.
+ * @param digest optional digest of the tarball (e.g., a blob sum of the
+ *     form 'sha256:<hex>'), which is verified in the same pass. The
+ *     digest is only verified when the agent is built with SSL
+ *     support; otherwise a warning is logged.
+ */
+process::Future<Nothing> extractLayer(
+    const std::string& tar,
+    const std::string& rootfs,
+    const Option<std::string>& digest = None());
+
+
+/**
+ * Extracts the metadata of an image archive (e.g., as created by
+ * `docker save`) into the given directory, i.e., everything but the
+ * layer tarballs. The layers are then extracted on demand with
+ * `extractArchivedLayer`, so that the layers already in the store are
+ * never written to disk. Archives that cannot be read natively are
+ * fully extracted with `tar`, leaving the layer tarballs in place.
+ *
+ * @param archive path of the image archive.
+ * @param directory directory the metadata is extracted into.
+ */
+process::Future<Nothing> extractArchiveMetadata(
+    const std::string& archive,
+    const std::string& directory);
+
+
+/**
+ * Extracts a layer tarball of an image archive into the rootfs
+ * directory, streaming it out of the archive without writing the
+ * layer tarball itself.
+ *
+ * @param archive path of the image archive.
+ * @param member path of the layer tarball in the archive.
+ * @param rootfs directory the layer is extracted into.
+ */
+process::Future<Nothing> extractArchivedLayer(
+    const std::string& archive,
+    const std::string& member,
+    const std::string& rootfs);
+
+} // namespace docker {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROVISIONER_DOCKER_EXTRACTOR_HPP__
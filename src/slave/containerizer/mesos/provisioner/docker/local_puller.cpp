@@ -30,8 +30,7 @@
 #include <process/id.hpp>
 #include <process/process.hpp>
 
-#include "common/command_utils.hpp"
-
+#include "slave/containerizer/mesos/provisioner/docker/extractor.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/local_puller.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/paths.hpp"
 
@@ -66,6 +65,7 @@ public:
 private:
   Future<vector<string>> _pull(
       const spec::ImageReference& reference,
+      const string& archive,
       const string& directory,
       const string& backend);
 
@@ -74,11 +74,13 @@ private:
       const string& layerId);
 
   Future<Nothing> extractLayers(
+      const string& archive,
       const string& directory,
       const vector<string>& layerIds,
       const string& backend);
 
   Future<Nothing> extractLayer(
+      const string& archive,
       const string& directory,
       const string& layerId,
       const string& backend);
@@ -151,17 +153,20 @@ Future<vector<string>> LocalPullerProcess::pull(
         stringify(reference) + "' at '" + tarPath + "'");
   }
 
-  VLOG(1) << "Untarring image '" << reference
+  VLOG(1) << "Extracting the metadata of image '" << reference
           << "' from '" << tarPath
           << "' to '" << directory << "'";
 
-  return command::untar(Path(tarPath), Path(directory))
-    .then(defer(self(), &Self::_pull, reference, directory, backend));
+  // NOTE: The layers are only extracted once we know which of them are
+  // not in the store yet, see `extractLayers`.
+  return extractArchiveMetadata(tarPath, directory)
+    .then(defer(self(), &Self::_pull, reference, tarPath, directory, backend));
 }
 
 
 Future<vector<string>> LocalPullerProcess::_pull(
     const spec::ImageReference& reference,
+    const string& archive,
     const string& directory,
     const string& backend)
 {
@@ -237,7 +242,7 @@ Future<vector<string>> LocalPullerProcess::_pull(
         "': " + parentLayerId.error());
   }
 
-  return extractLayers(directory, layerIds, backend)
+  return extractLayers(archive, directory, layerIds, backend)
     .then([layerIds]() -> vector<string> { return layerIds; });
 }
 
@@ -284,6 +289,7 @@ Result<string> LocalPullerProcess::getParentLayerId(
 
 
 Future<Nothing> LocalPullerProcess::extractLayers(
+    const string& archive,
     const string& directory,
     const vector<string>& layerIds,
     const string& backend)
@@ -299,7 +305,7 @@ Future<Nothing> LocalPullerProcess::extractLayers(
       continue;
     }
 
-    futures.push_back(extractLayer(directory, layerId, backend));
+    futures.push_back(extractLayer(archive, directory, layerId, backend));
   }
 
   return collect(futures)
@@ -308,6 +314,7 @@ Future<Nothing> LocalPullerProcess::extractLayers(
 
 
 Future<Nothing> LocalPullerProcess::extractLayer(
+    const string& archive,
     const string& directory,
     const string& layerId,
     const string& backend)
@@ -316,9 +323,6 @@ Future<Nothing> LocalPullerProcess::extractLayer(
   const string tar = paths::getImageLayerTarPath(layerPath);
   const string rootfs = paths::getImageLayerRootfsPath(layerPath, backend);
 
-  VLOG(1) << "Extracting layer tar ball '" << tar
-          << " to rootfs '" << rootfs << "'";
-
   Try<Nothing> mkdir = os::mkdir(rootfs);
   if (mkdir.isError()) {
     return Failure(
@@ -326,7 +330,21 @@ Future<Nothing> LocalPullerProcess::extractLayer(
         ": " + mkdir.error());
   }
 
-  return command::untar(Path(tar), Path(rootfs))
+  // The layer tar ball is only on disk if the archive could not be
+  // read natively, in which case it was fully extracted with `tar`.
+  if (!os::exists(tar)) {
+    const string member = path::join(layerId, Path(tar).basename());
+
+    VLOG(1) << "Extracting layer tar ball '" << member << "' from '"
+            << archive << "' to rootfs '" << rootfs << "'";
+
+    return extractArchivedLayer(archive, member, rootfs);
+  }
+
+  VLOG(1) << "Extracting layer tar ball '" << tar
+          << " to rootfs '" << rootfs << "'";
+
+  return docker::extractLayer(tar, rootfs)
     .then([tar]() -> Future<Nothing> {
       // Remove the tar after the extraction.
       Try<Nothing> rm = os::rm(tar);
@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <list>
 #include <string>
 #include <vector>
 
@@ -32,12 +33,19 @@
 
 #include "slave/state.hpp"
 
+#ifndef __WINDOWS__
+#include "slave/containerizer/mesos/disk_usage.hpp"
+#endif // __WINDOWS__
+
+#include "slave/containerizer/mesos/provisioner/layer_index.hpp"
+
 #include "slave/containerizer/mesos/provisioner/docker/paths.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/message.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/metadata_manager.hpp"
 
 namespace spec = docker::spec;
 
+using std::list;
 using std::string;
 using std::vector;
 
@@ -61,16 +69,30 @@ public:
 
   Future<Image> put(
       const spec::ImageReference& reference,
-      const vector<string>& layerIds);
+      const vector<string>& layerIds,
+      const hashmap<string, Bytes>& layerSizes);
 
   Future<Option<Image>> get(
       const spec::ImageReference& reference,
       bool cached);
 
   Future<hashset<string>> prune(
-      const vector<spec::ImageReference>& excludedImages);
+      const vector<spec::ImageReference>& excludedImages,
+      const hashset<string>& activeLayerIds,
+      const Option<Bytes>& maxSize);
 
 private:
+  // Adds the image to the stored images as the most recently used one.
+  void add(const Image& image);
+
+  // Reconciles the index with the layers in the store: the layers
+  // which are not in `sizedLayerIds` are sized, and the ones which are
+  // no longer in the store stop counting against its size.
+  Try<Nothing> reconcileLayers(const hashset<string>& sizedLayerIds);
+
+  // Returns the disk space used by the layer in the store.
+  Try<Bytes> layerSize(const string& layerId);
+
   // Write out metadata manager state to persistent store.
   Try<Nothing> persist();
 
@@ -80,6 +102,10 @@ private:
   // by image name.
   // For example, "ubuntu:14.04" -> ubuntu14:04 Image.
   hashmap<string, Image> storedImages;
+
+  // The index of the stored images, keyed by image name, and of the
+  // layers in the store, keyed by layer id.
+  LayerIndex index;
 };
 
 
@@ -113,13 +139,15 @@ Future<Nothing> MetadataManager::recover()
 
 Future<Image> MetadataManager::put(
     const spec::ImageReference& reference,
-    const vector<string>& layerIds)
+    const vector<string>& layerIds,
+    const hashmap<string, Bytes>& layerSizes)
 {
   return dispatch(
       process.get(),
       &MetadataManagerProcess::put,
       reference,
-      layerIds);
+      layerIds,
+      layerSizes);
 }
 
 
@@ -136,18 +164,23 @@ Future<Option<Image>> MetadataManager::get(
 
 
 Future<hashset<string>> MetadataManager::prune(
-    const vector<spec::ImageReference>& excludedImages)
+    const vector<spec::ImageReference>& excludedImages,
+    const hashset<string>& activeLayerIds,
+    const Option<Bytes>& maxSize)
 {
   return dispatch(
       process.get(),
       &MetadataManagerProcess::prune,
-      excludedImages);
+      excludedImages,
+      activeLayerIds,
+      maxSize);
 }
 
 
 Future<Image> MetadataManagerProcess::put(
     const spec::ImageReference& reference,
-    const vector<string>& layerIds)
+    const vector<string>& layerIds,
+    const hashmap<string, Bytes>& layerSizes)
 {
   const string imageReference = stringify(reference);
 
@@ -157,7 +190,30 @@ Future<Image> MetadataManagerProcess::put(
     dockerImage.add_layer_ids(layerId);
   }
 
-  storedImages[imageReference] = dockerImage;
+  foreachpair (const string& layerId, const Bytes& size, layerSizes) {
+    index.resize(layerId, size);
+  }
+
+  // The store does not size the layers which were already in it when
+  // the image was pulled, as they are expected to be indexed. Those
+  // which are not (e.g., moved into the store by an agent which failed
+  // before it checkpointed the image) are sized here.
+  foreach (const string& layerId, layerIds) {
+    if (layerSizes.contains(layerId) || index.contains(layerId)) {
+      continue;
+    }
+
+    Try<Bytes> size = layerSize(layerId);
+    if (size.isError()) {
+      LOG(WARNING) << "Failed to get the size of layer '" << layerId
+                   << "': " << size.error();
+      continue;
+    }
+
+    index.resize(layerId, size.get());
+  }
+
+  add(dockerImage);
 
   Try<Nothing> status = persist();
   if (status.isError()) {
@@ -187,21 +243,23 @@ Future<Option<Image>> MetadataManagerProcess::get(
     return None();
   }
 
+  index.use(imageReference);
+
   return storedImages[imageReference];
 }
 
 
 Future<hashset<string>> MetadataManagerProcess::prune(
-    const vector<spec::ImageReference>& excludedImages)
+    const vector<spec::ImageReference>& excludedImages,
+    const hashset<string>& activeLayerIds,
+    const Option<Bytes>& maxSize)
 {
-  hashmap<string, Image> retainedImages;
-  hashset<string> retainedLayers;
+  hashset<string> retainedImages;
 
   foreach (const spec::ImageReference& reference, excludedImages) {
     const string imageName = stringify(reference);
-    Option<Image> image = storedImages.get(imageName);
 
-    if (image.isNone()) {
+    if (!storedImages.contains(imageName)) {
       // This is possible if docker store was cleaned
       // in a recovery after the container using this image was
       // launched.
@@ -210,21 +268,105 @@ Future<hashset<string>> MetadataManagerProcess::prune(
       continue;
     }
 
-    retainedImages[imageName] = image.get();
+    retainedImages.insert(imageName);
+  }
+
+  LayerIndex::Pruned pruned =
+    index.prune(retainedImages, activeLayerIds, maxSize);
 
-    foreach (const string& layerId, image->layer_ids()) {
-      retainedLayers.insert(layerId);
-    }
+  foreach (const string& imageName, pruned.images) {
+    storedImages.erase(imageName);
+
+    VLOG(1) << "Pruned docker image '" << imageName << "'";
   }
 
-  storedImages = std::move(retainedImages);
+  if (!pruned.layers.empty()) {
+    LOG(INFO) << "Pruned " << pruned.images.size() << " Docker images and "
+              << pruned.layers.size() << " layers (" << pruned.size
+              << "), leaving " << index.size() << " in the store";
+  }
 
   Try<Nothing> status = persist();
   if (status.isError()) {
     return Failure("Failed to save state of Docker images: " + status.error());
   }
 
-  return retainedLayers;
+  return pruned.layers;
+}
+
+
+void MetadataManagerProcess::add(const Image& image)
+{
+  const string imageReference = stringify(image.reference());
+
+  storedImages[imageReference] = image;
+  index.add(
+      imageReference,
+      vector<string>(image.layer_ids().begin(), image.layer_ids().end()));
+}
+
+
+Try<Nothing> MetadataManagerProcess::reconcileLayers(
+    const hashset<string>& sizedLayerIds)
+{
+  Try<list<string>> layerIds = paths::listLayers(flags.docker_store_dir);
+  if (layerIds.isError()) {
+    return Error("Failed to list layers: " + layerIds.error());
+  }
+
+  hashset<string> storedLayerIds;
+
+  size_t sized = 0;
+
+  foreach (const string& layerId, layerIds.get()) {
+    storedLayerIds.insert(layerId);
+
+    if (sizedLayerIds.contains(layerId)) {
+      continue;
+    }
+
+    Try<Bytes> size = layerSize(layerId);
+    if (size.isError()) {
+      return Error(
+          "Failed to get the size of layer '" + layerId + "': " +
+          size.error());
+    }
+
+    index.resize(layerId, size.get());
+    sized++;
+  }
+
+  // The images referencing missing layers are pulled again when they
+  // are provisioned, which sizes the layers again.
+  size_t missing = 0;
+
+  foreachpair (const string& layerId, const Bytes& size, index.layers()) {
+    if (!storedLayerIds.contains(layerId) && size > Bytes(0)) {
+      index.resize(layerId, Bytes(0));
+      missing++;
+    }
+  }
+
+  if (sized == 0 && missing == 0) {
+    return Nothing();
+  }
+
+  LOG(INFO) << "Indexed " << sized << " Docker image layers found in the "
+            << "store and " << missing << " layers missing from it ("
+            << index.size() << ")";
+
+  return persist();
+}
+
+
+Try<Bytes> MetadataManagerProcess::layerSize(const string& layerId)
+{
+#ifdef __WINDOWS__
+  // NOTE: The size of layers is not recorded on Windows yet.
+  return Bytes(0);
+#else
+  return diskUsage(paths::getImageLayerPath(flags.docker_store_dir, layerId));
+#endif // __WINDOWS__
 }
 
 
@@ -232,8 +374,14 @@ Try<Nothing> MetadataManagerProcess::persist()
 {
   Images images;
 
-  foreachvalue (const Image& image, storedImages) {
-    images.add_images()->CopyFrom(image);
+  foreach (const string& imageReference, index.images()) {
+    images.add_images()->CopyFrom(storedImages.at(imageReference));
+  }
+
+  foreachpair (const string& layerId, const Bytes& size, index.layers()) {
+    docker::Layer* layer = images.add_layers();
+    layer->set_id(layerId);
+    layer->set_size(size.bytes());
   }
 
   Try<Nothing> status = state::checkpoint(
@@ -253,6 +401,14 @@ Future<Nothing> MetadataManagerProcess::recover()
   if (!os::exists(storedImagesPath)) {
     LOG(INFO) << "No images to load from disk. Docker provisioner image "
               << "storage path '" << storedImagesPath << "' does not exist";
+
+    // The store might still contain layers, e.g., if the agent
+    // failed before it checkpointed the images.
+    Try<Nothing> reconcile = reconcileLayers(hashset<string>());
+    if (reconcile.isError()) {
+      return Failure("Failed to index layers: " + reconcile.error());
+    }
+
     return Nothing();
   }
 
@@ -275,14 +431,30 @@ Future<Nothing> MetadataManagerProcess::recover()
       LOG(WARNING) << "Found duplicate image in recovery for image reference '"
                    << imageReference << "'";
     } else {
-      storedImages[imageReference] = image;
+      add(image);
     }
 
     VLOG(1) << "Successfully loaded image '" << imageReference << "'";
   }
 
+  hashset<string> sizedLayerIds;
+
+  foreach (const docker::Layer& layer, images->layers()) {
+    index.resize(layer.id(), Bytes(layer.size()));
+    sizedLayerIds.insert(layer.id());
+  }
+
   LOG(INFO) << "Successfully loaded " << storedImages.size()
-            << " Docker images";
+            << " Docker images and " << images->layers_size() << " layers ("
+            << index.size() << ")";
+
+  // The store may have changed since the images were checkpointed,
+  // e.g., if the agent failed after it moved layers into the store, or
+  // by agents which did not index the layers yet.
+  Try<Nothing> reconcile = reconcileLayers(sizedLayerIds);
+  if (reconcile.isError()) {
+    return Failure("Failed to index layers: " + reconcile.error());
+  }
 
   return Nothing();
 }
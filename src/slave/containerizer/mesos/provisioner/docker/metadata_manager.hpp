@@ -20,6 +20,7 @@
 #include <list>
 #include <string>
 
+#include <stout/bytes.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/json.hpp>
@@ -50,10 +51,11 @@ class MetadataManagerProcess;
 /**
  * The MetadataManager tracks the Docker images cached by the
  * provisioner that are stored on disk. It keeps track of the layers
- * that Docker images are composed of and recovers Image objects
- * upon initialization by checking for dependent layers stored on disk.
- * Currently, image layers are stored indefinitely, with no garbage
- * collection of unreferenced image layers.
+ * that Docker images are composed of, in an index of the layers in the
+ * store with their sizes and the number of cached images referencing
+ * them, and of the order in which the images were last used. Both are
+ * checkpointed together and recovered upon initialization, so that
+ * lookups and garbage collection do not need to scan the store.
  */
 class MetadataManager
 {
@@ -76,14 +78,17 @@ public:
    * @param layerIds the list of layer ids that comprise the Docker image in
    *                 order where the root layer's id (no parent layer) is first
    *                 and the leaf layer's id is last.
+   * @param layerSizes the sizes of the layers that were (re)added to the
+   *                   store while pulling the image.
    */
   process::Future<Image> put(
       const ::docker::spec::ImageReference& reference,
-      const std::vector<std::string>& layerIds);
+      const std::vector<std::string>& layerIds,
+      const hashmap<std::string, Bytes>& layerSizes = {});
 
   /**
    * Retrieve Image based on image reference if it is among the Images
-   * stored in memory.
+   * stored in memory, and mark it as the most recently used one.
    *
    * @param reference the reference of the Docker image to retrieve
    * @param cached the flag whether pull Docker image forcelly from remote
@@ -96,15 +101,21 @@ public:
   /**
    * Prune images from the metadata manager by comparing
    * existing images with active images in use. This function will
-   * remove all images not used anymore, and return the list of
-   * layers which are still referenced. The caller should
-   * ensure such layers are kept in best effort.
+   * remove the images not used anymore, in least recently used order,
+   * and return the layers which are no longer referenced by any image
+   * nor used by active containers. These layers are removed from the
+   * index, and the caller should remove them from the store.
    *
    * @param excludedImages all images to exclude from pruning.
-   * @return a list of all layers still refered.
+   * @param activeLayerIds the layers used by active containers.
+   * @param maxSize if set, images are only pruned until the layers in
+   *                the store fit within this size.
+   * @return the layers to remove from the store.
    */
   process::Future<hashset<std::string>> prune(
-      const std::vector<::docker::spec::ImageReference>& excludedImages);
+      const std::vector<::docker::spec::ImageReference>& excludedImages,
+      const hashset<std::string>& activeLayerIds = hashset<std::string>(),
+      const Option<Bytes>& maxSize = None());
 
 private:
   explicit MetadataManager(process::Owned<MetadataManagerProcess> process);
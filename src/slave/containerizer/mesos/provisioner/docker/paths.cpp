@@ -53,6 +53,12 @@ string getImageLayerPath(const string& storeDir, const string& layerId)
 Try<list<string>> listLayers(const string& storeDir)
 {
   const string layersDir = path::join(storeDir, "layers");
+
+  // The layers directory is created when the first layer is stored.
+  if (!os::exists(layersDir)) {
+    return list<string>();
+  }
+
   return os::ls(layersDir);
 }
 
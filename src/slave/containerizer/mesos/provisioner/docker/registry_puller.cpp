@@ -23,15 +23,16 @@
 #include <process/dispatch.hpp>
 #include <process/http.hpp>
 
+#include <stout/hashmap.hpp>
+
 #include <stout/os/exists.hpp>
 #include <stout/os/mkdir.hpp>
 #include <stout/os/rm.hpp>
 #include <stout/os/write.hpp>
 
-#include "common/command_utils.hpp"
-
 #include "uri/schemes/docker.hpp"
 
+#include "slave/containerizer/mesos/provisioner/docker/extractor.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/paths.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/registry_puller.hpp"
 
@@ -90,10 +91,10 @@ private:
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2::ImageManifest& manifest,
-    const hashset<string>& blobSums,
+    const hashmap<string, Future<Nothing>>& blobs,
     const string& backend);
 
-  Future<hashset<string>> fetchBlobs(
+  Try<hashmap<string, Future<Nothing>>> fetchBlobs(
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2::ImageManifest& manifest,
@@ -321,14 +322,16 @@ Future<vector<string>> RegistryPullerProcess::__pull(
     return Failure("'fsLayers' and 'history' have different size in manifest");
   }
 
-  return fetchBlobs(reference, directory, manifest.get(), backend, config)
-    .then(defer(self(),
-                &Self::___pull,
-                reference,
-                directory,
-                manifest.get(),
-                lambda::_1,
-                backend));
+  // NOTE: The layers are extracted as soon as their blob is fetched,
+  // rather than once all the blobs are fetched.
+  Try<hashmap<string, Future<Nothing>>> blobs =
+    fetchBlobs(reference, directory, manifest.get(), backend, config);
+
+  if (blobs.isError()) {
+    return Failure(blobs.error());
+  }
+
+  return ___pull(reference, directory, manifest.get(), blobs.get(), backend);
 }
 
 
@@ -336,7 +339,7 @@ Future<vector<string>> RegistryPullerProcess::___pull(
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2::ImageManifest& manifest,
-    const hashset<string>& blobSums,
+    const hashmap<string, Future<Nothing>>& blobs,
     const string& backend)
 {
   // Docker reads the layer ids from the disk:
@@ -381,9 +384,12 @@ Future<vector<string>> RegistryPullerProcess::___pull(
     layerIds.insert(layerIds.begin(), v1.id());
     uniqueIds.insert(v1.id());
 
-    // Skip if the layer is already in the store.
+    // Skip if the layer is already in the store. The blob is not
+    // fetched in that case, which also covers a layer that has been
+    // added to the store since the blobs were fetched.
     if (os::exists(
-        paths::getImageLayerRootfsPath(storeDir, v1.id(), backend))) {
+        paths::getImageLayerRootfsPath(storeDir, v1.id(), backend)) ||
+        !blobs.contains(blobSum)) {
       continue;
     }
 
@@ -410,13 +416,16 @@ Future<vector<string>> RegistryPullerProcess::___pull(
           v1.id() + "': " + write.error());
     }
 
-    futures.push_back(command::untar(Path(tar), Path(rootfs)));
+    // The blob sum is the digest of the tarball, which is verified
+    // while extracting it if the agent is built with SSL support.
+    futures.push_back(blobs.at(blobSum)
+      .then([=]() { return extractLayer(tar, rootfs, blobSum); }));
   }
 
   return collect(futures)
     .then([=]() -> Future<vector<string>> {
       // Remove the tarballs after the extraction.
-      foreach (const string& blobSum, blobSums) {
+      foreach (const string& blobSum, blobs.keys()) {
         const string tar = path::join(directory, blobSum);
 
         Try<Nothing> rm = os::rm(tar);
@@ -432,7 +441,7 @@ Future<vector<string>> RegistryPullerProcess::___pull(
 }
 
 
-Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
+Try<hashmap<string, Future<Nothing>>> RegistryPullerProcess::fetchBlobs(
     const spec::ImageReference& reference,
     const string& directory,
     const spec::v2::ImageManifest& manifest,
@@ -465,7 +474,7 @@ Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
   }
 
   // Now, actually fetch the blobs.
-  list<Future<Nothing>> futures;
+  hashmap<string, Future<Nothing>> blobs;
 
   foreach (const string& blobSum, blobSums) {
     URI blobUri;
@@ -473,12 +482,12 @@ Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
     if (reference.has_registry()) {
       Result<int> port = spec::getRegistryPort(reference.registry());
       if (port.isError()) {
-        return Failure("Failed to get registry port: " + port.error());
+        return Error("Failed to get registry port: " + port.error());
       }
 
       Try<string> scheme = spec::getRegistryScheme(reference.registry());
       if (scheme.isError()) {
-        return Failure("Failed to get registry scheme: " + scheme.error());
+        return Error("Failed to get registry scheme: " + scheme.error());
       }
 
       // If users want to use the registry specified in '--docker_image',
@@ -507,14 +516,13 @@ Future<hashset<string>> RegistryPullerProcess::fetchBlobs(
           port);
     }
 
-    futures.push_back(fetcher->fetch(
+    blobs[blobSum] = fetcher->fetch(
         blobUri,
         directory,
-        config.isSome() ? config->data() : Option<string>()));
+        config.isSome() ? config->data() : Option<string>());
   }
 
-  return collect(futures)
-    .then([blobSums]() -> hashset<string> { return blobSums; });
+  return blobs;
 }
 
 } // namespace docker {
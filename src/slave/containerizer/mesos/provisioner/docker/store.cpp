@@ -23,11 +23,13 @@
 
 #include <mesos/secret/resolver.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/hashset.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 
+#include <process/async.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
@@ -35,6 +37,10 @@
 #include <process/id.hpp>
 #include <process/metrics/counter.hpp>
 
+#ifndef __WINDOWS__
+#include "slave/containerizer/mesos/disk_usage.hpp"
+#endif // __WINDOWS__
+
 #include "slave/containerizer/mesos/provisioner/constants.hpp"
 #include "slave/containerizer/mesos/provisioner/utils.hpp"
 
@@ -57,6 +63,7 @@ using process::Owned;
 using process::Process;
 using process::Promise;
 
+using process::async;
 using process::defer;
 using process::dispatch;
 using process::spawn;
@@ -105,19 +112,19 @@ private:
       const Image& image,
       const string& backend);
 
-  Future<vector<string>> moveLayers(
+  // Moves the pulled layers into the store, and returns the sizes of
+  // the layers that were moved.
+  Future<hashmap<string, Bytes>> moveLayers(
       const string& staging,
       const vector<string>& layerIds,
       const string& backend);
 
-  Future<Nothing> moveLayer(
+  Future<Option<Bytes>> moveLayer(
       const string& staging,
       const string& layerId,
       const string& backend);
 
-  Future<Nothing> _prune(
-      const hashset<string>& activeLayerPaths,
-      const hashset<string>& retainedImageLayers);
+  Future<Nothing> _prune(const hashset<string>& prunedLayerIds);
 
   const Flags flags;
 
@@ -325,13 +332,11 @@ Future<Image> StoreProcess::_get(
         staging.get(),
         backend,
         config)
-      .then(defer(self(),
-                  &Self::moveLayers,
-                  staging.get(),
-                  lambda::_1,
-                  backend))
       .then(defer(self(), [=](const vector<string>& layerIds) {
-        return metadataManager->put(reference, layerIds);
+        return moveLayers(staging.get(), layerIds, backend)
+          .then(defer(self(), [=](const hashmap<string, Bytes>& layerSizes) {
+            return metadataManager->put(reference, layerIds, layerSizes);
+          }));
       }))
       .onAny(defer(self(), [=](const Future<Image>&) {
         pulling.erase(name);
@@ -393,22 +398,35 @@ Future<ImageInfo> StoreProcess::__get(
 }
 
 
-Future<vector<string>> StoreProcess::moveLayers(
+Future<hashmap<string, Bytes>> StoreProcess::moveLayers(
     const string& staging,
     const vector<string>& layerIds,
     const string& backend)
 {
-  list<Future<Nothing>> futures;
+  list<Future<Option<Bytes>>> futures;
   foreach (const string& layerId, layerIds) {
     futures.push_back(moveLayer(staging, layerId, backend));
   }
 
   return collect(futures)
-    .then([layerIds]() -> vector<string> { return layerIds; });
+    .then([layerIds](const list<Option<Bytes>>& sizes) {
+      hashmap<string, Bytes> layerSizes;
+
+      auto size = sizes.begin();
+      foreach (const string& layerId, layerIds) {
+        if (size->isSome()) {
+          layerSizes[layerId] = size->get();
+        }
+
+        ++size;
+      }
+
+      return layerSizes;
+    });
 }
 
 
-Future<Nothing> StoreProcess::moveLayer(
+Future<Option<Bytes>> StoreProcess::moveLayer(
     const string& staging,
     const string& layerId,
     const string& backend)
@@ -420,7 +438,7 @@ Future<Nothing> StoreProcess::moveLayer(
   //
   // TODO(jieyu): Verify that the layer is actually in the store.
   if (!os::exists(source)) {
-    return Nothing();
+    return None();
   }
 
   const string targetRootfs = paths::getImageLayerRootfsPath(
@@ -432,7 +450,7 @@ Future<Nothing> StoreProcess::moveLayer(
   // already exists in the store, we'll skip the moving since they are
   // expected to be the same.
   if (os::exists(targetRootfs)) {
-    return Nothing();
+    return None();
   }
 
   const string sourceRootfs = paths::getImageLayerRootfsPath(source, backend);
@@ -479,7 +497,24 @@ Future<Nothing> StoreProcess::moveLayer(
     }
   }
 
-  return Nothing();
+#ifdef __WINDOWS__
+  // NOTE: The size of layers is not recorded on Windows yet.
+  return None();
+#else
+  // The size of the layer is recorded in the metadata manager, so that
+  // image garbage collection does not need to scan the store.
+  return async([target]() { return diskUsage(target); })
+    .then([target](const Try<Bytes>& usage) -> Option<Bytes> {
+      if (usage.isError()) {
+        LOG(WARNING) << "Failed to get the size of '" << target << "': "
+                     << usage.error();
+
+        return None();
+      }
+
+      return usage.get();
+    });
+#endif // __WINDOWS__
 }
 
 
@@ -508,39 +543,36 @@ Future<Nothing> StoreProcess::prune(
     imageReferences.push_back(reference.get());
   }
 
-  return metadataManager->prune(imageReferences)
-      .then(defer(self(), &Self::_prune, activeLayerPaths, lambda::_1));
-}
+  // Paths in provisioner are layer rootfs. Normalize them to layer
+  // ids, ignoring the layers of other stores.
+  hashset<string> activeLayerIds;
 
+  foreach (const string& rootfsPath, activeLayerPaths) {
+    const string layerPath = Path(rootfsPath).dirname();
+    const string layerId = Path(layerPath).basename();
 
-Future<Nothing> StoreProcess::_prune(
-    const hashset<string>& activeLayerRootfses,
-    const hashset<string>& retainedLayerIds)
-{
-  Try<list<string>> allLayers = paths::listLayers(flags.docker_store_dir);
-  if (allLayers.isError()) {
-    return Failure("Failed to find all layer paths: " + allLayers.error());
+    if (layerPath ==
+        paths::getImageLayerPath(flags.docker_store_dir, layerId)) {
+      activeLayerIds.insert(layerId);
+    }
   }
 
-  // Paths in provisioner are layer rootfs. Normalize them to layer
-  // path.
-  hashset<string> activeLayerPaths;
-
-  foreach (const string& rootfsPath, activeLayerRootfses) {
-    activeLayerPaths.insert(Path(rootfsPath).dirname());
-  }
+  return metadataManager->prune(
+      imageReferences,
+      activeLayerIds,
+      flags.docker_store_max_size)
+    .then(defer(self(), &Self::_prune, lambda::_1));
+}
 
-  foreach (const string& layerId, allLayers.get()) {
-    if (retainedLayerIds.contains(layerId)) {
-      VLOG(1) << "Layer '" << layerId << "' is retained by image store cache";
-      continue;
-    }
 
+Future<Nothing> StoreProcess::_prune(const hashset<string>& prunedLayerIds)
+{
+  foreach (const string& layerId, prunedLayerIds) {
     const string layerPath =
       paths::getImageLayerPath(flags.docker_store_dir, layerId);
 
-    if (activeLayerPaths.contains(layerPath)) {
-      VLOG(1) << "Layer '" << layerId << "' is retained by active container";
+    if (!os::exists(layerPath)) {
+      VLOG(1) << "Pruned layer '" << layerId << "' is not in the store";
       continue;
     }
 
@@ -0,0 +1,166 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+
+#include "slave/containerizer/mesos/provisioner/layer_index.hpp"
+
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+void LayerIndex::add(const string& image, const vector<string>& layers)
+{
+  if (indexedImages.contains(image)) {
+    remove(image);
+  }
+
+  Image& _image = indexedImages[image];
+  _image.position = recentImages.insert(recentImages.end(), image);
+
+  // NOTE: An image references each of its layers once.
+  foreach (const string& layer, layers) {
+    if (_image.layers.insert(layer).second) {
+      indexedLayers[layer].references++;
+    }
+  }
+}
+
+
+void LayerIndex::remove(const string& image)
+{
+  CHECK(indexedImages.contains(image));
+
+  const Image& _image = indexedImages.at(image);
+
+  foreach (const string& layer, _image.layers) {
+    CHECK(indexedLayers.contains(layer));
+    CHECK_LT(0u, indexedLayers.at(layer).references);
+
+    indexedLayers.at(layer).references--;
+  }
+
+  recentImages.erase(_image.position);
+  indexedImages.erase(image);
+}
+
+
+bool LayerIndex::use(const string& image)
+{
+  if (!indexedImages.contains(image)) {
+    return false;
+  }
+
+  recentImages.splice(
+      recentImages.end(),
+      recentImages,
+      indexedImages.at(image).position);
+
+  return true;
+}
+
+
+void LayerIndex::resize(const string& layer, const Bytes& size)
+{
+  Layer& _layer = indexedLayers[layer];
+
+  totalSize -= _layer.size;
+  _layer.size = size;
+  totalSize += _layer.size;
+}
+
+
+LayerIndex::Pruned LayerIndex::prune(
+    const hashset<string>& retainedImages,
+    const hashset<string>& activeLayers,
+    const Option<Bytes>& maxSize)
+{
+  Pruned pruned;
+
+  auto prunable = [&](const string& layer) {
+    return indexedLayers.at(layer).references == 0 &&
+           !activeLayers.contains(layer) &&
+           !pruned.layers.contains(layer);
+  };
+
+  auto mark = [&](const string& layer) {
+    pruned.layers.insert(layer);
+    pruned.size += indexedLayers.at(layer).size;
+  };
+
+  // Layers which are not part of any image anymore (e.g., the image
+  // was pulled again with different layers) are always pruned.
+  foreachkey (const string& layer, indexedLayers) {
+    if (prunable(layer)) {
+      mark(layer);
+    }
+  }
+
+  // Prune the images from the least to the most recently used one,
+  // until the layers fit in the maximum size (if any).
+  for (auto it = recentImages.begin(); it != recentImages.end();) {
+    if (maxSize.isSome() && totalSize - pruned.size <= maxSize.get()) {
+      break;
+    }
+
+    // NOTE: We advance the iterator first since removing the image
+    // invalidates it.
+    const string image = *(it++);
+
+    if (retainedImages.contains(image)) {
+      continue;
+    }
+
+    const hashset<string> imageLayers = indexedImages.at(image).layers;
+
+    remove(image);
+    pruned.images.push_back(image);
+
+    foreach (const string& layer, imageLayers) {
+      if (prunable(layer)) {
+        mark(layer);
+      }
+    }
+  }
+
+  foreach (const string& layer, pruned.layers) {
+    totalSize -= indexedLayers.at(layer).size;
+    indexedLayers.erase(layer);
+  }
+
+  return pruned;
+}
+
+
+hashmap<string, Bytes> LayerIndex::layers() const
+{
+  hashmap<string, Bytes> result;
+
+  foreachpair (const string& layer, const Layer& _layer, indexedLayers) {
+    result[layer] = _layer.size;
+  }
+
+  return result;
+}
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
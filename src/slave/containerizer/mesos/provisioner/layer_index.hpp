@@ -0,0 +1,127 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __PROVISIONER_LAYER_INDEX_HPP__
+#define __PROVISIONER_LAYER_INDEX_HPP__
+
+#include <list>
+#include <string>
+#include <vector>
+
+#include <stout/bytes.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
+#include <stout/option.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+
+// An in-memory index of the images cached by an image store and of
+// the layers they are composed of, which lets the store choose the
+// images to prune without scanning its directories. Images and layers
+// are identified by opaque strings chosen by the store (e.g., the
+// image reference and the layer id for the docker store).
+//
+// For each layer, the index records its size and the number of
+// indexed images composed of it. Images are ordered from the least to
+// the most recently used.
+//
+// NOTE: The index is not thread-safe and is expected to be owned by
+// the store's process. Checkpointing it is up to the store.
+class LayerIndex
+{
+public:
+  // The images removed from the index by `prune` and the layers that
+  // the store should delete.
+  struct Pruned
+  {
+    std::vector<std::string> images;
+    hashset<std::string> layers;
+    Bytes size;
+  };
+
+  // Adds the image as the most recently used one, replacing any
+  // indexed image with the same name, and references its layers.
+  void add(const std::string& image, const std::vector<std::string>& layers);
+
+  // Removes the image from the index and dereferences its layers.
+  // The layers are kept in the index until they are pruned.
+  void remove(const std::string& image);
+
+  // Marks the image as the most recently used one. Returns false if
+  // the image is not in the index.
+  bool use(const std::string& image);
+
+  // Returns whether the layer is in the index.
+  bool contains(const std::string& layer) const
+  {
+    return indexedLayers.contains(layer);
+  }
+
+  // Records the disk space used by the layer, adding the layer to the
+  // index if needed.
+  void resize(const std::string& layer, const Bytes& size);
+
+  // Removes the least recently used images not in `retainedImages`
+  // until the layers fit in `maxSize` (or all of them, if no size is
+  // given), and returns the layers which are no longer referenced by
+  // any image or by `activeLayers`. Unreferenced layers are always
+  // pruned. The returned layers are removed from the index.
+  Pruned prune(
+      const hashset<std::string>& retainedImages,
+      const hashset<std::string>& activeLayers,
+      const Option<Bytes>& maxSize);
+
+  // The indexed images, from the least to the most recently used.
+  const std::list<std::string>& images() const { return recentImages; }
+
+  // The indexed layers and their sizes.
+  hashmap<std::string, Bytes> layers() const;
+
+  // The total size of the indexed layers.
+  Bytes size() const { return totalSize; }
+
+private:
+  struct Layer
+  {
+    Bytes size;
+
+    // The number of indexed images composed of this layer.
+    size_t references = 0;
+  };
+
+  struct Image
+  {
+    // The distinct layers of the image.
+    hashset<std::string> layers;
+
+    // The position of the image in `recentImages`.
+    std::list<std::string>::iterator position;
+  };
+
+  hashmap<std::string, Image> indexedImages;
+  std::list<std::string> recentImages;
+
+  hashmap<std::string, Layer> indexedLayers;
+  Bytes totalSize;
+};
+
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __PROVISIONER_LAYER_INDEX_HPP__
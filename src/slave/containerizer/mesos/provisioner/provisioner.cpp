@@ -24,6 +24,7 @@
 
 #include <mesos/secret/resolver.hpp>
 
+#include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/defer.hpp>
 #include <process/dispatch.hpp>
@@ -56,10 +57,12 @@ using std::list;
 using std::string;
 using std::vector;
 
+using process::Clock;
 using process::Failure;
 using process::Future;
 using process::Owned;
 using process::ReadWriteLock;
+using process::Time;
 
 using mesos::internal::slave::AUFS_BACKEND;
 using mesos::internal::slave::BIND_BACKEND;
@@ -502,6 +505,8 @@ Future<ProvisionInfo> ProvisionerProcess::provision(
     const ContainerID& containerId,
     const Image& image)
 {
+  const Time start = Clock::now();
+
   // `destroy` and `provision` can happen concurrently, but `pruneImages`
   // is exclusive.
   return rwLock.read_lock()
@@ -521,6 +526,9 @@ Future<ProvisionInfo> ProvisionerProcess::provision(
             defaultBackend,
             lambda::_1));
     }))
+    .onReady(defer(self(), [this, start](const ProvisionInfo&) {
+      metrics.provision_latency.record(Clock::now() - start);
+    }))
     .onAny(defer(self(), [this](const Future<ProvisionInfo>&) {
       rwLock.read_unlock();
     }));
@@ -786,15 +794,19 @@ Future<Nothing> ProvisionerProcess::pruneImages(
 
 ProvisionerProcess::Metrics::Metrics()
   : remove_container_errors(
-      "containerizer/mesos/provisioner/remove_container_errors")
+      "containerizer/mesos/provisioner/remove_container_errors"),
+    provision_latency(
+      "containerizer/mesos/provisioner/provision_latency")
 {
   process::metrics::add(remove_container_errors);
+  process::metrics::add(provision_latency);
 }
 
 
 ProvisionerProcess::Metrics::~Metrics()
 {
   process::metrics::remove(remove_container_errors);
+  process::metrics::remove(provision_latency);
 }
 
 } // namespace slave {
@@ -38,6 +38,7 @@
 
 #include <process/metrics/counter.hpp>
 #include <process/metrics/metrics.hpp>
+#include <process/metrics/timer.hpp>
 
 #include "slave/flags.hpp"
 
@@ -195,6 +196,10 @@ private:
     ~Metrics();
 
     process::metrics::Counter remove_container_errors;
+
+    // The time it takes to get the image from its store, pulling any
+    // missing layers, and to provision the container rootfs.
+    process::metrics::Timer<Milliseconds> provision_latency;
   } metrics;
 
   // This `ReadWriteLock` instance is used to protect the critical
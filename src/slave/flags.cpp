@@ -212,6 +212,17 @@ mesos::internal::slave::Flags::Flags()
       "Directory the Docker provisioner will store images in",
       path::join(os::temp(), "mesos", "store", "docker"));
 
+  add(&Flags::docker_store_max_size,
+      "docker_store_max_size",
+      "Maximum size of the image layers in the Docker store. If set, image\n"
+      "garbage collection removes the least recently used images that are\n"
+      "neither excluded nor used by active containers only until the\n"
+      "layers in the store fit in this size, instead of removing all of\n"
+      "them. With `--image_gc_config`, the automatic image garbage\n"
+      "collection then runs at every `image_disk_watch_interval`, rather\n"
+      "than only when the image disk headroom is exceeded. Images in the\n"
+      "Appc store are neither counted against this size nor pruned.");
+
   add(&Flags::docker_volume_checkpoint_dir,
       "docker_volume_checkpoint_dir",
       "The root directory where we checkpoint the information about docker\n"
@@ -239,15 +250,49 @@ mesos::internal::slave::Flags::Flags()
 
   add(&Flags::fetcher_cache_dir,
       "fetcher_cache_dir",
-      "Directory for the fetcher cache. The agent will clear this directory\n"
-      "on startup. It is recommended to set this value to a separate volume\n"
-      "for several reasons:\n"
-      "  * The cache directories are transient and not meant to be\n"
-      "    backed up. Upon restarting the agent, the cache is always empty.\n"
+      "Directory for the fetcher cache. On startup, the agent recovers the\n"
+      "cache files it has checkpointed in this directory and removes\n"
+      "everything else. It is recommended to set this value to a separate\n"
+      "volume for several reasons:\n"
+      "  * The cache directories are not meant to be backed up. The agent\n"
+      "    only reuses cache files that are left intact.\n"
       "  * The cache and container sandboxes can potentially interfere with\n"
       "    each other when occupying a shared space (i.e. disk contention).",
       path::join(os::temp(), "mesos", "fetch"));
 
+  add(&Flags::fetcher_cache_eviction_policy,
+      "fetcher_cache_eviction_policy",
+      "Policy that determines which fetcher cache files are evicted first\n"
+      "when space is needed. Supported values are:\n"
+      "  `lru`: Least recently used files are evicted first.\n"
+      "  `gdsf`: Greedy-Dual-Size-Frequency, files with the lowest\n"
+      "    download time times number of requests per byte are evicted\n"
+      "    first, aging the files that are no longer requested.",
+      "lru",
+      [](const string& value) -> Option<Error> {
+        if (value != "lru" && value != "gdsf") {
+          return Error(
+              "Expected --fetcher_cache_eviction_policy to be one of "
+              "'lru' or 'gdsf'");
+        }
+
+        return None();
+      });
+
+  add(&Flags::fetcher_max_concurrent_downloads,
+      "fetcher_max_concurrent_downloads",
+      "Maximum number of URIs of a container that are fetched concurrently.\n"
+      "URIs with the same output file are always fetched one after another.",
+      DEFAULT_FETCHER_MAX_CONCURRENT_DOWNLOADS,
+      [](unsigned int value) -> Option<Error> {
+        if (value == 0) {
+          return Error(
+              "Expected --fetcher_max_concurrent_downloads to be positive");
+        }
+
+        return None();
+      });
+
   add(&Flags::work_dir,
       "work_dir",
       "Path of the agent work directory. This is where executor sandboxes\n"
@@ -453,6 +498,21 @@ mesos::internal::slave::Flags::Flags()
       "be a value between 0.0 and 1.0",
       GC_DISK_HEADROOM);
 
+  add(&Flags::gc_max_concurrent_removals,
+      "gc_max_concurrent_removals",
+      "Maximum number of paths that are garbage collected concurrently.\n"
+      "Each removal occupies a libprocess worker thread while it runs.\n"
+      "Paths pruned under disk pressure are removed before the ones\n"
+      "whose regular `--gc_delay` expired.",
+      DEFAULT_GC_MAX_CONCURRENT_REMOVALS,
+      [](unsigned int value) -> Option<Error> {
+        if (value == 0) {
+          return Error("Expected --gc_max_concurrent_removals to be positive");
+        }
+
+        return None();
+      });
+
   add(&Flags::disk_watch_interval,
       "disk_watch_interval",
       "Periodic time interval (e.g., 10secs, 2mins, etc)\n"
@@ -515,6 +575,17 @@ mesos::internal::slave::Flags::Flags()
       "state as possible is recovered.\n",
       true);
 
+  add(&Flags::checkpoint_journal,
+      "checkpoint_journal",
+      "If `checkpoint_journal=true`, the agent records the checkpointed\n"
+      "information of its frameworks, executors and tasks in a single\n"
+      "append-only journal in its meta directory, instead of writing each\n"
+      "piece of information to its own file. The existing files are still\n"
+      "read during recovery until they are superseded. If\n"
+      "`checkpoint_journal=false` and a journal exists, its contents are\n"
+      "written back to individual files on startup.\n",
+      false);
+
   add(&Flags::max_completed_executors_per_framework,
       "max_completed_executors_per_framework",
       "Maximum number of completed executors per framework to store\n"
@@ -1282,6 +1353,16 @@ mesos::internal::slave::Flags::Flags()
       "this flag.",
       Seconds(0));
 
+  add(&Flags::usage_sampling_interval,
+      "usage_sampling_interval",
+      "The interval at which the agent samples the resource usage of its\n"
+      "executors. The latest sample is shared by all the consumers (e.g.,\n"
+      "the resource estimator, the QoS controller and the\n"
+      "'/monitor/statistics' endpoint) while it is younger than this\n"
+      "interval. If zero, the resource usage is only sampled on demand,\n"
+      "and only the concurrent requests share a sample.",
+      Seconds(0));
+
   add(&Flags::oversubscribed_resources_interval,
       "oversubscribed_resources_interval",
       "The agent periodically updates the master with the current estimation\n"
@@ -61,12 +61,15 @@ public:
 
   std::string docker_registry;
   std::string docker_store_dir;
+  Option<Bytes> docker_store_max_size;
   std::string docker_volume_checkpoint_dir;
 
   std::string default_role;
   Option<std::string> attributes;
   Bytes fetcher_cache_size;
   std::string fetcher_cache_dir;
+  unsigned int fetcher_max_concurrent_downloads;
+  std::string fetcher_cache_eviction_policy;
   std::string work_dir;
   std::string runtime_dir;
   std::string launcher_dir;
@@ -90,6 +93,7 @@ public:
 #endif // USE_SSL_SOCKET
   Duration gc_delay;
   double gc_disk_headroom;
+  unsigned int gc_max_concurrent_removals;
   Duration disk_watch_interval;
 
   Option<std::string> container_logger;
@@ -98,6 +102,7 @@ public:
   std::string recover;
   Duration recovery_timeout;
   bool strict;
+  bool checkpoint_journal;
   Duration register_retry_interval_min;
 #ifdef __linux__
   std::string cgroups_hierarchy;
@@ -175,6 +180,7 @@ public:
   Option<std::string> resource_estimator;
   Option<std::string> qos_controller;
   Duration qos_correction_interval_min;
+  Duration usage_sampling_interval;
   Duration oversubscribed_resources_interval;
   Option<std::string> master_detector;
 #if ENABLE_XFS_DISK_ISOLATOR
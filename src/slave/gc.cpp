@@ -16,7 +16,19 @@
 
 #include "slave/gc.hpp"
 
-#include <list>
+#ifndef __WINDOWS__
+#include <dirent.h>
+#include <fcntl.h>
+#include <fts.h>
+#include <unistd.h>
+
+#include <sys/stat.h>
+#include <sys/types.h>
+#endif // __WINDOWS__
+
+#include <deque>
+#include <string>
+#include <vector>
 
 #include <process/check.hpp>
 #include <process/defer.hpp>
@@ -27,8 +39,10 @@
 
 #include <stout/foreach.hpp>
 #include <stout/lambda.hpp>
+#include <stout/path.hpp>
 
 #include <stout/os/rmdir.hpp>
+#include <stout/os/strerror.hpp>
 
 #include "logging/logging.hpp"
 
@@ -38,8 +52,6 @@ using namespace process;
 
 using process::wait; // Necessary on some OS's to disambiguate.
 
-using std::list;
-using std::map;
 using std::string;
 
 using process::metrics::Counter;
@@ -48,6 +60,254 @@ namespace mesos {
 namespace internal {
 namespace slave {
 
+#ifndef __WINDOWS__
+// The maximum number of nested directories that are open at once while
+// removing a directory. Deeper subtrees are removed by path with `fts`,
+// so that neither the number of open file descriptors nor the memory
+// used grows with the depth of the directory.
+constexpr size_t MAX_OPEN_DIRECTORIES = 32;
+
+
+// Removes `path` (and everything beneath it if it is a directory)
+// with `fts`, which does not keep a file descriptor per level.
+static void removeTree(const string& path, Bytes* reclaimed, size_t* errors)
+{
+  char* paths[] = {const_cast<char*>(path.c_str()), nullptr};
+
+  FTS* tree = ::fts_open(paths, FTS_NOCHDIR | FTS_PHYSICAL, nullptr);
+  if (tree == nullptr) {
+    LOG(ERROR) << "Failed to open directory '" << path << "': "
+               << os::strerror(errno);
+    ++(*errors);
+    return;
+  }
+
+  FTSENT* node;
+  while ((node = ::fts_read(tree)) != nullptr) {
+    int result = 0;
+
+    switch (node->fts_info) {
+      case FTS_D:
+        // Directories are removed in postorder.
+        continue;
+      case FTS_DP:
+        result = ::rmdir(node->fts_path);
+        break;
+      case FTS_F:
+      case FTS_SL:
+      case FTS_SLNONE:
+      case FTS_DEFAULT:
+        result = ::unlink(node->fts_path);
+        break;
+      default:
+        LOG(ERROR) << "Failed to read '" << node->fts_path << "': "
+                   << os::strerror(node->fts_errno);
+        ++(*errors);
+        continue;
+    }
+
+    if (result < 0) {
+      if (errno != ENOENT) {
+        LOG(ERROR) << "Failed to delete path '" << node->fts_path << "': "
+                   << os::strerror(errno);
+        ++(*errors);
+      }
+    } else if (S_ISDIR(node->fts_statp->st_mode) ||
+               node->fts_statp->st_nlink == 1) {
+      *reclaimed += Bytes(node->fts_statp->st_blocks * 512);
+    }
+  }
+
+  ::fts_close(tree);
+}
+
+
+// Removes everything beneath the directory open at `fd`, which is
+// closed on return. Entries are removed relative to the descriptor of
+// their parent with `unlinkat`, so the kernel resolves only the last
+// component of each path, and `readdir` lists each directory with
+// large `getdents64` batches. Hard links are only accounted for when
+// removing their last link actually frees their space.
+//
+// The directories being removed are kept on an explicit stack rather
+// than recursing, and subtrees below `MAX_OPEN_DIRECTORIES` levels are
+// left to `removeTree`.
+static void removeContents(
+    int fd,
+    const string& directory,
+    Bytes* reclaimed,
+    size_t* errors)
+{
+  struct Directory
+  {
+    DIR* dir;
+    string path;
+    struct stat s;
+  };
+
+  // Removes the entry with the given name from the directory open at
+  // `parent`, once it is empty if it is a directory.
+  auto remove = [=](int parent, const string& path, const struct stat& s) {
+    const string name = Path(path).basename();
+    const int flags = S_ISDIR(s.st_mode) ? AT_REMOVEDIR : 0;
+
+    if (::unlinkat(parent, name.c_str(), flags) < 0) {
+      if (errno != ENOENT) {
+        LOG(ERROR) << "Failed to delete path '" << path << "': "
+                   << os::strerror(errno);
+        ++(*errors);
+      }
+    } else if (S_ISDIR(s.st_mode) || s.st_nlink == 1) {
+      // NOTE: `st_blocks` is in units of 512 bytes regardless of the
+      // block size of the filesystem.
+      *reclaimed += Bytes(s.st_blocks * 512);
+    }
+  };
+
+  std::vector<Directory> directories;
+
+  DIR* dir = ::fdopendir(fd);
+  if (dir == nullptr) {
+    LOG(ERROR) << "Failed to open directory '" << directory << "': "
+               << os::strerror(errno);
+    ::close(fd);
+    ++(*errors);
+    return;
+  }
+
+  directories.push_back({dir, directory, {}});
+
+  while (!directories.empty()) {
+    errno = 0;
+    struct dirent* entry = ::readdir(directories.back().dir);
+
+    if (entry == nullptr) {
+      if (errno != 0) {
+        LOG(ERROR) << "Failed to read directory '"
+                   << directories.back().path << "': "
+                   << os::strerror(errno);
+        ++(*errors);
+      }
+
+      const Directory finished = directories.back();
+      directories.pop_back();
+
+      ::closedir(finished.dir);
+
+      // The directory itself is removed by the caller.
+      if (!directories.empty()) {
+        remove(::dirfd(directories.back().dir), finished.path, finished.s);
+      }
+
+      continue;
+    }
+
+    const string name = entry->d_name;
+    if (name == "." || name == "..") {
+      continue;
+    }
+
+    const int parent = ::dirfd(directories.back().dir);
+    const string path = path::join(directories.back().path, name);
+
+    struct stat s;
+    if (::fstatat(parent, name.c_str(), &s, AT_SYMLINK_NOFOLLOW) < 0) {
+      if (errno != ENOENT) {
+        LOG(ERROR) << "Failed to stat '" << path << "': "
+                   << os::strerror(errno);
+        ++(*errors);
+      }
+      continue;
+    }
+
+    if (!S_ISDIR(s.st_mode)) {
+      remove(parent, path, s);
+      continue;
+    }
+
+    if (directories.size() >= MAX_OPEN_DIRECTORIES) {
+      removeTree(path, reclaimed, errors);
+      continue;
+    }
+
+    int child = ::openat(
+        parent, name.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (child < 0) {
+      LOG(ERROR) << "Failed to open directory '" << path << "': "
+                 << os::strerror(errno);
+      ++(*errors);
+      continue;
+    }
+
+    dir = ::fdopendir(child);
+    if (dir == nullptr) {
+      LOG(ERROR) << "Failed to open directory '" << path << "': "
+                 << os::strerror(errno);
+      ::close(child);
+      ++(*errors);
+      continue;
+    }
+
+    directories.push_back({dir, path, s});
+  }
+}
+#endif // __WINDOWS__
+
+
+// Removes `path` recursively, returning the disk space reclaimed.
+//
+// Like `os::rmdir(path, true, true, true)` this continues with the
+// remaining entries when some cannot be removed, as it is possible for
+// tasks and isolators to lay down files that are not deletable by GC.
+// In the face of such errors GC needs to free up disk space wherever it
+// can because the disk space has already been re-offered to frameworks.
+static Try<Bytes> removePath(const string& path)
+{
+#ifdef __WINDOWS__
+  Try<Nothing> rmdir = os::rmdir(path, true, true, true);
+  if (rmdir.isError()) {
+    return Error(rmdir.error());
+  }
+
+  return Bytes(0);
+#else
+  struct stat s;
+  if (::lstat(path.c_str(), &s) < 0) {
+    return ErrnoError();
+  }
+
+  Bytes reclaimed;
+  size_t errors = 0;
+
+  if (S_ISDIR(s.st_mode)) {
+    int fd = ::open(
+        path.c_str(), O_RDONLY | O_DIRECTORY | O_NOFOLLOW | O_CLOEXEC);
+
+    if (fd < 0) {
+      return ErrnoError("Failed to open directory");
+    }
+
+    removeContents(fd, path, &reclaimed, &errors);
+
+    if (::rmdir(path.c_str()) < 0 && errno != ENOENT) {
+      LOG(ERROR) << "Failed to delete directory '" << path << "': "
+                 << os::strerror(errno);
+      ++errors;
+    }
+  } else if (::unlink(path.c_str()) < 0 && errno != ENOENT) {
+    return ErrnoError();
+  }
+
+  if (errors > 0) {
+    return Error("Failed to delete " + stringify(errors) + " paths");
+  }
+
+  return reclaimed + Bytes(s.st_blocks * 512);
+#endif // __WINDOWS__
+}
+
+
 GarbageCollectorProcess::Metrics::Metrics(GarbageCollectorProcess *gc)
   : path_removals_succeeded("gc/path_removals_succeeded"),
     path_removals_failed("gc/path_removals_failed"),
@@ -56,11 +316,13 @@ GarbageCollectorProcess::Metrics::Metrics(GarbageCollectorProcess *gc)
       // basically has to be tracked as a member variable, which means we
       // can safely do concurrent reads while the map is being updated.
       return static_cast<double>(gc->paths.size());
-    })
+    }),
+    bytes_reclaimed("gc/bytes_reclaimed")
 {
   process::metrics::add(path_removals_succeeded);
   process::metrics::add(path_removals_failed);
   process::metrics::add(path_removals_pending);
+  process::metrics::add(bytes_reclaimed);
 }
 
 
@@ -68,6 +330,7 @@ GarbageCollectorProcess::Metrics::~Metrics()
 {
   process::metrics::remove(path_removals_succeeded);
   process::metrics::remove(path_removals_failed);
+  process::metrics::remove(bytes_reclaimed);
 
   // Wait for the metric to be removed to protect against asynchronous
   // evaluation referencing a deleted object.
@@ -75,6 +338,20 @@ GarbageCollectorProcess::Metrics::~Metrics()
 }
 
 
+GarbageCollectorProcess::GarbageCollectorProcess(
+    unsigned int maxConcurrentRemovals)
+  : ProcessBase(process::ID::generate("agent-garbage-collector")),
+    metrics(this)
+{
+  CHECK_GT(maxConcurrentRemovals, 0u);
+
+  for (size_t i = 0; i < maxConcurrentRemovals; i++) {
+    workers.push_back(Owned<Executor>(new Executor()));
+    idle.push(i);
+  }
+}
+
+
 GarbageCollectorProcess::~GarbageCollectorProcess()
 {
   foreachvalue (const Owned<PathInfo>& info, paths) {
@@ -163,114 +440,133 @@ Future<bool> GarbageCollectorProcess::unschedule(const string& path)
 void GarbageCollectorProcess::reset()
 {
   Clock::cancel(timer); // Cancel the existing timer, if any.
-  if (!paths.empty()) {
-    Timeout removalTime = (*paths.begin()).first; // Get the first entry.
 
-    timer = delay(removalTime.remaining(), self(), &Self::remove, removalTime);
-  } else {
-    timer = Timer(); // Reset the timer.
+  // Paths stay in `paths` until their removal completes, so skip the
+  // ones that are already queued for removal.
+  foreachpair (const Timeout& removalTime, const Owned<PathInfo>& info, paths) {
+    if (!info->removing) {
+      timer =
+        delay(removalTime.remaining(), self(), &Self::remove, removalTime);
+      return;
+    }
   }
+
+  timer = Timer(); // Reset the timer.
 }
 
 
 void GarbageCollectorProcess::remove(const Timeout& removalTime)
 {
   if (paths.count(removalTime) > 0) {
-    list<Owned<PathInfo>> infos;
-
-    foreach (const Owned<PathInfo> info, paths.get(removalTime)) {
+    foreach (const Owned<PathInfo>& info, paths.get(removalTime)) {
       if (info->removing) {
-        VLOG(1) << "Skipping deletion of '" << info-> path
-                << "'  as it is already in progress";
+        VLOG(1) << "Skipping deletion of '" << info->path
+                << "' as it is already in progress";
         continue;
       }
 
-      infos.push_back(info);
+      queue.push_back(info);
 
       // Set `removing` to signify that the path is being cleaned up.
       info->removing = true;
     }
 
-    Counter _succeeded = metrics.path_removals_succeeded;
-    Counter _failed = metrics.path_removals_failed;
-
-    auto rmdirs = [_succeeded, _failed, infos]() {
-      // Make mutable copies of the counters to work around MESOS-7907.
-      Counter succeeded = _succeeded;
-      Counter failed = _failed;
-
-      foreach (const Owned<PathInfo>& info, infos) {
-        // Run the removal operation with 'continueOnError = true'.
-        // It's possible for tasks and isolators to lay down files
-        // that are not deletable by GC. In the face of such errors
-        // GC needs to free up disk space wherever it can because the
-        // disk space has already been re-offered to frameworks.
-        LOG(INFO) << "Deleting " << info->path;
-        Try<Nothing> rmdir = os::rmdir(info->path, true, true, true);
-
-        if (rmdir.isError()) {
-          LOG(WARNING) << "Failed to delete '" << info->path << "': "
-                       << rmdir.error();
-          info->promise.fail(rmdir.error());
-
-          ++failed;
-        } else {
-          LOG(INFO) << "Deleted '" << info->path << "'";
-          info->promise.set(rmdir.get());
-
-          ++succeeded;
-        }
-      }
-
-      return Nothing();
-    };
-
-    // NOTE: All `rmdirs` calls are dispatched to one executor so that:
-    //   1. They do not block other dispatches (MESOS-6549).
-    //   2. They do not occupy all worker threads (MESOS-7964).
-    executor.execute(rmdirs)
-      .onAny(defer(self(), &Self::_remove, lambda::_1, infos));
+    dispatchRemovals();
   } else {
     // This occurs when either:
     //   1. The path(s) has already been removed (e.g. by prune()).
     //   2. All paths under the removal time were unscheduled.
     LOG(INFO) << "Ignoring gc event at " << removalTime.remaining()
               << " as the paths were already removed, or were unscheduled";
-    reset();
+  }
+
+  reset();
+}
+
+
+void GarbageCollectorProcess::dispatchRemovals()
+{
+  while (!queue.empty() && !idle.empty()) {
+    const Owned<PathInfo> info = queue.front();
+    queue.pop_front();
+
+    const size_t worker = idle.front();
+    idle.pop();
+
+    const string path = info->path;
+
+    workers[worker]->execute([path]() {
+      LOG(INFO) << "Deleting " << path;
+      return removePath(path);
+    })
+      .onAny(defer(self(), &Self::_remove, lambda::_1, worker, info));
   }
 }
 
 
-void  GarbageCollectorProcess::_remove(const Future<Nothing>& result,
-                                       const list<Owned<PathInfo>> infos)
+void GarbageCollectorProcess::_remove(
+    const Future<Try<Bytes>>& result,
+    size_t worker,
+    const Owned<PathInfo>& info)
 {
   CHECK_READY(result);
 
-  // Remove path records from `paths` and `timeouts` data structures.
-  foreach (const Owned<PathInfo>& info, infos) {
-    CHECK(paths.remove(timeouts[info->path], info));
-    CHECK_EQ(timeouts.erase(info->path), 1u);
+  // Remove the path record from `paths` and `timeouts` data structures
+  // before completing the promise, so that an `unschedule` following
+  // the removal returns false.
+  CHECK(paths.remove(timeouts[info->path], info));
+  CHECK_EQ(timeouts.erase(info->path), 1u);
+
+  if (result->isError()) {
+    LOG(WARNING) << "Failed to delete '" << info->path << "': "
+                 << result->error();
+    info->promise.fail(result->error());
+
+    ++metrics.path_removals_failed;
+  } else {
+    LOG(INFO) << "Deleted '" << info->path << "', reclaiming "
+              << result->get();
+    info->promise.set(Nothing());
+
+    ++metrics.path_removals_succeeded;
+    metrics.bytes_reclaimed += result->get().bytes();
   }
 
-  reset();
+  idle.push(worker);
+
+  dispatchRemovals();
 }
 
 
 void GarbageCollectorProcess::prune(const Duration& d)
 {
-  foreach (const Timeout& removalTime, paths.keys()) {
-    if (removalTime.remaining() <= d) {
-      LOG(INFO) << "Pruning directories with remaining removal time "
+  // Pruned paths go ahead of the queued ones, oldest first.
+  std::deque<Owned<PathInfo>> pruned;
+
+  foreachpair (const Timeout& removalTime, const Owned<PathInfo>& info, paths) {
+    if (removalTime.remaining() > d) {
+      break;
+    }
+
+    if (!info->removing) {
+      LOG(INFO) << "Pruning '" << info->path << "' with remaining removal time "
                 << removalTime.remaining();
-      dispatch(self(), &GarbageCollectorProcess::remove, removalTime);
+
+      pruned.push_back(info);
+      info->removing = true;
     }
   }
+
+  queue.insert(queue.begin(), pruned.begin(), pruned.end());
+
+  dispatchRemovals();
+  reset();
 }
 
 
-GarbageCollector::GarbageCollector()
+GarbageCollector::GarbageCollector(unsigned int maxConcurrentRemovals)
 {
-  process = new GarbageCollectorProcess();
+  process = new GarbageCollectorProcess(maxConcurrentRemovals);
   spawn(process);
 }
 
@@ -25,6 +25,8 @@
 #include <stout/duration.hpp>
 #include <stout/nothing.hpp>
 
+#include "slave/constants.hpp"
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -42,7 +44,8 @@ class GarbageCollectorProcess;
 class GarbageCollector
 {
 public:
-  GarbageCollector();
+  explicit GarbageCollector(
+      unsigned int maxConcurrentRemovals = DEFAULT_GC_MAX_CONCURRENT_REMOVALS);
   virtual ~GarbageCollector();
 
   // Schedules the specified path for removal after the specified
@@ -17,8 +17,10 @@
 #ifndef __SLAVE_GC_PROCESS_HPP__
 #define __SLAVE_GC_PROCESS_HPP__
 
-#include <list>
+#include <deque>
+#include <queue>
 #include <string>
+#include <vector>
 
 #include <process/executor.hpp>
 #include <process/future.hpp>
@@ -31,6 +33,7 @@
 #include <process/metrics/counter.hpp>
 #include <process/metrics/gauge.hpp>
 
+#include <stout/bytes.hpp>
 #include <stout/duration.hpp>
 #include <stout/hashmap.hpp>
 #include <stout/multimap.hpp>
@@ -45,9 +48,7 @@ class GarbageCollectorProcess :
     public process::Process<GarbageCollectorProcess>
 {
 public:
-  GarbageCollectorProcess()
-    : ProcessBase(process::ID::generate("agent-garbage-collector")),
-      metrics(this) {}
+  explicit GarbageCollectorProcess(unsigned int maxConcurrentRemovals);
 
   virtual ~GarbageCollectorProcess();
 
@@ -79,13 +80,19 @@ private:
     // This promise tracks the scheduled gc for the path.
     process::Promise<Nothing> promise;
 
+    // Set once the path is queued for removal, after which it can no
+    // longer be unscheduled.
     bool removing = false;
   };
 
-  // Callback for `remove` for bookkeeping after path removal.
+  // Starts removing the queued paths on the idle workers.
+  void dispatchRemovals();
+
+  // Callback for `dispatchRemovals` for bookkeeping after path removal.
   void _remove(
-      const process::Future<Nothing>& result,
-      const std::list<process::Owned<PathInfo>> infos);
+      const process::Future<Try<Bytes>>& result,
+      size_t worker,
+      const process::Owned<PathInfo>& info);
 
   struct Metrics
   {
@@ -95,6 +102,7 @@ private:
     process::metrics::Counter path_removals_succeeded;
     process::metrics::Counter path_removals_failed;
     process::metrics::Gauge path_removals_pending;
+    process::metrics::Counter bytes_reclaimed;
   } metrics;
 
   // Store all the timeouts and corresponding paths to delete.
@@ -108,8 +116,17 @@ private:
 
   process::Timer timer;
 
-  // For executing path removals in a separate actor.
-  process::Executor executor;
+  // Paths whose removal time has come, or that were pruned, waiting
+  // for a worker. Pruned paths are queued at the front so that disk
+  // pressure is relieved before the regular removals proceed.
+  std::deque<process::Owned<PathInfo>> queue;
+
+  // For executing path removals in separate actors, so that they do
+  // not block other dispatches (MESOS-6549) while a bounded number of
+  // them runs concurrently, leaving the remaining worker threads free
+  // (MESOS-7964).
+  std::vector<process::Owned<process::Executor>> workers;
+  std::queue<size_t> idle;
 };
 
 } // namespace slave {
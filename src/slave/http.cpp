@@ -634,6 +634,9 @@ Future<Response> Http::_api(
     case mesos::agent::Call::WAIT_CONTAINER:
       return waitContainer(call, mediaTypes.accept, principal);
 
+    case mesos::agent::Call::WAIT_CONTAINERS:
+      return waitContainers(call, mediaTypes, principal);
+
     case mesos::agent::Call::KILL_CONTAINER:
       return killContainer(call, mediaTypes.accept, principal);
 
@@ -2144,7 +2147,7 @@ Future<JSON::Array> Http::__containers(
 
           metadata->push_back(entry);
           statusFutures.push_back(slave->containerizer->status(containerId));
-          statsFutures.push_back(slave->containerizer->usage(containerId));
+          statsFutures.push_back(slave->containerUsage(containerId));
         }
       }
 
@@ -2202,7 +2205,7 @@ Future<JSON::Array> Http::__containers(
 
         metadata->push_back(entry);
         statusFutures.push_back(slave->containerizer->status(containerId));
-        statsFutures.push_back(slave->containerizer->usage(containerId));
+        statsFutures.push_back(slave->containerUsage(containerId));
       }
 
       return await(await(statusFutures), await(statsFutures)).then(
@@ -2698,23 +2701,8 @@ Future<Response> Http::_waitContainer(
     const Owned<ObjectApprovers>& approvers,
     const bool deprecated) const
 {
-  // Attempt to get the executor associated with this ContainerID.
-  // We only expect to get the executor when waiting upon a nested container
-  // under a container launched via a scheduler. In other cases, we are
-  // waiting on a standalone container (possibly nested).
-  Executor* executor = slave->getExecutor(containerId);
-  if (executor == nullptr) {
-    if (!approvers->approved<action>(containerId)) {
-      return Forbidden();
-    }
-  } else {
-    Framework* framework = slave->getFramework(executor->frameworkId);
-    CHECK_NOTNULL(framework);
-
-    if (!approvers->approved<action>(
-            executor->info, framework->info, containerId)) {
-      return Forbidden();
-    }
+  if (!approveWaitContainer<action>(containerId, approvers)) {
+    return Forbidden();
   }
 
   return slave->containerizer->wait(containerId)
@@ -2788,6 +2776,158 @@ Future<Response> Http::_waitContainer(
 }
 
 
+template <authorization::Action action>
+bool Http::approveWaitContainer(
+    const ContainerID& containerId,
+    const Owned<ObjectApprovers>& approvers) const
+{
+  // Attempt to get the executor associated with this ContainerID.
+  // We only expect to get the executor when waiting upon a nested container
+  // under a container launched via a scheduler. In other cases, we are
+  // waiting on a standalone container (possibly nested).
+  Executor* executor = slave->getExecutor(containerId);
+  if (executor == nullptr) {
+    return approvers->approved<action>(containerId);
+  }
+
+  Framework* framework = slave->getFramework(executor->frameworkId);
+  CHECK_NOTNULL(framework);
+
+  return approvers->approved<action>(
+      executor->info, framework->info, containerId);
+}
+
+
+Future<Response> Http::waitContainers(
+    const mesos::agent::Call& call,
+    const RequestMediaTypes& mediaTypes,
+    const Option<Principal>& principal) const
+{
+  CHECK_EQ(mesos::agent::Call::WAIT_CONTAINERS, call.type());
+  CHECK(call.has_wait_containers());
+
+  LOG(INFO) << "Processing WAIT_CONTAINERS call for "
+            << call.wait_containers().container_ids().size()
+            << " containers";
+
+  return ObjectApprovers::create(
+      slave->authorizer,
+      principal,
+      {WAIT_NESTED_CONTAINER, WAIT_STANDALONE_CONTAINER})
+    .then(defer(
+        slave->self(),
+        [=](const Owned<ObjectApprovers>& approvers) {
+          return _waitContainers(call, mediaTypes, approvers);
+        }));
+}
+
+
+Future<Response> Http::_waitContainers(
+    const mesos::agent::Call& call,
+    const RequestMediaTypes& mediaTypes,
+    const Owned<ObjectApprovers>& approvers) const
+{
+  // Nested containers are authorized like `WAIT_CONTAINER` does it.
+  foreach (const ContainerID& containerId,
+           call.wait_containers().container_ids()) {
+    const bool approved = containerId.has_parent()
+      ? approveWaitContainer<WAIT_NESTED_CONTAINER>(containerId, approvers)
+      : approveWaitContainer<WAIT_STANDALONE_CONTAINER>(
+            containerId, approvers);
+
+    if (!approved) {
+      return Forbidden();
+    }
+  }
+
+  Pipe pipe;
+  Pipe::Writer writer = pipe.writer();
+
+  OK ok;
+  ok.headers["Content-Type"] = stringify(mediaTypes.accept);
+  ok.type = Response::PIPE;
+  ok.reader = pipe.reader();
+
+  // The terminations are always sent as RecordIO records. If a client
+  // sets the 'Accept' header expecting a streaming response,
+  // `messageAccept` would always be set and we use it to serialize the
+  // records, otherwise we use the 'Accept' header like the switchboard
+  // does for `ATTACH_CONTAINER_OUTPUT`.
+  ContentType messageContentType = mediaTypes.accept;
+  if (streamingMediaType(mediaTypes.accept)) {
+    CHECK_SOME(mediaTypes.messageAccept);
+    ok.headers[MESSAGE_CONTENT_TYPE] =
+      stringify(mediaTypes.messageAccept.get());
+    messageContentType = mediaTypes.messageAccept.get();
+  }
+
+  ::recordio::Encoder<v1::agent::Response> encoder(lambda::bind(
+      serialize, messageContentType, lambda::_1));
+
+  // Each termination is written out as soon as the container
+  // terminates, so a client waiting on many containers learns
+  // about every exit without waiting on the others.
+  list<Future<Nothing>> waits;
+  foreach (const ContainerID& containerId,
+           call.wait_containers().container_ids()) {
+    waits.push_back(slave->containerizer->wait(containerId)
+      .then([=](const Option<ContainerTermination>& termination) mutable {
+        mesos::agent::Response response;
+        response.set_type(mesos::agent::Response::WAIT_CONTAINERS);
+
+        mesos::agent::Response::WaitContainers* waitContainers =
+          response.mutable_wait_containers();
+
+        waitContainers->mutable_container_id()->CopyFrom(containerId);
+
+        if (termination.isSome()) {
+          mesos::agent::Response::WaitContainer* waitContainer =
+            waitContainers->mutable_wait_container();
+
+          if (termination->has_status()) {
+            waitContainer->set_exit_status(termination->status());
+          }
+
+          if (termination->has_state()) {
+            waitContainer->set_state(termination->state());
+          }
+
+          if (termination->has_reason()) {
+            waitContainer->set_reason(termination->reason());
+          }
+
+          if (!termination->limited_resources().empty()) {
+            waitContainer->mutable_limitation()->mutable_resources()
+              ->CopyFrom(termination->limited_resources());
+          }
+
+          if (termination->has_message()) {
+            waitContainer->set_message(termination->message());
+          }
+        }
+
+        // NOTE: The write fails if the client has closed the
+        // connection, in which case there is nobody left to notify.
+        writer.write(encoder.encode(evolve(response)));
+
+        return Nothing();
+      }));
+  }
+
+  process::collect(waits)
+    .onAny([writer](const Future<list<Nothing>>& future) mutable {
+      if (future.isReady()) {
+        writer.close();
+        return;
+      }
+
+      writer.fail(future.isFailed() ? future.failure() : "discarded");
+    });
+
+  return ok;
+}
+
+
 Future<Response> Http::killNestedContainer(
     const mesos::agent::Call& call,
     ContentType acceptType,
@@ -266,6 +266,23 @@ private:
       const process::Owned<ObjectApprovers>& approvers,
       const bool deprecated) const;
 
+  process::Future<process::http::Response> waitContainers(
+      const mesos::agent::Call& call,
+      const RequestMediaTypes& mediaTypes,
+      const Option<process::http::authentication::Principal>& principal) const;
+
+  process::Future<process::http::Response> _waitContainers(
+      const mesos::agent::Call& call,
+      const RequestMediaTypes& mediaTypes,
+      const process::Owned<ObjectApprovers>& approvers) const;
+
+  // Returns whether the principal of `approvers` may wait on the
+  // given container.
+  template <authorization::Action action>
+  bool approveWaitContainer(
+      const ContainerID& containerId,
+      const process::Owned<ObjectApprovers>& approvers) const;
+
   process::Future<process::http::Response> killNestedContainer(
       const mesos::agent::Call& call,
       ContentType acceptType,
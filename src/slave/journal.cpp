@@ -0,0 +1,536 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "slave/journal.hpp"
+
+#include <stdint.h>
+#include <string.h>
+
+#include <algorithm>
+#include <vector>
+
+#include <glog/logging.h>
+
+#include <stout/foreach.hpp>
+#include <stout/path.hpp>
+#include <stout/strings.hpp>
+#include <stout/synchronized.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/exists.hpp>
+#include <stout/os/fsync.hpp>
+#include <stout/os/ftruncate.hpp>
+#include <stout/os/mkdir.hpp>
+#include <stout/os/mktemp.hpp>
+#include <stout/os/open.hpp>
+#include <stout/os/read.hpp>
+#include <stout/os/rename.hpp>
+#include <stout/os/rm.hpp>
+#include <stout/os/write.hpp>
+
+#include "slave/constants.hpp"
+#include "slave/paths.hpp"
+
+using std::shared_ptr;
+using std::string;
+using std::vector;
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace state {
+
+namespace {
+
+// Every record starts with the size of the path and of the data of the
+// checkpoint, followed by the checksum of both.
+struct Header
+{
+  uint32_t pathSize;
+  uint32_t dataSize;
+  uint32_t checksum;
+};
+
+
+// CRC-32 (IEEE 802.3), as used by zlib.
+uint32_t crc32(uint32_t crc, const char* data, size_t size)
+{
+  static const vector<uint32_t>* table = []() {
+    vector<uint32_t>* table = new vector<uint32_t>(256);
+
+    for (uint32_t i = 0; i < 256; i++) {
+      uint32_t value = i;
+      for (int bit = 0; bit < 8; bit++) {
+        value = (value & 1) ? (0xEDB88320 ^ (value >> 1)) : (value >> 1);
+      }
+      (*table)[i] = value;
+    }
+
+    return table;
+  }();
+
+  crc = ~crc;
+  for (size_t i = 0; i < size; i++) {
+    crc = (*table)[(crc ^ static_cast<uint8_t>(data[i])) & 0xFF] ^ (crc >> 8);
+  }
+
+  return ~crc;
+}
+
+
+string encode(const string& path, const string& data)
+{
+  Header header;
+  header.pathSize = path.size();
+  header.dataSize = data.size();
+  header.checksum = crc32(
+      crc32(0, path.data(), path.size()), data.data(), data.size());
+
+  string record;
+  record.reserve(sizeof(header) + path.size() + data.size());
+  record.append((const char*) &header, sizeof(header));
+  record.append(path);
+  record.append(data);
+
+  return record;
+}
+
+
+// Replays the records in `contents` into `checkpoints`, and returns
+// the offset of the end of the last valid record.
+size_t replay(const string& contents, hashmap<string, string>* checkpoints)
+{
+  size_t offset = 0;
+
+  while (contents.size() - offset >= sizeof(Header)) {
+    Header header;
+    memcpy(&header, contents.data() + offset, sizeof(header));
+
+    const size_t size =
+      sizeof(header) + (size_t) header.pathSize + (size_t) header.dataSize;
+
+    if (contents.size() - offset < size) {
+      break;
+    }
+
+    const char* path = contents.data() + offset + sizeof(header);
+    const char* data = path + header.pathSize;
+
+    const uint32_t checksum =
+      crc32(crc32(0, path, header.pathSize), data, header.dataSize);
+
+    if (checksum != header.checksum) {
+      break;
+    }
+
+    (*checkpoints)[string(path, header.pathSize)] =
+      string(data, header.dataSize);
+
+    offset += size;
+  }
+
+  return offset;
+}
+
+
+Try<hashmap<string, string>> load(const string& path)
+{
+  Try<string> contents = os::read(path);
+  if (contents.isError()) {
+    return Error("Failed to read '" + path + "': " + contents.error());
+  }
+
+  hashmap<string, string> checkpoints;
+  const size_t offset = replay(contents.get(), &checkpoints);
+
+  // The records following a torn or corrupted one cannot be trusted
+  // either, e.g., a crash might have left a record partially written.
+  if (offset < contents->size()) {
+    LOG(WARNING) << "Discarding " << Bytes(contents->size() - offset)
+                 << " of torn or corrupted records at the end of the"
+                 << " checkpoint journal '" << path << "'";
+
+    Try<int_fd> fd = os::open(path, O_WRONLY | O_CLOEXEC);
+    if (fd.isError()) {
+      return Error("Failed to open '" + path + "': " + fd.error());
+    }
+
+    Try<Nothing> truncate = os::ftruncate(fd.get(), offset);
+    os::close(fd.get());
+
+    if (truncate.isError()) {
+      return Error("Failed to truncate '" + path + "': " + truncate.error());
+    }
+  }
+
+  return checkpoints;
+}
+
+
+// The journals installed by the agent, see `Journal::install()`.
+struct Registry
+{
+  std::mutex mutex;
+  vector<shared_ptr<Journal>> journals;
+};
+
+
+Registry* registry()
+{
+  static Registry* registry = new Registry();
+  return registry;
+}
+
+} // namespace {
+
+
+Try<shared_ptr<Journal>> Journal::open(const string& metaDir)
+{
+  Try<Nothing> mkdir = os::mkdir(metaDir);
+  if (mkdir.isError()) {
+    return Error(
+        "Failed to create directory '" + metaDir + "': " + mkdir.error());
+  }
+
+  const string path = paths::getCheckpointJournalPath(metaDir);
+
+  hashmap<string, string> checkpoints;
+  if (os::exists(path)) {
+    Try<hashmap<string, string>> replayed = load(path);
+    if (replayed.isError()) {
+      return Error(replayed.error());
+    }
+
+    checkpoints = replayed.get();
+  }
+
+  Try<int_fd> fd = os::open(
+      path,
+      O_WRONLY | O_CREAT | O_APPEND | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (fd.isError()) {
+    return Error("Failed to open '" + path + "': " + fd.error());
+  }
+
+  shared_ptr<Journal> journal(new Journal(metaDir, path, fd.get()));
+  journal->checkpoints = checkpoints;
+
+  // Drop the superseded records and the checkpoints of the directories
+  // garbage collected while the agent was down.
+  Try<Nothing> compact = journal->compact();
+  if (compact.isError()) {
+    return Error(
+        "Failed to compact '" + path + "': " + compact.error());
+  }
+
+  LOG(INFO) << "Opened the checkpoint journal '" << path << "' with "
+            << journal->checkpoints.size() << " checkpoints";
+
+  return journal;
+}
+
+
+Try<Nothing> Journal::expand(const string& metaDir)
+{
+  const string path = paths::getCheckpointJournalPath(metaDir);
+
+  if (!os::exists(path)) {
+    return Nothing();
+  }
+
+  Try<hashmap<string, string>> checkpoints = load(path);
+  if (checkpoints.isError()) {
+    return Error(checkpoints.error());
+  }
+
+  LOG(INFO) << "Writing the " << checkpoints->size() << " checkpoints of"
+            << " the checkpoint journal '" << path << "' to their own files";
+
+  foreachpair (const string& relative,
+               const string& data,
+               checkpoints.get()) {
+    const string checkpoint = path::join(metaDir, relative);
+    const string base = Path(checkpoint).dirname();
+
+    // Skip the checkpoints of directories that were garbage collected.
+    if (!os::exists(base)) {
+      continue;
+    }
+
+    Try<string> temp = os::mktemp(path::join(base, "XXXXXX"));
+    if (temp.isError()) {
+      return Error("Failed to create temporary file: " + temp.error());
+    }
+
+    Try<Nothing> write = os::write(temp.get(), data);
+    if (write.isError()) {
+      os::rm(temp.get());
+      return Error(
+          "Failed to write temporary file '" + temp.get() + "': " +
+          write.error());
+    }
+
+    Try<Nothing> rename = os::rename(temp.get(), checkpoint);
+    if (rename.isError()) {
+      os::rm(temp.get());
+      return Error(
+          "Failed to rename '" + temp.get() + "' to '" + checkpoint +
+          "': " + rename.error());
+    }
+  }
+
+  Try<Nothing> rm = os::rm(path);
+  if (rm.isError()) {
+    return Error("Failed to remove '" + path + "': " + rm.error());
+  }
+
+  return Nothing();
+}
+
+
+void Journal::install(const shared_ptr<Journal>& journal)
+{
+  synchronized (registry()->mutex) {
+    registry()->journals.push_back(journal);
+  }
+}
+
+
+void Journal::uninstall(const shared_ptr<Journal>& journal)
+{
+  synchronized (registry()->mutex) {
+    vector<shared_ptr<Journal>>& journals = registry()->journals;
+
+    journals.erase(
+        std::remove(journals.begin(), journals.end(), journal),
+        journals.end());
+  }
+}
+
+
+shared_ptr<Journal> Journal::lookup(const string& path)
+{
+  synchronized (registry()->mutex) {
+    foreach (const shared_ptr<Journal>& journal, registry()->journals) {
+      if (journal->covers(path)) {
+        return journal;
+      }
+    }
+  }
+
+  return nullptr;
+}
+
+
+Journal::Journal(const string& _metaDir, const string& _path, int_fd _fd)
+  : metaDir(_metaDir),
+    path(_path),
+    fd(_fd) {}
+
+
+Journal::~Journal()
+{
+  Try<Nothing> close = os::close(fd);
+  if (close.isError()) {
+    LOG(WARNING) << "Failed to close '" << path << "': " << close.error();
+  }
+}
+
+
+Try<Nothing> Journal::write(const string& checkpoint, const string& data)
+{
+  CHECK(covers(checkpoint));
+
+  const string relative = checkpoint.substr(metaDir.size() + 1);
+  const string record = encode(relative, data);
+
+  synchronized (mutex) {
+    Try<Nothing> write = os::write(fd, record);
+    if (write.isError()) {
+      // Drop whatever part of the record made it to the journal, so
+      // that it does not shadow the records appended after it.
+      os::ftruncate(fd, size.bytes());
+
+      return Error(
+          "Failed to append to '" + path + "': " + write.error());
+    }
+
+    if (checkpoints.contains(relative)) {
+      live -= Bytes(encode(relative, checkpoints.at(relative)).size());
+    }
+
+    checkpoints[relative] = data;
+    size += Bytes(record.size());
+    live += Bytes(record.size());
+
+    __compact();
+  }
+
+  return Nothing();
+}
+
+
+Option<string> Journal::read(const string& checkpoint)
+{
+  CHECK(covers(checkpoint));
+
+  const string relative = checkpoint.substr(metaDir.size() + 1);
+
+  synchronized (mutex) {
+    if (checkpoints.contains(relative)) {
+      return checkpoints.at(relative);
+    }
+  }
+
+  return None();
+}
+
+
+void Journal::remove(const string& directory)
+{
+  if (!strings::startsWith(directory, path::join(metaDir, ""))) {
+    return;
+  }
+
+  const string prefix = path::join(directory.substr(metaDir.size() + 1), "");
+
+  synchronized (mutex) {
+    foreach (const string& relative, checkpoints.keys()) {
+      if (strings::startsWith(relative, prefix)) {
+        live -= Bytes(encode(relative, checkpoints.at(relative)).size());
+        checkpoints.erase(relative);
+      }
+    }
+
+    __compact();
+  }
+}
+
+
+Try<Nothing> Journal::compact()
+{
+  synchronized (mutex) {
+    return _compact();
+  }
+}
+
+
+bool Journal::covers(const string& checkpoint) const
+{
+  if (!strings::startsWith(checkpoint, path::join(metaDir, ""))) {
+    return false;
+  }
+
+  // Only the checkpoints that are solely read back by the agent's own
+  // recovery (see `state::recover()`) are recorded in the journal.
+  const string name = Path(checkpoint).basename();
+
+  return name == paths::SLAVE_INFO_FILE ||
+         name == paths::FRAMEWORK_INFO_FILE ||
+         name == paths::FRAMEWORK_PID_FILE ||
+         name == paths::EXECUTOR_INFO_FILE ||
+         name == paths::FORKED_PID_FILE ||
+         name == paths::LIBPROCESS_PID_FILE ||
+         name == paths::TASK_INFO_FILE;
+}
+
+
+Try<Nothing> Journal::_compact()
+{
+  Try<string> temp = os::mktemp(path + ".XXXXXX");
+  if (temp.isError()) {
+    return Error("Failed to create temporary file: " + temp.error());
+  }
+
+  Bytes _live;
+
+  foreach (const string& relative, checkpoints.keys()) {
+    if (!os::exists(Path(path::join(metaDir, relative)).dirname())) {
+      checkpoints.erase(relative);
+      continue;
+    }
+
+    _live += Bytes(encode(relative, checkpoints.at(relative)).size());
+  }
+
+  Try<int_fd> _fd = os::open(
+      temp.get(),
+      O_WRONLY | O_APPEND | O_CLOEXEC,
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  if (_fd.isError()) {
+    os::rm(temp.get());
+    return Error(
+        "Failed to open '" + temp.get() + "': " + _fd.error());
+  }
+
+  string records;
+  records.reserve(_live.bytes());
+
+  foreachpair (const string& relative, const string& data, checkpoints) {
+    records += encode(relative, data);
+  }
+
+  Try<Nothing> write = os::write(_fd.get(), records);
+  if (write.isSome()) {
+    write = os::fsync(_fd.get());
+  }
+
+  if (write.isError()) {
+    os::close(_fd.get());
+    os::rm(temp.get());
+    return Error(
+        "Failed to write '" + temp.get() + "': " + write.error());
+  }
+
+  Try<Nothing> rename = os::rename(temp.get(), path);
+  if (rename.isError()) {
+    os::close(_fd.get());
+    os::rm(temp.get());
+    return Error(
+        "Failed to rename '" + temp.get() + "' to '" + path + "': " +
+        rename.error());
+  }
+
+  VLOG(1) << "Compacted the checkpoint journal '" << path << "' from "
+          << size << " to " << _live;
+
+  os::close(fd);
+
+  fd = _fd.get();
+  size = _live;
+  live = _live;
+
+  return Nothing();
+}
+
+
+void Journal::__compact()
+{
+  if (size >= CHECKPOINT_JOURNAL_MIN_COMPACTION_SIZE && size > live * 2) {
+    Try<Nothing> compact = _compact();
+    if (compact.isError()) {
+      LOG(WARNING) << "Failed to compact '" << path << "': "
+                   << compact.error();
+    }
+  }
+}
+
+} // namespace state {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,129 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __SLAVE_JOURNAL_HPP__
+#define __SLAVE_JOURNAL_HPP__
+
+#include <memory>
+#include <mutex>
+#include <string>
+
+#include <stout/bytes.hpp>
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+#include <stout/option.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/int_fd.hpp>
+
+namespace mesos {
+namespace internal {
+namespace slave {
+namespace state {
+
+// `Journal` is an append-only log of the checkpoints the agent writes
+// for every framework, executor, run and task (e.g., `task.info` or
+// `forked.pid`) under its meta directory. Recording them in a single
+// file replaces a temporary file, a write and a rename per checkpoint
+// with one append, and lets recovery read them back sequentially.
+//
+// Each record holds the path of the checkpoint, relative to the meta
+// directory, and its contents, protected by a checksum. A torn record
+// at the end of the journal (e.g., after a crash) is discarded during
+// replay, so that a checkpoint is either fully written or not at all,
+// like with the rename-based checkpoints.
+//
+// The journal is compacted once most of it is made of records that
+// were superseded by later ones, or that belong to directories which
+// have since been garbage collected (see `remove()`).
+//
+// Once installed, `state::checkpoint()` writes the checkpoints covered
+// by the journal to it and `state::read()` looks them up in the journal
+// before falling back to the individual files. The existing files are
+// thus read as before until they are superseded, and `expand()` turns
+// a journal back into individual files if it is disabled again.
+class Journal
+{
+public:
+  // Opens the journal in the meta directory, creating it if needed,
+  // and replays its records.
+  static Try<std::shared_ptr<Journal>> open(const std::string& metaDir);
+
+  // Writes the records of the journal in the meta directory, if any,
+  // back to their individual files and removes the journal.
+  static Try<Nothing> expand(const std::string& metaDir);
+
+  // Makes `journal` the one covering the checkpoints under its meta
+  // directory, until it is uninstalled.
+  static void install(const std::shared_ptr<Journal>& journal);
+  static void uninstall(const std::shared_ptr<Journal>& journal);
+
+  // Returns the installed journal covering the checkpoint at `path`,
+  // or `nullptr` if the checkpoint is written to its own file.
+  static std::shared_ptr<Journal> lookup(const std::string& path);
+
+  ~Journal();
+
+  Journal(const Journal& that) = delete;
+  Journal& operator=(const Journal& that) = delete;
+
+  // Records `data` as the contents of the checkpoint at `path`.
+  Try<Nothing> write(const std::string& path, const std::string& data);
+
+  // Returns the contents last recorded for the checkpoint at `path`.
+  Option<std::string> read(const std::string& path);
+
+  // Forgets the checkpoints under `directory`, which has been removed
+  // (e.g., garbage collected), so that their records no longer count
+  // as live and are dropped by the next compaction.
+  void remove(const std::string& directory);
+
+  // Rewrites the journal with only the latest record of each
+  // checkpoint whose directory still exists.
+  Try<Nothing> compact();
+
+private:
+  Journal(const std::string& metaDir, const std::string& path, int_fd fd);
+
+  // Returns whether checkpoints to `path` are recorded in this journal.
+  bool covers(const std::string& path) const;
+
+  Try<Nothing> _compact();
+
+  // Compacts the journal if most of it is made of dead records.
+  void __compact();
+
+  const std::string metaDir;
+  const std::string path;
+  int_fd fd;
+
+  // The latest contents of each checkpoint, keyed by its path relative
+  // to the meta directory.
+  hashmap<std::string, std::string> checkpoints;
+
+  // The size of the journal on disk, and of its latest records.
+  Bytes size;
+  Bytes live;
+
+  std::mutex mutex;
+};
+
+} // namespace state {
+} // namespace slave {
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __SLAVE_JOURNAL_HPP__
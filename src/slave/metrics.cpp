@@ -247,6 +247,11 @@ Metrics::~Metrics()
   if (recovery_time_secs.isSome()) {
     process::metrics::remove(recovery_time_secs.get());
   }
+
+  foreach (const Gauge& gauge, recovery_phase_time_secs) {
+    process::metrics::remove(gauge);
+  }
+  recovery_phase_time_secs.clear();
 }
 
 
@@ -263,6 +268,22 @@ void Metrics::setRecoveryTime(const Duration& duration)
   process::metrics::add(recovery_time_secs.get());
 }
 
+
+void Metrics::setRecoveryPhaseTime(
+    const string& phase,
+    const Duration& duration)
+{
+  const double recovery_seconds = duration.secs();
+
+  Gauge gauge(
+      "slave/recovery/" + phase + "_time_secs",
+      [recovery_seconds]() { return recovery_seconds; });
+
+  recovery_phase_time_secs.push_back(gauge);
+
+  process::metrics::add(gauge);
+}
+
 } // namespace slave {
 } // namespace internal {
 } // namespace mesos {
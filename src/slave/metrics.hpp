@@ -17,6 +17,7 @@
 #ifndef __SLAVE_METRICS_HPP__
 #define __SLAVE_METRICS_HPP__
 
+#include <string>
 #include <vector>
 
 #include <process/metrics/counter.hpp>
@@ -37,12 +38,17 @@ struct Metrics
 
   void setRecoveryTime(const Duration& duration);
 
+  void setRecoveryPhaseTime(const std::string& phase, const Duration& duration);
+
   process::metrics::Gauge uptime_secs;
   process::metrics::Gauge registered;
 
   process::metrics::Counter recovery_errors;
   Option<process::metrics::Gauge> recovery_time_secs;
 
+  // Time spent in each phase of the agent recovery.
+  std::vector<process::metrics::Gauge> recovery_phase_time_secs;
+
   process::metrics::Gauge frameworks_active;
 
   process::metrics::Gauge tasks_staging;
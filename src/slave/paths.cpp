@@ -66,6 +66,7 @@ const char RESOURCES_INFO_FILE[] = "resources.info";
 const char RESOURCES_TARGET_FILE[] = "resources.target";
 const char RESOURCE_PROVIDER_STATE_FILE[] = "resource_provider.state";
 const char OPERATION_UPDATES_FILE[] = "operation.updates";
+const char CHECKPOINT_JOURNAL_FILE[] = "checkpoints.journal";
 
 
 const char CONTAINERS_DIR[] = "containers";
@@ -155,6 +156,12 @@ string getBootIdPath(const string& rootDir)
 }
 
 
+string getCheckpointJournalPath(const string& rootDir)
+{
+  return path::join(rootDir, CHECKPOINT_JOURNAL_FILE);
+}
+
+
 string getLatestSlavePath(const string& rootDir)
 {
   return path::join(rootDir, SLAVES_DIR, LATEST_SYMLINK);
@@ -155,6 +155,9 @@ std::string getLatestSlavePath(const std::string& rootDir);
 std::string getBootIdPath(const std::string& rootDir);
 
 
+std::string getCheckpointJournalPath(const std::string& rootDir);
+
+
 std::string getSlaveInfoPath(
     const std::string& rootDir,
     const SlaveID& slaveId);
@@ -419,8 +422,14 @@ std::string createResourceProviderDirectory(
     const ResourceProviderID& resourceProviderId);
 
 
+extern const char SLAVE_INFO_FILE[];
+extern const char FRAMEWORK_PID_FILE[];
+extern const char FRAMEWORK_INFO_FILE[];
 extern const char LIBPROCESS_PID_FILE[];
+extern const char EXECUTOR_INFO_FILE[];
 extern const char HTTP_MARKER_FILE[];
+extern const char FORKED_PID_FILE[];
+extern const char TASK_INFO_FILE[];
 
 } // namespace paths {
 } // namespace slave {
@@ -157,6 +157,7 @@ using process::Owned;
 using process::PID;
 using process::Time;
 using process::UPID;
+using process::undiscardable;
 
 using process::http::authentication::Principal;
 
@@ -244,6 +245,10 @@ Slave::~Slave()
   }
 
   delete authenticatee;
+
+  if (journal != nullptr) {
+    state::Journal::uninstall(journal);
+  }
 }
 
 
@@ -912,7 +917,28 @@ void Slave::initialize()
   }
 #endif  // __WINDOWS__
 
+  // Checkpoints are read back from the journal during recovery, so it
+  // is set up (or written back to individual files) beforehand.
+  if (flags.checkpoint_journal) {
+    Try<shared_ptr<state::Journal>> open = state::Journal::open(metaDir);
+    if (open.isError()) {
+      EXIT(EXIT_FAILURE)
+        << "Failed to open the checkpoint journal: " << open.error();
+    }
+
+    journal = open.get();
+    state::Journal::install(journal);
+  } else {
+    Try<Nothing> expand = state::Journal::expand(metaDir);
+    if (expand.isError()) {
+      EXIT(EXIT_FAILURE)
+        << "Failed to expand the checkpoint journal: " << expand.error();
+    }
+  }
+
   // Do recovery.
+  recoveryPhaseStartTime = Clock::now();
+
   async(&state::recover, metaDir, flags.strict)
     .then(defer(self(), &Slave::recover, lambda::_1))
     .then(defer(self(), &Slave::_recover))
@@ -6811,11 +6837,20 @@ void Slave::_checkImageDiskUsage(const Future<double>& usage)
               << std::setiosflags(std::ios::fixed) << std::setprecision(2)
               << 100 * usage.get() << "%.";
 
-    if ((flags.image_gc_config->image_disk_headroom() + usage.get()) > 1.0) {
+    const bool exceeded =
+      (flags.image_gc_config->image_disk_headroom() + usage.get()) > 1.0;
+
+    if (exceeded) {
       LOG(INFO) << "Image store disk usage exceeds the threshold '"
                 << 100 * (1.0 - flags.image_gc_config->image_disk_headroom())
                 << "%'. Container Image GC is triggered.";
+    }
 
+    // NOTE: If the size of the docker store is bounded, the store only
+    // removes images when it exceeds that size, so we always trigger
+    // the garbage collection. The store logs what it reclaimed, if
+    // anything, rather than logging here at every interval.
+    if (exceeded || flags.docker_store_max_size.isSome()) {
       vector<Image> excludedImages(
           flags.image_gc_config->excluded_images().begin(),
           flags.image_gc_config->excluded_images().end());
@@ -6834,6 +6869,8 @@ void Slave::_checkImageDiskUsage(const Future<double>& usage)
 
 Future<Nothing> Slave::recover(const Try<state::State>& state)
 {
+  recoveryPhaseCompleted("state");
+
   if (state.isError()) {
     return Failure(state.error());
   }
@@ -7058,12 +7095,16 @@ Future<Nothing> Slave::recover(const Try<state::State>& state)
 Future<Nothing> Slave::_recoverContainerizer(
     const Option<state::SlaveState>& state)
 {
+  recoveryPhaseCompleted("frameworks");
+
   return containerizer->recover(state);
 }
 
 
 Future<Nothing> Slave::_recover()
 {
+  recoveryPhaseCompleted("containerizer");
+
   // Alow HTTP based executors to subscribe after the
   // containerizer recovery is complete.
   recoveryInfo.reconnect = true;
@@ -7217,6 +7258,8 @@ void Slave::__recover(const Future<Nothing>& future)
 
   LOG(INFO) << "Finished recovery";
 
+  recoveryPhaseCompleted("executors");
+
   CHECK_EQ(RECOVERING, state);
 
   // Checkpoint boot ID.
@@ -7286,6 +7329,11 @@ void Slave::__recover(const Future<Nothing>& future)
 
     // Start acting on correction from QoS Controller.
     qosCorrections();
+
+    // Start sampling the resource usage periodically if requested.
+    if (flags.usage_sampling_interval > Duration::zero()) {
+      sampleUsage();
+    }
   } else {
     // Slave started in cleanup mode.
     CHECK_EQ("cleanup", flags.recover);
@@ -7399,7 +7447,19 @@ Future<Nothing> Slave::garbageCollect(const string& path)
   // GC based on the modification time.
   Duration delay = flags.gc_delay - (Clock::now() - time.get());
 
-  return gc->schedule(delay, path);
+  Future<Nothing> removed = gc->schedule(delay, path);
+
+  // The journaled checkpoints of garbage collected meta directories are
+  // dead, as nothing supersedes them (e.g., those of a finished task).
+  if (journal != nullptr) {
+    const shared_ptr<state::Journal> _journal = journal;
+
+    removed.onReady([_journal, path]() {
+      _journal->remove(path);
+    });
+  }
+
+  return removed;
 }
 
 
@@ -8240,6 +8300,70 @@ void Slave::_qosCorrections(const Future<list<QoSCorrection>>& future)
 
 
 Future<ResourceUsage> Slave::usage()
+{
+  // Share the latest sample if it is still being collected or it is
+  // recent enough.
+  if (usageSample.isSome() &&
+      (usageSample->isPending() ||
+       (usageSample->isReady() &&
+        Clock::now() - usageSampleTime < flags.usage_sampling_interval))) {
+    return undiscardable(usageSample.get());
+  }
+
+  usageSampleTime = Clock::now();
+  usageSample = _usage()
+    .onReady(defer(self(), &Self::__usage, lambda::_1, usageSampleTime));
+
+  // The sample is shared, so no consumer gets to discard it.
+  return undiscardable(usageSample.get());
+}
+
+
+Future<ResourceStatistics> Slave::containerUsage(
+    const ContainerID& containerId)
+{
+  if (collectedUsageSample.isSome() &&
+      Clock::now() - collectedUsageSample->time <
+        flags.usage_sampling_interval &&
+      collectedUsageSample->index.contains(containerId)) {
+    const ResourceUsage::Executor& executor =
+      collectedUsageSample->usage.executors(
+          collectedUsageSample->index.at(containerId));
+
+    if (executor.has_statistics()) {
+      return executor.statistics();
+    }
+  }
+
+  return containerizer->usage(containerId);
+}
+
+
+void Slave::__usage(const ResourceUsage& usage, const Time& time)
+{
+  CollectedUsageSample sample;
+  sample.usage = usage;
+  sample.time = time;
+
+  for (int i = 0; i < usage.executors_size(); i++) {
+    sample.index[usage.executors(i).container_id()] = i;
+  }
+
+  collectedUsageSample = sample;
+}
+
+
+void Slave::sampleUsage()
+{
+  // NOTE: If the collection of a sample takes longer than the sampling
+  // interval, the next round shares it instead of starting another one.
+  usage();
+
+  delay(flags.usage_sampling_interval, self(), &Self::sampleUsage);
+}
+
+
+Future<ResourceUsage> Slave::_usage()
 {
   // NOTE: We use 'Owned' here trying to avoid the expensive copy.
   // C++11 lambda only supports capturing variables that have copy
@@ -8307,6 +8431,18 @@ Future<ResourceUsage> Slave::usage()
 }
 
 
+void Slave::recoveryPhaseCompleted(const string& phase)
+{
+  const Time now = Clock::now();
+
+  VLOG(1) << "Finished the '" << phase << "' phase of the recovery in "
+          << now - recoveryPhaseStartTime;
+
+  metrics.setRecoveryPhaseTime(phase, now - recoveryPhaseStartTime);
+  recoveryPhaseStartTime = now;
+}
+
+
 // As a principle, we do not need to re-authorize actions that have already
 // been authorized by the master. However, we re-authorize the RUN_TASK action
 // on the agent even though the master has already authorized it because:
@@ -570,9 +570,19 @@ public:
       const process::Future<std::list<
           mesos::slave::QoSCorrection>>& correction);
 
-  // Returns the resource usage information for all executors.
+  // Returns the resource usage information for all executors. All the
+  // consumers (e.g., the resource estimator, the QoS controller and the
+  // '/monitor/statistics' endpoint) share the latest sample while it is
+  // younger than `--usage_sampling_interval`, as well as a sample which
+  // is still being collected.
   virtual process::Future<ResourceUsage> usage();
 
+  // Returns the resource statistics of the container from the latest
+  // resource usage sample if it is still fresh, or from the
+  // containerizer otherwise.
+  process::Future<ResourceStatistics> containerUsage(
+      const ContainerID& containerId);
+
   // Handle the second phase of shutting down an executor for those
   // executors that have not properly shutdown within a timeout.
   void shutdownExecutorTimeout(
@@ -593,6 +603,21 @@ private:
   void _authenticate();
   void authenticationTimeout(process::Future<bool> future);
 
+  // Records the time spent in the phase of the agent recovery which
+  // just completed, and starts the next phase.
+  void recoveryPhaseCompleted(const std::string& phase);
+
+  // Collects a new resource usage sample.
+  process::Future<ResourceUsage> _usage();
+
+  // Records a collected resource usage sample, whose collection
+  // started at the given time.
+  void __usage(const ResourceUsage& usage, const process::Time& time);
+
+  // Periodically samples the resource usage, so that the consumers
+  // are always served with a recent sample.
+  void sampleUsage();
+
   // Process creation of persistent volumes (for CREATE) and/or deletion
   // of persistent volumes (for DESTROY) as a part of handling
   // checkpointed resources, and commit the checkpointed resources on
@@ -747,6 +772,9 @@ private:
 
   process::Time startTime;
 
+  // The time the current phase of the agent recovery started.
+  process::Time recoveryPhaseStartTime;
+
   GarbageCollector* gc;
 
   TaskStatusUpdateManager* taskStatusUpdateManager;
@@ -767,6 +795,10 @@ private:
   // Root meta directory containing checkpointed data.
   const std::string metaDir;
 
+  // Journal of the checkpoints under `metaDir`, if enabled with
+  // `--checkpoint_journal`.
+  std::shared_ptr<state::Journal> journal;
+
   // Indicates the number of errors ignored in "--no-strict" recovery mode.
   unsigned int recoveryErrors;
 
@@ -807,6 +839,24 @@ private:
   // (allocated and oversubscribable) resources.
   Option<Resources> oversubscribedResources;
 
+  // The latest resource usage sample, which might still be collected,
+  // and the time its collection started.
+  Option<process::Future<ResourceUsage>> usageSample;
+  process::Time usageSampleTime;
+
+  // The latest collected resource usage sample, with the time its
+  // collection started and the index of its executors by container ID.
+  // These are replaced together, so that the index always matches the
+  // sample it is read from.
+  struct CollectedUsageSample
+  {
+    ResourceUsage usage;
+    process::Time time;
+    hashmap<ContainerID, int> index;
+  };
+
+  Option<CollectedUsageSample> collectedUsageSample;
+
   ResourceProviderManager resourceProviderManager;
   process::Owned<LocalResourceProviderDaemon> localResourceProviderDaemon;
 
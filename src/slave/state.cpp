@@ -16,7 +16,11 @@
 
 #include <glog/logging.h>
 
+#include <algorithm>
+#include <atomic>
 #include <iostream>
+#include <thread>
+#include <vector>
 
 #include <process/pid.hpp>
 
@@ -48,6 +52,7 @@
 
 #include "messages/messages.hpp"
 
+#include "slave/constants.hpp"
 #include "slave/paths.hpp"
 #include "slave/state.hpp"
 
@@ -59,6 +64,7 @@ namespace state {
 using std::list;
 using std::max;
 using std::string;
+using std::vector;
 
 
 Try<State> recover(const string& rootDir, bool strict)
@@ -144,7 +150,7 @@ Try<SlaveState> SlaveState::recover(
 
   // Read the slave info.
   const string& path = paths::getSlaveInfoPath(rootDir, slaveId);
-  if (!os::exists(path)) {
+  if (!state::exists(path)) {
     // This could happen if the slave died before it registered with
     // the master.
     LOG(WARNING) << "Failed to find agent info file '" << path << "'";
@@ -215,7 +221,7 @@ Try<FrameworkState> FrameworkState::recover(
 
   // Read the framework info.
   string path = paths::getFrameworkInfoPath(rootDir, slaveId, frameworkId);
-  if (!os::exists(path)) {
+  if (!state::exists(path)) {
     // This could happen if the slave died after creating the
     // framework directory but before it checkpointed the framework
     // info.
@@ -249,7 +255,7 @@ Try<FrameworkState> FrameworkState::recover(
 
   // Read the framework pid.
   path = paths::getFrameworkPidPath(rootDir, slaveId, frameworkId);
-  if (!os::exists(path)) {
+  if (!state::exists(path)) {
     // This could happen if the slave died after creating the
     // framework info but before it checkpointed the framework pid.
     LOG(WARNING) << "Failed to framework pid file '" << path << "'";
@@ -290,13 +296,45 @@ Try<FrameworkState> FrameworkState::recover(
         ": " + executors.error());
   }
 
-  // Recover the executors.
+  vector<ExecutorID> executorIds;
   foreach (const string& path, executors.get()) {
     ExecutorID executorId;
     executorId.set_value(Path(path).basename());
+    executorIds.push_back(executorId);
+  }
+
+  // Recover the executors. Recovering an executor mostly consists of
+  // reading the many small checkpoint files of its runs and tasks, so
+  // the executors are recovered concurrently by a bounded number of
+  // threads to overlap the I/O.
+  vector<Option<Try<ExecutorState>>> recovered(executorIds.size());
+  std::atomic<size_t> next(0);
+
+  auto recoverExecutors = [&]() {
+    for (size_t i = next++; i < executorIds.size(); i = next++) {
+      recovered[i] = ExecutorState::recover(
+          rootDir, slaveId, frameworkId, executorIds[i], strict);
+    }
+  };
+
+  const size_t concurrency = std::min(
+      MAX_CONCURRENT_EXECUTOR_RECOVERIES,
+      executorIds.size());
 
-    Try<ExecutorState> executor =
-      ExecutorState::recover(rootDir, slaveId, frameworkId, executorId, strict);
+  vector<std::thread> threads;
+  for (size_t i = 1; i < concurrency; i++) {
+    threads.emplace_back(recoverExecutors);
+  }
+
+  recoverExecutors();
+
+  foreach (std::thread& thread, threads) {
+    thread.join();
+  }
+
+  for (size_t i = 0; i < executorIds.size(); i++) {
+    const ExecutorID& executorId = executorIds[i];
+    const Try<ExecutorState>& executor = recovered[i].get();
 
     if (executor.isError()) {
       return Error("Failed to recover executor '" + executorId.value() +
@@ -382,7 +420,7 @@ Try<ExecutorState> ExecutorState::recover(
   // Read the executor info.
   const string& path =
     paths::getExecutorInfoPath(rootDir, slaveId, frameworkId, executorId);
-  if (!os::exists(path)) {
+  if (!state::exists(path)) {
     // This could happen if the slave died after creating the executor
     // directory but before it checkpointed the executor info.
     LOG(WARNING) << "Failed to find executor info file '" << path << "'";
@@ -472,7 +510,7 @@ Try<RunState> RunState::recover(
   // Read the forked pid.
   path = paths::getForkedPidPath(
       rootDir, slaveId, frameworkId, executorId, containerId);
-  if (!os::exists(path)) {
+  if (!state::exists(path)) {
     // This could happen if the slave died before the isolator
     // checkpointed the forked pid.
     LOG(WARNING) << "Failed to find executor forked pid file '" << path << "'";
@@ -514,7 +552,7 @@ Try<RunState> RunState::recover(
   path = paths::getLibprocessPidPath(
       rootDir, slaveId, frameworkId, executorId, containerId);
 
-  if (os::exists(path)) {
+  if (state::exists(path)) {
     pid = state::read<string>(path);
 
     if (pid.isError()) {
@@ -579,7 +617,7 @@ Try<TaskState> TaskState::recover(
   // Read the task info.
   string path = paths::getTaskInfoPath(
       rootDir, slaveId, frameworkId, executorId, containerId, taskId);
-  if (!os::exists(path)) {
+  if (!state::exists(path)) {
     // This could happen if the slave died after creating the task
     // directory but before it checkpointed the task info.
     LOG(WARNING) << "Failed to find task info file '" << path << "'";
@@ -21,6 +21,11 @@
 #include <unistd.h>
 #endif // __WINDOWS__
 
+#include <stdint.h>
+#include <string.h>
+
+#include <memory>
+#include <string>
 #include <vector>
 
 #include <mesos/resources.hpp>
@@ -36,6 +41,7 @@
 #include <stout/utils.hpp>
 #include <stout/uuid.hpp>
 
+#include <stout/os/exists.hpp>
 #include <stout/os/mkdir.hpp>
 #include <stout/os/mktemp.hpp>
 #include <stout/os/rename.hpp>
@@ -46,6 +52,8 @@
 
 #include "messages/messages.hpp"
 
+#include "slave/journal.hpp"
+
 namespace mesos {
 namespace internal {
 namespace slave {
@@ -74,13 +82,107 @@ struct TaskState;
 Try<State> recover(const std::string& rootDir, bool strict);
 
 
+// Returns whether there is a checkpoint at the given path, either in
+// its own file or in the agent's checkpoint journal.
+inline bool exists(const std::string& path)
+{
+  std::shared_ptr<Journal> journal = Journal::lookup(path);
+  if (journal != nullptr && journal->read(path).isSome()) {
+    return true;
+  }
+
+  return os::exists(path);
+}
+
+
+namespace internal {
+
+// Parses the contents of a checkpoint recorded in the checkpoint
+// journal, which use the same framing as `::protobuf::write()`.
+template <typename T>
+struct Parse
+{
+  static Result<T> parse(const std::string& data)
+  {
+    if (data.empty()) {
+      return None();
+    }
+
+    uint32_t size;
+    if (data.size() < sizeof(size)) {
+      return Error("Failed to read size: unexpected end of data");
+    }
+
+    memcpy(&size, data.data(), sizeof(size));
+
+    if (data.size() - sizeof(size) < size) {
+      return Error("Failed to read message: unexpected end of data");
+    }
+
+    T message;
+    if (!message.ParseFromArray(data.data() + sizeof(size), size)) {
+      return Error("Failed to deserialize " + message.GetDescriptor()->name());
+    }
+
+    return message;
+  }
+};
+
+
+template <typename T>
+struct Parse<google::protobuf::RepeatedPtrField<T>>
+{
+  static Result<google::protobuf::RepeatedPtrField<T>> parse(
+      const std::string& data)
+  {
+    google::protobuf::RepeatedPtrField<T> messages;
+
+    size_t offset = 0;
+    while (offset < data.size()) {
+      uint32_t size;
+      if (data.size() - offset < sizeof(size)) {
+        return Error("Failed to read size: unexpected end of data");
+      }
+
+      memcpy(&size, data.data() + offset, sizeof(size));
+
+      Result<T> message = Parse<T>::parse(
+          data.substr(offset, sizeof(size) + size));
+
+      if (message.isError()) {
+        return Error(message.error());
+      }
+
+      CHECK_SOME(message);
+
+      messages.Add()->CopyFrom(message.get());
+      offset += sizeof(size) + size;
+    }
+
+    return messages;
+  }
+};
+
+} // namespace internal {
+
+
 // Reads the protobuf message(s) from the given path.
 // `T` may be either a single protobuf message or a sequence of messages
 // if `T` is a specialization of `google::protobuf::RepeatedPtrField`.
 template <typename T>
 Result<T> read(const std::string& path)
 {
-  Result<T> result = ::protobuf::read<T>(path);
+  Option<std::string> journaled;
+
+  std::shared_ptr<Journal> journal = Journal::lookup(path);
+  if (journal != nullptr) {
+    journaled = journal->read(path);
+  }
+
+  Result<T> result = journaled.isSome()
+    ? internal::Parse<T>::parse(journaled.get())
+    : ::protobuf::read<T>(path);
+
   if (result.isSome()) {
     upgradeResources(&result.get());
   }
@@ -96,6 +198,14 @@ Result<T> read(const std::string& path)
 template <>
 inline Result<std::string> read<std::string>(const std::string& path)
 {
+  std::shared_ptr<Journal> journal = Journal::lookup(path);
+  if (journal != nullptr) {
+    Option<std::string> journaled = journal->read(path);
+    if (journaled.isSome()) {
+      return journaled.get();
+    }
+  }
+
   return os::read(path);
 }
 
@@ -128,6 +238,63 @@ inline Try<Nothing> checkpoint(
 }
 
 
+// Serializes a checkpoint for the checkpoint journal, into the same
+// bytes `checkpoint()` would write to its own file.
+inline Try<std::string> serialize(const std::string& message)
+{
+  return message;
+}
+
+
+template <
+    typename T,
+    typename std::enable_if<
+        std::is_convertible<T*, google::protobuf::Message*>::value,
+        int>::type = 0>
+inline Try<std::string> serialize(T message)
+{
+  downgradeResources(&message);
+
+  if (!message.IsInitialized()) {
+    return Error(message.InitializationErrorString() +
+                 " is required but not initialized");
+  }
+
+  const uint32_t size = message.ByteSize();
+
+  std::string data((char*) &size, sizeof(size));
+  message.AppendToString(&data);
+
+  return data;
+}
+
+
+template <typename T>
+inline Try<std::string> serialize(google::protobuf::RepeatedPtrField<T> messages)
+{
+  downgradeResources(&messages);
+
+  std::string data;
+  foreach (const T& message, messages) {
+    Try<std::string> serialized = serialize(message);
+    if (serialized.isError()) {
+      return Error(serialized.error());
+    }
+
+    data += serialized.get();
+  }
+
+  return data;
+}
+
+
+inline Try<std::string> serialize(const Resources& resources)
+{
+  const google::protobuf::RepeatedPtrField<Resource>& messages = resources;
+  return serialize(messages);
+}
+
+
 template <
     typename T,
     typename std::enable_if<
@@ -188,10 +355,15 @@ inline Try<Nothing> checkpoint(
 // NOTE: We provide atomic (all-or-nothing) semantics here by always
 // writing to a temporary file first then using os::rename to atomically
 // move it to the desired path.
+//
+// If the agent's checkpoint journal covers the path, the checkpoint is
+// appended to the journal instead, which provides the same semantics.
 template <typename T>
 Try<Nothing> checkpoint(const std::string& path, const T& t)
 {
-  // Create the base directory.
+  // Create the base directory. This is done for journaled checkpoints
+  // too, since recovery discovers frameworks, executors, runs and tasks
+  // by listing their directories.
   std::string base = Path(path).dirname();
 
   Try<Nothing> mkdir = os::mkdir(base);
@@ -199,6 +371,16 @@ Try<Nothing> checkpoint(const std::string& path, const T& t)
     return Error("Failed to create directory '" + base + "': " + mkdir.error());
   }
 
+  std::shared_ptr<Journal> journal = Journal::lookup(path);
+  if (journal != nullptr) {
+    Try<std::string> data = internal::serialize(t);
+    if (data.isError()) {
+      return Error("Failed to serialize checkpoint: " + data.error());
+    }
+
+    return journal->write(path, data.get());
+  }
+
   // NOTE: We create the temporary file at 'base/XXXXXX' to make sure
   // rename below does not cross devices (MESOS-2319).
   //
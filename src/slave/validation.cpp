@@ -532,6 +532,29 @@ Option<Error> validate(
     case mesos::agent::Call::PRUNE_IMAGES: {
       return None();
     }
+
+    case mesos::agent::Call::WAIT_CONTAINERS: {
+      if (!call.has_wait_containers()) {
+        return Error("Expecting 'wait_containers' to be present");
+      }
+
+      if (call.wait_containers().container_ids().empty()) {
+        return Error("Expecting 'wait_containers.container_ids' to be present");
+      }
+
+      foreach (const ContainerID& containerId,
+               call.wait_containers().container_ids()) {
+        Option<Error> error =
+          validation::container::validateContainerId(containerId);
+
+        if (error.isSome()) {
+          return Error("'wait_containers.container_ids' is invalid"
+                       ": " + error->message);
+        }
+      }
+
+      return None();
+    }
   }
 
   UNREACHABLE();
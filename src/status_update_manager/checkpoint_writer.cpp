@@ -0,0 +1,140 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#include "status_update_manager/checkpoint_writer.hpp"
+
+#include <utility>
+
+#include <glog/logging.h>
+
+#include <process/dispatch.hpp>
+#include <process/id.hpp>
+
+#include <stout/foreach.hpp>
+#include <stout/try.hpp>
+
+#include <stout/os/close.hpp>
+#include <stout/os/fsync.hpp>
+#include <stout/os/write.hpp>
+
+using std::string;
+using std::vector;
+
+using process::Future;
+using process::Owned;
+using process::Promise;
+
+namespace mesos {
+namespace internal {
+
+CheckpointWriterProcess::CheckpointWriterProcess()
+  : ProcessBase(process::ID::generate("status-update-checkpoint-writer")),
+    scheduled(false) {}
+
+
+Future<Nothing> CheckpointWriterProcess::write(
+    const int_fd& fd,
+    const string& path,
+    const string& data)
+{
+  Write write;
+  write.fd = fd;
+  write.path = path;
+  write.data = data;
+  write.promise.reset(new Promise<Nothing>());
+
+  Future<Nothing> future = write.promise->future();
+
+  writes.push_back(std::move(write));
+
+  // Any writes dispatched to us while this one was queued are already
+  // ahead of the flush in our mailbox, so they will join this batch.
+  if (!scheduled) {
+    scheduled = true;
+    dispatch(self(), &Self::flush);
+  }
+
+  return future;
+}
+
+
+void CheckpointWriterProcess::close(const int_fd& fd, const string& path)
+{
+  // Make sure the writes queued for the file land before closing it.
+  flush();
+
+  errors.erase(fd);
+
+  Try<Nothing> close = os::close(fd);
+  if (close.isError()) {
+    LOG(WARNING) << "Failed to close '" << path << "': " << close.error();
+  }
+}
+
+
+void CheckpointWriterProcess::flush()
+{
+  scheduled = false;
+
+  if (writes.empty()) {
+    return;
+  }
+
+  vector<Write> batch;
+  std::swap(batch, writes);
+
+  // Write out the whole batch first, so that a file with several
+  // records in the batch is only synced once.
+  hashmap<int_fd, string> written;
+  foreach (const Write& write, batch) {
+    if (errors.contains(write.fd)) {
+      continue;
+    }
+
+    Try<Nothing> result = os::write(write.fd, write.data);
+    if (result.isError()) {
+      errors[write.fd] =
+        "Failed to write to file '" + write.path + "': " + result.error();
+      continue;
+    }
+
+    written[write.fd] = write.path;
+  }
+
+  foreachpair (const int_fd& fd, const string& path, written) {
+    if (errors.contains(fd)) {
+      continue;
+    }
+
+    Try<Nothing> fsync = os::fsync(fd);
+    if (fsync.isError()) {
+      errors[fd] = "Failed to sync file '" + path + "': " + fsync.error();
+    }
+  }
+
+  foreach (Write& write, batch) {
+    if (errors.contains(write.fd)) {
+      write.promise->fail(errors.at(write.fd));
+    } else {
+      write.promise->set(Nothing());
+    }
+  }
+
+  VLOG(2) << "Flushed " << batch.size() << " status update checkpoint writes";
+}
+
+} // namespace internal {
+} // namespace mesos {
@@ -0,0 +1,92 @@
+// Licensed to the Apache Software Foundation (ASF) under one
+// or more contributor license agreements.  See the NOTICE file
+// distributed with this work for additional information
+// regarding copyright ownership.  The ASF licenses this file
+// to you under the Apache License, Version 2.0 (the
+// "License"); you may not use this file except in compliance
+// with the License.  You may obtain a copy of the License at
+//
+//     http://www.apache.org/licenses/LICENSE-2.0
+//
+// Unless required by applicable law or agreed to in writing, software
+// distributed under the License is distributed on an "AS IS" BASIS,
+// WITHOUT WARRANTIES OR CONDITIONS OF ANY KIND, either express or implied.
+// See the License for the specific language governing permissions and
+// limitations under the License.
+
+#ifndef __STATUS_UPDATE_MANAGER_CHECKPOINT_WRITER_HPP__
+#define __STATUS_UPDATE_MANAGER_CHECKPOINT_WRITER_HPP__
+
+#include <string>
+#include <vector>
+
+#include <process/future.hpp>
+#include <process/owned.hpp>
+#include <process/process.hpp>
+
+#include <stout/hashmap.hpp>
+#include <stout/nothing.hpp>
+
+#include <stout/os/int_fd.hpp>
+
+namespace mesos {
+namespace internal {
+
+// `CheckpointWriterProcess` appends records to status update stream files
+// off the status update manager's actor, and makes them durable with group
+// commits: all the writes queued while a batch is being flushed are written
+// out together and each file is synced once per batch, instead of once per
+// record.
+//
+// Writes to a file are made durable in the order in which they were queued.
+// Once a write to a file fails, all subsequent writes to it fail as well so
+// that no record is ever appended after a partially written one.
+class CheckpointWriterProcess : public process::Process<CheckpointWriterProcess>
+{
+public:
+  CheckpointWriterProcess();
+
+  CheckpointWriterProcess(const CheckpointWriterProcess& that) = delete;
+  CheckpointWriterProcess& operator=(
+      const CheckpointWriterProcess& that) = delete;
+
+  // Appends `data` to the file open as `fd`. The returned future is
+  // satisfied once `data`, and everything written to the file before it,
+  // has been synced to disk.
+  process::Future<Nothing> write(
+      const int_fd& fd,
+      const std::string& path,
+      const std::string& data);
+
+  // Closes `fd` once all of the writes queued for it have been flushed.
+  //
+  // NOTE: Files written through the writer must be closed through it as
+  // well, as this is when it forgets that writes to `fd` failed, which
+  // must happen before the descriptor can be reused.
+  void close(const int_fd& fd, const std::string& path);
+
+private:
+  struct Write
+  {
+    int_fd fd;
+    std::string path;
+    std::string data;
+    process::Owned<process::Promise<Nothing>> promise;
+  };
+
+  void flush();
+
+  // Writes queued since the last flush.
+  std::vector<Write> writes;
+
+  // Whether a flush of `writes` has been dispatched already.
+  bool scheduled;
+
+  // Files which can no longer be written to, with the reason why.
+  hashmap<int_fd, std::string> errors;
+};
+
+} // namespace internal {
+} // namespace mesos {
+
+#endif // __STATUS_UPDATE_MANAGER_CHECKPOINT_WRITER_HPP__
@@ -25,9 +25,12 @@
 #include <mesos/mesos.hpp>
 #include <mesos/type_utils.hpp>
 
+#include <process/defer.hpp>
 #include <process/delay.hpp>
+#include <process/dispatch.hpp>
 #include <process/future.hpp>
 #include <process/owned.hpp>
+#include <process/pid.hpp>
 #include <process/protobuf.hpp>
 #include <process/timeout.hpp>
 
@@ -50,6 +53,8 @@
 
 #include "slave/constants.hpp"
 
+#include "status_update_manager/checkpoint_writer.hpp"
+
 namespace mesos {
 namespace internal {
 
@@ -68,7 +73,12 @@ namespace internal {
 //
 // NOTE: Unless first paused, this actor will forward updates as soon as
 // possible; for example, during recovery or as soon as the first status update
-// is processed.
+// is checkpointed.
+//
+// Checkpointing is done asynchronously by a `CheckpointWriterProcess`, which
+// batches the writes of all streams into group commits. A status update is
+// only forwarded once it (and any acknowledgement written before it) is
+// durable.
 //
 // This process does NOT garbage collect any checkpointed state. The users of it
 // are responsible for the garbage collection of the status updates files.
@@ -115,7 +125,22 @@ public:
       const std::string& _statusUpdateType)
     : process::ProcessBase(process::ID::generate(id)),
       statusUpdateType(_statusUpdateType),
-      paused(false) {}
+      paused(false),
+      writer(new CheckpointWriterProcess())
+  {
+    process::spawn(writer.get());
+  }
+
+  virtual ~StatusUpdateManagerProcess()
+  {
+    // Destroying the streams hands the files with pending writes over to
+    // the writer to close, so the writer must outlive them and drain its
+    // queue before terminating.
+    streams.clear();
+
+    process::terminate(writer.get(), false);
+    process::wait(writer.get());
+  }
 
   StatusUpdateManagerProcess(const StatusUpdateManagerProcess& that) = delete;
   StatusUpdateManagerProcess& operator=(
@@ -218,22 +243,14 @@ public:
       return Nothing();
     }
 
-    // Forward the status update if this is at the front of the queue.
-    // Subsequent status updates will be sent in `acknowledgement()`.
-    if (!paused && stream->pending.size() == 1) {
-      CHECK_NONE(stream->timeout);
+    // The status update is forwarded once it is checkpointed, if it is at
+    // the front of the queue. Subsequent status updates will be sent once
+    // the acknowledgements of the preceding ones are checkpointed.
+    const process::Future<Nothing> checkpointing = stream->checkpoint;
 
-      const Result<UpdateType>& next = stream->next();
-      if (next.isError()) {
-        return process::Failure(next.error());
-      }
+    checkpointed(streamId, checkpointing);
 
-      CHECK_SOME(next);
-      stream->timeout =
-        forward(stream, next.get(), slave::STATUS_UPDATE_RETRY_INTERVAL_MIN);
-    }
-
-    return Nothing();
+    return checkpointing;
   }
 
   // Process the acknowledgment of a status update.
@@ -283,20 +300,20 @@ public:
       return process::Failure(next.error());
     }
 
-    bool terminated = stream->terminated;
-    if (terminated) {
-      if (next.isSome()) {
-        LOG(WARNING) << "Acknowledged a terminal " << statusUpdateType
-                     << " but updates are still pending";
-      }
-      cleanupStatusUpdateStream(streamId);
-    } else if (!paused && next.isSome()) {
-      // Forward the next queued status update.
-      stream->timeout =
-        forward(stream, next.get(), slave::STATUS_UPDATE_RETRY_INTERVAL_MIN);
+    const bool terminated = stream->terminated;
+    if (terminated && next.isSome()) {
+      LOG(WARNING) << "Acknowledged a terminal " << statusUpdateType
+                   << " but updates are still pending";
     }
 
-    return !terminated;
+    // Once the acknowledgement is checkpointed, a terminated stream is
+    // cleaned up, otherwise the next queued status update is forwarded.
+    const process::Future<Nothing> checkpointing = stream->checkpoint;
+
+    checkpointed(streamId, checkpointing);
+
+    return checkpointing
+      .then([terminated]() -> process::Future<bool> { return !terminated; });
   }
 
   // Recovers the status update manager's state using the supplied stream IDs.
@@ -386,6 +403,12 @@ public:
     paused = false;
 
     foreachvalue (process::Owned<StatusUpdateStream>& stream, streams) {
+      // Updates which are still being checkpointed are forwarded once
+      // they are durable, see `_checkpointed()`.
+      if (!stream->checkpoint.isReady()) {
+        continue;
+      }
+
       const Result<UpdateType>& next = stream->next();
 
       if (next.isSome()) {
@@ -419,7 +442,8 @@ private:
           statusUpdateType,
           streamId,
           frameworkId,
-          checkpoint ? Option<std::string>(getPath(streamId)) : None());
+          checkpoint ? Option<std::string>(getPath(streamId)) : None(),
+          writer->self());
 
     if (stream.isError()) {
       return Error(stream.error());
@@ -447,7 +471,11 @@ private:
         process::Owned<StatusUpdateStream>,
         typename StatusUpdateStream::State>> result =
           StatusUpdateStream::recover(
-              statusUpdateType, streamId, getPath(streamId), strict);
+              statusUpdateType,
+              streamId,
+              getPath(streamId),
+              writer->self(),
+              strict);
 
     if (result.isError()) {
       return Error(result.error());
@@ -509,6 +537,85 @@ private:
     streams.erase(streamId);
   }
 
+  // Acts on the completion of the latest checkpoint of a stream: this
+  // forwards the update at the front of the queue (if it was not forwarded
+  // yet) or cleans up the stream if it has terminated.
+  //
+  // This is done right away if the checkpoint has already completed (e.g.,
+  // for streams which are not checkpointed), so that forwarding is not
+  // needlessly delayed.
+  void checkpointed(
+      const IDType& streamId,
+      const process::Future<Nothing>& checkpoint)
+  {
+    if (checkpoint.isPending()) {
+      checkpoint.onAny(process::defer(
+          ProtobufProcess<
+              StatusUpdateManagerProcess<
+              IDType,
+              CheckpointType,
+              UpdateType>>::self(),
+          &StatusUpdateManagerProcess::_checkpointed,
+          streamId,
+          checkpoint));
+      return;
+    }
+
+    _checkpointed(streamId, checkpoint);
+  }
+
+  void _checkpointed(
+      const IDType& streamId,
+      const process::Future<Nothing>& checkpoint)
+  {
+    if (!streams.contains(streamId)) {
+      return;
+    }
+
+    StatusUpdateStream* stream = streams[streamId].get();
+
+    // The checkpoints of a stream complete in order, so only the latest one
+    // needs to be acted upon. This also ignores checkpoints of a stream that
+    // has since been cleaned up and recreated.
+    if (checkpoint != stream->checkpoint) {
+      return;
+    }
+
+    if (!checkpoint.isReady()) {
+      const std::string message = checkpoint.isFailed()
+        ? checkpoint.failure()
+        : "Checkpointing was discarded";
+
+      LOG(ERROR) << "Failed to checkpoint " << statusUpdateType << " stream "
+                 << stringify(streamId) << ": " << message;
+
+      stream->fail(message);
+      return;
+    }
+
+    if (stream->terminated) {
+      cleanupStatusUpdateStream(streamId);
+      return;
+    }
+
+    if (paused || stream->timeout.isSome()) {
+      return;
+    }
+
+    const Result<UpdateType>& next = stream->next();
+    if (next.isError()) {
+      LOG(ERROR) << "Failed to get the next " << statusUpdateType
+                 << " of stream " << stringify(streamId) << ": "
+                 << next.error();
+      return;
+    }
+
+    if (next.isSome()) {
+      stream->timeout =
+        forward(stream, next.get(), slave::STATUS_UPDATE_RETRY_INTERVAL_MIN);
+    }
+  }
+
   // Forwards the status update and starts a timer based on the `duration` to
   // check for ACK.
   process::Timeout forward(
@@ -552,10 +659,10 @@ private:
 
     StatusUpdateStream* stream = streams[streamId].get();
 
-    // Check and see if we should resend the status update.
-    if (!stream->pending.empty()) {
-      CHECK_SOME(stream->timeout);
-
+    // Check and see if we should resend the status update. There is no
+    // timeout if the update at the front of the queue is still being
+    // checkpointed, in which case it has not been forwarded yet.
+    if (!stream->pending.empty() && stream->timeout.isSome()) {
       if (stream->timeout->expired()) {
         const UpdateType& update = stream->pending.front();
         LOG(WARNING) << "Resending " << statusUpdateType << " " << update;
@@ -580,6 +687,8 @@ private:
   hashmap<FrameworkID, hashset<IDType>> frameworkStreams;
   bool paused;
 
+  process::Owned<CheckpointWriterProcess> writer;
+
   // Handles the status updates and acknowledgements, checkpointing them if
   // necessary. It also holds the information about received, acknowledged and
   // pending status updates.
@@ -599,14 +708,18 @@ private:
     ~StatusUpdateStream()
     {
       if (fd.isSome()) {
-        Try<Nothing> close = os::close(fd.get());
-
-        if (close.isError()) {
-          CHECK_SOME(path);
-          LOG(WARNING) << "Failed to close " << statusUpdateType
-                       << " stream file '" << path.get() << "': "
-                       << close.error();
-        }
+        // The writer closes the file once the pending writes have landed.
+        //
+        // NOTE: The file is closed by the writer even if no writes are
+        // pending, as the writer tracks failed files by descriptor and
+        // forgets them on close. Closing the file here could let a new
+        // stream reuse the descriptor while it is still marked failed.
+        CHECK_SOME(path);
+        process::dispatch(
+            writer,
+            &CheckpointWriterProcess::close,
+            fd.get(),
+            path.get());
       }
     }
 
@@ -614,7 +727,8 @@ private:
         const std::string& statusUpdateType,
         const IDType& streamId,
         const Option<FrameworkID>& frameworkId,
-        const Option<std::string>& path)
+        const Option<std::string>& path,
+        const process::PID<CheckpointWriterProcess>& writer)
     {
       Option<int_fd> fd;
 
@@ -631,10 +745,11 @@ private:
               "Failed to create '" + dirName + "': " + directory.error());
         }
 
-        // Open the updates file.
+        // Open the updates file. Writes are synced explicitly by the
+        // checkpoint writer, see `CheckpointWriterProcess::flush()`.
         Try<int_fd> result = os::open(
             path.get(),
-            O_CREAT | O_SYNC | O_WRONLY | O_CLOEXEC,
+            O_CREAT | O_WRONLY | O_CLOEXEC,
             S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
 
         if (result.isError()) {
@@ -646,7 +761,8 @@ private:
       }
 
       process::Owned<StatusUpdateStream> stream(
-          new StatusUpdateStream(statusUpdateType, streamId, path, fd));
+          new StatusUpdateStream(
+              statusUpdateType, streamId, path, fd, writer));
 
       stream->frameworkId = frameworkId;
 
@@ -658,6 +774,7 @@ private:
         const std::string& statusUpdateType,
         const IDType& streamId,
         const std::string& path,
+        const process::PID<CheckpointWriterProcess>& writer,
         bool strict)
     {
       if (os::exists(Path(path).dirname()) && !os::exists(path)) {
@@ -672,14 +789,15 @@ private:
 #ifdef __WINDOWS__
           O_BINARY |
 #endif // __WINDOWS__
-          O_SYNC | O_RDWR | O_CLOEXEC);
+          O_RDWR | O_CLOEXEC);
 
       if (fd.isError()) {
         return Error("Failed to open '" + path + "': " + fd.error());
       }
 
       process::Owned<StatusUpdateStream> stream(
-          new StatusUpdateStream(statusUpdateType, streamId, path, fd.get()));
+          new StatusUpdateStream(
+              statusUpdateType, streamId, path, fd.get(), writer));
 
       VLOG(1) << "Replaying " << statusUpdateType << " stream "
               << stringify(streamId);
@@ -891,6 +1009,14 @@ private:
     // Returns `true` if the stream is checkpointed, `false` otherwise.
     bool checkpointed() { return path.isSome(); }
 
+    // Marks the stream as failed after a record could not be checkpointed.
+    void fail(const std::string& message)
+    {
+      if (error.isNone()) {
+        error = message;
+      }
+    }
+
     const IDType streamId;
 
     bool terminated;
@@ -898,26 +1024,28 @@ private:
     Option<process::Timeout> timeout; // Timeout for resending status update.
     std::queue<UpdateType> pending;
 
+    // Satisfied once all of the records written to the stream so far are
+    // durable. Checkpoints complete in the order in which they are made.
+    process::Future<Nothing> checkpoint;
+
   private:
     StatusUpdateStream(
         const std::string& _statusUpdateType,
         const IDType& _streamId,
         const Option<std::string>& _path,
-        Option<int_fd> _fd)
+        Option<int_fd> _fd,
+        const process::PID<CheckpointWriterProcess>& _writer)
       : streamId(_streamId),
         terminated(false),
+        checkpoint(Nothing()),
         statusUpdateType(_statusUpdateType),
         path(_path),
-        fd(_fd) {}
+        fd(_fd),
+        writer(_writer) {}
 
-    // Handles the status update and writes it to disk, if necessary.
-    //
-    // TODO(vinod): The write has to be asynchronous to avoid status updates
-    // that are being checkpointed, blocking the processing of other updates.
-    // One solution is to wrap the protobuf::write inside async, but it's
-    // probably too much of an overhead to spin up a new libprocess per status
-    // update?
-    // A better solution might be to be have async write capability for file IO.
+    // Handles the status update and queues it to be written to disk, if
+    // necessary. The update is handled in memory right away, `checkpoint`
+    // tells when it is durable.
     Try<Nothing> handle(
         const UpdateType& update,
         const typename CheckpointType::Type& type)
@@ -943,12 +1071,27 @@ private:
             break;
         }
 
-        Try<Nothing> write = ::protobuf::write(fd.get(), record);
-        if (write.isError()) {
+        if (!record.IsInitialized()) {
           error =
-            "Failed to write to file '" + path.get() + "': " + write.error();
+            "Failed to write to file '" + path.get() + "': " +
+            record.InitializationErrorString() +
+            " is required but not initialized";
           return Error(error.get());
         }
+
+        // Use the same framing as `::protobuf::write()`, so that the
+        // stream can be replayed with `::protobuf::read()`.
+        const uint32_t size = record.ByteSize();
+
+        std::string data((char*) &size, sizeof(size));
+        record.AppendToString(&data);
+
+        checkpoint = process::dispatch(
+            writer,
+            &CheckpointWriterProcess::write,
+            fd.get(),
+            path.get(),
+            data);
       }
 
       // Now actually handle the update.
@@ -999,6 +1142,9 @@ private:
     const Option<std::string> path; // File path of the update stream.
     const Option<int_fd> fd; // File descriptor to the update stream.
 
+    // Writes the records to `fd`.
+    const process::PID<CheckpointWriterProcess> writer;
+
     hashset<id::UUID> received;
     hashset<id::UUID> acknowledged;
 
@@ -36,11 +36,15 @@
 
 #include <stout/gtest.hpp>
 #include <stout/jsonify.hpp>
+#include <stout/lambda.hpp>
 #include <stout/nothing.hpp>
+#include <stout/recordio.hpp>
+#include <stout/result.hpp>
 #include <stout/stringify.hpp>
 #include <stout/try.hpp>
 
 #include "common/http.hpp"
+#include "common/recordio.hpp"
 
 #include "master/detector/standalone.hpp"
 
@@ -543,6 +547,116 @@ TEST_P_TEMP_DISABLED_ON_WINDOWS(AgentContainerAPITest, NestedContainerLaunch)
 }
 
 
+// This test launches two nested containers and waits on both of them with
+// a single `WAIT_CONTAINERS` call. The termination of each nested container
+// is streamed back as soon as it happens.
+TEST_P_TEMP_DISABLED_ON_WINDOWS(AgentContainerAPITest, WaitContainers)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+
+  slave::Flags slaveFlags = CreateSlaveFlags();
+  slaveFlags.launcher = std::get<1>(std::get<3>(GetParam()));
+  slaveFlags.isolation = std::get<0>(std::get<3>(GetParam()));
+
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), slaveFlags);
+  ASSERT_SOME(slave);
+
+  Try<v1::ContainerID> parentContainerId =
+    launchParentContainer(master.get()->pid, slave.get()->pid);
+
+  ASSERT_SOME(parentContainerId);
+
+  v1::ContainerID containerId1;
+  containerId1.set_value(id::UUID::random().toString());
+  containerId1.mutable_parent()->CopyFrom(parentContainerId.get());
+
+  v1::ContainerID containerId2;
+  containerId2.set_value(id::UUID::random().toString());
+  containerId2.mutable_parent()->CopyFrom(parentContainerId.get());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::OK().status,
+      launchNestedContainer(slave.get()->pid, containerId1));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::OK().status,
+      launchNestedContainer(slave.get()->pid, containerId2));
+
+  ContentType contentType = std::get<2>(GetParam());
+
+  v1::agent::Call call;
+  call.set_type(v1::agent::Call::WAIT_CONTAINERS);
+  call.mutable_wait_containers()->add_container_ids()->CopyFrom(containerId1);
+  call.mutable_wait_containers()->add_container_ids()->CopyFrom(containerId2);
+
+  http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+  headers["Accept"] = APPLICATION_RECORDIO;
+  headers[MESSAGE_ACCEPT] = stringify(contentType);
+
+  Future<http::Response> response = http::streaming::post(
+      slave.get()->pid,
+      "api/v1",
+      headers,
+      serialize(contentType, call),
+      stringify(contentType));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+  ASSERT_EQ(http::Response::PIPE, response->type);
+  ASSERT_SOME(response->reader);
+
+  recordio::Reader<v1::agent::Response> reader(
+      ::recordio::Decoder<v1::agent::Response>(lambda::bind(
+          mesos::internal::deserialize<v1::agent::Response>,
+          contentType,
+          lambda::_1)),
+      response->reader.get());
+
+  // Only the termination of the first nested container is
+  // reported while the second one is still running.
+  Future<Result<v1::agent::Response>> record = reader.read();
+  EXPECT_TRUE(record.isPending());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::OK().status,
+      killNestedContainer(slave.get()->pid, containerId1));
+
+  AWAIT_READY(record);
+  ASSERT_SOME(record.get());
+  ASSERT_EQ(v1::agent::Response::WAIT_CONTAINERS, record->get().type());
+  EXPECT_EQ(containerId1, record->get().wait_containers().container_id());
+  ASSERT_TRUE(
+      record->get().wait_containers().wait_container().has_exit_status());
+  EXPECT_EQ(
+      SIGKILL,
+      record->get().wait_containers().wait_container().exit_status());
+
+  record = reader.read();
+  EXPECT_TRUE(record.isPending());
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      http::OK().status,
+      killNestedContainer(slave.get()->pid, containerId2));
+
+  AWAIT_READY(record);
+  ASSERT_SOME(record.get());
+  ASSERT_EQ(v1::agent::Response::WAIT_CONTAINERS, record->get().type());
+  EXPECT_EQ(containerId2, record->get().wait_containers().container_id());
+  ASSERT_TRUE(
+      record->get().wait_containers().wait_container().has_exit_status());
+  EXPECT_EQ(
+      SIGKILL,
+      record->get().wait_containers().wait_container().exit_status());
+
+  // The agent closes the stream once all nested containers terminated.
+  record = reader.read();
+  AWAIT_READY(record);
+  EXPECT_TRUE(record->isNone());
+}
+
+
 // This test launches a parent and nested container, simulates an agent
 // failover, and then waits/kills the containers.
 TEST_P_TEMP_DISABLED_ON_WINDOWS(AgentContainerAPITest, RecoverNestedContainer)
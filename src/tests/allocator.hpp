@@ -380,6 +380,11 @@ public:
       bool,
       const Option<DomainInfo>&));
 
+  virtual void setAuthorizer(const Option<Authorizer*>& authorizer)
+  {
+    real->setAuthorizer(authorizer);
+  }
+
   MOCK_METHOD2(recover, void(
       const int expectedAgentCount,
       const hashmap<std::string, Quota>&));
@@ -14,25 +14,42 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#ifndef __WINDOWS__
+#include <sys/resource.h>
+#endif // __WINDOWS__
+
+#include <atomic>
+#include <iostream>
 #include <memory>
+#include <mutex>
 #include <string>
 #include <utility>
 #include <vector>
 
 #include <mesos/v1/mesos.hpp>
 
+#include <process/address.hpp>
 #include <process/clock.hpp>
+#include <process/http.hpp>
 #include <process/owned.hpp>
+#include <process/process.hpp>
+#include <process/queue.hpp>
 
 #include <stout/hashmap.hpp>
+#include <stout/hashset.hpp>
 #include <stout/foreach.hpp>
 #include <stout/nothing.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/strings.hpp>
+#include <stout/synchronized.hpp>
 #include <stout/try.hpp>
+#include <stout/uuid.hpp>
 
 #include <stout/os/getcwd.hpp>
 
 #include "checks/checker.hpp"
+#include "checks/checker_process.hpp"
 
 #include "slave/containerizer/fetcher.hpp"
 
@@ -50,13 +67,22 @@ using mesos::v1::scheduler::Call;
 using mesos::v1::scheduler::Event;
 using mesos::v1::scheduler::Mesos;
 
+using mesos::internal::checks::CheckScheduler;
+using mesos::internal::checks::CheckerProcess;
+
 using process::Future;
 using process::Owned;
 
+using std::cout;
+using std::endl;
 using std::pair;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
+using testing::Values;
+using testing::WithParamInterface;
+
 namespace mesos {
 namespace internal {
 namespace tests {
@@ -3066,6 +3092,456 @@ TEST_F(CheckTest, CheckStatusInfoValidation)
   }
 }
 
+
+// Verifies that the check scheduler bounds the number of concurrent
+// checks and hands the permit of a completed check to a queued one.
+TEST_F(CheckTest, CheckSchedulerQueuesChecks)
+{
+  CheckScheduler* scheduler = CheckScheduler::instance();
+
+  // NOTE: Checks of previous tests might still hold permits, hence we
+  // acquire permits until one is queued.
+  vector<shared_ptr<CheckScheduler::Permit>> permits;
+  Option<Future<shared_ptr<CheckScheduler::Permit>>> queued;
+
+  for (size_t i = 0; i <= checks::MAX_CONCURRENT_CHECKS; i++) {
+    Future<shared_ptr<CheckScheduler::Permit>> permit = scheduler->acquire();
+
+    if (permit.isPending()) {
+      queued = permit;
+      break;
+    }
+
+    ASSERT_TRUE(permit.isReady());
+    permits.push_back(permit.get());
+  }
+
+  ASSERT_SOME(queued);
+  ASSERT_FALSE(permits.empty());
+
+  JSON::Object metrics = Metrics();
+
+  ASSERT_EQ(1u, metrics.values.count("checker/checks_queued"));
+  EXPECT_SOME_EQ(1u, metrics.at<JSON::Number>("checker/checks_queued"));
+
+  // Completing a check lets the queued one run.
+  permits.pop_back();
+
+  AWAIT_READY(queued.get());
+
+  metrics = Metrics();
+
+  EXPECT_SOME_EQ(0u, metrics.at<JSON::Number>("checker/checks_queued"));
+  EXPECT_EQ(1u, metrics.values.count("checker/check_latency_ms"));
+}
+
+
+
+// Starts a checker which sends HTTP checks for the given path to a
+// server on the loopback address, and puts the results of the checks
+// into `results`.
+static Owned<CheckerProcess> startHttpChecker(
+    const string& launcherDir,
+    uint16_t port,
+    const string& path,
+    double timeoutSeconds,
+    process::Queue<Try<CheckStatusInfo>> results)
+{
+  CheckInfo checkInfo;
+  checkInfo.set_type(CheckInfo::HTTP);
+  checkInfo.set_delay_seconds(0);
+  checkInfo.set_interval_seconds(0);
+  checkInfo.set_timeout_seconds(timeoutSeconds);
+  checkInfo.mutable_http()->set_port(port);
+  checkInfo.mutable_http()->set_path(path);
+
+  TaskID taskId;
+  taskId.set_value(id::UUID::random().toString());
+
+  Owned<CheckerProcess> checker(new CheckerProcess(
+      checkInfo,
+      launcherDir,
+      [results](const Try<CheckStatusInfo>& result) mutable {
+        results.put(result);
+      },
+      taskId,
+      "HTTP check",
+      checks::runtime::Plain(),
+      None()));
+
+  process::spawn(checker.get());
+
+  return checker;
+}
+
+
+// Verifies that HTTP checks follow redirects to the checked server,
+// both to a path and to an absolute URL, like `curl -L` does.
+TEST_F(CheckTest, HTTPCheckFollowsRedirects)
+{
+  Try<process::http::Server> server = process::http::Server::create(
+      process::network::inet4::Address(net::IPv4::LOOPBACK(), 0),
+      [](const process::network::Socket& socket,
+         const process::http::Request& request)
+          -> Future<process::http::Response> {
+        if (request.url.path == "/redirect") {
+          return process::http::TemporaryRedirect("/absolute");
+        }
+
+        if (request.url.path == "/absolute") {
+          Try<process::network::inet::Address> address =
+            process::network::convert<process::network::inet::Address>(
+                socket.address());
+
+          if (address.isError()) {
+            return process::http::InternalServerError(address.error());
+          }
+
+          return process::http::TemporaryRedirect(
+              "http://" + stringify(address.get()) + "/ok");
+        }
+
+        return process::http::OK();
+      });
+
+  ASSERT_SOME(server);
+
+  Future<Nothing> run = server->run();
+
+  Try<process::network::inet::Address> address =
+    process::network::convert<process::network::inet::Address>(
+        server->address());
+
+  ASSERT_SOME(address);
+
+  process::Queue<Try<CheckStatusInfo>> results;
+
+  Owned<CheckerProcess> checker =
+    startHttpChecker(sandbox.get(), address->port, "/redirect", 10, results);
+
+  Future<Try<CheckStatusInfo>> result = results.get();
+
+  AWAIT_READY(result);
+  ASSERT_SOME(result.get());
+  EXPECT_EQ(200u, result->get().http().status_code());
+
+  process::terminate(checker.get());
+  process::wait(checker.get());
+
+  AWAIT_READY(server->stop());
+  AWAIT_READY(run);
+}
+
+
+// Verifies that HTTP checks do not follow redirects which leave the
+// checked server, and return the status code of the redirect instead.
+TEST_F(CheckTest, HTTPCheckOffHostRedirect)
+{
+  Try<process::http::Server> server = process::http::Server::create(
+      process::network::inet4::Address(net::IPv4::LOOPBACK(), 0),
+      [](const process::network::Socket&, const process::http::Request&) {
+        return process::http::TemporaryRedirect("http://127.0.0.2/");
+      });
+
+  ASSERT_SOME(server);
+
+  Future<Nothing> run = server->run();
+
+  Try<process::network::inet::Address> address =
+    process::network::convert<process::network::inet::Address>(
+        server->address());
+
+  ASSERT_SOME(address);
+
+  process::Queue<Try<CheckStatusInfo>> results;
+
+  Owned<CheckerProcess> checker =
+    startHttpChecker(sandbox.get(), address->port, "/", 10, results);
+
+  Future<Try<CheckStatusInfo>> result = results.get();
+
+  AWAIT_READY(result);
+  ASSERT_SOME(result.get());
+  EXPECT_EQ(
+      static_cast<uint32_t>(process::http::Status::TEMPORARY_REDIRECT),
+      result->get().http().status_code());
+
+  process::terminate(checker.get());
+  process::wait(checker.get());
+
+  AWAIT_READY(server->stop());
+  AWAIT_READY(run);
+}
+
+
+// Verifies that an HTTP check is retried once on a new connection if
+// the server closes the connection reused from the previous check
+// while the request is being sent.
+TEST_F(CheckTest, HTTPCheckRetriesStaleConnection)
+{
+  std::atomic<size_t> requests(0);
+
+  std::mutex mutex;
+  hashset<uint16_t> clients;
+
+  Try<process::http::Server> server = process::http::Server::create(
+      process::network::inet4::Address(net::IPv4::LOOPBACK(), 0),
+      [&](const process::network::Socket& socket,
+          const process::http::Request&)
+          -> Future<process::http::Response> {
+        Try<process::network::inet::Address> client =
+          process::network::convert<process::network::inet::Address>(
+              socket.peer());
+
+        if (client.isSome()) {
+          synchronized (mutex) {
+            clients.insert(client->port);
+          }
+        }
+
+        // Close the connection instead of answering the second
+        // request, which is the first one sent over a reused
+        // connection.
+        if (++requests == 2) {
+          process::network::Socket _socket = socket;
+          _socket.shutdown(process::network::Socket::Shutdown::READ_WRITE);
+        }
+
+        return process::http::OK();
+      });
+
+  ASSERT_SOME(server);
+
+  Future<Nothing> run = server->run();
+
+  Try<process::network::inet::Address> address =
+    process::network::convert<process::network::inet::Address>(
+        server->address());
+
+  ASSERT_SOME(address);
+
+  process::Queue<Try<CheckStatusInfo>> results;
+
+  Owned<CheckerProcess> checker =
+    startHttpChecker(sandbox.get(), address->port, "/", 10, results);
+
+  Future<Try<CheckStatusInfo>> result1 = results.get();
+  Future<Try<CheckStatusInfo>> result2 = results.get();
+
+  AWAIT_READY(result1);
+  ASSERT_SOME(result1.get());
+  EXPECT_EQ(200u, result1->get().http().status_code());
+
+  // The second check succeeds on a new connection.
+  AWAIT_READY(result2);
+  ASSERT_SOME(result2.get());
+  EXPECT_EQ(200u, result2->get().http().status_code());
+
+  process::terminate(checker.get());
+  process::wait(checker.get());
+
+  AWAIT_READY(server->stop());
+  AWAIT_READY(run);
+
+  EXPECT_LE(3u, requests.load());
+
+  synchronized (mutex) {
+    EXPECT_LE(2u, clients.size());
+  }
+}
+
+
+// Verifies that the connection of an HTTP check which times out is
+// torn down, so that the next check is sent over a new connection.
+TEST_F(CheckTest, HTTPCheckTimeoutClosesConnection)
+{
+  std::atomic<size_t> requests(0);
+  process::Promise<process::http::Response> stuck;
+
+  std::mutex mutex;
+  hashset<uint16_t> clients;
+
+  Try<process::http::Server> server = process::http::Server::create(
+      process::network::inet4::Address(net::IPv4::LOOPBACK(), 0),
+      [&](const process::network::Socket& socket,
+          const process::http::Request&)
+          -> Future<process::http::Response> {
+        Try<process::network::inet::Address> client =
+          process::network::convert<process::network::inet::Address>(
+              socket.peer());
+
+        if (client.isSome()) {
+          synchronized (mutex) {
+            clients.insert(client->port);
+          }
+        }
+
+        // Do not answer the first check until it has timed out.
+        if (++requests == 1) {
+          return stuck.future();
+        }
+
+        return process::http::OK();
+      });
+
+  ASSERT_SOME(server);
+
+  Future<Nothing> run = server->run();
+
+  Try<process::network::inet::Address> address =
+    process::network::convert<process::network::inet::Address>(
+        server->address());
+
+  ASSERT_SOME(address);
+
+  process::Queue<Try<CheckStatusInfo>> results;
+
+  Owned<CheckerProcess> checker =
+    startHttpChecker(sandbox.get(), address->port, "/", 1, results);
+
+  Future<Try<CheckStatusInfo>> result1 = results.get();
+  Future<Try<CheckStatusInfo>> result2 = results.get();
+
+  AWAIT_READY(result1);
+  ASSERT_ERROR(result1.get());
+  EXPECT_TRUE(strings::contains(result1->error(), "timed out"));
+
+  AWAIT_READY(result2);
+  ASSERT_SOME(result2.get());
+  EXPECT_EQ(200u, result2->get().http().status_code());
+
+  synchronized (mutex) {
+    EXPECT_EQ(2u, clients.size());
+  }
+
+  process::terminate(checker.get());
+  process::wait(checker.get());
+
+  stuck.set(process::http::OK());
+
+  AWAIT_READY(server->stop());
+  AWAIT_READY(run);
+}
+
+#ifndef __WINDOWS__
+class Checker_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+// The number of tasks checked concurrently.
+INSTANTIATE_TEST_CASE_P(
+    Tasks,
+    Checker_BENCHMARK_Test,
+    Values(10U, 100U, 1000U));
+
+
+// Measures the throughput of HTTP and TCP checks when many tasks are
+// checked back to back, in checks per second and in checks per second
+// of CPU time used by the checkers, i.e., per fully used agent core.
+TEST_P(Checker_BENCHMARK_Test, NetworkChecks)
+{
+  const size_t tasks = GetParam();
+  const Duration duration = Seconds(5);
+
+  Try<process::http::Server> server = process::http::Server::create(
+      process::network::inet4::Address(net::IPv4::LOOPBACK(), 0),
+      [](const process::network::Socket&, const process::http::Request&) {
+        return process::http::OK();
+      });
+
+  ASSERT_SOME(server);
+
+  Future<Nothing> run = server->run();
+
+  Try<process::network::inet::Address> address =
+    process::network::convert<process::network::inet::Address>(
+        server->address());
+
+  ASSERT_SOME(address);
+
+  const vector<CheckInfo::Type> types = {CheckInfo::HTTP, CheckInfo::TCP};
+
+  foreach (CheckInfo::Type type, types) {
+    CheckInfo checkInfo;
+    checkInfo.set_type(type);
+    checkInfo.set_delay_seconds(0);
+    checkInfo.set_interval_seconds(0);
+
+    if (type == CheckInfo::HTTP) {
+      checkInfo.mutable_http()->set_port(address->port);
+      checkInfo.mutable_http()->set_path("/");
+    } else {
+      checkInfo.mutable_tcp()->set_port(address->port);
+    }
+
+    std::atomic<size_t> checks(0);
+    std::atomic<size_t> failures(0);
+
+    auto callback = [&checks, &failures](const Try<CheckStatusInfo>& result) {
+      ++checks;
+
+      if (result.isError()) {
+        ++failures;
+      }
+    };
+
+    struct rusage before;
+    ASSERT_EQ(0, ::getrusage(RUSAGE_SELF, &before));
+
+    Stopwatch watch;
+    watch.start();
+
+    vector<Owned<CheckerProcess>> checkers;
+    for (size_t i = 0; i < tasks; i++) {
+      TaskID taskId;
+      taskId.set_value(id::UUID::random().toString());
+
+      Owned<CheckerProcess> checker(new CheckerProcess(
+          checkInfo,
+          sandbox.get(),
+          callback,
+          taskId,
+          CheckInfo::Type_Name(type) + " check",
+          checks::runtime::Plain(),
+          None()));
+
+      process::spawn(checker.get());
+      checkers.push_back(checker);
+    }
+
+    os::sleep(duration);
+
+    foreach (const Owned<CheckerProcess>& checker, checkers) {
+      process::terminate(checker.get());
+      process::wait(checker.get());
+    }
+
+    watch.stop();
+
+    struct rusage after;
+    ASSERT_EQ(0, ::getrusage(RUSAGE_SELF, &after));
+
+    auto seconds = [](const struct timeval& time) {
+      return time.tv_sec + time.tv_usec / 1000000.0;
+    };
+
+    const double cpu =
+      seconds(after.ru_utime) - seconds(before.ru_utime) +
+      seconds(after.ru_stime) - seconds(before.ru_stime);
+
+    cout << "Performed " << checks << " " << CheckInfo::Type_Name(type)
+         << " checks (" << failures << " failed) of " << tasks << " tasks in "
+         << watch.elapsed() << ": "
+         << checks / watch.elapsed().secs() << " checks/sec, "
+         << checks / cpu << " checks per CPU second" << endl;
+  }
+
+  AWAIT_READY(server->stop());
+  AWAIT_READY(run);
+}
+#endif // __WINDOWS__
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
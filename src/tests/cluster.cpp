@@ -486,7 +486,8 @@ Try<process::Owned<Slave>> Slave::create(
 
   // If the garbage collector is not provided, create a default one.
   if (gc.isNone()) {
-    slave->gc.reset(new slave::GarbageCollector());
+    slave->gc.reset(new slave::GarbageCollector(
+        flags.gc_max_concurrent_removals));
   }
 
   // If the resource estimator is not provided, create a default one.
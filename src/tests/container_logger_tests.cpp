@@ -15,11 +15,14 @@
 // limitations under the License.
 
 #include <list>
+#include <memory>
 #include <string>
 #include <vector>
 
 #include <gmock/gmock.h>
 
+#include <mesos/module/container_logger.hpp>
+
 #include <mesos/slave/container_logger.hpp>
 #include <mesos/slave/containerizer.hpp>
 
@@ -27,9 +30,12 @@
 #include <process/future.hpp>
 #include <process/gtest.hpp>
 #include <process/owned.hpp>
+#include <process/subprocess.hpp>
 
 #include <stout/bytes.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
+#include <stout/gzip.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/strings.hpp>
@@ -49,6 +55,7 @@
 #include "slave/flags.hpp"
 #include "slave/paths.hpp"
 #include "slave/slave.hpp"
+#include "slave/state.hpp"
 
 #include "slave/containerizer/docker.hpp"
 #include "slave/containerizer/fetcher.hpp"
@@ -60,6 +67,7 @@
 #include "tests/flags.hpp"
 #include "tests/mesos.hpp"
 #include "tests/mock_docker.hpp"
+#include "tests/module.hpp"
 #include "tests/utils.hpp"
 
 #include "tests/containerizer/launcher.hpp"
@@ -82,10 +90,12 @@ using mesos::internal::slave::state::SlaveState;
 
 using mesos::master::detector::MasterDetector;
 
+using mesos::slave::ContainerIO;
 using mesos::slave::ContainerLogger;
 using mesos::slave::Isolator;
 
 using std::list;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -391,6 +401,281 @@ TEST_F(ContainerLoggerTest, LOGROTATE_RotateInSandbox)
 }
 
 
+// Tests that the packaged logrotate container logger writes and
+// rotates the logs of a container within the agent with `in_process`.
+TEST_F(ContainerLoggerTest, LOGROTATE_RotateInProcess)
+{
+  Parameters parameters;
+
+  Parameter* parameter = parameters.add_parameter();
+  parameter->set_key("launcher_dir");
+  parameter->set_value(getLauncherDir());
+
+  parameter = parameters.add_parameter();
+  parameter->set_key("max_stdout_size");
+  parameter->set_value(stringify(Megabytes(1)));
+
+  parameter = parameters.add_parameter();
+  parameter->set_key("logrotate_stdout_options");
+  parameter->set_value("rotate 2\ncompress");
+
+  parameter = parameters.add_parameter();
+  parameter->set_key("in_process");
+  parameter->set_value("true");
+
+  Try<ContainerLogger*> _logger =
+    tests::Module<ContainerLogger, LogrotateContainerLogger>::create(
+        parameters);
+
+  ASSERT_SOME(_logger);
+  Owned<ContainerLogger> logger(_logger.get());
+  ASSERT_SOME(logger->initialize());
+
+  // The sandbox is laid out like in the work directory of an agent, as
+  // the logger keys the metrics of a container by its ID.
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorID executorId;
+  executorId.set_value("executor");
+
+  ContainerID containerId;
+  containerId.set_value("container");
+
+  const string sandboxDirectory = slave::paths::getExecutorRunPath(
+      os::getcwd(), slaveId, frameworkId, executorId, containerId);
+
+  ASSERT_SOME(os::mkdir(sandboxDirectory));
+
+  {
+    Future<ContainerIO> containerIO =
+      logger->prepare(ExecutorInfo(), sandboxDirectory, None());
+
+    AWAIT_READY(containerIO);
+
+    // Spam stdout with 3.5 MB of (mostly blank) output.
+    Try<Subprocess> s = subprocess(
+        "i=0; while [ $i -lt 3584 ]; "
+        "do printf '%-1023d\\n' $i; i=$((i+1)); done",
+        Subprocess::PATH(os::DEV_NULL),
+        containerIO->out,
+        containerIO->err);
+
+    ASSERT_SOME(s);
+    AWAIT_EXPECT_WEXITSTATUS_EQ(0, s->status());
+
+    // NOTE: Our ends of the pipes are closed once `containerIO` goes
+    // out of scope, which lets the logger finish.
+  }
+
+  const string stdoutPath = path::join(sandboxDirectory, "stdout");
+
+  // Wait for the logger to write all the output and to compress the
+  // rotated log files in the background, for up to 5 seconds.
+  Duration waited = Duration::zero();
+  do {
+    Try<Bytes> size = os::stat::size(stdoutPath);
+    Try<list<string>> rotating = ::fs::list(stdoutPath + ".rotating.*");
+
+    if (size.isSome() && size.get() == Kilobytes(512) &&
+        rotating.isSome() && rotating->empty()) {
+      break;
+    }
+
+    os::sleep(Milliseconds(100));
+    waited += Milliseconds(100);
+  } while (waited < Seconds(5));
+
+  Try<Bytes> stdoutSize = os::stat::size(stdoutPath);
+  ASSERT_SOME(stdoutSize);
+  EXPECT_EQ(Kilobytes(512), stdoutSize.get());
+
+  // The two most recent rotated log files (1 MB each) are compressed.
+  for (int i = 1; i <= 2; i++) {
+    Try<string> compressed =
+      os::read(stdoutPath + "." + stringify(i) + ".gz");
+
+    ASSERT_SOME(compressed);
+
+    Try<string> decompressed = gzip::decompress(compressed.get());
+    ASSERT_SOME(decompressed);
+    EXPECT_EQ(Megabytes(1), Bytes(decompressed->size()));
+  }
+
+  EXPECT_FALSE(os::exists(stdoutPath + ".3.gz"));
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(
+      1u,
+      metrics.values.count(
+          "container_logger/logrotate/container/stdout/bytes_written"));
+}
+
+
+// Tests that the logrotate container logger still uses companion
+// processes with `in_process` for the containers of frameworks with
+// checkpointing enabled, as these must outlive the agent.
+TEST_F(ContainerLoggerTest, LOGROTATE_CheckpointingFrameworkNotInProcess)
+{
+  Parameters parameters;
+
+  Parameter* parameter = parameters.add_parameter();
+  parameter->set_key("launcher_dir");
+  parameter->set_value(getLauncherDir());
+
+  parameter = parameters.add_parameter();
+  parameter->set_key("in_process");
+  parameter->set_value("true");
+
+  Try<ContainerLogger*> _logger =
+    tests::Module<ContainerLogger, LogrotateContainerLogger>::create(
+        parameters);
+
+  ASSERT_SOME(_logger);
+  Owned<ContainerLogger> logger(_logger.get());
+  ASSERT_SOME(logger->initialize());
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorID executorId;
+  executorId.set_value("executor");
+
+  ContainerID containerId;
+  containerId.set_value("checkpointed");
+
+  // The agent checkpoints the info of frameworks with checkpointing
+  // enabled before it launches their executors.
+  const string workDir = os::getcwd();
+
+  ASSERT_SOME(slave::state::checkpoint(
+      slave::paths::getFrameworkInfoPath(
+          slave::paths::getMetaRootDir(workDir), slaveId, frameworkId),
+      FrameworkInfo()));
+
+  const string sandboxDirectory = slave::paths::getExecutorRunPath(
+      workDir, slaveId, frameworkId, executorId, containerId);
+
+  ASSERT_SOME(os::mkdir(sandboxDirectory));
+
+  {
+    Future<ContainerIO> containerIO =
+      logger->prepare(ExecutorInfo(), sandboxDirectory, None());
+
+    AWAIT_READY(containerIO);
+
+    Try<Subprocess> s = subprocess(
+        "echo hello",
+        Subprocess::PATH(os::DEV_NULL),
+        containerIO->out,
+        containerIO->err);
+
+    ASSERT_SOME(s);
+    AWAIT_EXPECT_WEXITSTATUS_EQ(0, s->status());
+  }
+
+  const string stdoutPath = path::join(sandboxDirectory, "stdout");
+
+  // Wait for the companion process to write the output.
+  Duration waited = Duration::zero();
+  do {
+    Try<string> read = os::read(stdoutPath);
+    if (read.isSome() && read.get() == "hello\n") {
+      break;
+    }
+
+    os::sleep(Milliseconds(100));
+    waited += Milliseconds(100);
+  } while (waited < Seconds(5));
+
+  EXPECT_SOME_EQ("hello\n", os::read(stdoutPath));
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(
+      0u,
+      metrics.values.count(
+          "container_logger/logrotate/checkpointed/stdout/bytes_written"));
+}
+
+
+// Tests that the logrotate container logger recognizes frameworks with
+// checkpointing enabled when their info is recorded in the checkpoint
+// journal of the agent (i.e., with `--checkpoint_journal`).
+TEST_F(ContainerLoggerTest, LOGROTATE_JournaledFrameworkNotInProcess)
+{
+  Parameters parameters;
+
+  Parameter* parameter = parameters.add_parameter();
+  parameter->set_key("launcher_dir");
+  parameter->set_value(getLauncherDir());
+
+  parameter = parameters.add_parameter();
+  parameter->set_key("in_process");
+  parameter->set_value("true");
+
+  Try<ContainerLogger*> _logger =
+    tests::Module<ContainerLogger, LogrotateContainerLogger>::create(
+        parameters);
+
+  ASSERT_SOME(_logger);
+  Owned<ContainerLogger> logger(_logger.get());
+  ASSERT_SOME(logger->initialize());
+
+  SlaveID slaveId;
+  slaveId.set_value("slave");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework");
+
+  ExecutorID executorId;
+  executorId.set_value("executor");
+
+  ContainerID containerId;
+  containerId.set_value("journaled");
+
+  const string workDir = os::getcwd();
+  const string metaDir = slave::paths::getMetaRootDir(workDir);
+
+  Try<shared_ptr<slave::state::Journal>> journal =
+    slave::state::Journal::open(metaDir);
+
+  ASSERT_SOME(journal);
+  slave::state::Journal::install(journal.get());
+
+  const string frameworkInfoPath =
+    slave::paths::getFrameworkInfoPath(metaDir, slaveId, frameworkId);
+
+  ASSERT_SOME(slave::state::checkpoint(frameworkInfoPath, FrameworkInfo()));
+  EXPECT_FALSE(os::exists(frameworkInfoPath));
+
+  const string sandboxDirectory = slave::paths::getExecutorRunPath(
+      workDir, slaveId, frameworkId, executorId, containerId);
+
+  ASSERT_SOME(os::mkdir(sandboxDirectory));
+
+  Future<ContainerIO> containerIO =
+    logger->prepare(ExecutorInfo(), sandboxDirectory, None());
+
+  AWAIT_READY(containerIO);
+
+  slave::state::Journal::uninstall(journal.get());
+
+  // The output is handed to companion processes, so the in-process
+  // writer never registers its metrics.
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(
+      0u,
+      metrics.values.count(
+          "container_logger/logrotate/journaled/stdout/bytes_written"));
+}
+
+
 // Tests that the packaged logrotate container logger will find and use
 // overrides inside the Executor's environment.
 TEST_F(ContainerLoggerTest, LOGROTATE_CustomRotateOptions)
@@ -556,6 +556,46 @@ TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest, ROOT_CGROUPS_Stat)
 }
 
 
+TEST_F(CgroupsAnyHierarchyWithCpuAcctMemoryTest, ROOT_CGROUPS_ControlFile)
+{
+  EXPECT_ERROR(cgroups::ControlFile::open(
+      baseHierarchy, TEST_CGROUPS_ROOT, "invalid"));
+
+  Try<Owned<cgroups::ControlFile>> file = cgroups::ControlFile::open(
+      path::join(baseHierarchy, "memory"), "/", "memory.stat");
+
+  ASSERT_SOME(file);
+
+  // The control file can be read repeatedly without being reopened.
+  for (int i = 0; i < 2; i++) {
+    hashmap<string, uint64_t> result;
+
+    ASSERT_SOME(file.get()->stat([&result](const string& name, uint64_t value) {
+      result[name] = value;
+    }));
+
+    EXPECT_TRUE(result.contains("rss"));
+    EXPECT_GT(result.get("rss").get(), 0llu);
+  }
+
+  file = cgroups::ControlFile::open(
+      path::join(baseHierarchy, "memory"), "/", "memory.usage_in_bytes");
+
+  ASSERT_SOME(file);
+
+  Try<uint64_t> usage = file.get()->value();
+  ASSERT_SOME(usage);
+  EXPECT_GT(usage.get(), 0llu);
+
+  // A stat file does not hold a single value.
+  file = cgroups::ControlFile::open(
+      path::join(baseHierarchy, "cpuacct"), "/", "cpuacct.stat");
+
+  ASSERT_SOME(file);
+  EXPECT_ERROR(file.get()->value());
+}
+
+
 TEST_F(CgroupsAnyHierarchyWithCpuMemoryTest, ROOT_CGROUPS_Listen)
 {
   string hierarchy = path::join(baseHierarchy, "memory");
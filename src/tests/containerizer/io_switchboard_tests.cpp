@@ -14,21 +14,28 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+#include <list>
 #include <map>
+#include <memory>
 #include <string>
 #include <tuple>
+#include <utility>
 #include <vector>
 
 #include <process/clock.hpp>
 #include <process/address.hpp>
+#include <process/collect.hpp>
 #include <process/future.hpp>
 #include <process/http.hpp>
+#include <process/loop.hpp>
 #include <process/owned.hpp>
 
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/protobuf.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/uuid.hpp>
 
 #include <stout/os/constants.hpp>
@@ -79,7 +86,11 @@ using process::Future;
 using process::Owned;
 
 using testing::Eq;
+using testing::Values;
+using testing::WithParamInterface;
 
+using std::cout;
+using std::endl;
 using std::map;
 using std::string;
 using std::tuple;
@@ -702,6 +713,149 @@ TEST_F(IOSwitchboardServerTest, ReceiveHeartbeat)
 }
 
 
+class IOSwitchboardServer_BENCHMARK_Test
+  : public IOSwitchboardServerTest,
+    public WithParamInterface<std::pair<size_t, bool>> {};
+
+
+// The number of output connections attached to the switchboard, and
+// whether the log file is opened with `O_APPEND` (as the sandbox
+// container logger does).
+INSTANTIATE_TEST_CASE_P(
+    ConnectionsAndAppend,
+    IOSwitchboardServer_BENCHMARK_Test,
+    Values(
+        std::make_pair(0U, false),
+        std::make_pair(1U, false),
+        std::make_pair(4U, false),
+        std::make_pair(0U, true),
+        std::make_pair(1U, true),
+        std::make_pair(4U, true)));
+
+
+// Measures the throughput of a container writing its stdout at a high
+// rate through the switchboard to its log file, with a varying number
+// of clients attached to its output.
+TEST_P(IOSwitchboardServer_BENCHMARK_Test, RedirectOutput)
+{
+  const size_t connections = GetParam().first;
+  const bool append = GetParam().second;
+  const Bytes total = Megabytes(512);
+
+  Try<int> nullFd = os::open(os::DEV_NULL, O_RDWR);
+  ASSERT_SOME(nullFd);
+
+  Try<std::array<int_fd, 2>> stdoutPipe_ = os::pipe();
+  ASSERT_SOME(stdoutPipe_);
+
+  const std::array<int_fd, 2>& stdoutPipe = stdoutPipe_.get();
+
+  // The log file may already have some output (e.g., the one of the
+  // fetcher), which is kept when it is appended to.
+  const string header = "header\n";
+
+  string stdoutPath = path::join(sandbox.get(), "stdout");
+  ASSERT_SOME(os::write(stdoutPath, header));
+
+  Try<int> stdoutFd = os::open(
+      stdoutPath,
+      O_WRONLY | O_CREAT | (append ? O_APPEND : O_TRUNC),
+      S_IRUSR | S_IWUSR | S_IRGRP | S_IROTH);
+
+  ASSERT_SOME(stdoutFd);
+
+  string socketPath = path::join(sandbox.get(), "mesos-io-switchboard");
+
+  Try<Owned<IOSwitchboardServer>> server = IOSwitchboardServer::create(
+      false,
+      nullFd.get(),
+      stdoutPipe[0],
+      stdoutFd.get(),
+      nullFd.get(),
+      nullFd.get(),
+      socketPath);
+
+  ASSERT_SOME(server);
+
+  Future<Nothing> runServer = server.get()->run();
+
+  ContainerID containerId;
+  containerId.set_value(id::UUID::random().toString());
+
+  Try<unix::Address> address = unix::Address::create(socketPath);
+  ASSERT_SOME(address);
+
+  // Attach the clients, which count the bytes of the output they
+  // receive (including the encoding) without keeping it around.
+  vector<http::Connection> clients;
+  std::list<Future<Bytes>> received;
+
+  for (size_t i = 0; i < connections; i++) {
+    Future<http::Connection> connection =
+      http::connect(address.get(), http::Scheme::HTTP);
+
+    AWAIT_READY(connection);
+    clients.push_back(connection.get());
+
+    Future<http::Response> response = attachOutput(containerId, clients.back());
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+    ASSERT_SOME(response->reader);
+
+    http::Pipe::Reader reader = response->reader.get();
+    std::shared_ptr<Bytes> bytes(new Bytes());
+
+    received.push_back(process::loop(
+        None(),
+        [reader]() mutable { return reader.read(); },
+        [bytes](const string& data) -> process::ControlFlow<Bytes> {
+          if (data.empty()) {
+            return process::Break(*bytes);
+          }
+
+          *bytes += Bytes(data.size());
+          return process::Continue();
+        }));
+  }
+
+  const string data(Kilobytes(64).bytes(), 'x');
+
+  Stopwatch watch;
+  watch.start();
+
+  for (Bytes written; written < total; written += Bytes(data.size())) {
+    ASSERT_SOME(os::write(stdoutPipe[1], data));
+  }
+
+  os::close(stdoutPipe[1]);
+
+  AWAIT_ASSERT_READY_FOR(runServer, Minutes(5));
+
+  watch.stop();
+
+  cout << "Redirected " << total << " of output to a file opened "
+       << (append ? "with" : "without") << " O_APPEND and " << connections
+       << " attached connection(s) in " << watch.elapsed()
+       << " (" << (total.bytes() / Megabytes(1).bytes()) /
+                  watch.elapsed().secs()
+       << " MB/s)" << endl;
+
+  AWAIT_READY(process::collect(received));
+
+  foreach (http::Connection& client, clients) {
+    AWAIT_READY(client.disconnect());
+  }
+
+  os::close(nullFd.get());
+  os::close(stdoutPipe[0]);
+  os::close(stdoutFd.get());
+
+  Try<Bytes> size = os::stat::size(stdoutPath);
+  ASSERT_SOME(size);
+  EXPECT_EQ(append ? total + Bytes(header.size()) : total, size.get());
+}
+
+
 class IOSwitchboardTest
   : public ContainerizerTest<slave::MesosContainerizer> {};
 
@@ -14,13 +14,21 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
+#include <tuple>
+
+#include <mesos/docker/spec.hpp>
+
 #include <process/gtest.hpp>
 
 #include <stout/foreach.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
 #include <stout/os.hpp>
 #include <stout/os/permissions.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 #include <stout/strings.hpp>
 
 #include <stout/tests/utils.hpp>
@@ -36,6 +44,7 @@
 #include "slave/containerizer/mesos/provisioner/constants.hpp"
 
 #include "tests/flags.hpp"
+#include "tests/utils.hpp"
 
 using namespace process;
 
@@ -46,9 +55,13 @@ using mesos::internal::slave::BIND_BACKEND;
 using mesos::internal::slave::COPY_BACKEND;
 using mesos::internal::slave::OVERLAY_BACKEND;
 
+using std::cout;
+using std::endl;
 using std::string;
 using std::vector;
 
+using testing::WithParamInterface;
+
 namespace mesos {
 namespace internal {
 namespace tests {
@@ -344,6 +357,182 @@ TEST_F(CopyBackendTest, ROOT_CopyBackend)
   EXPECT_FALSE(os::exists(rootfs));
 }
 
+
+// Provision a rootfs using multiple layers with whiteouts, symlinks
+// and hard links with the copy backend.
+TEST_F(CopyBackendTest, CopyBackendWhiteouts)
+{
+  string layer1 = path::join(sandbox.get(), "source1");
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir1")));
+  ASSERT_SOME(os::write(path::join(layer1, "dir1", "1"), "1"));
+  ASSERT_SOME(os::mkdir(path::join(layer1, "dir2")));
+  ASSERT_SOME(os::write(path::join(layer1, "dir2", "2"), "2"));
+  ASSERT_SOME(os::write(path::join(layer1, "file"), "test1"));
+  ASSERT_SOME(::fs::symlink("dir1", path::join(layer1, "link")));
+
+  string layer2 = path::join(sandbox.get(), "source2");
+  ASSERT_SOME(os::mkdir(path::join(layer2, "dir2")));
+  ASSERT_SOME(os::write(path::join(layer2, "dir2", "3"), "3"));
+  ASSERT_SOME(os::touch(path::join(
+      layer2, "dir2", docker::spec::WHITEOUT_OPAQUE_PREFIX)));
+  ASSERT_SOME(os::touch(path::join(
+      layer2, string(docker::spec::WHITEOUT_PREFIX) + "file")));
+  ASSERT_SOME(os::write(path::join(layer2, "link"), "test2"));
+  ASSERT_SOME(os::write(path::join(layer2, "hardlink1"), "hardlink"));
+  ASSERT_EQ(0, ::link(
+      path::join(layer2, "hardlink1").c_str(),
+      path::join(layer2, "hardlink2").c_str()));
+
+  string rootfs = path::join(sandbox.get(), "rootfs");
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends.contains(COPY_BACKEND));
+
+  AWAIT_READY(backends[COPY_BACKEND]->provision(
+      {layer1, layer2},
+      rootfs,
+      sandbox.get()));
+
+  EXPECT_SOME_EQ("1", os::read(path::join(rootfs, "dir1", "1")));
+
+  // The opaque whiteout hides the content of `dir2` in the first layer.
+  EXPECT_FALSE(os::exists(path::join(rootfs, "dir2", "2")));
+  EXPECT_SOME_EQ("3", os::read(path::join(rootfs, "dir2", "3")));
+  EXPECT_FALSE(os::exists(
+      path::join(rootfs, "dir2", docker::spec::WHITEOUT_OPAQUE_PREFIX)));
+
+  // The whiteout removes `file` of the first layer.
+  EXPECT_FALSE(os::exists(path::join(rootfs, "file")));
+  EXPECT_FALSE(os::exists(
+      path::join(rootfs, string(docker::spec::WHITEOUT_PREFIX) + "file")));
+
+  // The symlink is replaced by a regular file rather than followed.
+  EXPECT_FALSE(os::stat::islink(path::join(rootfs, "link")));
+  EXPECT_SOME_EQ("test2", os::read(path::join(rootfs, "link")));
+  EXPECT_SOME_EQ("1", os::read(path::join(layer1, "dir1", "1")));
+
+  // Hard links are preserved.
+  Try<ino_t> inode1 = os::stat::inode(path::join(rootfs, "hardlink1"));
+  Try<ino_t> inode2 = os::stat::inode(path::join(rootfs, "hardlink2"));
+  ASSERT_SOME(inode1);
+  ASSERT_SOME_EQ(inode1.get(), inode2);
+
+  AWAIT_READY(backends[COPY_BACKEND]->destroy(rootfs, sandbox.get()));
+
+  EXPECT_FALSE(os::exists(rootfs));
+}
+
+
+// Provision rootfses concurrently with two copy backends, which share
+// their metrics until the last of them is destroyed.
+TEST_F(CopyBackendTest, CopyBackendSharedMetrics)
+{
+  const string filesCopied =
+    "containerizer/mesos/provisioner/copy/files_copied";
+
+  string layer = path::join(sandbox.get(), "source");
+  ASSERT_SOME(os::mkdir(path::join(layer, "dir")));
+  ASSERT_SOME(os::write(path::join(layer, "dir", "1"), "1"));
+  ASSERT_SOME(os::write(path::join(layer, "file"), "test"));
+
+  hashmap<string, Owned<Backend>> backends1 = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends1.contains(COPY_BACKEND));
+
+  hashmap<string, Owned<Backend>> backends2 = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends2.contains(COPY_BACKEND));
+
+  string rootfs1 = path::join(sandbox.get(), "rootfs1");
+  string rootfs2 = path::join(sandbox.get(), "rootfs2");
+
+  Future<Nothing> provision1 =
+    backends1[COPY_BACKEND]->provision({layer}, rootfs1, sandbox.get());
+
+  Future<Nothing> provision2 =
+    backends2[COPY_BACKEND]->provision({layer}, rootfs2, sandbox.get());
+
+  AWAIT_READY(provision1);
+  AWAIT_READY(provision2);
+
+  EXPECT_SOME_EQ("1", os::read(path::join(rootfs1, "dir", "1")));
+  EXPECT_SOME_EQ("test", os::read(path::join(rootfs1, "file")));
+  EXPECT_SOME_EQ("1", os::read(path::join(rootfs2, "dir", "1")));
+  EXPECT_SOME_EQ("test", os::read(path::join(rootfs2, "file")));
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(4, metrics.values[filesCopied]);
+
+  // Destroying one of the backends keeps the metrics of the other.
+  backends1.clear();
+
+  metrics = Metrics();
+  EXPECT_EQ(4, metrics.values[filesCopied]);
+
+  backends2.clear();
+
+  metrics = Metrics();
+  EXPECT_EQ(0u, metrics.values.count(filesCopied));
+}
+
+
+class CopyBackend_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<std::tuple<size_t, size_t>> {};
+
+
+// The copy backend benchmark tests are parameterized by the number of
+// layers and the number of files in each layer.
+INSTANTIATE_TEST_CASE_P(
+    LayerAndFileCount,
+    CopyBackend_BENCHMARK_Test,
+    ::testing::Combine(
+      ::testing::Values(1U, 5U, 20U),
+      ::testing::Values(100U, 1000U, 10000U)));
+
+
+// Provisions a rootfs from a synthetic multi-layer image in a local
+// directory. Each layer contains directories of 64KB files.
+TEST_P(CopyBackend_BENCHMARK_Test, Provision)
+{
+  const size_t layerCount = std::get<0>(GetParam());
+  const size_t fileCount = std::get<1>(GetParam());
+
+  const string content(64 * 1024, 'x');
+
+  vector<string> layers;
+  for (size_t i = 0; i < layerCount; i++) {
+    string layer = path::join(sandbox.get(), "layer" + stringify(i));
+
+    for (size_t j = 0; j < fileCount; j++) {
+      string directory = path::join(layer, stringify(j % 100));
+      ASSERT_SOME(os::mkdir(directory));
+      ASSERT_SOME(os::write(path::join(directory, stringify(j)), content));
+    }
+
+    layers.push_back(layer);
+  }
+
+  string rootfs = path::join(sandbox.get(), "rootfs");
+
+  hashmap<string, Owned<Backend>> backends = Backend::create(slave::Flags());
+  ASSERT_TRUE(backends.contains(COPY_BACKEND));
+
+  Stopwatch watch;
+  watch.start();
+
+  AWAIT_READY_FOR(
+      backends[COPY_BACKEND]->provision(layers, rootfs, sandbox.get()),
+      Minutes(10));
+
+  watch.stop();
+
+  cout << "Provisioned " << layerCount << " layers with " << fileCount
+       << " files each in " << watch.elapsed() << endl;
+
+  AWAIT_READY_FOR(
+      backends[COPY_BACKEND]->destroy(rootfs, sandbox.get()),
+      Minutes(10));
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
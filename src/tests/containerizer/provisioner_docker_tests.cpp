@@ -14,14 +14,18 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <utility>
+
 #include <gmock/gmock.h>
 
 #include <stout/duration.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
 #include <stout/json.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/stringify.hpp>
+#include <stout/strings.hpp>
 
 #include <process/future.hpp>
 #include <process/gmock.hpp>
@@ -29,6 +33,8 @@
 
 #include <mesos/docker/spec.hpp>
 
+#include "common/command_utils.hpp"
+
 #ifdef __linux__
 #include "linux/fs.hpp"
 #endif // __linux__
@@ -36,6 +42,8 @@
 #include "slave/containerizer/mesos/provisioner/constants.hpp"
 #include "slave/containerizer/mesos/provisioner/paths.hpp"
 
+#include "slave/containerizer/mesos/provisioner/docker/extractor.hpp"
+#include "slave/containerizer/mesos/provisioner/docker/local_puller.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/metadata_manager.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/paths.hpp"
 #include "slave/containerizer/mesos/provisioner/docker/puller.hpp"
@@ -55,9 +63,11 @@ namespace paths = mesos::internal::slave::docker::paths;
 namespace slave = mesos::internal::slave;
 namespace spec = ::docker::spec;
 
+using std::pair;
 using std::string;
 using std::vector;
 
+using process::Failure;
 using process::Future;
 using process::Owned;
 using process::PID;
@@ -75,6 +85,7 @@ using mesos::master::detector::MasterDetector;
 using slave::ImageInfo;
 using slave::Slave;
 
+using slave::docker::LocalPuller;
 using slave::docker::Puller;
 using slave::docker::RegistryPuller;
 using slave::docker::Store;
@@ -241,6 +252,125 @@ TEST_F(ProvisionerDockerLocalStoreTest, MetadataManagerInitialization)
 }
 
 
+// This test verifies that the metadata manager prunes the least
+// recently used images until the store fits in its maximum size, and
+// only prunes the layers which are not referenced by other images.
+TEST_F(ProvisionerDockerLocalStoreTest, MetadataManagerPruneLeastRecentlyUsed)
+{
+  slave::Flags flags;
+  flags.docker_store_dir = path::join(os::getcwd(), "store");
+  ASSERT_SOME(os::mkdir(flags.docker_store_dir));
+
+  Try<Owned<slave::docker::MetadataManager>> metadataManager =
+    slave::docker::MetadataManager::create(flags);
+
+  ASSERT_SOME(metadataManager);
+  AWAIT_READY(metadataManager.get()->recover());
+
+  Try<spec::ImageReference> a = spec::parseImageReference("a");
+  Try<spec::ImageReference> b = spec::parseImageReference("b");
+  Try<spec::ImageReference> c = spec::parseImageReference("c");
+
+  ASSERT_SOME(a);
+  ASSERT_SOME(b);
+  ASSERT_SOME(c);
+
+  AWAIT_READY(metadataManager.get()->put(
+      a.get(), {"base", "a"}, {{"base", Bytes(10)}, {"a", Bytes(10)}}));
+
+  AWAIT_READY(metadataManager.get()->put(
+      b.get(), {"base", "b"}, {{"b", Bytes(10)}}));
+
+  AWAIT_READY(metadataManager.get()->put(
+      c.get(), {"c"}, {{"c", Bytes(10)}}));
+
+  // Using 'a' makes 'b' the least recently used image.
+  AWAIT_READY(metadataManager.get()->get(a.get(), true));
+
+  Future<hashset<string>> pruned =
+    metadataManager.get()->prune({}, {}, Bytes(25));
+
+  AWAIT_READY(pruned);
+  EXPECT_EQ(hashset<string>({"b", "c"}), pruned.get());
+
+  // The index is recovered from the checkpointed images.
+  metadataManager->reset();
+  metadataManager = slave::docker::MetadataManager::create(flags);
+
+  ASSERT_SOME(metadataManager);
+  AWAIT_READY(metadataManager.get()->recover());
+
+  Future<Option<slave::docker::Image>> image =
+    metadataManager.get()->get(a.get(), true);
+
+  AWAIT_READY(image);
+  EXPECT_SOME(image.get());
+
+  // Layers used by active containers are not pruned.
+  pruned = metadataManager.get()->prune({}, {"base"});
+
+  AWAIT_READY(pruned);
+  EXPECT_EQ(hashset<string>({"a"}), pruned.get());
+}
+
+
+// This test verifies that the metadata manager sizes the layers found
+// in the store which it has not indexed, both when it recovers and
+// when an image is put with layers that were already in the store.
+TEST_F(ProvisionerDockerLocalStoreTest, MetadataManagerIndexStoredLayers)
+{
+  slave::Flags flags;
+  flags.docker_store_dir = path::join(os::getcwd(), "store");
+
+  auto createLayer = [&flags](const string& layerId) -> Try<Nothing> {
+    const string layerPath =
+      paths::getImageLayerPath(flags.docker_store_dir, layerId);
+
+    Try<Nothing> mkdir = os::mkdir(layerPath);
+    if (mkdir.isError()) {
+      return mkdir;
+    }
+
+    return os::write(
+        path::join(layerPath, "file"),
+        string(Kilobytes(64).bytes(), 'x'));
+  };
+
+  // The layer is in the store but not in the (missing) images file.
+  ASSERT_SOME(createLayer("x"));
+
+  Try<Owned<slave::docker::MetadataManager>> metadataManager =
+    slave::docker::MetadataManager::create(flags);
+
+  ASSERT_SOME(metadataManager);
+  AWAIT_READY(metadataManager.get()->recover());
+
+  // The layer is moved into the store after the recovery.
+  ASSERT_SOME(createLayer("z"));
+
+  Try<spec::ImageReference> a = spec::parseImageReference("a");
+  Try<spec::ImageReference> b = spec::parseImageReference("b");
+  Try<spec::ImageReference> c = spec::parseImageReference("c");
+
+  ASSERT_SOME(a);
+  ASSERT_SOME(b);
+  ASSERT_SOME(c);
+
+  AWAIT_READY(metadataManager.get()->put(a.get(), {"x"}, {}));
+  AWAIT_READY(metadataManager.get()->put(c.get(), {"z"}, {}));
+  AWAIT_READY(metadataManager.get()->put(
+      b.get(), {"y"}, {{"y", Bytes(10)}}));
+
+  // Both 'a' and 'c' need to be pruned for the store to fit, which it
+  // would already do if their layers were not sized.
+  Future<hashset<string>> pruned =
+    metadataManager.get()->prune({}, {}, Kilobytes(1));
+
+  AWAIT_READY(pruned);
+  EXPECT_EQ(hashset<string>({"x", "z"}), pruned.get());
+}
+
+
 // This test verifies that the layer that is missing from the store
 // will be pulled.
 TEST_F(ProvisionerDockerLocalStoreTest, MissingLayer)
@@ -274,6 +404,50 @@ TEST_F(ProvisionerDockerLocalStoreTest, MissingLayer)
 }
 
 
+// This test verifies that the local puller only extracts the layers
+// which are not in the store yet, streaming them out of the image
+// archive without writing the layer tar balls to disk.
+TEST_F(ProvisionerDockerLocalStoreTest, LocalPullerExtractsMissingLayers)
+{
+  slave::Flags flags;
+  flags.docker_registry = path::join(os::getcwd(), "images");
+  flags.docker_store_dir = path::join(os::getcwd(), "store");
+
+  ASSERT_SOME(os::mkdir(paths::getImageLayerRootfsPath(
+      flags.docker_store_dir, "123", COPY_BACKEND)));
+
+  Try<Owned<Puller>> puller = LocalPuller::create(flags);
+  ASSERT_SOME(puller);
+
+  Try<spec::ImageReference> reference = spec::parseImageReference("abc");
+  ASSERT_SOME(reference);
+
+  const string directory = path::join(os::getcwd(), "staging");
+  ASSERT_SOME(os::mkdir(directory));
+
+  Future<vector<string>> layerIds = puller.get()->pull(
+      reference.get(), directory, COPY_BACKEND);
+
+  AWAIT_READY(layerIds);
+  EXPECT_EQ((vector<string>{"123", "456"}), layerIds.get());
+
+  const string layerPath123 = path::join(directory, "123");
+  const string layerPath456 = path::join(directory, "456");
+
+  EXPECT_FALSE(os::exists(
+      paths::getImageLayerRootfsPath(layerPath123, COPY_BACKEND)));
+
+  EXPECT_SOME_EQ(
+      "bar 456",
+      os::read(path::join(
+          paths::getImageLayerRootfsPath(layerPath456, COPY_BACKEND),
+          "temp")));
+
+  EXPECT_FALSE(os::exists(paths::getImageLayerTarPath(layerPath123)));
+  EXPECT_FALSE(os::exists(paths::getImageLayerTarPath(layerPath456)));
+}
+
+
 class MockPuller : public Puller
 {
 public:
@@ -370,6 +544,233 @@ TEST_F(ProvisionerDockerLocalStoreTest, PullingSameImageSimutanuously)
 }
 
 
+class ProvisionerDockerExtractorTest : public TemporaryDirectoryTest
+{
+protected:
+  virtual void SetUp()
+  {
+    TemporaryDirectoryTest::SetUp();
+
+    const string layer = path::join(os::getcwd(), "layer");
+
+    ASSERT_SOME(os::mkdir(path::join(layer, "etc", "conf.d")));
+    ASSERT_SOME(os::write(path::join(layer, "etc", "conf.d", "foo"), "foo"));
+    ASSERT_SOME(os::write(path::join(layer, string(150, 'a')), "long"));
+    ASSERT_SOME(::fs::symlink("conf.d/foo", path::join(layer, "etc", "link")));
+    ASSERT_SOME(os::chmod(path::join(layer, "etc", "conf.d"), 0555));
+
+    AWAIT_READY(command::tar(
+        Path("."),
+        Path(path::join(os::getcwd(), "layer.tar.gz")),
+        Path(layer),
+        command::Compression::GZIP));
+  }
+
+  virtual void TearDown()
+  {
+    // Make the read-only directories removable.
+    const vector<string> directories = {"layer", "rootfs"};
+
+    foreach (const string& directory, directories) {
+      const string path = path::join(os::getcwd(), directory, "etc", "conf.d");
+      if (os::exists(path)) {
+        ASSERT_SOME(os::chmod(path, 0755));
+      }
+    }
+
+    TemporaryDirectoryTest::TearDown();
+  }
+
+  // Returns a ustar entry with the given name, type, link name and
+  // content, to craft malicious layers that `tar` would not create.
+  static string entry(
+      const string& name,
+      char type,
+      const string& link = "",
+      const string& content = "",
+      unsigned int mode = 0644)
+  {
+    string header(512, '\0');
+
+    name.copy(&header[0], 100);
+    ::snprintf(&header[100], 8, "%07o", mode);
+    ::snprintf(&header[108], 8, "%07o", 0);
+    ::snprintf(&header[116], 8, "%07o", 0);
+    ::snprintf(&header[124], 12, "%011o", (unsigned int) content.size());
+    ::snprintf(&header[136], 12, "%011o", 0);
+    header[156] = type;
+    link.copy(&header[157], 100);
+    header.replace(257, 8, "ustar\0" "00", 8);
+
+    // The checksum is computed with the checksum field set to spaces.
+    header.replace(148, 8, 8, ' ');
+
+    unsigned int checksum = 0;
+    foreach (char c, header) {
+      checksum += static_cast<unsigned char>(c);
+    }
+
+    ::snprintf(&header[148], 8, "%06o", checksum);
+
+    return header + content +
+      string((512 - content.size() % 512) % 512, '\0');
+  }
+
+  // Extracts a layer consisting of the given entries into a new
+  // rootfs with the given name.
+  Future<Nothing> extract(const string& name, const vector<string>& entries)
+  {
+    const string rootfs = path::join(os::getcwd(), name);
+    const string tar = rootfs + ".tar";
+
+    Try<Nothing> mkdir = os::mkdir(rootfs);
+    if (mkdir.isError()) {
+      return Failure(mkdir.error());
+    }
+
+    Try<Nothing> write =
+      os::write(tar, strings::join("", entries) + string(1024, '\0'));
+
+    if (write.isError()) {
+      return Failure(write.error());
+    }
+
+    return slave::docker::extractLayer(tar, rootfs);
+  }
+};
+
+
+// This test verifies that a gzip compressed layer tarball is extracted
+// natively, preserving symbolic links, long names and permissions.
+TEST_F(ProvisionerDockerExtractorTest, ExtractLayer)
+{
+  const string rootfs = path::join(os::getcwd(), "rootfs");
+  ASSERT_SOME(os::mkdir(rootfs));
+
+  AWAIT_READY(slave::docker::extractLayer(
+      path::join(os::getcwd(), "layer.tar.gz"),
+      rootfs));
+
+  EXPECT_SOME_EQ("foo", os::read(path::join(rootfs, "etc", "conf.d", "foo")));
+  EXPECT_SOME_EQ("foo", os::read(path::join(rootfs, "etc", "link")));
+  EXPECT_SOME_EQ("long", os::read(path::join(rootfs, string(150, 'a'))));
+
+  EXPECT_TRUE(os::stat::islink(path::join(rootfs, "etc", "link")));
+
+  Try<mode_t> mode = os::stat::mode(path::join(rootfs, "etc", "conf.d"));
+  ASSERT_SOME(mode);
+  EXPECT_EQ(0555u, mode.get() & 07777);
+}
+
+
+// This test verifies that layers cannot write outside of the rootfs
+// through entries containing '..'.
+TEST_F(ProvisionerDockerExtractorTest, RejectTraversal)
+{
+  AWAIT_FAILED(extract("rootfs", {entry("../escape", '0', "", "evil")}));
+
+  EXPECT_FALSE(os::exists(path::join(os::getcwd(), "escape")));
+}
+
+
+// This test verifies that layers cannot reach outside of the rootfs
+// through the symbolic links they contain, neither to write files, to
+// hard link files, nor to change the metadata of directories.
+TEST_F(ProvisionerDockerExtractorTest, RejectSymlinkEscape)
+{
+  const string outside = path::join(os::getcwd(), "outside");
+
+  ASSERT_SOME(os::mkdir(outside));
+  ASSERT_SOME(os::write(path::join(outside, "secret"), "secret"));
+  ASSERT_SOME(os::chmod(outside, 0700));
+
+  AWAIT_FAILED(extract("write", {
+      entry("x", '2', outside),
+      entry("x/evil", '0', "", "evil")}));
+
+  EXPECT_FALSE(os::exists(path::join(outside, "evil")));
+
+  AWAIT_FAILED(extract("link", {
+      entry("x", '2', outside),
+      entry("y", '1', "x/secret")}));
+
+  EXPECT_FALSE(os::exists(path::join(os::getcwd(), "link", "y")));
+
+  // The metadata of the directory 'd' is set once the layer is
+  // extracted, by which time 'd' is a symbolic link.
+  AWAIT_READY(extract("metadata", {
+      entry("d", '5', "", "", 0777),
+      entry("d", '2', outside)}));
+
+  EXPECT_TRUE(os::stat::islink(path::join(os::getcwd(), "metadata", "d")));
+
+  Try<mode_t> mode = os::stat::mode(outside);
+  ASSERT_SOME(mode);
+  EXPECT_EQ(0700u, mode.get() & 07777);
+}
+
+
+// This test verifies that the records of pax global headers apply to
+// all the following entries, unless overridden by a pax extended
+// header, and that the records identifying a single entry are ignored.
+TEST_F(ProvisionerDockerExtractorTest, PaxGlobalHeader)
+{
+  AWAIT_READY(extract("rootfs", {
+      entry("global", 'g', "", "20 mtime=1000000000\n13 path=evil\n"),
+      entry("a", '0', "", "a"),
+      entry("extended", 'x', "", "20 mtime=2000000000\n"),
+      entry("b", '0', "", "b"),
+      entry("c", '0', "", "c"),
+      entry("global", 'g', "", "9 mtime=\n"),
+      entry("d", '0', "", "d")}));
+
+  const string rootfs = path::join(os::getcwd(), "rootfs");
+
+  EXPECT_FALSE(os::exists(path::join(rootfs, "evil")));
+
+  const vector<pair<string, time_t>> mtimes = {
+    {"a", 1000000000},
+    {"b", 2000000000},
+    {"c", 1000000000},
+    {"d", 0}};
+
+  foreach (const auto& mtime, mtimes) {
+    EXPECT_SOME_EQ(mtime.first, os::read(path::join(rootfs, mtime.first)));
+
+    struct stat s;
+    ASSERT_EQ(0, ::stat(path::join(rootfs, mtime.first).c_str(), &s));
+    EXPECT_EQ(mtime.second, s.st_mtime) << mtime.first;
+  }
+}
+
+
+#ifdef USE_SSL_SOCKET
+// This test verifies that the digest of a layer tarball is verified
+// while it is being extracted.
+TEST_F(ProvisionerDockerExtractorTest, VerifyLayerDigest)
+{
+  const string tar = path::join(os::getcwd(), "layer.tar.gz");
+
+  Future<string> sha512 = command::sha512(Path(tar));
+  AWAIT_READY(sha512);
+
+  const string rootfs = path::join(os::getcwd(), "rootfs");
+  ASSERT_SOME(os::mkdir(rootfs));
+
+  AWAIT_READY(
+      slave::docker::extractLayer(tar, rootfs, "sha512:" + sha512.get()));
+
+  const string corrupted = path::join(os::getcwd(), "corrupted");
+  ASSERT_SOME(os::mkdir(corrupted));
+
+  AWAIT_FAILED(slave::docker::extractLayer(
+      tar,
+      corrupted,
+      "sha512:" + string(128, '0')));
+}
+#endif // USE_SSL_SOCKET
+
+
 #ifdef __linux__
 class ProvisionerDockerTest
   : public MesosTest,
@@ -450,6 +851,14 @@ TEST_F(ProvisionerDockerTest, ROOT_LocalPullerSimpleCommand)
   EXPECT_EQ(task.task_id(), statusRunning->task_id());
   EXPECT_EQ(TASK_RUNNING, statusRunning->state());
 
+  // The time the container took to start running, and the part of it
+  // spent provisioning the image, are exposed as metrics.
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(1u, metrics.values.count(
+      "containerizer/mesos/container_start_latency_ms"));
+  EXPECT_EQ(1u, metrics.values.count(
+      "containerizer/mesos/provisioner/provision_latency_ms"));
+
   AWAIT_READY(statusFinished);
   EXPECT_EQ(task.task_id(), statusFinished->task_id());
   EXPECT_EQ(TASK_FINISHED, statusFinished->state());
@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <iostream>
 #include <memory>
 #include <set>
 #include <string>
@@ -40,6 +41,7 @@
 #include <stout/none.hpp>
 #include <stout/nothing.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/uri.hpp>
 
 #include <stout/os/exists.hpp>
@@ -62,10 +64,13 @@ using mesos::v1::scheduler::Mesos;
 
 using process::Future;
 using process::Owned;
+using process::Promise;
 
 using process::http::OK;
 using process::http::Response;
 
+using std::cout;
+using std::endl;
 using std::pair;
 using std::set;
 using std::string;
@@ -74,6 +79,7 @@ using std::vector;
 using testing::_;
 using testing::AllOf;
 using testing::DoAll;
+using testing::Invoke;
 using testing::Return;
 using testing::WithParamInterface;
 
@@ -3461,6 +3467,114 @@ TEST_P_TEMP_DISABLED_ON_WINDOWS(DefaultExecutorTest, ROOT_LaunchGroupFailure)
   AWAIT_READY(executorFailure);
 }
 
+
+class DefaultExecutor_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<size_t> {};
+
+
+// The benchmark is parameterized by the number of tasks in the task group.
+INSTANTIATE_TEST_CASE_P(
+    TaskGroupSize,
+    DefaultExecutor_BENCHMARK_Test,
+    ::testing::Values(10U, 100U, 500U));
+
+
+// This benchmark measures how long it takes the default executor to
+// launch a task group, from the `LAUNCH_GROUP` operation until all of
+// its tasks are reported as TASK_RUNNING.
+TEST_P(DefaultExecutor_BENCHMARK_Test, LaunchGroup)
+{
+  const size_t taskCount = GetParam();
+
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.resources = "cpus:8;mem:4096;disk:4096";
+
+  Owned<MasterDetector> detector = master.get()->createDetector();
+  Try<Owned<cluster::Slave>> slave = StartSlave(detector.get(), flags);
+  ASSERT_SOME(slave);
+
+  auto scheduler = std::make_shared<v1::MockHTTPScheduler>();
+
+  EXPECT_CALL(*scheduler, connected(_))
+    .WillOnce(v1::scheduler::SendSubscribe(v1::DEFAULT_FRAMEWORK_INFO));
+
+  Future<v1::scheduler::Event::Subscribed> subscribed;
+  EXPECT_CALL(*scheduler, subscribed(_, _))
+    .WillOnce(FutureArg<1>(&subscribed));
+
+  Future<v1::scheduler::Event::Offers> offers;
+  EXPECT_CALL(*scheduler, offers(_, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return());
+
+  EXPECT_CALL(*scheduler, heartbeat(_))
+    .WillRepeatedly(Return()); // Ignore heartbeats.
+
+  v1::scheduler::TestMesos mesos(
+      master.get()->pid,
+      ContentType::PROTOBUF,
+      scheduler);
+
+  AWAIT_READY(subscribed);
+  v1::FrameworkID frameworkId(subscribed->framework_id());
+
+  v1::ExecutorInfo executorInfo = v1::createExecutorInfo(
+      v1::DEFAULT_EXECUTOR_ID,
+      None(),
+      v1::Resources::parse("cpus:0.1;mem:32;disk:32").get(),
+      v1::ExecutorInfo::DEFAULT,
+      frameworkId);
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->offers().empty());
+
+  const v1::Offer& offer = offers->offers(0);
+  const v1::AgentID& agentId = offer.agent_id();
+
+  const v1::Resources taskResources =
+    v1::Resources::parse("cpus:0.01;mem:1").get();
+
+  vector<v1::TaskInfo> tasks;
+  for (size_t i = 0; i < taskCount; i++) {
+    tasks.push_back(
+        v1::createTask(agentId, taskResources, SLEEP_COMMAND(1000)));
+  }
+
+  // The scheduler library invokes the callbacks sequentially,
+  // so the counter does not need to be synchronized.
+  size_t runningCount = 0;
+  Promise<Nothing> running;
+
+  EXPECT_CALL(*scheduler, update(_, _))
+    .WillRepeatedly(DoAll(
+        v1::scheduler::SendAcknowledge(frameworkId, agentId),
+        Invoke([&](v1::scheduler::Mesos*,
+                   const v1::scheduler::Event::Update& update) {
+          if (update.status().state() == v1::TASK_RUNNING &&
+              ++runningCount == taskCount) {
+            running.set(Nothing());
+          }
+        })));
+
+  Stopwatch watch;
+  watch.start();
+
+  mesos.send(
+      v1::createCallAccept(
+          frameworkId,
+          offer,
+          {v1::LAUNCH_GROUP(executorInfo, v1::createTaskGroupInfo(tasks))}));
+
+  AWAIT_READY_FOR(running.future(), Minutes(5));
+
+  cout << "Launched a task group of " << taskCount << " tasks in "
+       << watch.elapsed() << endl;
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
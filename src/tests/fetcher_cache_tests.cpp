@@ -39,6 +39,7 @@
 #include <process/queue.hpp>
 #include <process/subprocess.hpp>
 
+#include <stout/hashmap.hpp>
 #include <stout/json.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
@@ -76,6 +77,7 @@ using mesos::internal::slave::FetcherProcess;
 using mesos::master::detector::MasterDetector;
 
 using process::TEST_AWAIT_TIMEOUT;
+using process::Clock;
 using process::Future;
 using process::HttpEvent;
 using process::Latch;
@@ -1129,6 +1131,29 @@ TEST_F(FetcherCacheHttpTest, HttpCachedConcurrent)
 
   verifyCacheMetrics();
 
+  // Only one task downloads the command into the cache, the others
+  // reuse its download.
+  Try<Bytes> commandSize = os::stat::size(commandPath);
+  ASSERT_SOME(commandSize);
+
+  JSON::Object metrics = Metrics();
+
+  EXPECT_SOME_EQ(
+      1u,
+      metrics.at<JSON::Number>("containerizer/fetcher/cache_misses"));
+
+  EXPECT_SOME_EQ(
+      countTasks - 1,
+      metrics.at<JSON::Number>("containerizer/fetcher/cache_hits"));
+
+  EXPECT_SOME_EQ(
+      commandSize->bytes(),
+      metrics.at<JSON::Number>("containerizer/fetcher/cache_bytes_downloaded"));
+
+  EXPECT_SOME_EQ(
+      (countTasks - 1) * commandSize->bytes(),
+      metrics.at<JSON::Number>("containerizer/fetcher/cache_bytes_reused"));
+
   // HTTP requests regarding the archive asset as follows. Archive
   // "content-length" requests: 1, archive file downloads: 2.
   EXPECT_EQ(2u, httpServer->countCommandRequests);
@@ -1706,6 +1731,112 @@ TEST_F(FetcherCacheTest, RemoveLRUCacheEntries)
   EXPECT_TRUE(cmd2Found);
 }
 
+
+// Tests that the GDSF eviction policy evicts the cache entry that is
+// requested least often per byte, whereas the LRU eviction policy
+// evicts the least recently used one.
+TEST_F(FetcherCacheTest, EvictionPolicy)
+{
+  // Charge all entries the same fetch time.
+  Clock::pause();
+
+  const hashmap<string, string> survivors = {
+    {"lru", "b"},
+    {"gdsf", "a"}
+  };
+
+  foreachpair (const string& policy, const string& survivor, survivors) {
+    const string directory = path::join(flags.fetcher_cache_dir, policy);
+    ASSERT_SOME(os::mkdir(directory));
+
+    FetcherProcess::Cache cache(Bytes(20), directory, policy);
+
+    foreach (const string& name, vector<string>({"a", "b"})) {
+      CommandInfo::URI uri;
+      uri.set_value(path::join(assetsDirectory, name));
+
+      std::shared_ptr<FetcherProcess::Cache::Entry> entry =
+        cache.create(directory, None(), uri);
+
+      ASSERT_SOME(os::write(entry->path().string(), string(10, 'x')));
+
+      cache.claimSpace(Bytes(10));
+      entry->size = Bytes(10);
+
+      cache.complete(entry);
+    }
+
+    // Request "a" more often, but "b" more recently.
+    cache.get(None(), path::join(assetsDirectory, "a"));
+    cache.get(None(), path::join(assetsDirectory, "a"));
+    cache.get(None(), path::join(assetsDirectory, "b"));
+
+    ASSERT_SOME(cache.reserve(Bytes(10)));
+
+    EXPECT_EQ(1u, cache.size());
+    EXPECT_TRUE(cache.contains(None(), path::join(assetsDirectory, survivor)))
+      << policy;
+  }
+
+  Clock::resume();
+}
+
+
+// Tests that the completed cache entries are recovered after a
+// restart, and that any other files in the cache directory are
+// removed.
+TEST_F(FetcherCacheTest, RecoverCacheEntries)
+{
+  const string directory = flags.fetcher_cache_dir;
+  ASSERT_SOME(os::mkdir(directory));
+
+  vector<string> paths;
+
+  {
+    FetcherProcess::Cache cache(Bytes(100), directory, "lru");
+
+    foreach (const string& name, vector<string>({"a", "b", "c"})) {
+      CommandInfo::URI uri;
+      uri.set_value(path::join(assetsDirectory, name));
+
+      std::shared_ptr<FetcherProcess::Cache::Entry> entry =
+        cache.create(directory, None(), uri);
+
+      ASSERT_SOME(os::write(entry->path().string(), string(10, 'x')));
+
+      cache.claimSpace(Bytes(10));
+      entry->size = Bytes(10);
+
+      // Leave the last entry as a partial download.
+      if (name != "c") {
+        cache.complete(entry);
+      }
+
+      paths.push_back(entry->path().string());
+    }
+  }
+
+  // Tamper with the file of the second entry.
+  ASSERT_SOME(os::write(paths[1], "tampered"));
+
+  FetcherProcess::Cache cache(Bytes(100), directory, "lru");
+  ASSERT_SOME(cache.recover());
+
+  EXPECT_EQ(1u, cache.size());
+  EXPECT_EQ(Bytes(10), cache.usedSpace());
+  EXPECT_TRUE(cache.contains(None(), path::join(assetsDirectory, "a")));
+
+  EXPECT_TRUE(os::exists(paths[0]));
+  EXPECT_FALSE(os::exists(paths[1]));
+  EXPECT_FALSE(os::exists(paths[2]));
+
+  // New entries must not reuse the file names of recovered ones.
+  CommandInfo::URI uri;
+  uri.set_value(path::join(assetsDirectory, "a"));
+
+  EXPECT_NE(Path(paths[0]).basename(), cache.nextFilename(uri));
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
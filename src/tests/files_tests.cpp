@@ -14,6 +14,7 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <memory>
 #include <string>
 
 #include <gmock/gmock.h>
@@ -23,6 +24,7 @@
 #include <process/future.hpp>
 #include <process/gtest.hpp>
 #include <process/http.hpp>
+#include <process/loop.hpp>
 #include <process/pid.hpp>
 #include <process/process.hpp>
 
@@ -240,6 +242,157 @@ TEST_F(FilesTest, ReadTest)
 }
 
 
+// Tests raw reads, which return the contents of the file directly
+// and honor byte ranges.
+TEST_F(FilesTest, RawReadTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "body"));
+  AWAIT_EXPECT_READY(files.attach("file", "myname"));
+
+  Future<Response> response =
+    process::http::get(upid, "read", "path=myname&raw=true");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes", "Accept-Ranges", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("body", response);
+
+  response =
+    process::http::get(upid, "read", "path=myname&raw=true&offset=1&length=2");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 1-2/4", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("od", response);
+
+  // The 'Range' header is honored in the absence of an offset.
+  process::http::Headers headers;
+  headers["Range"] = "bytes=-3";
+
+  response = process::http::get(upid, "read", "path=myname&raw=true", headers);
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes 1-3/4", "Content-Range", response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("ody", response);
+
+  // Reading past the end of the file returns its size.
+  response = process::http::get(upid, "read", "path=myname&raw=true&offset=4");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(
+          process::http::Status::REQUESTED_RANGE_NOT_SATISFIABLE),
+      response);
+  AWAIT_EXPECT_RESPONSE_HEADER_EQ("bytes */4", "Content-Range", response);
+
+  // Missing file.
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      NotFound().status,
+      process::http::get(upid, "read", "path=missing&raw=true"));
+}
+
+
+// Tests that a read at the end of a file with `follow=true` returns
+// once data is appended to the file.
+TEST_F(FilesTest, FollowReadTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "body"));
+  AWAIT_EXPECT_READY(files.attach("file", "myname"));
+
+  Future<Response> response =
+    process::http::get(upid, "read", "path=myname&offset=4&follow=true");
+
+  ASSERT_TRUE(response.isPending());
+
+  ASSERT_SOME(os::write("file", "body and more"));
+
+  JSON::Object expected;
+  expected.values["offset"] = 4;
+  expected.values["data"] = " and more";
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ(stringify(expected), response);
+
+  response = process::http::get(
+      upid, "read", "path=myname&offset=13&raw=true&follow=true");
+
+  ASSERT_TRUE(response.isPending());
+
+  ASSERT_SOME(os::write("file", "body and more!"));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      process::http::Status::string(process::http::Status::PARTIAL_CONTENT),
+      response);
+  AWAIT_EXPECT_RESPONSE_BODY_EQ("!", response);
+}
+
+
+// Tests that `/files/tail` streams the contents of a file along with
+// the data appended to it afterwards.
+TEST_F(FilesTest, TailTest)
+{
+  Files files;
+  process::UPID upid("files", process::address());
+
+  ASSERT_SOME(os::write("file", "body"));
+  AWAIT_EXPECT_READY(files.attach("file", "myname"));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(
+      NotFound().status,
+      process::http::get(upid, "tail", "path=missing"));
+
+  Future<Response> response =
+    process::http::streaming::get(upid, "tail", "path=myname&offset=1");
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+  ASSERT_EQ(Response::PIPE, response->type);
+  ASSERT_SOME(response->reader);
+
+  process::http::Pipe::Reader reader = response->reader.get();
+
+  // Reads from the stream until `length` bytes have been received, as
+  // the data may be split into chunks arbitrarily.
+  auto receive = [&reader](size_t length) {
+    std::shared_ptr<string> data(new string());
+
+    return process::loop(
+        None(),
+        [reader]() mutable { return reader.read(); },
+        [data, length](const string& chunk)
+            -> process::ControlFlow<string> {
+          data->append(chunk);
+
+          if (chunk.empty() || data->size() >= length) {
+            return process::Break(*data);
+          }
+
+          return process::Continue();
+        });
+  };
+
+  AWAIT_EXPECT_EQ("ody", receive(3));
+
+  Future<string> appended = receive(9);
+  EXPECT_TRUE(appended.isPending());
+
+  Try<int_fd> fd = os::open("file", O_WRONLY | O_APPEND | O_CLOEXEC);
+  ASSERT_SOME(fd);
+  ASSERT_SOME(os::write(fd.get(), " and more"));
+  os::close(fd.get());
+
+  AWAIT_EXPECT_EQ(" and more", appended);
+
+  EXPECT_TRUE(reader.close());
+}
+
+
 TEST_F_TEMP_DISABLED_ON_WINDOWS(FilesTest, ResolveTest)
 {
   Files files;
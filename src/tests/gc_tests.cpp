@@ -36,6 +36,7 @@
 #include <process/timeout.hpp>
 
 #include <stout/duration.hpp>
+#include <stout/fs.hpp>
 #include <stout/gtest.hpp>
 #include <stout/nothing.hpp>
 #include <stout/os.hpp>
@@ -281,6 +282,110 @@ TEST_F(GarbageCollectorTest, Prune)
 }
 
 
+#ifndef __WINDOWS__
+// This test verifies that directory trees are removed along with their
+// contents, without following symbolic links out of the tree, and that
+// the reclaimed disk space is reported.
+TEST_F(GarbageCollectorTest, RemoveDirectory)
+{
+  GarbageCollector gc(4);
+
+  const string target = path::join(sandbox.get(), "target");
+  ASSERT_SOME(os::write(target, "target"));
+
+  // Make some directory trees to gc.
+  vector<string> directories;
+  for (int i = 0; i < 8; i++) {
+    const string directory = path::join(sandbox.get(), stringify(i));
+    const string nested = path::join(directory, "a", "b", "c");
+
+    ASSERT_SOME(os::mkdir(nested));
+    ASSERT_SOME(os::write(path::join(directory, "file"), string(8192, 'x')));
+    ASSERT_SOME(os::write(path::join(nested, "file"), string(8192, 'x')));
+    ASSERT_SOME(::fs::symlink(target, path::join(nested, "link")));
+
+    directories.push_back(directory);
+  }
+
+  Clock::pause();
+
+  list<Future<Nothing>> schedules;
+  foreach (const string& directory, directories) {
+    schedules.push_back(gc.schedule(Seconds(10), directory));
+  }
+
+  Clock::settle();
+  Clock::advance(Seconds(10));
+
+  foreach (const Future<Nothing>& schedule, schedules) {
+    AWAIT_READY(schedule);
+  }
+
+  foreach (const string& directory, directories) {
+    EXPECT_FALSE(os::exists(directory));
+  }
+
+  EXPECT_SOME_EQ("target", os::read(target));
+
+  JSON::Object metrics = Metrics();
+
+  ASSERT_EQ(1u, metrics.values.count("gc/bytes_reclaimed"));
+  EXPECT_LE(
+      8 * 2 * 8192,
+      metrics.at<JSON::Number>("gc/bytes_reclaimed")->as<int64_t>());
+
+  EXPECT_SOME_EQ(
+      8u,
+      metrics.at<JSON::Number>("gc/path_removals_succeeded"));
+
+  Clock::resume();
+}
+
+
+// This test verifies that directory trees deeper than the number of
+// directories the garbage collector keeps open at once are removed.
+TEST_F(GarbageCollectorTest, RemoveDeepDirectory)
+{
+  GarbageCollector gc(1);
+
+  const string target = path::join(sandbox.get(), "target");
+  ASSERT_SOME(os::write(target, "target"));
+
+  const string directory = path::join(sandbox.get(), "deep");
+
+  string nested = directory;
+  for (int i = 0; i < 100; i++) {
+    nested = path::join(nested, "d");
+  }
+
+  ASSERT_SOME(os::mkdir(nested));
+  ASSERT_SOME(os::write(path::join(nested, "file"), string(8192, 'x')));
+  ASSERT_SOME(::fs::symlink(sandbox.get(), path::join(nested, "link")));
+
+  Clock::pause();
+
+  Future<Nothing> schedule = gc.schedule(Seconds(10), directory);
+
+  Clock::settle();
+  Clock::advance(Seconds(10));
+
+  AWAIT_READY(schedule);
+
+  EXPECT_FALSE(os::exists(directory));
+  EXPECT_SOME_EQ("target", os::read(target));
+
+  JSON::Object metrics = Metrics();
+
+  ASSERT_EQ(1u, metrics.values.count("gc/bytes_reclaimed"));
+  EXPECT_LE(
+      8192,
+      metrics.at<JSON::Number>("gc/bytes_reclaimed")->as<int64_t>());
+
+  Clock::resume();
+}
+#endif // __WINDOWS__
+
+
 class GarbageCollectorIntegrationTest : public MesosTest {};
 
 
@@ -25,6 +25,10 @@
 
 #include <mesos/allocator/allocator.hpp>
 
+#include <mesos/authentication/http/basic_authenticator_factory.hpp>
+
+#include <mesos/authorizer/authorizer.hpp>
+
 #include <process/clock.hpp>
 #include <process/future.hpp>
 #include <process/gtest.hpp>
@@ -54,8 +58,10 @@
 
 using mesos::internal::master::MIN_CPUS;
 using mesos::internal::master::MIN_MEM;
+using mesos::internal::master::READONLY_HTTP_AUTHENTICATION_REALM;
 
 using mesos::internal::master::allocator::HierarchicalDRFAllocator;
+using mesos::internal::master::allocator::HierarchicalDRFAllocatorProcess;
 
 using mesos::internal::protobuf::createLabel;
 
@@ -63,8 +69,16 @@ using mesos::internal::slave::AGENT_CAPABILITIES;
 
 using mesos::allocator::Allocator;
 
+using mesos::http::authentication::BasicAuthenticatorFactory;
+
 using process::Clock;
 using process::Future;
+using process::Owned;
+using process::PID;
+
+using process::http::Forbidden;
+using process::http::OK;
+using process::http::Response;
 
 using std::atomic;
 using std::cout;
@@ -1059,6 +1073,93 @@ TEST_F(HierarchicalAllocatorTest, SmallOfferFilterTimeout)
 }
 
 
+// This test ensures that an offer filter which is covered by a newer
+// offer filter (i.e., the newer one filters a superset of resources
+// for at least as long) is no longer kept active.
+TEST_F(HierarchicalAllocatorTest, RedundantOfferFilter)
+{
+  // Pausing the clock is not necessary, but ensures that the test
+  // doesn't rely on the batch allocation in the allocator, which
+  // would slow down the test.
+  Clock::pause();
+
+  const string ROLE{"role"};
+
+  initialize();
+
+  FrameworkInfo framework = createFrameworkInfo({ROLE});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  SlaveInfo agent = createSlaveInfo("cpus:1;mem:512;disk:0");
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  Allocation expected = Allocation(
+      framework.id(),
+      {{ROLE, {{agent.id(), agent.resources()}}}});
+
+  Future<Allocation> allocation = allocations.get();
+  AWAIT_EXPECT_EQ(expected, allocation);
+
+  Filters offerFilter;
+  offerFilter.set_refuse_seconds((flags.allocation_interval * 100).secs());
+
+  allocator->recoverResources(
+      framework.id(),
+      agent.id(),
+      allocation->resources.at(ROLE).at(agent.id()),
+      offerFilter);
+
+  Clock::settle();
+
+  string activeOfferFilters =
+    "allocator/mesos/offer_filters/roles/" + ROLE + "/active";
+
+  JSON::Object metrics = Metrics();
+  EXPECT_EQ(1, metrics.values[activeOfferFilters]);
+
+  // Grow the agent so that its resources are no longer filtered.
+  const Resources agentResources2 =
+    Resources::parse("cpus:2;mem:1024;disk:0").get();
+
+  allocator->updateSlave(agent.id(), agent, agentResources2);
+
+  expected = Allocation(
+      framework.id(),
+      {{ROLE, {{agent.id(), agentResources2}}}});
+
+  allocation = allocations.get();
+  AWAIT_EXPECT_EQ(expected, allocation);
+
+  // Decline the offer for longer than before. The new filter covers
+  // the previous one, which is then no longer active.
+  offerFilter.set_refuse_seconds((flags.allocation_interval * 200).secs());
+
+  allocator->recoverResources(
+      framework.id(),
+      agent.id(),
+      allocation->resources.at(ROLE).at(agent.id()),
+      offerFilter);
+
+  Clock::settle();
+
+  metrics = Metrics();
+  EXPECT_EQ(1, metrics.values[activeOfferFilters]);
+
+  // Nothing is offered while the newer filter is active.
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  allocation = allocations.get();
+  EXPECT_TRUE(allocation.isPending());
+}
+
+
 // This test ensures that agents which are scheduled for maintenance are
 // properly sent inverse offers after they have accepted or reserved resources.
 TEST_F(HierarchicalAllocatorTest, MaintenanceInverseOffers)
@@ -4640,6 +4741,148 @@ TEST_F_TEMP_DISABLED_ON_WINDOWS(
 }
 
 
+// This test checks that the per-phase allocation run metrics
+// are reported in the metrics endpoint.
+TEST_F_TEMP_DISABLED_ON_WINDOWS(
+    HierarchicalAllocatorTest,
+    AllocationRunPhaseMetrics)
+{
+  Clock::pause();
+
+  initialize();
+
+  SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024;disk:0");
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  Clock::settle();
+
+  FrameworkInfo framework = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework.id(), framework, {}, true, {});
+
+  // Wait for the allocation triggered by `addFramework()` to complete.
+  AWAIT_READY(allocations.get());
+
+  Clock::settle();
+
+  JSON::Object metrics = Metrics();
+
+  auto timers = {
+    "allocator/mesos/allocation_run_sort_ms",
+    "allocator/mesos/allocation_run_quota_headroom_ms",
+    "allocator/mesos/allocation_run_filter_ms",
+    "allocator/mesos/allocation_run_resources_ms",
+    "allocator/mesos/allocation_run_offer_callback_ms",
+  };
+
+  foreach (const string& timer, timers) {
+    EXPECT_EQ(1u, metrics.values.count(timer))
+      << "Expected " << timer << " to be present";
+  }
+
+  // Each of the two allocation runs considered the agent, only the
+  // second one considered the framework.
+  JSON::Object expected;
+  expected.values = {
+    {"allocator/mesos/allocation_runs", 2},
+    {"allocator/mesos/allocation_run_agents_considered", 2},
+    {"allocator/mesos/allocation_run_agents_skipped", 0},
+    {"allocator/mesos/allocation_run_frameworks_considered", 1},
+    {"allocator/mesos/allocation_run_frameworks_skipped", 0},
+  };
+
+  EXPECT_TRUE(JSON::Value(metrics).contains(expected));
+}
+
+
+// This test verifies that requests to the allocator's `/allocation_runs`
+// endpoint are authorized with the `view_allocation_runs` ACL.
+TEST_F(HierarchicalAllocatorTest, AllocationRunsEndpointAuthorization)
+{
+  const string realm = READONLY_HTTP_AUTHENTICATION_REALM;
+
+  Credentials credentials;
+  credentials.add_credentials()->CopyFrom(DEFAULT_CREDENTIAL);
+  credentials.add_credentials()->CopyFrom(DEFAULT_CREDENTIAL_2);
+
+  Try<process::http::authentication::Authenticator*> authenticator =
+    BasicAuthenticatorFactory::create(realm, credentials);
+
+  ASSERT_SOME(authenticator);
+
+  AWAIT_READY(process::http::authentication::setAuthenticator(
+      realm,
+      Owned<process::http::authentication::Authenticator>(
+          authenticator.get())));
+
+  // Only the principal of `DEFAULT_CREDENTIAL` can view the allocation runs.
+  ACLs acls;
+
+  {
+    mesos::ACL::ViewAllocationRuns* acl = acls.add_view_allocation_runs();
+    acl->mutable_principals()->add_values(DEFAULT_CREDENTIAL.principal());
+    acl->mutable_allocation_runs()->set_type(mesos::ACL::Entity::ANY);
+  }
+
+  {
+    mesos::ACL::ViewAllocationRuns* acl = acls.add_view_allocation_runs();
+    acl->mutable_principals()->set_type(mesos::ACL::Entity::ANY);
+    acl->mutable_allocation_runs()->set_type(mesos::ACL::Entity::NONE);
+  }
+
+  Result<Authorizer*> authorizer = Authorizer::create(acls);
+  ASSERT_SOME(authorizer);
+
+  Owned<Authorizer> authorizer_(authorizer.get());
+
+  HierarchicalDRFAllocatorProcess process;
+  PID<HierarchicalDRFAllocatorProcess> pid = spawn(process);
+
+  dispatch(pid, [&]() {
+    process.initialize(
+        flags.allocation_interval,
+        [](const FrameworkID&,
+           const hashmap<string, hashmap<SlaveID, Resources>>&) {},
+        [](const FrameworkID&,
+           const hashmap<SlaveID, UnavailableResources>&) {},
+        None(),
+        true,
+        None());
+
+    process.setAuthorizer(authorizer_.get());
+  });
+
+  Future<Response> response = process::http::get(
+      pid,
+      "allocation_runs",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+  Try<JSON::Array> runs = JSON::parse<JSON::Array>(response->body);
+  EXPECT_SOME(runs);
+
+  response = process::http::get(
+      pid,
+      "allocation_runs",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL_2));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(Forbidden().status, response);
+
+  terminate(pid);
+  wait(pid);
+
+  AWAIT_READY(process::http::authentication::unsetAuthenticator(realm));
+}
+
+
 // This test checks that the allocation run latency
 // metrics are reported in the metrics endpoint.
 // TODO(xujyan): This test is structurally similar to
@@ -6234,6 +6477,122 @@ TEST_P(HierarchicalAllocations_BENCHMARK_Test, PersistentVolumes)
 }
 
 
+// This test ensures that the views of the available resources of an
+// agent cached by the allocator are invalidated when the agent's
+// resources are reserved, updated, recovered, or when the agent is
+// removed. A framework filters the agent throughout the test, so
+// that some of the allocation cycles compute the views without
+// allocating anything on the agent.
+TEST_F(HierarchicalAllocatorTest, CachedAvailableResourcesInvalidation)
+{
+  // Pause clock to disable batch allocation.
+  Clock::pause();
+
+  initialize();
+
+  const SlaveInfo agent = createSlaveInfo("cpus:2;mem:1024");
+
+  allocator->addSlave(
+      agent.id(),
+      agent,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent.resources(),
+      {});
+
+  const FrameworkInfo framework1 = createFrameworkInfo({"role1"});
+  allocator->addFramework(framework1.id(), framework1, {}, true, {});
+
+  Allocation expected = Allocation(
+      framework1.id(),
+      {{"role1", {{agent.id(), agent.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected, allocations.get());
+
+  // Decline the agent's resources for the rest of the test. The next
+  // allocation cycle caches the views without allocating anything.
+  Filters offerFilter;
+  offerFilter.set_refuse_seconds((flags.allocation_interval * 100).secs());
+
+  allocator->recoverResources(
+      framework1.id(),
+      agent.id(),
+      expected.resources.at("role1").at(agent.id()),
+      offerFilter);
+
+  Clock::advance(flags.allocation_interval);
+  Clock::settle();
+
+  Future<Allocation> allocation = allocations.get();
+  EXPECT_TRUE(allocation.isPending());
+
+  // Reserve one of the cpus for `role2`. A framework in `role2` is
+  // offered the reservation along with the unreserved resources.
+  const Resources unreserved = Resources::parse("cpus:1;mem:1024").get();
+  const Resources reserved = Resources::parse("cpus:1").get()
+    .pushReservation(createDynamicReservationInfo("role2", "ops"));
+
+  AWAIT_READY(allocator->updateAvailable(agent.id(), {RESERVE(reserved)}));
+
+  const FrameworkInfo framework2 = createFrameworkInfo({"role2"});
+  allocator->addFramework(framework2.id(), framework2, {}, true, {});
+
+  const Allocation expected1 = Allocation(
+      framework2.id(),
+      {{"role2", {{agent.id(), unreserved + reserved}}}});
+
+  AWAIT_EXPECT_EQ(expected1, allocation);
+
+  // Increase the agent's total. Only the added resources are offered.
+  const Resources addedResources = Resources::parse("cpus:2").get();
+
+  allocator->updateSlave(
+      agent.id(),
+      agent,
+      unreserved + reserved + addedResources);
+
+  const Allocation expected2 = Allocation(
+      framework2.id(),
+      {{"role2", {{agent.id(), addedResources}}}});
+
+  AWAIT_EXPECT_EQ(expected2, allocations.get());
+
+  // Recover the first allocation of `framework2`, which is offered
+  // again in the next allocation cycle.
+  allocator->recoverResources(
+      framework2.id(),
+      agent.id(),
+      expected1.resources.at("role2").at(agent.id()),
+      None());
+
+  Clock::advance(flags.allocation_interval);
+
+  AWAIT_EXPECT_EQ(expected1, allocations.get());
+
+  // Remove the agent and add it back with fewer resources. Only the
+  // resources of the new agent are offered.
+  allocator->removeSlave(agent.id());
+
+  SlaveInfo agent2 = agent;
+  agent2.mutable_resources()->CopyFrom(
+      Resources::parse("cpus:1;mem:512").get());
+
+  allocator->addSlave(
+      agent2.id(),
+      agent2,
+      AGENT_CAPABILITIES(),
+      None(),
+      agent2.resources(),
+      {});
+
+  const Allocation expected3 = Allocation(
+      framework2.id(),
+      {{"role2", {{agent2.id(), agent2.resources()}}}});
+
+  AWAIT_EXPECT_EQ(expected3, allocations.get());
+}
+
+
 class HierarchicalAllocator_BENCHMARK_Test
   : public HierarchicalAllocatorTestBase,
     public WithParamInterface<std::tuple<size_t, size_t>> {};
@@ -6505,6 +6864,126 @@ TEST_P(HierarchicalAllocator_BENCHMARK_Test, DeclineOffers)
 }
 
 
+// This benchmark measures the allocation cycles when the agents have
+// no allocatable resources left, which is when the allocator reuses
+// the views of their available resources across cycles. The cycles
+// are measured both when the agents are unchanged and after all of
+// them were updated, which requires computing the views again.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, CachedAvailableResources)
+{
+  size_t slaveCount = std::get<0>(GetParam());
+  size_t frameworkCount = std::get<1>(GetParam());
+
+  // Pause the clock because we want to manually drive the allocations.
+  Clock::pause();
+
+  atomic<size_t> offerCallbacks(0);
+
+  auto offerCallback = [&offerCallbacks](
+      const FrameworkID& frameworkId,
+      const hashmap<string, hashmap<SlaveID, Resources>>& resources) {
+    offerCallbacks++;
+  };
+
+  cout << "Using " << slaveCount << " agents and "
+       << frameworkCount << " frameworks" << endl;
+
+  vector<SlaveInfo> slaves;
+  slaves.reserve(slaveCount);
+
+  vector<FrameworkInfo> frameworks;
+  frameworks.reserve(frameworkCount);
+
+  initialize(master::Flags(), offerCallback);
+
+  for (size_t i = 0; i < frameworkCount; i++) {
+    frameworks.push_back(createFrameworkInfo({"*"}));
+    allocator->addFramework(frameworks[i].id(), frameworks[i], {}, true, {});
+  }
+
+  const Resources agentResources = Resources::parse(
+      "cpus:24;mem:4096;disk:4096;ports:[31000-32000]").get();
+
+  // All the cpus and memory of each agent are allocated to a single
+  // framework, which leaves no allocatable resources on the agent.
+  // We round-robin through the frameworks when allocating.
+  Resources allocation = Resources::parse("cpus:24;mem:4096").get();
+  allocation.allocate("*");
+
+  for (size_t i = 0; i < slaveCount; i++) {
+    slaves.push_back(createSlaveInfo(agentResources));
+
+    hashmap<FrameworkID, Resources> used = {
+      {frameworks[i % frameworkCount].id(), allocation}
+    };
+
+    allocator->addSlave(
+        slaves[i].id(),
+        slaves[i],
+        AGENT_CAPABILITIES(),
+        None(),
+        slaves[i].resources(),
+        used);
+  }
+
+  // Wait for all the `addSlave` operations to be processed.
+  Clock::settle();
+
+  Stopwatch watch;
+
+  for (size_t i = 0; i < 5; i++) {
+    offerCallbacks = 0;
+
+    watch.start();
+
+    // Advance the clock and trigger a background allocation cycle.
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+
+    watch.stop();
+
+    cout << "round " << i
+         << " allocate() took " << watch.elapsed()
+         << " to make " << offerCallbacks.load() << " offers"
+         << " with unchanged agents" << endl;
+  }
+
+  // Reserving and unreserving some of the disk changes the agent's
+  // resources without triggering an allocation.
+  const Resources reserved = Resources::parse("disk:1024").get()
+    .pushReservation(createDynamicReservationInfo("role1", "ops"));
+
+  for (size_t i = 0; i < 5; i++) {
+    const Offer::Operation operation =
+      i % 2 == 0 ? RESERVE(reserved) : UNRESERVE(reserved);
+
+    foreach (const SlaveInfo& slave, slaves) {
+      allocator->updateAvailable(slave.id(), {operation});
+    }
+
+    // Wait for all the `updateAvailable` operations to be processed.
+    Clock::settle();
+
+    offerCallbacks = 0;
+
+    watch.start();
+
+    // Advance the clock and trigger a background allocation cycle.
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+
+    watch.stop();
+
+    cout << "round " << i
+         << " allocate() took " << watch.elapsed()
+         << " to make " << offerCallbacks.load() << " offers"
+         << " after updating all agents" << endl;
+  }
+
+  Clock::resume();
+}
+
+
 // Returns the requested number of labels:
 //   [{"<key>_1": "<value>_1"}, ..., {"<key>_<count>":"<value>_<count>"}]
 static Labels createLabels(
@@ -7090,6 +7569,94 @@ TEST_P(HierarchicalAllocator_BENCHMARK_Test, Metrics)
 }
 
 
+// This benchmark measures the allocation cycle time when many roles have
+// quota set and hold allocations across the cluster. Each framework is
+// subscribed to its own quota'ed role.
+TEST_P(HierarchicalAllocator_BENCHMARK_Test, ManyQuotaRoles)
+{
+  size_t slaveCount = std::get<0>(GetParam());
+  size_t frameworkCount = std::get<1>(GetParam());
+
+  // Pause the clock because we want to manually drive the allocations.
+  Clock::pause();
+
+  initialize();
+
+  vector<FrameworkInfo> frameworks;
+  frameworks.reserve(frameworkCount);
+
+  for (size_t i = 0; i < frameworkCount; i++) {
+    string role = stringify(i);
+    allocator->setQuota(role, createQuota(role, "cpus:1;mem:512"));
+
+    frameworks.push_back(createFrameworkInfo({role}));
+    allocator->addFramework(
+        frameworks.back().id(), frameworks.back(), {}, true, {});
+  }
+
+  // Wait for all the `setQuota` and `addFramework` operations
+  // to be processed.
+  Clock::settle();
+
+  cout << "Using " << slaveCount << " agents and "
+       << frameworkCount << " quota'ed roles" << endl;
+
+  const Resources agentResources = Resources::parse(
+      "cpus:16;mem:2048;disk:1024").get();
+
+  const Resources used = Resources::parse("cpus:1;mem:128").get();
+
+  Stopwatch watch;
+  watch.start();
+
+  // Each agent has a portion of its resources allocated to one of the
+  // frameworks. We round-robin through the frameworks when allocating.
+  for (size_t i = 0; i < slaveCount; i++) {
+    SlaveInfo slave = createSlaveInfo(agentResources);
+
+    const FrameworkInfo& framework = frameworks.at(i % frameworkCount);
+
+    allocator->addSlave(
+        slave.id(),
+        slave,
+        AGENT_CAPABILITIES(),
+        None(),
+        slave.resources(),
+        {{framework.id(),
+          allocatedResources(used, framework.roles(0))}});
+  }
+
+  // Wait for all the `addSlave` operations to be processed.
+  Clock::settle();
+
+  watch.stop();
+
+  cout << "Added " << slaveCount << " agents in "
+       << watch.elapsed() << endl;
+
+  // Measure the allocation cycles. All resources have been offered by
+  // now, but each cycle still computes the quota headroom.
+  const size_t allocationsCount = 5;
+  Duration totalTime;
+
+  for (size_t count = 0; count < allocationsCount; count++) {
+    watch.start();
+
+    // Advance the clock and trigger a batch allocation.
+    Clock::advance(flags.allocation_interval);
+    Clock::settle();
+
+    watch.stop();
+
+    cout << "allocate() took " << watch.elapsed() << endl;
+
+    totalTime += watch.elapsed();
+  }
+
+  cout << "Average allocate() took " << totalTime / allocationsCount << endl;
+}
+
+
 // Tests that the `updateSlave()` function correctly removes all filters
 // for the specified slave when slave attributes are changed on restart.
 TEST_F(HierarchicalAllocatorTest, RemoveFilters)
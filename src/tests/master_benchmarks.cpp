@@ -25,6 +25,7 @@
 #include <process/clock.hpp>
 #include <process/collect.hpp>
 #include <process/future.hpp>
+#include <process/loop.hpp>
 #include <process/pid.hpp>
 #include <process/process.hpp>
 #include <process/protobuf.hpp>
@@ -32,13 +33,17 @@
 #include <stout/stopwatch.hpp>
 
 #include "common/protobuf_utils.hpp"
+#include "common/recordio.hpp"
 
 #include "tests/mesos.hpp"
 
 namespace http = process::http;
 
 using process::await;
+using process::Break;
 using process::Clock;
+using process::Continue;
+using process::ControlFlow;
 using process::Failure;
 using process::Future;
 using process::Owned;
@@ -484,6 +489,154 @@ TEST_P(MasterStateQuery_BENCHMARK_Test, GetState)
 }
 
 
+class MasterEventStream_BENCHMARK_Test
+  : public MesosTest,
+    public WithParamInterface<tuple<size_t, size_t>> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    SubscriberAndAgentCount,
+    MasterEventStream_BENCHMARK_Test,
+    ::testing::Values(
+        make_tuple(1, 1000),
+        make_tuple(10, 1000),
+        make_tuple(50, 1000),
+        make_tuple(10, 10000)));
+
+
+// This test measures the event throughput of the master's 'api/v1'
+// event stream. Artificial agents are registered with the master and
+// we measure the time it takes until every subscriber has received an
+// `AGENT_ADDED` event for each agent. Since events are filtered and
+// serialized by a separate actor for each subscriber, the throughput
+// is expected to scale with the number of cores, which can be varied
+// by setting `LIBPROCESS_NUM_WORKER_THREADS`.
+TEST_P(MasterEventStream_BENCHMARK_Test, AgentAdded)
+{
+  size_t subscriberCount;
+  size_t agentCount;
+
+  tie(subscriberCount, agentCount) = GetParam();
+
+  // Disable authentication to avoid the overhead, since we don't care about
+  // it in this test.
+  master::Flags masterFlags = CreateMasterFlags();
+  masterFlags.authenticate_agents = false;
+
+  Try<Owned<cluster::Master>> master = StartMaster(masterFlags);
+  ASSERT_SOME(master);
+
+  const ContentType contentType = ContentType::PROTOBUF;
+
+  v1::master::Call v1Call;
+  v1Call.set_type(v1::master::Call::SUBSCRIBE);
+
+  http::Headers headers = createBasicAuthHeaders(DEFAULT_CREDENTIAL);
+  headers["Accept"] = stringify(contentType);
+
+  auto deserializer =
+    lambda::bind(deserialize<v1::master::Event>, contentType, lambda::_1);
+
+  vector<http::Pipe::Reader> readers;
+  vector<Owned<recordio::Reader<v1::master::Event>>> decoders;
+
+  for (size_t i = 0; i < subscriberCount; i++) {
+    Future<http::Response> response = http::streaming::post(
+        master.get()->pid,
+        "api/v1",
+        headers,
+        serialize(contentType, v1Call),
+        stringify(contentType));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::OK().status, response);
+    ASSERT_EQ(http::Response::PIPE, response->type);
+    ASSERT_SOME(response->reader);
+
+    readers.push_back(response->reader.get());
+    decoders.push_back(Owned<recordio::Reader<v1::master::Event>>(
+        new recordio::Reader<v1::master::Event>(
+            ::recordio::Decoder<v1::master::Event>(deserializer),
+            response->reader.get())));
+
+    Future<Result<v1::master::Event>> event = decoders.back()->read();
+    AWAIT_READY(event);
+    ASSERT_SOME(event.get());
+    ASSERT_EQ(v1::master::Event::SUBSCRIBED, event->get().type());
+  }
+
+  vector<Owned<TestSlave>> slaves;
+
+  for (size_t i = 0; i < agentCount; i++) {
+    SlaveID slaveId;
+    slaveId.set_value("agent" + stringify(i));
+
+    slaves.push_back(Owned<TestSlave>(
+        new TestSlave(master.get()->pid, slaveId, 0, 0, 0, 0)));
+  }
+
+  cout << "Test setup: " << subscriberCount << " subscribers and "
+       << agentCount << " agents" << endl;
+
+  Stopwatch watch;
+  watch.start();
+
+  list<Future<Nothing>> reregistered;
+
+  foreach (const Owned<TestSlave>& slave, slaves) {
+    reregistered.push_back(slave->reregister());
+  }
+
+  list<Future<Nothing>> received;
+
+  foreach (const Owned<recordio::Reader<v1::master::Event>>& decoder,
+           decoders) {
+    std::shared_ptr<size_t> count(new size_t(0));
+
+    received.push_back(process::loop(
+        None(),
+        [=]() {
+          return decoder->read();
+        },
+        [=](const Result<v1::master::Event>& event)
+            -> Future<ControlFlow<Nothing>> {
+          if (event.isNone()) {
+            return Failure("Unexpected end of the event stream");
+          }
+
+          if (event.isError()) {
+            return Failure(event.error());
+          }
+
+          if (event->type() == v1::master::Event::AGENT_ADDED &&
+              ++(*count) == agentCount) {
+            return Break();
+          }
+
+          return Continue();
+        }));
+  }
+
+  // Wait for all agents to finish reregistration and for all the
+  // subscribers to receive the corresponding events.
+  await(reregistered).await();
+  await(received).await();
+
+  watch.stop();
+
+  foreach (const Future<Nothing>& future, received) {
+    ASSERT_TRUE(future.isReady());
+  }
+
+  cout << "Delivered " << agentCount * subscriberCount
+       << " 'AGENT_ADDED' events to " << subscriberCount
+       << " subscribers in " << watch.elapsed() << endl;
+
+  foreach (http::Pipe::Reader& reader, readers) {
+    reader.close();
+  }
+}
+
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
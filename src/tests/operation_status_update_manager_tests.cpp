@@ -14,13 +14,17 @@
 // See the License for the specific language governing permissions and
 // limitations under the License.
 
+#include <list>
+#include <map>
 #include <string>
+#include <vector>
 
 #include <gtest/gtest.h>
 
 #include <mesos/v1/mesos.hpp>
 
 #include <process/clock.hpp>
+#include <process/collect.hpp>
 #include <process/future.hpp>
 #include <process/gmock.hpp>
 #include <process/owned.hpp>
@@ -29,6 +33,7 @@
 #include <stout/os.hpp>
 #include <stout/path.hpp>
 #include <stout/protobuf.hpp>
+#include <stout/stopwatch.hpp>
 #include <stout/uuid.hpp>
 
 #include <stout/os/ftruncate.hpp>
@@ -38,16 +43,26 @@
 #include "tests/mesos.hpp"
 #include "tests/utils.hpp"
 
+#include "status_update_manager/checkpoint_writer.hpp"
 #include "status_update_manager/operation.hpp"
 
 using lambda::function;
 
 using process::Clock;
+using process::collect;
 using process::Future;
 using process::Owned;
 using process::Promise;
 
+using std::cout;
+using std::endl;
+using std::list;
+using std::map;
 using std::string;
+using std::vector;
+
+using testing::Values;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -903,6 +918,138 @@ TEST_F(OperationStatusUpdateManagerTest, UpdateLatestWhenResending)
   AWAIT_EXPECT_EQ(expectedStatusUpdate, forwardedStatusUpdate3);
 }
 
+
+class CheckpointWriterTest : public TemporaryDirectoryTest {};
+
+
+// This test verifies that once a file whose writes failed is closed
+// through the checkpoint writer, writes to a new file that reuses its
+// file descriptor succeed.
+TEST_F(CheckpointWriterTest, CloseForgetsFailedFile)
+{
+  CheckpointWriterProcess writer;
+  process::spawn(writer);
+
+  const string failed = path::join(os::getcwd(), "failed");
+  ASSERT_SOME(os::touch(failed));
+
+  // Writes to a file opened for reading fail.
+  Try<int_fd> fd = os::open(failed, O_RDONLY | O_CLOEXEC);
+  ASSERT_SOME(fd);
+
+  AWAIT_FAILED(process::dispatch(
+      writer, &CheckpointWriterProcess::write, fd.get(), failed, "data"));
+
+  process::dispatch(writer, &CheckpointWriterProcess::close, fd.get(), failed);
+
+  // The file is closed by the writer at this point.
+  process::Future<Nothing> flushed =
+    process::dispatch(writer, []() { return Nothing(); });
+  AWAIT_READY(flushed);
+
+  const string reused = path::join(os::getcwd(), "reused");
+
+  Try<int_fd> reusedFd = os::open(
+      reused,
+      O_CREAT | O_WRONLY | O_CLOEXEC,
+      S_IRUSR | S_IWUSR);
+
+  ASSERT_SOME(reusedFd);
+  ASSERT_EQ(fd.get(), reusedFd.get());
+
+  AWAIT_READY(process::dispatch(
+      writer, &CheckpointWriterProcess::write, reusedFd.get(), reused, "data"));
+
+  process::dispatch(
+      writer, &CheckpointWriterProcess::close, reusedFd.get(), reused);
+
+  process::terminate(writer, false);
+  process::wait(writer);
+
+  EXPECT_SOME_EQ("data", os::read(reused));
+}
+
+
+class OperationStatusUpdateManager_BENCHMARK_Test
+  : public OperationStatusUpdateManagerTest,
+    public WithParamInterface<size_t> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    Streams,
+    OperationStatusUpdateManager_BENCHMARK_Test,
+    Values(1U, 10U, 100U, 1000U));
+
+
+// Measures the throughput of checkpointed status updates as the number of
+// streams being updated concurrently grows, both on the filesystem of the
+// test sandbox and on a tmpfs (when `/dev/shm` is available).
+TEST_P(OperationStatusUpdateManager_BENCHMARK_Test, CheckpointedUpdates)
+{
+  const size_t streams = GetParam();
+  const size_t updatesPerStream = 10;
+
+  map<string, string> directories;
+  directories["sandbox"] = os::getcwd();
+
+  Option<string> tmpfs;
+  if (os::exists("/dev/shm")) {
+    Try<string> directory = os::mkdtemp("/dev/shm/XXXXXX");
+    ASSERT_SOME(directory);
+
+    tmpfs = directory.get();
+    directories["tmpfs"] = tmpfs.get();
+  }
+
+  vector<id::UUID> operationUuids;
+  for (size_t i = 0; i < streams; i++) {
+    operationUuids.push_back(id::UUID::random());
+  }
+
+  foreachpair (const string& name, const string& directory, directories) {
+    OperationStatusUpdateManager manager;
+
+    manager.initialize(
+        [](const UpdateOperationStatusMessage&) {},
+        [directory](const id::UUID& operationUuid) {
+          return path::join(directory, "streams", operationUuid.toString());
+        });
+
+    // Interleave the streams so that concurrent updates hit different files.
+    vector<UpdateOperationStatusMessage> updates;
+    for (size_t i = 0; i < updatesPerStream; i++) {
+      foreach (const id::UUID& operationUuid, operationUuids) {
+        updates.push_back(createUpdateOperationStatusMessage(
+            id::UUID::random(),
+            operationUuid,
+            OperationState::OPERATION_PENDING));
+      }
+    }
+
+    Stopwatch watch;
+    watch.start();
+
+    list<Future<Nothing>> futures;
+    foreach (const UpdateOperationStatusMessage& update, updates) {
+      futures.push_back(manager.update(update, true));
+    }
+
+    AWAIT_READY_FOR(collect(futures), Minutes(5));
+
+    watch.stop();
+
+    cout << "Checkpointed " << updates.size() << " updates across "
+         << streams << " streams on the " << name << " in "
+         << watch.elapsed() << " ("
+         << updates.size() / watch.elapsed().secs() << " updates/sec)"
+         << endl;
+  }
+
+  if (tmpfs.isSome()) {
+    ASSERT_SOME(os::rmdir(tmpfs.get()));
+  }
+}
+
 } // namespace tests {
 } // namespace internal {
 } // namespace mesos {
@@ -1139,6 +1139,23 @@ TEST_F(ExecutorAuthorizationTest, FailedApiCalls)
     AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::Forbidden().status, response);
   }
 
+  {
+    v1::agent::Call call;
+    call.set_type(v1::agent::Call::WAIT_CONTAINERS);
+
+    call.mutable_wait_containers()->add_container_ids()
+      ->CopyFrom(containerId);
+
+    Future<http::Response> response = http::post(
+      slave.get()->pid,
+      "api/v1",
+      headers,
+      serialize(ContentType::PROTOBUF, call),
+      stringify(ContentType::PROTOBUF));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(http::Forbidden().status, response);
+  }
+
   {
     v1::agent::Call call;
     call.set_type(v1::agent::Call::KILL_NESTED_CONTAINER);
@@ -40,12 +40,15 @@
 #include <process/owned.hpp>
 #include <process/reap.hpp>
 
+#include <stout/fs.hpp>
 #include <stout/hashset.hpp>
 #include <stout/none.hpp>
 #include <stout/numify.hpp>
 #include <stout/option.hpp>
 #include <stout/os.hpp>
 #include <stout/path.hpp>
+#include <stout/stopwatch.hpp>
+#include <stout/stringify.hpp>
 #include <stout/uuid.hpp>
 
 #include <stout/os/killtree.hpp>
@@ -60,6 +63,7 @@
 
 #include "slave/gc.hpp"
 #include "slave/gc_process.hpp"
+#include "slave/journal.hpp"
 #include "slave/paths.hpp"
 #include "slave/slave.hpp"
 #include "slave/state.hpp"
@@ -94,7 +98,10 @@ using mesos::slave::ContainerTermination;
 
 using mesos::v1::executor::Call;
 
+using std::cout;
+using std::endl;
 using std::map;
+using std::shared_ptr;
 using std::string;
 using std::vector;
 
@@ -104,6 +111,8 @@ using testing::DoAll;
 using testing::Eq;
 using testing::Return;
 using testing::SaveArg;
+using testing::Values;
+using testing::WithParamInterface;
 
 namespace mesos {
 namespace internal {
@@ -156,6 +165,238 @@ TEST_F(SlaveStateTest, CheckpointRepeatedProtobufMessages)
 }
 
 
+// This test verifies that checkpoints covered by the checkpoint journal
+// are recorded in it, survive a torn record at the end of the journal,
+// and are written back to their own files when the journal is expanded.
+TEST_F(SlaveStateTest, CheckpointJournal)
+{
+  const string metaDir = paths::getMetaRootDir(os::getcwd());
+  const string journalPath = paths::getCheckpointJournalPath(metaDir);
+
+  Try<shared_ptr<slave::state::Journal>> open =
+    slave::state::Journal::open(metaDir);
+
+  ASSERT_SOME(open);
+
+  shared_ptr<slave::state::Journal> journal = open.get();
+  slave::state::Journal::install(journal);
+
+  SlaveID slaveId;
+  slaveId.set_value("agent1");
+
+  SlaveInfo expected;
+  expected.mutable_id()->CopyFrom(slaveId);
+  expected.set_hostname("localhost");
+
+  const string path = paths::getSlaveInfoPath(metaDir, slaveId);
+  ASSERT_SOME(slave::state::checkpoint(path, expected));
+
+  // The agent info is recorded in the journal instead of its own file.
+  EXPECT_FALSE(os::exists(path));
+  EXPECT_TRUE(slave::state::exists(path));
+  EXPECT_SOME_EQ(expected, slave::state::read<SlaveInfo>(path));
+
+  // Checkpoints which are not covered by the journal still get a file.
+  const string bootIdPath = paths::getBootIdPath(metaDir);
+  ASSERT_SOME(slave::state::checkpoint(bootIdPath, string("boot")));
+  EXPECT_TRUE(os::exists(bootIdPath));
+
+  slave::state::Journal::uninstall(journal);
+  journal.reset();
+
+  // Simulate a crash in the middle of appending a record.
+  Try<int_fd> fd = os::open(journalPath, O_WRONLY | O_APPEND | O_CLOEXEC);
+  ASSERT_SOME(fd);
+  ASSERT_SOME(os::write(fd.get(), "torn"));
+  ASSERT_SOME(os::close(fd.get()));
+
+  open = slave::state::Journal::open(metaDir);
+  ASSERT_SOME(open);
+
+  journal = open.get();
+  slave::state::Journal::install(journal);
+
+  EXPECT_SOME_EQ(expected, slave::state::read<SlaveInfo>(path));
+
+  slave::state::Journal::uninstall(journal);
+  journal.reset();
+
+  // Disabling the journal writes the checkpoints back to their files.
+  ASSERT_SOME(slave::state::Journal::expand(metaDir));
+
+  EXPECT_FALSE(os::exists(journalPath));
+  EXPECT_SOME_EQ(expected, ::protobuf::read<SlaveInfo>(path));
+}
+
+
+// This test verifies that the checkpoint journal forgets the
+// checkpoints of removed directories.
+TEST_F(SlaveStateTest, CheckpointJournalRemove)
+{
+  const string metaDir = paths::getMetaRootDir(os::getcwd());
+
+  Try<shared_ptr<slave::state::Journal>> open =
+    slave::state::Journal::open(metaDir);
+
+  ASSERT_SOME(open);
+
+  shared_ptr<slave::state::Journal> journal = open.get();
+  slave::state::Journal::install(journal);
+
+  SlaveID slaveId;
+  slaveId.set_value("agent1");
+
+  FrameworkID frameworkId;
+  frameworkId.set_value("framework1");
+
+  FrameworkID otherFrameworkId;
+  otherFrameworkId.set_value("framework10");
+
+  FrameworkInfo frameworkInfo;
+  frameworkInfo.set_user("user");
+  frameworkInfo.set_name("framework");
+
+  const string path =
+    paths::getFrameworkInfoPath(metaDir, slaveId, frameworkId);
+
+  const string otherPath =
+    paths::getFrameworkInfoPath(metaDir, slaveId, otherFrameworkId);
+
+  ASSERT_SOME(slave::state::checkpoint(path, frameworkInfo));
+  ASSERT_SOME(slave::state::checkpoint(otherPath, frameworkInfo));
+
+  const string directory =
+    paths::getFrameworkPath(metaDir, slaveId, frameworkId);
+
+  ASSERT_SOME(os::rmdir(directory));
+  journal->remove(directory);
+
+  EXPECT_NONE(journal->read(path));
+  EXPECT_FALSE(slave::state::exists(path));
+
+  // Only the checkpoints beneath the removed directory are forgotten.
+  EXPECT_SOME_EQ(
+      frameworkInfo,
+      slave::state::read<FrameworkInfo>(otherPath));
+
+  slave::state::Journal::uninstall(journal);
+}
+
+
+class SlaveStateRecovery_BENCHMARK_Test
+  : public TemporaryDirectoryTest,
+    public WithParamInterface<size_t> {};
+
+
+INSTANTIATE_TEST_CASE_P(
+    Executors,
+    SlaveStateRecovery_BENCHMARK_Test,
+    Values(100U, 1000U, 5000U));
+
+
+// Measures how long it takes to read back the checkpointed state of
+// an agent running many executors, which bounds how quickly the agent
+// can start re-registering its containers after a restart.
+TEST_P(SlaveStateRecovery_BENCHMARK_Test, Recover)
+{
+  const size_t executors = GetParam();
+  const string rootDir = paths::getMetaRootDir(os::getcwd());
+
+  SlaveID slaveId;
+  slaveId.set_value("agent");
+
+  SlaveInfo slaveInfo;
+  slaveInfo.mutable_id()->CopyFrom(slaveId);
+  slaveInfo.set_hostname("localhost");
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getSlaveInfoPath(rootDir, slaveId), slaveInfo));
+
+  ASSERT_SOME(::fs::symlink(
+      paths::getSlavePath(rootDir, slaveId),
+      paths::getLatestSlavePath(rootDir)));
+
+  FrameworkInfo frameworkInfo = DEFAULT_FRAMEWORK_INFO;
+  frameworkInfo.mutable_id()->set_value("framework");
+
+  const FrameworkID& frameworkId = frameworkInfo.id();
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getFrameworkInfoPath(rootDir, slaveId, frameworkId),
+      frameworkInfo));
+
+  ASSERT_SOME(slave::state::checkpoint(
+      paths::getFrameworkPidPath(rootDir, slaveId, frameworkId),
+      string("scheduler@127.0.0.1:5050")));
+
+  for (size_t i = 0; i < executors; i++) {
+    ExecutorInfo executorInfo = DEFAULT_EXECUTOR_INFO;
+    executorInfo.mutable_executor_id()->set_value("executor-" + stringify(i));
+    executorInfo.mutable_framework_id()->CopyFrom(frameworkId);
+
+    const ExecutorID& executorId = executorInfo.executor_id();
+
+    ContainerID containerId;
+    containerId.set_value(id::UUID::random().toString());
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getExecutorInfoPath(rootDir, slaveId, frameworkId, executorId),
+        executorInfo));
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getForkedPidPath(
+            rootDir, slaveId, frameworkId, executorId, containerId),
+        stringify(1000 + i)));
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getLibprocessPidPath(
+            rootDir, slaveId, frameworkId, executorId, containerId),
+        "executor@127.0.0.1:" + stringify(10000 + i)));
+
+    ASSERT_SOME(::fs::symlink(
+        paths::getExecutorRunPath(
+            rootDir, slaveId, frameworkId, executorId, containerId),
+        paths::getExecutorLatestRunPath(
+            rootDir, slaveId, frameworkId, executorId)));
+
+    Task task;
+    task.set_name("task");
+    task.mutable_task_id()->set_value("task-" + stringify(i));
+    task.mutable_framework_id()->CopyFrom(frameworkId);
+    task.mutable_executor_id()->CopyFrom(executorId);
+    task.mutable_slave_id()->CopyFrom(slaveId);
+    task.set_state(TASK_RUNNING);
+
+    ASSERT_SOME(slave::state::checkpoint(
+        paths::getTaskInfoPath(
+            rootDir,
+            slaveId,
+            frameworkId,
+            executorId,
+            containerId,
+            task.task_id()),
+        task));
+  }
+
+  Stopwatch watch;
+  watch.start();
+
+  Try<slave::state::State> state = slave::state::recover(rootDir, true);
+
+  watch.stop();
+
+  ASSERT_SOME(state);
+  ASSERT_SOME(state->slave);
+  ASSERT_TRUE(state->slave->frameworks.contains(frameworkId));
+  EXPECT_EQ(
+      executors,
+      state->slave->frameworks.at(frameworkId).executors.size());
+
+  cout << "Recovered the state of " << executors << " executors in "
+       << watch.elapsed() << endl;
+}
+
+
 template <typename T>
 class SlaveRecoveryTest : public ContainerizerTest<T>
 {
@@ -647,26 +888,22 @@ TYPED_TEST(SlaveRecoveryTest, DISABLED_ROOT_CGROUPS_ReconnectDefaultExecutor)
   Future<v1::executor::Call> updateCall2 =
     DROP_HTTP_CALL(Call(), Call::UPDATE, _, ContentType::PROTOBUF);
 
-  Future<v1::agent::Call> waitCall1 = FUTURE_HTTP_CALL(
-      v1::agent::Call(),
-      v1::agent::Call::WAIT_NESTED_CONTAINER,
-      _,
-      ContentType::PROTOBUF);
-
-  Future<v1::agent::Call> waitCall2 = FUTURE_HTTP_CALL(
+  // The default executor waits on both child containers with one call.
+  Future<v1::agent::Call> waitCall = FUTURE_HTTP_CALL(
       v1::agent::Call(),
-      v1::agent::Call::WAIT_NESTED_CONTAINER,
+      v1::agent::Call::WAIT_CONTAINERS,
       _,
       ContentType::PROTOBUF);
 
   // Stop the agent after dropping the update calls and upon receiving the
-  // wait calls. We can't drop the wait calls as doing so results in a
+  // wait call. We can't drop the wait call as doing so results in a
   // '500 Interval Server Error' for the default executor leading to it
   // failing fast.
   AWAIT_READY(updateCall1);
   AWAIT_READY(updateCall2);
-  AWAIT_READY(waitCall1);
-  AWAIT_READY(waitCall2);
+  AWAIT_READY(waitCall);
+
+  EXPECT_EQ(2, waitCall->wait_containers().container_ids().size());
 
   slave.get()->terminate();
 
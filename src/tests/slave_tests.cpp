@@ -2361,6 +2361,121 @@ TEST_F(SlaveTest, StatisticsEndpointMissingStatistics)
 }
 
 
+// This test verifies that the consumers of the resource usage share
+// the latest sample while it is younger than the sampling interval.
+TEST_F(SlaveTest, StatisticsEndpointSharedUsageSample)
+{
+  Try<Owned<cluster::Master>> master = StartMaster();
+  ASSERT_SOME(master);
+
+  MockExecutor exec(DEFAULT_EXECUTOR_ID);
+  TestContainerizer containerizer(&exec);
+  StandaloneMasterDetector detector(master.get()->pid);
+
+  slave::Flags flags = CreateSlaveFlags();
+  flags.usage_sampling_interval = Seconds(1);
+
+  Try<Owned<cluster::Slave>> slave = StartSlave(
+      &detector,
+      &containerizer,
+      flags);
+
+  ASSERT_SOME(slave);
+
+  MockScheduler sched;
+  MesosSchedulerDriver driver(
+      &sched, DEFAULT_FRAMEWORK_INFO, master.get()->pid, DEFAULT_CREDENTIAL);
+
+  EXPECT_CALL(sched, registered(_, _, _));
+  EXPECT_CALL(exec, registered(_, _, _, _));
+
+  Future<vector<Offer>> offers;
+
+  EXPECT_CALL(sched, resourceOffers(&driver, _))
+    .WillOnce(FutureArg<1>(&offers))
+    .WillRepeatedly(Return()); // Ignore subsequent offers.
+
+  driver.start();
+
+  AWAIT_READY(offers);
+  ASSERT_FALSE(offers->empty());
+
+  const Offer& offer = offers.get()[0];
+
+  TaskInfo task = createTask(
+      offer.slave_id(),
+      Resources::parse("cpus:0.1;mem:32").get(),
+      SLEEP_COMMAND(1000),
+      exec.id);
+
+  EXPECT_CALL(exec, launchTask(_, _))
+    .WillOnce(SendStatusUpdateFromTask(TASK_RUNNING));
+
+  Future<TaskStatus> status;
+  EXPECT_CALL(sched, statusUpdate(&driver, _))
+    .WillOnce(FutureArg<1>(&status));
+
+  driver.launchTasks(offer.id(), {task});
+
+  AWAIT_READY(status);
+  EXPECT_EQ(TASK_RUNNING, status->state());
+
+  ResourceStatistics statistics;
+  statistics.set_timestamp(1);
+  statistics.set_cpus_limit(0.1);
+
+  // Trigger the next periodic sample, which is then shared by all the
+  // consumers as the clock is paused. The statistics are only
+  // collected once from the containerizer.
+  Clock::pause();
+  Clock::settle();
+
+  EXPECT_CALL(containerizer, usage(_))
+    .WillOnce(Return(statistics));
+
+  Clock::advance(flags.usage_sampling_interval);
+  Clock::settle();
+
+  for (int i = 0; i < 2; i++) {
+    Future<Response> response = process::http::get(
+        slave.get()->pid,
+        "monitor/statistics",
+        None(),
+        createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+    AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+    Try<JSON::Array> parse = JSON::parse<JSON::Array>(response->body);
+    ASSERT_SOME(parse);
+    ASSERT_EQ(1u, parse->values.size());
+
+    Result<JSON::Number> cpusLimit =
+      parse->values[0].as<JSON::Object>().find<JSON::Number>(
+          "statistics.cpus_limit");
+
+    ASSERT_SOME(cpusLimit);
+    EXPECT_DOUBLE_EQ(0.1, cpusLimit->as<double>());
+  }
+
+  // The '/containers' endpoint shares the sample as well.
+  Future<Response> response = process::http::get(
+      slave.get()->pid,
+      "containers",
+      None(),
+      createBasicAuthHeaders(DEFAULT_CREDENTIAL));
+
+  AWAIT_EXPECT_RESPONSE_STATUS_EQ(OK().status, response);
+
+  Clock::resume();
+
+  EXPECT_CALL(exec, shutdown(_))
+    .Times(AtMost(1));
+
+  driver.stop();
+  driver.join();
+}
+
+
 // This test verifies the correct response of /monitor/statistics endpoint
 // when ResourceUsage collection fails.
 TEST_F(SlaveTest, StatisticsEndpointGetResourceUsageFailed)
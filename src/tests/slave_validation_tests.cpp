@@ -365,6 +365,48 @@ TEST(AgentCallValidationTest, WaitNestedContainer)
 }
 
 
+TEST(AgentCallValidationTest, WaitContainers)
+{
+  // Missing `wait_containers`.
+  agent::Call call;
+  call.set_type(agent::Call::WAIT_CONTAINERS);
+
+  Option<Error> error = validation::agent::call::validate(call);
+  EXPECT_SOME(error);
+
+  // Expecting at least one `container_ids` entry.
+  agent::Call::WaitContainers* wait = call.mutable_wait_containers();
+
+  error = validation::agent::call::validate(call);
+  EXPECT_SOME(error);
+
+  // One of the `container_ids` is not valid.
+  ContainerID containerId;
+  containerId.set_value(id::UUID::random().toString());
+
+  ContainerID badContainerId;
+  badContainerId.set_value("no spaces allowed");
+
+  wait->add_container_ids()->CopyFrom(containerId);
+  wait->add_container_ids()->CopyFrom(badContainerId);
+
+  error = validation::agent::call::validate(call);
+  EXPECT_SOME(error);
+
+  // Test the valid case.
+  ContainerID nestedContainerId;
+  nestedContainerId.set_value(id::UUID::random().toString());
+  nestedContainerId.mutable_parent()->CopyFrom(containerId);
+
+  wait->clear_container_ids();
+  wait->add_container_ids()->CopyFrom(containerId);
+  wait->add_container_ids()->CopyFrom(nestedContainerId);
+
+  error = validation::agent::call::validate(call);
+  EXPECT_NONE(error);
+}
+
+
 TEST(AgentCallValidationTest, KillNestedContainer)
 {
   // Missing `kill_nested_container`.